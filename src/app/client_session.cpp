@@ -1,5 +1,9 @@
 #include "app/client_session.h"
 #include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/timing.h"
+#include "core/trace.h"
+#include "net/viewport.h"
 
 #if defined(LANCAST_PLATFORM_LINUX)
 #include "capture/mic_capture_pulse.h"
@@ -7,11 +11,19 @@
 #include "capture/mic_capture_wasapi.h"
 #endif
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 
 namespace lancast {
 
 static constexpr const char* TAG = "ClientSession";
+static constexpr auto OVERLAY_REFRESH = std::chrono::milliseconds(500);
+static constexpr auto PERF_REPORT_INTERVAL = std::chrono::seconds(5);
+static constexpr auto LOAD_REPORT_INTERVAL = std::chrono::seconds(1);
+static constexpr auto VIEWPORT_CHECK_INTERVAL = std::chrono::milliseconds(250);
+static constexpr auto VIEWPORT_RESEND_INTERVAL = std::chrono::seconds(2);  // Heals a lost VIEWPORT
+static constexpr double EWMA_ALPHA = 0.1;
 
 ClientSession::~ClientSession() {
     stop();
@@ -20,54 +32,54 @@ ClientSession::~ClientSession() {
 bool ClientSession::connect(const std::string& host_ip, uint16_t port) {
     LOG_INFO(TAG, "Connecting to %s:%u...", host_ip.c_str(), port);
 
-    if (!client_.connect(host_ip, port)) {
-        LOG_ERROR(TAG, "Failed to connect to server");
-        return false;
+    if (!packet_record_path_.empty() && !client_.start_recording(packet_record_path_)) {
+        LOG_WARN(TAG, "Packet recording disabled");
     }
 
-    const auto& config = client_.stream_config();
-    LOG_INFO(TAG, "Connected: stream %ux%u @ %u fps, codec_data %zu bytes",
-             config.width, config.height, config.fps, config.codec_data.size());
-
-    return true;
-}
-
-void ClientSession::run(std::atomic<bool>& running) {
-    running_ = &running;
-
-    const auto& config = client_.stream_config();
-
-    // Initialize decoder
-    decoder_ = std::make_unique<VideoDecoder>();
-    if (!decoder_->init(config.width, config.height, config.codec_data)) {
-        LOG_ERROR(TAG, "Failed to initialize video decoder");
-        return;
+    if (stream_ != 0) client_.subscribe(static_cast<uint16_t>(1u << stream_));
+
+    // The join mostly waits on the host (WELCOME, stream config, bandwidth
+    // probe), so setup that doesn't need the stream config runs meanwhile:
+    // SDL video on this (the main) thread, the mic on a helper
+    bool joined = false;
+    {
+        lancast::jthread join([&](lancast::stop_token) {
+            StartupTimeline::Scope phase(startup_, "join");
+            joined = client_.connect(host_ip, port);
+        });
+        lancast::jthread mic([this](lancast::stop_token) { init_mic(); });
+        StartupTimeline::Scope phase(startup_, "sdl_video");
+        renderer_.prepare();
     }
-
-    // Initialize audio decoder
-    audio_decoder_ = std::make_unique<AudioDecoder>();
-    if (!audio_decoder_->init(config.audio_sample_rate, config.audio_channels)) {
-        LOG_WARN(TAG, "Failed to initialize audio decoder — continuing without audio");
-        audio_decoder_.reset();
+    if (!joined) {
+        LOG_ERROR(TAG, "Failed to connect to server");
+        return false;
+    }
+    if (!xdp_interface_.empty()) {
+        StartupTimeline::Scope phase(startup_, "xdp");
+        client_.enable_xdp(xdp_interface_);
     }
 
-    // Initialize SDL renderer
-    if (!renderer_.init(config.width, config.height, "lancast - viewer")) {
-        LOG_ERROR(TAG, "Failed to initialize SDL renderer");
-        return;
+    if (stream_ == 0) {
+        const auto config = client_.stream_config();
+        LOG_INFO(TAG, "Connected: stream %ux%u @ %u fps, codec_data %zu bytes",
+                 config.width, config.height, config.fps, config.codec_data.size());
+        return true;
     }
 
-    // Initialize audio player
-    if (audio_decoder_) {
-        audio_player_ = std::make_unique<AudioPlayer>();
-        if (!audio_player_->init(config.audio_sample_rate, config.audio_channels)) {
-            LOG_WARN(TAG, "Failed to initialize audio player — continuing without audio");
-            audio_decoder_.reset();
-            audio_player_.reset();
-        }
+    // Its config arrives ahead of its first keyframe; the list has the size
+    for (const auto& s : client_.streams()) {
+        if (s.stream_id != stream_) continue;
+        LOG_INFO(TAG, "Connected: stream %u \"%s\" %ux%u @ %u fps", stream_, s.name, s.width, s.height, s.fps);
+        return true;
     }
+    LOG_ERROR(TAG, "Host offers no stream %u", stream_);
+    client_.disconnect();
+    return false;
+}
 
-    // Initialize mic capture
+void ClientSession::init_mic() {
+    StartupTimeline::Scope phase(startup_, "mic");
 #if defined(LANCAST_PLATFORM_LINUX)
     mic_capture_ = std::make_unique<MicCapturePulse>();
 #elif defined(LANCAST_PLATFORM_WINDOWS)
@@ -89,6 +101,76 @@ void ClientSession::run(std::atomic<bool>& running) {
         }
     }
 #endif
+}
+
+void ClientSession::run(std::atomic<bool>& running) {
+    running_ = &running;
+
+    decoder_generation_ = client_.config_generation(stream_);
+    auto config = client_.stream_config(stream_);
+    // Audio always comes with stream 0
+    const auto primary = client_.stream_config();
+    config.audio_sample_rate = primary.audio_sample_rate;
+    config.audio_channels = primary.audio_channels;
+    if (config.width == 0) {
+        for (const auto& s : client_.streams()) {
+            if (s.stream_id != stream_) continue;
+            config.width = s.width;
+            config.height = s.height;
+            config.fps = s.fps;
+        }
+    }
+    decoder_config_ = config;
+
+    // Decoders open on a helper while this thread creates the window
+    bool decoder_ok = false;
+    bool window_ok = false;
+    {
+        lancast::jthread decoders([&](lancast::stop_token) {
+            StartupTimeline::Scope phase(startup_, "decoders");
+            decoder_ = std::make_unique<VideoDecoder>();
+            decoder_ok = decoder_->init(config.width, config.height, config.codec_data);
+
+            audio_decoder_ = std::make_unique<AudioDecoder>();
+            if (!audio_decoder_->init(config.audio_sample_rate, config.audio_channels)) {
+                LOG_WARN(TAG, "Failed to initialize audio decoder — continuing without audio");
+                audio_decoder_.reset();
+            }
+        });
+        StartupTimeline::Scope phase(startup_, "window");
+        window_ok = renderer_.init(config.width, config.height, "lancast - viewer");
+    }
+    if (!decoder_ok) {
+        LOG_ERROR(TAG, "Failed to initialize video decoder");
+        return;
+    }
+    if (!window_ok) {
+        LOG_ERROR(TAG, "Failed to initialize SDL renderer");
+        return;
+    }
+
+    // Initialize audio player
+    if (audio_decoder_) {
+        StartupTimeline::Scope phase(startup_, "audio_output");
+        audio_player_ = std::make_unique<AudioPlayer>();
+        if (!audio_player_->init(config.audio_sample_rate, config.audio_channels)) {
+            LOG_WARN(TAG, "Failed to initialize audio player — continuing without audio");
+            audio_decoder_.reset();
+            audio_player_.reset();
+        }
+    }
+
+    if (!recording_path_.empty()) {
+        // The stream's own audio only reaches the file if it's being decoded
+        uint16_t channels = audio_decoder_ ? config.audio_channels : 0;
+        if (!recorder_.start(recording_path_, config.audio_sample_rate, channels)) {
+            LOG_WARN(TAG, "Recording disabled");
+        }
+    }
+
+    if (!frame_share_name_.empty() && !frame_share_.open(frame_share_name_)) {
+        LOG_WARN(TAG, "Frame sharing disabled");
+    }
 
     // Set up mute toggle key callback ('M' key)
     renderer_.set_key_callback([this](uint32_t keycode) {
@@ -119,16 +201,25 @@ void ClientSession::run(std::atomic<bool>& running) {
     }
 
     // Request a keyframe so we start cleanly
-    client_.request_keyframe();
+    client_.request_keyframe(stream_);
 
     LOG_INFO(TAG, "Render loop started (audio %s, mic %s)",
              audio_player_ ? "enabled" : "disabled",
              mic_capture_ ? "enabled (muted)" : "disabled");
 
     uint32_t frames_rendered = 0;
+    double latency_ms = 0.0;
+    auto last_frame_time = std::chrono::steady_clock::now();
+    last_stats_time_ = last_frame_time;
+    last_net_stats_ = client_.stats();
+    last_perf_report_ = last_frame_time;
+    last_load_report_ = last_frame_time;
+    Tracer::set_thread_name("render");
 
     // Main thread render loop
     while (running_->load() && client_.is_connected()) {
+        Tracer::dump_if_requested();
+
         // Poll SDL events (returns false on quit/ESC)
         if (!renderer_.poll_events()) {
             running_->store(false);
@@ -138,11 +229,26 @@ void ClientSession::run(std::atomic<bool>& running) {
         // Drain decoded queue — always render the LATEST frame, skip stale ones
         std::optional<RawVideoFrame> frame;
         while (auto f = decoded_queue_.try_pop()) {
+            if (frame) frames_skipped_++;
             frame = std::move(f);
         }
         if (frame) {
-            renderer_.render_frame(*frame);
+            {
+                TRACE_SCOPE("render", frame->frame_id);
+                renderer_.render_frame(*frame);
+            }
             frames_rendered++;
+            if (frames_rendered == 1 && startup_.mark_once("first_frame")) {
+                LOG_INFO(TAG, "Startup: %s", startup_.summary().c_str());
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            renderer_.overlay().add_frame_time(
+                std::chrono::duration<double, std::milli>(now - last_frame_time).count());
+            last_frame_time = now;
+            if (frame->recv_us > 0) {
+                latency_ms = ewma(latency_ms, (steady_now_us() - frame->recv_us) / 1000.0, EWMA_ALPHA);
+            }
 
             if (frames_rendered % 300 == 0) {
                 LOG_INFO(TAG, "Rendered %u frames", frames_rendered);
@@ -151,6 +257,25 @@ void ClientSession::run(std::atomic<bool>& running) {
             // No frame available, sleep briefly to avoid busy-waiting
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
+
+        if (std::chrono::steady_clock::now() - last_stats_time_ >= OVERLAY_REFRESH) {
+            refresh_overlay_stats(frames_rendered, latency_ms);
+        }
+
+        if (std::chrono::steady_clock::now() - last_load_report_ >= LOAD_REPORT_INTERVAL) {
+            send_load_report(frames_rendered);
+        }
+
+        if (std::chrono::steady_clock::now() - last_viewport_check_ >= VIEWPORT_CHECK_INTERVAL) {
+            send_viewport_if_changed();
+        }
+
+        if (PerfCounters::enabled() &&
+            std::chrono::steady_clock::now() - last_perf_report_ >= PERF_REPORT_INTERVAL) {
+            last_perf_report_ = std::chrono::steady_clock::now();
+            std::string report = PerfCounters::report();
+            if (!report.empty()) LOG_INFO(TAG, "Per-frame stage counters:\n%s", report.c_str());
+        }
     }
 
     LOG_INFO(TAG, "Render loop ended (total frames: %u)", frames_rendered);
@@ -178,6 +303,10 @@ void ClientSession::stop() {
         decode_thread_.join();
     }
 
+    // Decode threads are gone, so nothing more arrives for the file
+    recorder_.stop();
+    frame_share_.close();
+
     mic_raw_queue_.close();
     mic_encoded_queue_.close();
     video_queue_.close();
@@ -195,8 +324,74 @@ void ClientSession::stop() {
     LOG_INFO(TAG, "Client session stopped");
 }
 
+void ClientSession::refresh_overlay_stats(uint32_t frames_rendered, double latency_ms) {
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_stats_time_).count();
+    auto net = client_.stats();
+
+    PerfOverlay::Stats stats;
+    stats.latency_ms = latency_ms;
+    stats.fps = (frames_rendered - last_frames_rendered_) / secs;
+    stats.bitrate_mbps = (net.bytes_received - last_net_stats_.bytes_received) * 8.0 / secs / 1e6;
+    uint64_t total = net.packets_received + net.packets_lost;
+    stats.loss_pct = total > 0 ? 100.0 * net.packets_lost / total : 0.0;
+    stats.jitter_ms = net.jitter_ms;
+    stats.queue_delay_ms = queue_delay_ms_.load(std::memory_order_relaxed);
+    stats.decode_ms = decode_ms_.load(std::memory_order_relaxed);
+    stats.kernel_rx_ms = net.rx_queue_ms;
+    stats.kernel_tx_ms = net.tx_queue_ms;
+    stats.video_queue = video_queue_.size();
+    stats.decoded_queue = decoded_queue_.size();
+    stats.frames_dropped = net.frames_dropped;
+    renderer_.overlay().set_stats(stats);
+
+    last_stats_time_ = now;
+    last_net_stats_ = net;
+    last_frames_rendered_ = frames_rendered;
+}
+
+void ClientSession::send_load_report(uint32_t frames_rendered) {
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_load_report_).count();
+
+    // Frames lost to full queues or skipped by the renderer were all decoded
+    // or received for nothing; the host eases off when they pile up.
+    uint32_t decoded = frames_decoded_.load(std::memory_order_relaxed);
+    uint64_t discarded = video_queue_.dropped() + decoded_queue_.dropped() + frames_skipped_;
+
+    ClientReportPayload report;
+    report.rendered_fps_x10 = static_cast<uint16_t>(
+        std::min(10.0 * (frames_rendered - load_report_.rendered) / secs, 65535.0));
+    report.decoded = static_cast<uint16_t>(std::min<uint32_t>(decoded - load_report_.decoded, 65535));
+    report.discarded = static_cast<uint16_t>(std::min<uint64_t>(discarded - load_report_.discarded, 65535));
+    report.decode_us = static_cast<uint32_t>(decode_ms_.load(std::memory_order_relaxed) * 1000.0);
+    report.video_queue = static_cast<uint8_t>(video_queue_.size());
+    report.decoded_queue = static_cast<uint8_t>(decoded_queue_.size());
+    client_.send_report(report);
+
+    last_load_report_ = now;
+    load_report_ = {frames_rendered, decoded, discarded};
+}
+
+void ClientSession::send_viewport_if_changed() {
+    auto now = std::chrono::steady_clock::now();
+    last_viewport_check_ = now;
+
+    ViewportRequest request;
+    renderer_.drawable_size(request.drawable_width, request.drawable_height);
+    request.region = renderer_.view_region();
+    ViewportPayload viewport = viewport_payload(request);
+
+    bool changed = std::memcmp(&viewport, &sent_viewport_, sizeof(viewport)) != 0;
+    if (!changed && now - last_viewport_sent_ < VIEWPORT_RESEND_INTERVAL) return;
+    client_.send_viewport(viewport, stream_);
+    sent_viewport_ = viewport;
+    last_viewport_sent_ = now;
+}
+
 void ClientSession::recv_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Receive loop started");
+    Tracer::set_thread_name("recv");
 
     while (!st.stop_requested() && running_->load() && client_.is_connected()) {
         client_.poll(video_queue_, audio_queue_);
@@ -207,30 +402,91 @@ void ClientSession::recv_loop(lancast::stop_token st) {
 
 void ClientSession::decode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Decode loop started");
+    Tracer::set_thread_name("decode");
+    bool first_packet = true;
+    bool first_decoded = true;
 
     while (!st.stop_requested() && running_->load()) {
         auto packet = video_queue_.wait_pop(std::chrono::milliseconds(5));
         if (packet) {
-            auto decoded = decoder_->decode(*packet);
+            if (first_packet) {
+                first_packet = false;
+                startup_.mark_once("first_video_packet");
+            }
+            TRACE_SCOPE("decode", packet->frame_id);
+            if (packet->type == FrameType::VideoKeyframe) reinit_decoder_if_changed();
+            int64_t start_us = steady_now_us();
+            if (packet->recv_us > 0) {
+                queue_delay_ms_.store(ewma(queue_delay_ms_.load(std::memory_order_relaxed),
+                                           (start_us - packet->recv_us) / 1000.0, EWMA_ALPHA),
+                                      std::memory_order_relaxed);
+            }
+            std::optional<RawVideoFrame> decoded;
+            {
+                PerfScope perf(PerfStage::Decode);
+                decoded = decoder_->decode(*packet);
+            }
+            decode_ms_.store(ewma(decode_ms_.load(std::memory_order_relaxed),
+                                  (steady_now_us() - start_us) / 1000.0, EWMA_ALPHA),
+                             std::memory_order_relaxed);
             if (decoded) {
+                decoded->region = decoder_config_.region;
+                frames_decoded_.fetch_add(1, std::memory_order_relaxed);
+                if (first_decoded) {
+                    first_decoded = false;
+                    startup_.mark_once("first_frame_decoded");
+                }
+                if (frame_share_.is_open()) frame_share_.publish(*decoded);
                 decoded_queue_.push(std::move(*decoded));
             }
+            if (recorder_.is_recording()) {
+                recorder_.add_video(std::move(*packet), decoder_config_, decoder_generation_);
+            }
         }
     }
 
     LOG_INFO(TAG, "Decode loop ended");
 }
 
+void ClientSession::reinit_decoder_if_changed() {
+    // Frames queued before the switch were encoded with the old config, so
+    // the decoder only changes at the first keyframe after it
+    uint32_t generation = client_.config_generation(stream_);
+    if (generation == decoder_generation_) return;
+    decoder_generation_ = generation;
+
+    auto config = client_.stream_config(stream_);
+    bool same_stream = config.width == decoder_config_.width &&
+                       config.height == decoder_config_.height &&
+                       config.codec_data == decoder_config_.codec_data;
+    decoder_config_ = config;
+    // A new source region at the same size and SPS/PPS keeps the decoder
+    if (same_stream) {
+        LOG_INFO(TAG, "Video region switched to (%u,%u %ux%u)/65536",
+                 config.region.x, config.region.y, config.region.width, config.region.height);
+        return;
+    }
+    decoder_->shutdown();
+    if (!decoder_->init(config.width, config.height, config.codec_data)) {
+        LOG_ERROR(TAG, "Failed to reinitialize video decoder for %ux%u", config.width, config.height);
+        return;
+    }
+    LOG_INFO(TAG, "Video decoder switched to %ux%u @ %u fps", config.width, config.height, config.fps);
+}
+
 void ClientSession::audio_decode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Audio decode loop started");
+    Tracer::set_thread_name("audio_decode");
 
     while (!st.stop_requested() && running_->load()) {
         auto packet = audio_queue_.wait_pop(std::chrono::milliseconds(10));
         if (packet) {
+            TRACE_SCOPE("audio_decode", packet->frame_id);
             auto decoded = audio_decoder_->decode(*packet);
             if (decoded) {
                 audio_player_->play_frame(*decoded);
             }
+            if (recorder_.is_recording()) recorder_.add_audio(std::move(*packet));
         }
     }
 
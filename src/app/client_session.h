@@ -7,10 +7,14 @@
 #include "capture/audio_capture.h"
 #include "render/sdl_renderer.h"
 #include "render/audio_player.h"
+#include "render/frame_share.h"
+#include "record/media_recorder.h"
+#include "core/startup_timeline.h"
 #include "core/thread_safe_queue.h"
 #include "core/types.h"
 #include "core/jthread.h"
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -21,6 +25,24 @@ public:
     ClientSession() = default;
     ~ClientSession();
 
+    // Record received datagrams to a packet trace for offline replay (call before connect)
+    void set_packet_record_path(const std::string& path) { packet_record_path_ = path; }
+
+    // Watch this stream of a multi-stream host instead of stream 0 (call before connect)
+    void set_stream(uint8_t stream) { stream_ = stream; }
+
+    // Receive media through AF_XDP on this interface, falling back to the
+    // socket where that fails (call before connect)
+    void set_xdp_interface(const std::string& interface) { xdp_interface_ = interface; }
+
+    // Save the received video and audio to this .mkv/.mp4 as they arrive,
+    // without re-encoding (call before run)
+    void set_recording_path(const std::string& path) { recording_path_ = path; }
+
+    // Publish decoded frames in shared memory under this name for other
+    // local processes (see FramePublisher; call before run)
+    void set_frame_share_name(const std::string& name) { frame_share_name_ = name; }
+
     bool connect(const std::string& host_ip, uint16_t port);
 
     // Runs the SDL render loop on the main thread. Blocks until quit.
@@ -28,12 +50,20 @@ public:
 
     void stop();
 
+    // Setup phases since the session was created, up to the first frame rendered
+    const StartupTimeline& startup() const { return startup_; }
+
 private:
+    void init_mic();
     void recv_loop(lancast::stop_token st);
     void decode_loop(lancast::stop_token st);
+    void reinit_decoder_if_changed();
     void audio_decode_loop(lancast::stop_token st);
     void mic_capture_loop(lancast::stop_token st);
     void mic_encode_loop(lancast::stop_token st);
+    void refresh_overlay_stats(uint32_t frames_rendered, double latency_ms);
+    void send_load_report(uint32_t frames_rendered);
+    void send_viewport_if_changed();
 
     Client client_;
     std::unique_ptr<VideoDecoder> decoder_;
@@ -52,6 +82,43 @@ private:
     ThreadSafeQueue<EncodedPacket> audio_queue_{8};
     ThreadSafeQueue<RawVideoFrame> decoded_queue_{2};
 
+    // Per-frame timings for the performance overlay (EWMA, written by the decode thread)
+    std::atomic<double> decode_ms_{0.0};
+    std::atomic<double> queue_delay_ms_{0.0};
+    std::atomic<uint32_t> frames_decoded_{0};
+    uint32_t decoder_generation_ = 0;  // Client config generation the decoder was built for
+    StreamConfig decoder_config_;      // Config the decoder was built for (decode thread only)
+
+    // Overlay refresh state (render thread only)
+    std::chrono::steady_clock::time_point last_stats_time_;
+    Client::Stats last_net_stats_;
+    uint32_t last_frames_rendered_ = 0;
+    std::chrono::steady_clock::time_point last_perf_report_;
+
+    // Load reports to the host (render thread only): totals at the last report
+    struct LoadTotals {
+        uint32_t rendered = 0;
+        uint32_t decoded = 0;
+        uint64_t discarded = 0;
+    };
+    std::chrono::steady_clock::time_point last_load_report_;
+    LoadTotals load_report_;
+    uint64_t frames_skipped_ = 0;  // Decoded frames replaced by a newer one before rendering
+
+    // Viewport reports to the host (render thread only)
+    std::chrono::steady_clock::time_point last_viewport_check_;
+    std::chrono::steady_clock::time_point last_viewport_sent_;
+    ViewportPayload sent_viewport_;
+
+    std::string packet_record_path_;
+    uint8_t stream_ = 0;
+    std::string xdp_interface_;
+    std::string recording_path_;
+    MediaRecorder recorder_;
+    std::string frame_share_name_;
+    FramePublisher frame_share_;  // Written by the decode thread
+    StartupTimeline startup_;
+
     std::atomic<bool>* running_ = nullptr;
     lancast::jthread recv_thread_;
     lancast::jthread decode_thread_;
@@ -1,6 +1,14 @@
 #include "app/host_session.h"
 #include "core/clock.h"
 #include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/round_robin.h"
+#include "core/trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <thread>
 
 #if defined(LANCAST_PLATFORM_LINUX)
 #include "capture/screen_capture_x11.h"
@@ -17,6 +25,19 @@ namespace lancast {
 
 static constexpr const char* TAG = "HostSession";
 
+// Extra streams nobody subscribes to check back this often
+static constexpr auto UNWATCHED_STREAM_POLL = std::chrono::milliseconds(100);
+
+static std::unique_ptr<ICaptureSource> make_screen_capture() {
+#if defined(LANCAST_PLATFORM_LINUX)
+    return std::make_unique<ScreenCaptureX11>();
+#elif defined(LANCAST_PLATFORM_MACOS)
+    return std::make_unique<ScreenCaptureMac>();
+#elif defined(LANCAST_PLATFORM_WINDOWS)
+    return std::make_unique<ScreenCaptureDXGI>();
+#endif
+}
+
 HostSession::~HostSession() {
     stop();
 }
@@ -25,104 +46,126 @@ bool HostSession::start(uint16_t port, uint32_t fps, uint32_t bitrate,
                          uint32_t width, uint32_t height, uint64_t window_id,
                          std::atomic<bool>& running) {
     running_ = &running;
+    port_ = port;
+    started_ = std::chrono::steady_clock::now();
     fps_ = fps;
+    capture_fps_ = fps;
+    fps_limit_ = fps;
     target_bitrate_ = bitrate;
     current_bitrate_ = bitrate;
 
-    // Initialize screen capture (platform-specific)
-#if defined(LANCAST_PLATFORM_LINUX)
-    capture_ = std::make_unique<ScreenCaptureX11>();
-#elif defined(LANCAST_PLATFORM_MACOS)
-    capture_ = std::make_unique<ScreenCaptureMac>();
-#elif defined(LANCAST_PLATFORM_WINDOWS)
-    capture_ = std::make_unique<ScreenCaptureDXGI>();
-#endif
-    if (!capture_->init(width, height, window_id)) {
-        LOG_ERROR(TAG, "Failed to initialize screen capture");
-        return false;
-    }
-
-    uint32_t w = capture_->target_width();
-    uint32_t h = capture_->target_height();
+    streams_.clear();
+    streams_.push_back(std::make_unique<VideoStream>());
+    VideoStream& primary = *streams_.front();
+    primary.window_id = window_id;
+    primary.fps = fps;
 
-    // Initialize encoder
-    encoder_ = std::make_unique<VideoEncoder>();
-    if (!encoder_->init(w, h, fps, bitrate)) {
-        LOG_ERROR(TAG, "Failed to initialize video encoder");
-        capture_->shutdown();
-        return false;
+    // Extra streams are optional: one that fails to start is left out
+    std::vector<std::unique_ptr<VideoStream>> extras;
+    for (uint64_t extra_window : extra_windows_) {
+        if (1 + extras.size() >= MAX_STREAMS) {
+            LOG_WARN(TAG, "At most %u streams, ignoring window 0x%llx", MAX_STREAMS,
+                     static_cast<unsigned long long>(extra_window));
+            continue;
+        }
+        auto stream = std::make_unique<VideoStream>();
+        stream->id = static_cast<uint8_t>(1 + extras.size());
+        stream->window_id = extra_window;
+        stream->fps = fps;
+        extras.push_back(std::move(stream));
     }
 
-    // Initialize audio capture (platform-specific)
-#if defined(LANCAST_PLATFORM_LINUX)
-    audio_capture_ = std::make_unique<AudioCapturePulse>();
-#elif defined(LANCAST_PLATFORM_MACOS)
+    // Setup steps that don't depend on each other run side by side: each
+    // stream's display connection, shared memory and x264 encoder, system
+    // audio capture and its encoder, and playback of client mic audio. This
+    // thread takes the client audio, as SDL prefers its subsystems brought
+    // up from the main thread.
+    bool video_ok = false;
     {
-        auto mac_audio = std::make_unique<AudioCaptureMac>();
-        auto* mac_capture = dynamic_cast<ScreenCaptureMac*>(capture_.get());
-        if (mac_capture) {
-            mac_audio->set_stream_manager(mac_capture->stream_manager());
+        std::vector<lancast::jthread> setup;
+        setup.emplace_back([&](lancast::stop_token) {
+            video_ok = init_stream_video(primary, width, height, bitrate);
+#if defined(LANCAST_PLATFORM_MACOS)
+            // Audio comes from the screen capture's stream manager
+            if (video_ok) init_audio();
+#endif
+        });
+#if !defined(LANCAST_PLATFORM_MACOS)
+        setup.emplace_back([this](lancast::stop_token) { init_audio(); });
+#endif
+        for (auto& extra : extras) {
+            setup.emplace_back([&, stream = extra.get()](lancast::stop_token) {
+                init_stream_video(*stream, width, height, bitrate);
+            });
         }
-        audio_capture_ = std::move(mac_audio);
+        init_client_audio();
     }
-#elif defined(LANCAST_PLATFORM_WINDOWS)
-    audio_capture_ = std::make_unique<AudioCaptureWASAPI>();
-#endif
-    if (!audio_capture_->init(48000, 2)) {
-        LOG_WARN(TAG, "Failed to initialize audio capture — continuing without audio");
-        audio_capture_.reset();
+    if (!video_ok) {
+        LOG_ERROR(TAG, "Failed to initialize screen capture or video encoder");
+        for (auto& extra : extras) streams_.push_back(std::move(extra));
+        shutdown_media();
+        return false;
     }
 
-    // Initialize audio encoder
-    if (audio_capture_) {
-        audio_encoder_ = std::make_unique<AudioEncoder>();
-        if (!audio_encoder_->init(48000, 2, 128000)) {
-            LOG_WARN(TAG, "Failed to initialize audio encoder — continuing without audio");
-            audio_capture_->shutdown();
-            audio_capture_.reset();
-            audio_encoder_.reset();
+    capture_ = primary.capture.get();
+    encoder_ = primary.encoder.get();
+    uint32_t w = capture_->target_width();
+    uint32_t h = capture_->target_height();
+    max_width_ = w;
+    max_height_ = h;
+    limit_width_ = w;
+    limit_height_ = h;
+    encoded_width_ = w;
+    encoded_height_ = h;
+    source_width_ = capture_->native_width();
+    source_height_ = capture_->native_height();
+    viewport_ = ViewportFormat{w, h, {}};
+
+    // Optional: streaming works without it
+    if (replay_seconds_ > 0) {
+        StartupTimeline::Scope phase(startup_, "replay");
+        size_t capacity = ReplayBuffer::capacity_for(std::chrono::seconds(replay_seconds_), bitrate);
+        if (replay_.start(capacity, 48000, audio_encoder_ ? 2 : 0)) {
+            replay_.set_video_config(stream_config(primary));
+        } else {
+            LOG_WARN(TAG, "Replay buffer unavailable — continuing without it");
         }
     }
 
     // Configure server with target (output) dimensions
-    StreamConfig config;
-    config.width = w;
-    config.height = h;
-    config.fps = fps;
-    config.video_bitrate = bitrate;
-    config.codec_data = encoder_->extradata();
-
-    // Set keyframe callback
+    auto server_start = StartupTimeline::Clock::now();
     server_ = std::make_unique<Server>(port);
-    server_->set_stream_config(config);
-    server_->set_keyframe_callback([this]() {
-        if (encoder_) encoder_->request_keyframe();
+    server_->set_stream_config(stream_config(primary));
+    server_->set_liveness_config(liveness_);
+    server_->set_receive_shards(receive_shards_);
+    server_->set_tx_timestamps(tx_timestamps_);
+    server_->set_keyframe_callback([this](uint8_t stream) {
+        for (auto& s : streams_) {
+            if (s->id == stream) s->encoder->request_keyframe();
+        }
+    });
+    server_->set_client_count_callback([this](size_t count) {
+        set_idle(count == 0);
+    });
+    server_->set_probe_callback([this](uint32_t start_bitrate) {
+        apply_probed_bitrate(start_bitrate);
     });
 
+    // Numbered in command line order, closing up over any that failed
+    for (auto& extra : extras) {
+        if (!extra->encoder) continue;
+        extra->id = static_cast<uint8_t>(streams_.size());
+        add_extra_stream(std::move(extra));
+    }
+
     if (!server_->start()) {
         LOG_ERROR(TAG, "Failed to start server");
-        if (audio_encoder_) audio_encoder_->shutdown();
-        if (audio_capture_) audio_capture_->shutdown();
-        encoder_->shutdown();
-        capture_->shutdown();
+        shutdown_media();
         return false;
     }
-
-    // Initialize client audio decoder + player (for receiving mic audio from clients)
-    client_audio_decoder_ = std::make_unique<AudioDecoder>();
-    if (!client_audio_decoder_->init(48000, 2)) {
-        LOG_WARN(TAG, "Failed to initialize client audio decoder — continuing without client mic playback");
-        client_audio_decoder_.reset();
-    }
-
-    if (client_audio_decoder_) {
-        client_audio_player_ = std::make_unique<AudioPlayer>();
-        if (!client_audio_player_->init(48000, 2)) {
-            LOG_WARN(TAG, "Failed to initialize client audio player — continuing without client mic playback");
-            client_audio_decoder_->shutdown();
-            client_audio_decoder_.reset();
-            client_audio_player_.reset();
-        }
+    startup_.record("server", server_start, StartupTimeline::Clock::now());
+    for (auto& stream : streams_) {
+        stream->encoder_generation = stream->encoder->generation();
     }
 
     // Set callback so server dispatches received client audio to our queue
@@ -132,18 +175,53 @@ bool HostSession::start(uint16_t port, uint32_t fps, uint32_t bitrate,
         });
     }
 
-    LOG_INFO(TAG, "Host started: %ux%u @ %u fps, bitrate %u, port %u, audio %s, client mic playback %s",
+    // One x264 encoder already spreads over several cores, so a worker per
+    // stream is only worth it on a machine with cores to spare
+    size_t encode_workers = std::min(streams_.size(),
+                                     std::max<size_t>(1, std::thread::hardware_concurrency() / 4));
+
+    LOG_INFO(TAG, "Host started: %ux%u @ %u fps, bitrate %u, port %u, audio %s, client mic playback %s, "
+                  "%zu stream(s) on %zu encode worker(s)",
              w, h, fps, bitrate, port,
              audio_capture_ ? "enabled" : "disabled",
-             client_audio_decoder_ ? "enabled" : "disabled");
+             client_audio_decoder_ ? "enabled" : "disabled",
+             streams_.size(), encode_workers);
 
     last_bitrate_check_ = std::chrono::steady_clock::now();
+    last_stats_log_ = last_bitrate_check_;
+    last_stats_cpu_ns_ = PerfCounters::process_cpu_ns();
+    last_autotune_ = last_bitrate_check_;
+    autotune_cpu_ns_ = last_stats_cpu_ns_;
+    if (autotune_) {
+        AutotuneLimits limits;
+        limits.max_fps = fps;
+        limits.presets = NUM_ENCODER_PRESETS;
+        autotuner_.set_limits(limits);
+        LOG_INFO(TAG, "Autotuning resolution, frame rate and preset within %ux%u @ %u fps", w, h, fps);
+    }
+
+    // Nothing is captured or encoded until the first viewer arrives
+    idle_ = true;
+    idle_since_ = last_bitrate_check_;
+    idle_cpu_start_ns_ = last_stats_cpu_ns_;
+    LOG_INFO(TAG, "Waiting for viewers (pipeline idle)");
 
     // Launch threads
     poll_thread_ = lancast::jthread([this](lancast::stop_token st) { server_poll_loop(st); });
+    for (size_t i = 1; i < server_->receive_shards(); ++i) {
+        shard_threads_.emplace_back([this, i](lancast::stop_token st) { server_shard_loop(st, i); });
+    }
     send_thread_ = lancast::jthread([this](lancast::stop_token st) { network_send_loop(st); });
-    encode_thread_ = lancast::jthread([this](lancast::stop_token st) { encode_loop(st); });
+    for (size_t i = 0; i < encode_workers; ++i) {
+        encode_threads_.emplace_back([this](lancast::stop_token st) { encode_loop(st); });
+    }
     capture_thread_ = lancast::jthread([this](lancast::stop_token st) { capture_loop(st); });
+    for (size_t i = 1; i < streams_.size(); ++i) {
+        VideoStream& stream = *streams_[i];
+        stream.capture_thread = lancast::jthread([this, &stream](lancast::stop_token st) {
+            extra_capture_loop(st, stream);
+        });
+    }
 
     if (audio_capture_ && audio_encoder_) {
         audio_encode_thread_ = lancast::jthread([this](lancast::stop_token st) { audio_encode_loop(st); });
@@ -154,60 +232,224 @@ bool HostSession::start(uint16_t port, uint32_t fps, uint32_t bitrate,
         client_audio_decode_thread_ = lancast::jthread([this](lancast::stop_token st) { client_audio_decode_loop(st); });
     }
 
+    // Optional: streaming works without it
+    if (!control_path_.empty()) {
+        if (control_.open(control_path_)) {
+            control_thread_ = lancast::jthread([this](lancast::stop_token st) { control_loop(st); });
+        } else {
+            LOG_WARN(TAG, "Control socket unavailable — continuing without it");
+        }
+    }
+
+    startup_.mark_once("ready");
+    LOG_INFO(TAG, "Startup: %s", startup_.summary().c_str());
     return true;
 }
 
+bool HostSession::init_stream_video(VideoStream& stream, uint32_t width, uint32_t height, uint32_t bitrate) {
+    std::string suffix = stream.id == 0 ? "" : "_" + std::to_string(stream.id);
+    {
+        StartupTimeline::Scope phase(startup_, "capture" + suffix);
+        stream.capture = make_screen_capture();
+        if (!stream.capture->init(width, height, stream.window_id)) {
+            LOG_WARN(TAG, "Can't capture %s 0x%llx", stream.window_id ? "window" : "screen",
+                     static_cast<unsigned long long>(stream.window_id));
+            stream.capture.reset();
+            return false;
+        }
+    }
+
+    StartupTimeline::Scope phase(startup_, "encoder" + suffix);
+    stream.encoder = std::make_unique<VideoEncoder>();
+    if (!stream.encoder->init(stream.capture->target_width(), stream.capture->target_height(),
+                              stream.fps, bitrate)) {
+        LOG_WARN(TAG, "Video encoder init failed for %s 0x%llx", stream.window_id ? "window" : "screen",
+                 static_cast<unsigned long long>(stream.window_id));
+        stream.capture->shutdown();
+        stream.capture.reset();
+        stream.encoder.reset();
+        return false;
+    }
+    stream.encoder->set_static_refinement(true);
+    return true;
+}
+
+void HostSession::init_audio() {
+    StartupTimeline::Scope phase(startup_, "audio");
+#if defined(LANCAST_PLATFORM_LINUX)
+    audio_capture_ = std::make_unique<AudioCapturePulse>();
+#elif defined(LANCAST_PLATFORM_MACOS)
+    {
+        auto mac_audio = std::make_unique<AudioCaptureMac>();
+        auto* mac_capture = dynamic_cast<ScreenCaptureMac*>(streams_.front()->capture.get());
+        if (mac_capture) {
+            mac_audio->set_stream_manager(mac_capture->stream_manager());
+        }
+        audio_capture_ = std::move(mac_audio);
+    }
+#elif defined(LANCAST_PLATFORM_WINDOWS)
+    audio_capture_ = std::make_unique<AudioCaptureWASAPI>();
+#endif
+    if (!audio_capture_->init(48000, 2)) {
+        LOG_WARN(TAG, "Failed to initialize audio capture — continuing without audio");
+        audio_capture_.reset();
+        return;
+    }
+
+    audio_encoder_ = std::make_unique<AudioEncoder>();
+    if (!audio_encoder_->init(48000, 2, 128000)) {
+        LOG_WARN(TAG, "Failed to initialize audio encoder — continuing without audio");
+        audio_capture_->shutdown();
+        audio_capture_.reset();
+        audio_encoder_.reset();
+    }
+}
+
+void HostSession::init_client_audio() {
+    StartupTimeline::Scope phase(startup_, "client_audio");
+    client_audio_decoder_ = std::make_unique<AudioDecoder>();
+    if (!client_audio_decoder_->init(48000, 2)) {
+        LOG_WARN(TAG, "Failed to initialize client audio decoder — continuing without client mic playback");
+        client_audio_decoder_.reset();
+        return;
+    }
+
+    client_audio_player_ = std::make_unique<AudioPlayer>();
+    if (!client_audio_player_->init(48000, 2)) {
+        LOG_WARN(TAG, "Failed to initialize client audio player — continuing without client mic playback");
+        client_audio_decoder_->shutdown();
+        client_audio_decoder_.reset();
+        client_audio_player_.reset();
+    }
+}
+
+StreamConfig HostSession::stream_config(const VideoStream& stream) const {
+    StreamConfig config;
+    config.width = stream.capture->target_width();
+    config.height = stream.capture->target_height();
+    config.fps = stream.fps;
+    config.video_bitrate = target_bitrate_.load();
+    config.codec_data = stream.encoder->extradata();
+    return config;
+}
+
+void HostSession::add_extra_stream(std::unique_ptr<VideoStream> stream) {
+    char name[32];
+    if (stream->window_id == 0) {
+        snprintf(name, sizeof(name), "screen");
+    } else {
+        snprintf(name, sizeof(name), "window 0x%llx", static_cast<unsigned long long>(stream->window_id));
+    }
+    StreamConfig config = stream_config(*stream);
+    server_->add_stream(stream->id, name, config);
+    LOG_INFO(TAG, "Stream %u: %s, %ux%u @ %u fps", stream->id, name, config.width, config.height, config.fps);
+    streams_.push_back(std::move(stream));
+}
+
 void HostSession::stop() {
+    if (control_thread_.joinable()) control_thread_.request_stop();
     if (client_audio_decode_thread_.joinable()) client_audio_decode_thread_.request_stop();
     if (audio_capture_thread_.joinable()) audio_capture_thread_.request_stop();
     if (audio_encode_thread_.joinable()) audio_encode_thread_.request_stop();
     if (capture_thread_.joinable()) capture_thread_.request_stop();
-    if (encode_thread_.joinable()) encode_thread_.request_stop();
+    for (auto& stream : streams_) {
+        if (stream->capture_thread.joinable()) stream->capture_thread.request_stop();
+    }
+    for (auto& t : encode_threads_) t.request_stop();
     if (send_thread_.joinable()) send_thread_.request_stop();
     if (poll_thread_.joinable()) poll_thread_.request_stop();
+    for (auto& t : shard_threads_) t.request_stop();
+    idle_cv_.notify_all();
 
     client_audio_queue_.close();
     audio_raw_queue_.close();
     audio_encoded_queue_.close();
 
+    if (control_thread_.joinable()) control_thread_.join();
+    control_.close();
     if (client_audio_decode_thread_.joinable()) client_audio_decode_thread_.join();
     if (audio_capture_thread_.joinable()) audio_capture_thread_.join();
     if (audio_encode_thread_.joinable()) audio_encode_thread_.join();
     if (capture_thread_.joinable()) capture_thread_.join();
-    if (encode_thread_.joinable()) encode_thread_.join();
+    for (auto& stream : streams_) {
+        if (stream->capture_thread.joinable()) stream->capture_thread.join();
+    }
+    for (auto& t : encode_threads_) {
+        if (t.joinable()) t.join();
+    }
+    encode_threads_.clear();
     if (send_thread_.joinable()) send_thread_.join();
     if (poll_thread_.joinable()) poll_thread_.join();
+    for (auto& t : shard_threads_) {
+        if (t.joinable()) t.join();
+    }
+    shard_threads_.clear();
 
+    replay_.stop();
     if (server_) server_->stop();
+    shutdown_media();
+
+    LOG_INFO(TAG, "Host session stopped");
+}
+
+void HostSession::shutdown_media() {
     if (client_audio_player_) client_audio_player_->shutdown();
     if (client_audio_decoder_) client_audio_decoder_->shutdown();
     if (audio_encoder_) audio_encoder_->shutdown();
     if (audio_capture_) audio_capture_->shutdown();
-    if (encoder_) encoder_->shutdown();
-    if (capture_) capture_->shutdown();
-
-    LOG_INFO(TAG, "Host session stopped");
+    for (auto& stream : streams_) {
+        if (stream->encoder) stream->encoder->shutdown();
+        if (stream->capture) stream->capture->shutdown();
+    }
 }
 
 void HostSession::capture_loop(lancast::stop_token st) {
     Clock clock;
-    auto frame_interval = std::chrono::microseconds(1'000'000 / fps_);
 
     LOG_INFO(TAG, "Capture loop started (%u fps, interval %lld us)",
-             fps_, static_cast<long long>(frame_interval.count()));
+             fps_.load(), static_cast<long long>(1'000'000 / fps_.load()));
+    Tracer::set_thread_name("capture");
+    VideoStream& stream = *streams_.front();
 
     while (!st.stop_requested() && running_->load()) {
+        // Capture again immediately on wake so the first IDR isn't delayed
+        if (wait_while_idle(st)) continue;
+        apply_pending_reconfigure();
+        // With several streams, viewers may all be watching the others
+        if (streams_.size() > 1 && server_->subscribers(0) == 0) {
+            std::this_thread::sleep_for(UNWATCHED_STREAM_POLL);
+            continue;
+        }
+
         auto start = std::chrono::steady_clock::now();
 
-        auto raw_frame = capture_->capture_frame();
+        // Frame ids are assigned here rather than by the encoder so every
+        // stage (including capture) can be traced under the same id.
+        uint16_t frame_id = stream.next_frame_id;
+        std::optional<RawVideoFrame> raw_frame;
+        {
+            TRACE_SCOPE("capture", frame_id);
+            raw_frame = capture_->capture_frame();
+        }
         if (raw_frame) {
-            if (!raw_buffer_.try_push(std::move(*raw_frame))) {
+            raw_frame->frame_id = frame_id;
+            raw_frame->pts_us = media_clock_.now_us();
+            raw_frame->region = stream.capture_region;
+            stream.next_frame_id++;
+            if (autotune_) {
+                motion_ppm_.add(static_cast<uint64_t>(motion_sampler_.sample(*raw_frame) * 1e6));
+            }
+            if (!stream.raw_buffer.try_push(std::move(*raw_frame))) {
                 LOG_DEBUG(TAG, "Raw buffer full, dropping frame");
             }
         }
 
-        // Sleep to maintain target FPS
+        // Sleep to maintain target FPS; clients that can't keep up lower it
+        auto frame_interval = std::chrono::microseconds(1'000'000 / capture_fps_.load());
         auto elapsed = std::chrono::steady_clock::now() - start;
+        if (raw_frame) {
+            capture_us_.add(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        }
         auto sleep_time = frame_interval - elapsed;
         if (sleep_time > std::chrono::microseconds(0)) {
             std::this_thread::sleep_for(sleep_time);
@@ -217,19 +459,69 @@ void HostSession::capture_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Capture loop ended");
 }
 
+void HostSession::extra_capture_loop(lancast::stop_token st, VideoStream& stream) {
+    LOG_INFO(TAG, "Stream %u capture loop started (%u fps)", stream.id, stream.fps);
+    Tracer::set_thread_name("capture_extra");
+    auto frame_interval = std::chrono::microseconds(1'000'000 / std::max<uint32_t>(stream.fps, 1));
+
+    while (!st.stop_requested() && running_->load()) {
+        if (wait_while_idle(st)) continue;
+        // The server asks for a keyframe when someone subscribes
+        if (server_->subscribers(stream.id) == 0) {
+            std::this_thread::sleep_for(UNWATCHED_STREAM_POLL);
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        uint16_t frame_id = stream.next_frame_id;
+        std::optional<RawVideoFrame> raw_frame;
+        {
+            TRACE_SCOPE("capture", frame_id);
+            raw_frame = stream.capture->capture_frame();
+        }
+        if (raw_frame) {
+            raw_frame->frame_id = frame_id;
+            raw_frame->pts_us = media_clock_.now_us();
+            stream.next_frame_id++;
+            if (!stream.raw_buffer.try_push(std::move(*raw_frame))) {
+                LOG_DEBUG(TAG, "Stream %u raw buffer full, dropping frame", stream.id);
+            }
+        }
+
+        auto sleep_time = frame_interval - (std::chrono::steady_clock::now() - start);
+        if (sleep_time > std::chrono::microseconds(0)) {
+            std::this_thread::sleep_for(sleep_time);
+        }
+    }
+
+    LOG_INFO(TAG, "Stream %u capture loop ended", stream.id);
+}
+
 void HostSession::encode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Encode loop started");
+    Tracer::set_thread_name("encode");
+    size_t first = 0;
 
     while (!st.stop_requested() && running_->load()) {
-        auto raw_frame = raw_buffer_.try_pop();
-        if (raw_frame) {
-            auto encoded = encoder_->encode(*raw_frame);
-            if (encoded) {
-                if (!encoded_buffer_.try_push(std::move(*encoded))) {
-                    LOG_DEBUG(TAG, "Encoded buffer full, dropping frame");
-                }
+        if (idle_.load(std::memory_order_relaxed)) {
+            // Frames captured before going idle would be stale on wake
+            for (auto& stream : streams_) {
+                if (stream->encoding.exchange(true, std::memory_order_acquire)) continue;
+                while (stream->raw_buffer.try_pop()) {}
+                stream->encoding.store(false, std::memory_order_release);
             }
-        } else {
+            wait_while_idle(st);
+            continue;
+        }
+
+        bool encoded_any = serve_round_robin(streams_, first, &VideoStream::encoding, [&](VideoStream& stream) {
+            auto raw_frame = stream.raw_buffer.try_pop();
+            if (!raw_frame) return false;
+            encode_frame(stream, *raw_frame);
+            return true;
+        });
+
+        if (!encoded_any) {
             std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
     }
@@ -237,26 +529,109 @@ void HostSession::encode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Encode loop ended");
 }
 
+void HostSession::encode_frame(VideoStream& stream, RawVideoFrame& raw_frame) {
+    TRACE_SCOPE("encode", raw_frame.frame_id);
+    bool primary = stream.id == 0;
+    uint32_t fps = primary ? fps_.load() : stream.fps;
+    // Capture switched size or rate: rebuild the encoder, starting on a keyframe
+    stream.encoder->reconfigure(raw_frame.width, raw_frame.height, fps);
+    // A new region at the same size only needs a keyframe for clients to switch at
+    bool region_changed = raw_frame.region != stream.encoded_region;
+    if (region_changed) {
+        stream.encoded_region = raw_frame.region;
+        stream.encoder->request_keyframe();
+    }
+    std::optional<EncodedPacket> encoded;
+    auto encode_start = std::chrono::steady_clock::now();
+    {
+        PerfScope perf(PerfStage::Encode);
+        encoded = stream.encoder->encode(raw_frame);
+    }
+    if (primary) {
+        encode_us_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - encode_start).count());
+        encoded_width_ = raw_frame.width;
+        encoded_height_ = raw_frame.height;
+    }
+    if (!encoded) return;
+
+    // The capture id, not the encoder's count, so traces on both ends line
+    // up; skipped captures leave gaps (see core/trace.h)
+    encoded->frame_id = raw_frame.frame_id;
+    encoded->stream_id = stream.id;
+    // Any re-init (size, rate or bitrate) may change the SPS/PPS
+    uint32_t generation = stream.encoder->generation();
+    if (generation != stream.encoder_generation || region_changed) {
+        stream.encoder_generation = generation;
+        StreamConfig config;
+        config.width = raw_frame.width;
+        config.height = raw_frame.height;
+        config.fps = fps;
+        config.video_bitrate = primary ? target_bitrate_.load() : stream.encoder->current_bitrate();
+        config.codec_data = stream.encoder->extradata();
+        config.region = raw_frame.region;
+        if (primary && replay_.is_running()) replay_.set_video_config(config);
+        std::lock_guard lock(stream.config_mutex);
+        stream.pending_config = PendingStreamConfig{std::move(config), encoded->frame_id};
+        stream.config_pending = true;
+    }
+    if (primary) replay_.add_video(*encoded);
+    if (!stream.encoded_buffer.try_push(std::move(*encoded))) {
+        LOG_DEBUG(TAG, "Stream %u encoded buffer full, dropping frame", stream.id);
+    }
+}
+
 void HostSession::network_send_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Network send loop started");
+    Tracer::set_thread_name("send");
+    bool first_frame_sent = false;
 
     while (!st.stop_requested() && running_->load()) {
+        if (idle_.load(std::memory_order_relaxed)) {
+            for (auto& stream : streams_) {
+                while (stream->encoded_buffer.try_pop()) {}
+            }
+            while (audio_encoded_queue_.try_pop()) {}
+            wait_while_idle(st);
+            continue;
+        }
+
         bool sent_anything = false;
 
-        // Check video encoded buffer
-        auto video_packet = encoded_buffer_.try_pop();
-        if (video_packet) {
-            server_->broadcast(*video_packet);
-            LOG_DEBUG(TAG, "Broadcast video frame %u (%zu bytes, %s)",
-                      video_packet->frame_id, video_packet->data.size(),
+        // One frame from each stream's encoded buffer
+        for (auto& stream : streams_) {
+            auto video_packet = stream->encoded_buffer.try_pop();
+            if (!video_packet) continue;
+            if (stream->config_pending.load()) publish_stream_config(*stream, video_packet->frame_id);
+            auto send_start = std::chrono::steady_clock::now();
+            {
+                TRACE_SCOPE("send", video_packet->frame_id);
+                server_->broadcast(*video_packet);
+            }
+            if (stream->id == 0) {
+                send_us_.add(std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - send_start).count());
+            }
+            LOG_DEBUG(TAG, "Broadcast stream %u video frame %u (%zu bytes, %s)",
+                      stream->id, video_packet->frame_id, video_packet->data.size(),
                       video_packet->type == FrameType::VideoKeyframe ? "keyframe" : "P-frame");
             sent_anything = true;
+            if (!first_frame_sent) {
+                first_frame_sent = true;
+                // Time to first frame, from launch to the first viewer's first keyframe
+                if (startup_.mark_once("first_frame_sent")) {
+                    LOG_INFO(TAG, "Startup: %s", startup_.summary().c_str());
+                }
+            }
         }
 
         // Check audio encoded queue
         auto audio_packet = audio_encoded_queue_.try_pop();
         if (audio_packet) {
-            server_->broadcast(*audio_packet);
+            {
+                TRACE_SCOPE("send_audio", audio_packet->frame_id);
+                server_->broadcast(*audio_packet);
+            }
             LOG_DEBUG(TAG, "Broadcast audio frame %u (%zu bytes)",
                       audio_packet->frame_id, audio_packet->data.size());
             sent_anything = true;
@@ -272,17 +647,30 @@ void HostSession::network_send_loop(lancast::stop_token st) {
 
 void HostSession::server_poll_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Server poll loop started");
+    Tracer::set_thread_name("server_poll");
 
     while (!st.stop_requested() && running_->load()) {
         server_->poll();
 
-        // Periodically check adaptive bitrate
+        // Periodically check adaptive bitrate and client load
         check_adaptive_bitrate();
+        check_client_load();
+        check_viewport();
+        check_autotune();
+        log_stats();
     }
 
     LOG_INFO(TAG, "Server poll loop ended");
 }
 
+void HostSession::server_shard_loop(lancast::stop_token st, size_t shard) {
+    Tracer::set_thread_name("server_rx");  // The tracer keeps the pointer; tids tell shards apart
+
+    while (!st.stop_requested() && running_->load()) {
+        server_->poll_shard(shard);
+    }
+}
+
 void HostSession::check_adaptive_bitrate() {
     auto now = std::chrono::steady_clock::now();
     if (now - last_bitrate_check_ < std::chrono::seconds(5)) return;
@@ -293,15 +681,21 @@ void HostSession::check_adaptive_bitrate() {
     double rtt = server_->max_rtt_ms();
     if (rtt <= 0) return; // No valid RTT measurements yet
 
+    uint32_t target = target_bitrate_.load();
     uint32_t desired_bitrate;
     if (rtt > 100.0) {
-        desired_bitrate = target_bitrate_ / 2;
+        desired_bitrate = target / 2;
     } else if (rtt > 50.0) {
-        desired_bitrate = target_bitrate_ * 3 / 4;
+        desired_bitrate = target * 3 / 4;
     } else {
-        desired_bitrate = target_bitrate_;
+        desired_bitrate = target;
     }
 
+    // Never above what the slowest probed viewer's link can carry
+    uint32_t ceiling = server_->probed_bitrate_ceiling();
+    if (ceiling > 0) desired_bitrate = std::min(desired_bitrate, ceiling);
+
+    std::lock_guard lock(bitrate_mutex_);
     if (desired_bitrate != current_bitrate_) {
         LOG_INFO(TAG, "Adaptive bitrate: RTT=%.1f ms, adjusting %u -> %u",
                  rtt, current_bitrate_, desired_bitrate);
@@ -309,14 +703,331 @@ void HostSession::check_adaptive_bitrate() {
             current_bitrate_ = desired_bitrate;
         }
     }
+    server_->tune_send_buffer(current_bitrate_, rtt);
+}
+
+void HostSession::check_client_load() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_load_check_ < LOAD_CHECK_INTERVAL) return;
+    last_load_check_ = now;
+
+    // One encoder feeds every viewer, so the slowest decoder sets the rate.
+    // Clients step their own limits back up, so follow the ceiling directly.
+    uint32_t configured = fps_.load();
+    uint32_t ceiling = server_->fps_ceiling();
+    uint32_t fps = ceiling > 0 ? std::min(ceiling, configured) : configured;
+    uint32_t previous = capture_fps_.exchange(fps);
+    if (fps == previous) return;
+
+    if (fps < configured) {
+        LOG_INFO(TAG, "Client load: capture %u -> %u fps (configured %u)", previous, fps, configured);
+    } else {
+        LOG_INFO(TAG, "Client load: all viewers keep up, capture back to %u fps", fps);
+    }
+}
+
+void HostSession::check_viewport() {
+    if (!viewport_scaling_) return;
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_viewport_check_ < VIEWPORT_CHECK_INTERVAL) return;
+    last_viewport_check_ = now;
+
+    auto viewports = server_->viewports();
+    if (viewports.empty()) return;
+    bool limit_changed = viewport_limit_changed_.exchange(false);
+
+    // One encoder feeds every viewer: capture the union of their regions at
+    // the size the most demanding one needs
+    ViewportFormat format = viewport_format(viewports, source_width_, source_height_,
+                                            max_width_.load(), max_height_.load());
+    if (format == viewport_) {
+        viewport_candidate_.reset();
+        return;
+    }
+    // An operator change applies at once
+    if (!limit_changed) {
+        if (!viewport_candidate_ || *viewport_candidate_ != format) {
+            viewport_candidate_ = format;
+            viewport_candidate_since_ = now;
+            return;
+        }
+        if (now - viewport_candidate_since_ < VIEWPORT_SETTLE) return;
+    }
+
+    LOG_INFO(TAG, "Viewport (%zu viewers): capture %ux%u -> %ux%u, region %s(%u,%u %ux%u)",
+             viewports.size(), viewport_.width, viewport_.height, format.width, format.height,
+             format.region.full() ? "full " : "", format.region.x, format.region.y,
+             format.region.width, format.region.height);
+    viewport_ = format;
+    viewport_candidate_.reset();
+
+    std::lock_guard lock(reconfigure_mutex_);
+    if (!pending_reconfigure_) pending_reconfigure_ = VideoFormat{};
+    pending_reconfigure_->width = format.width;
+    pending_reconfigure_->height = format.height;
+    pending_reconfigure_->region = format.region;
+}
+
+void HostSession::reconfigure(uint32_t width, uint32_t height, uint32_t fps) {
+    LOG_INFO(TAG, "Reconfigure requested: %ux%u @ %u fps (0 = unchanged)", width, height, fps);
+    if (width > 0) limit_width_ = width;
+    if (height > 0) limit_height_ = height;
+    if (width > 0 || height > 0) apply_size_limit();
+    if (fps > 0) {
+        // Autotuning picks up the new limit on its next window
+        fps_limit_ = fps;
+        std::lock_guard lock(reconfigure_mutex_);
+        if (!pending_reconfigure_) pending_reconfigure_ = VideoFormat{};
+        pending_reconfigure_->fps = fps;
+    }
+}
+
+void HostSession::apply_size_limit() {
+    uint32_t step = scale_step_.load();
+    uint32_t w = limit_width_.load();
+    uint32_t h = limit_height_.load();
+    if (step > 0) {
+        w = std::max(2u, static_cast<uint32_t>(w * AUTOTUNE_SCALES[step]) & ~1u);
+        h = std::max(2u, static_cast<uint32_t>(h * AUTOTUNE_SCALES[step]) & ~1u);
+    }
+
+    if (viewport_scaling_) {
+        // The size is a limit; check_viewport() picks the actual one
+        max_width_ = w;
+        max_height_ = h;
+        viewport_limit_changed_ = true;
+        return;
+    }
+    std::lock_guard lock(reconfigure_mutex_);
+    if (!pending_reconfigure_) pending_reconfigure_ = VideoFormat{};
+    pending_reconfigure_->width = w;
+    pending_reconfigure_->height = h;
+}
+
+void HostSession::check_autotune() {
+    if (!autotune_) return;
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_autotune_).count();
+    if (now - last_autotune_ < AUTOTUNE_INTERVAL) return;
+    last_autotune_ = now;
+
+    // Close the window even when idle so the next one starts clean
+    int64_t cpu_ns = PerfCounters::process_cpu_ns();
+    int64_t cpu_delta = cpu_ns - autotune_cpu_ns_;
+    autotune_cpu_ns_ = cpu_ns;
+    auto net = server_->stats();
+    uint64_t lost = net.send_drops + net.frames_cut;
+    bool network_loss = lost > autotune_lost_;
+    autotune_lost_ = lost;
+
+    AutotuneSample sample;
+    sample.capture_ms = capture_us_.take() / 1000.0;
+    sample.encode_ms = encode_us_.take() / 1000.0;
+    sample.send_ms = send_us_.take() / 1000.0;
+    sample.motion = motion_ppm_.take() / 1e6;
+    if (idle_.load() || sample.encode_ms <= 0.0) return;
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    sample.cpu_load = cpu_delta / 1e9 / secs / cores;
+    sample.network_loss = network_loss;
+    {
+        std::lock_guard lock(bitrate_mutex_);
+        sample.bitrate = current_bitrate_;
+    }
+    AutotuneSettings current;
+    current.scale_step = scale_step_.load();
+    current.fps = fps_.load();
+    current.preset = encoder_->preset();
+    double scale = AUTOTUNE_SCALES[current.scale_step];
+    uint64_t pixels = static_cast<uint64_t>(encoded_width_.load()) * encoded_height_.load();
+    sample.full_pixels = static_cast<uint64_t>(pixels / (scale * scale));
+    autotune_sample_ = sample;
+
+    AutotuneLimits limits = autotuner_.limits();
+    limits.max_fps = fps_limit_.load();
+    autotuner_.set_limits(limits);
+
+    AutotuneSettings next = autotuner_.update(current, sample);
+    if (next == current) return;
+
+    autotune_changes_++;
+    LOG_INFO(TAG, "Autotune: %s (scale %.0f%%, %u fps, preset %s; capture %.1f, encode %.1f, "
+                  "send %.1f ms, CPU %.0f%%, motion %.1f%%, %u kbps)",
+             autotuner_.reason().c_str(), AUTOTUNE_SCALES[next.scale_step] * 100, next.fps,
+             ENCODER_PRESETS[next.preset], sample.capture_ms, sample.encode_ms, sample.send_ms,
+             sample.cpu_load * 100, sample.motion * 100, sample.bitrate / 1000);
+
+    if (next.preset != current.preset && !encoder_->set_preset(next.preset)) {
+        LOG_WARN(TAG, "Autotune: encoder can't switch to preset %s", ENCODER_PRESETS[next.preset]);
+    }
+    if (next.scale_step != current.scale_step) {
+        scale_step_ = next.scale_step;
+        apply_size_limit();
+    }
+    if (next.fps != current.fps) {
+        std::lock_guard lock(reconfigure_mutex_);
+        if (!pending_reconfigure_) pending_reconfigure_ = VideoFormat{};
+        pending_reconfigure_->fps = next.fps;
+    }
+}
+
+void HostSession::apply_pending_reconfigure() {
+    std::optional<VideoFormat> request;
+    {
+        std::lock_guard lock(reconfigure_mutex_);
+        request.swap(pending_reconfigure_);
+    }
+    if (!request) return;
+
+    // The encoder follows on the first frame captured at the new size
+    if (request->width > 0 || request->height > 0) {
+        uint32_t w = request->width > 0 ? request->width : capture_->target_width();
+        uint32_t h = request->height > 0 ? request->height : capture_->target_height();
+        if (!capture_->set_target_size(w, h)) {
+            LOG_WARN(TAG, "Capture can't switch to %ux%u, staying at %ux%u",
+                     w, h, capture_->target_width(), capture_->target_height());
+        }
+    }
+    if (request->region && !capture_->set_source_region(*request->region)) {
+        LOG_WARN(TAG, "Capture can't switch source region, keeping the previous one");
+    } else if (request->region) {
+        streams_.front()->capture_region = *request->region;
+    }
+    if (request->fps > 0) {
+        fps_ = request->fps;
+        uint32_t ceiling = server_->fps_ceiling();
+        capture_fps_ = ceiling > 0 ? std::min(ceiling, request->fps) : request->fps;
+    }
+
+    LOG_INFO(TAG, "Reconfigured: capture %ux%u @ %u fps",
+             capture_->target_width(), capture_->target_height(), fps_.load());
+}
+
+void HostSession::publish_stream_config(VideoStream& stream, uint16_t frame_id) {
+    std::lock_guard lock(stream.config_mutex);
+    if (!stream.pending_config) return;
+    // Frames still in flight from before the switch keep the old config
+    if (static_cast<int16_t>(frame_id - stream.pending_config->frame_id) < 0) return;
+
+    server_->update_stream_config(stream.pending_config->config, stream.id);
+    stream.pending_config.reset();
+    stream.config_pending = false;
+}
+
+void HostSession::apply_probed_bitrate(uint32_t start_bitrate) {
+    std::lock_guard lock(bitrate_mutex_);
+    // The first viewer sets the starting point; later ones can only lower it
+    uint32_t base = idle_.load() ? target_bitrate_.load() : current_bitrate_;
+    uint32_t bitrate = std::min(base, start_bitrate);
+    if (bitrate == current_bitrate_) return;
+
+    LOG_INFO(TAG, "Probed start bitrate: %u -> %u", current_bitrate_, bitrate);
+    if (encoder_->set_bitrate(bitrate)) {
+        current_bitrate_ = bitrate;
+    }
+}
+
+void HostSession::set_idle(bool idle) {
+    {
+        // Held throughout so concurrent calls can't both act on one transition
+        std::lock_guard lock(idle_mutex_);
+        if (idle_.load() == idle) return;
+
+        auto now = std::chrono::steady_clock::now();
+        int64_t cpu_ns = PerfCounters::process_cpu_ns();
+        if (idle) {
+            idle_since_ = now;
+            idle_cpu_start_ns_ = cpu_ns;
+            LOG_INFO(TAG, "No viewers left, pipeline idle");
+        } else {
+            double secs = std::chrono::duration<double>(now - idle_since_).count();
+            double cpu_pct = secs > 0 ? 100.0 * (cpu_ns - idle_cpu_start_ns_) / 1e9 / secs : 0.0;
+            LOG_INFO(TAG, "Viewer connected, resuming pipeline (idle %.0f s at %.2f%% CPU)",
+                     secs, cpu_pct);
+            startup_.mark_once("first_viewer");
+            for (auto& stream : streams_) stream->encoder->request_keyframe();
+        }
+        idle_.store(idle);
+    }
+    idle_cv_.notify_all();
+}
+
+bool HostSession::wait_while_idle(lancast::stop_token st) {
+    if (!idle_.load(std::memory_order_relaxed)) return false;
+
+    std::unique_lock lock(idle_mutex_);
+    while (idle_.load() && !st.stop_requested() && running_->load()) {
+        // Timed so a stop request is noticed even without a notify
+        idle_cv_.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    return true;
+}
+
+void HostSession::log_stats() {
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_stats_log_).count();
+    if (secs < 5.0) return;
+    last_stats_log_ = now;
+
+    int64_t cpu_ns = PerfCounters::process_cpu_ns();
+    LOG_DEBUG(TAG, "Process CPU %.2f%% over %.0f s (%s)",
+              100.0 * (cpu_ns - last_stats_cpu_ns_) / 1e9 / secs, secs,
+              idle_.load() ? "idle" : "streaming");
+    last_stats_cpu_ns_ = cpu_ns;
+
+    auto net = server_->stats();
+    if (net.evictions > 0) {
+        LOG_DEBUG(TAG, "Clients evicted for silence: %llu (%llu resumed)",
+                  static_cast<unsigned long long>(net.evictions),
+                  static_cast<unsigned long long>(net.resumptions));
+    }
+    if (net.send_retries > 0 || net.send_drops > 0) {
+        LOG_DEBUG(TAG, "Send backpressure: %llu waits, %llu datagrams dropped locally, %llu frames cut",
+                  static_cast<unsigned long long>(net.send_retries),
+                  static_cast<unsigned long long>(net.send_drops),
+                  static_cast<unsigned long long>(net.frames_cut));
+    }
+    if (net.tx_timestamps > 0) {
+        LOG_DEBUG(TAG, "Kernel delay: tx %.3f ms (send -> wire), rx %.3f ms (arrival -> handled)",
+                  net.tx_queue_ms, net.rx_queue_ms);
+    }
+
+    if (autotune_) {
+        const auto& a = autotune_sample_;
+        LOG_DEBUG(TAG, "Autotune: scale %.0f%%, %u fps, preset %s (%llu changes); last window "
+                       "capture %.1f, encode %.1f, send %.1f ms, CPU %.0f%%, motion %.1f%%",
+                  AUTOTUNE_SCALES[scale_step_.load()] * 100, fps_.load(),
+                  ENCODER_PRESETS[encoder_->preset()],
+                  static_cast<unsigned long long>(autotune_changes_),
+                  a.capture_ms, a.encode_ms, a.send_ms, a.cpu_load * 100, a.motion * 100);
+    }
+
+    if (!PerfCounters::enabled()) return;
+    std::string report = PerfCounters::report();
+    if (!report.empty()) {
+        LOG_INFO(TAG, "Per-frame stage counters (%zu clients, %u bps):\n%s",
+                 server_->client_count(), current_bitrate_, report.c_str());
+    }
 }
 
 void HostSession::audio_capture_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Audio capture loop started");
+    Tracer::set_thread_name("audio_capture");
 
     while (!st.stop_requested() && running_->load()) {
+        if (idle_.load(std::memory_order_relaxed)) {
+            audio_capture_->set_paused(true);
+            wait_while_idle(st);
+            if (!idle_.load()) audio_capture_->set_paused(false);
+            continue;
+        }
+
         auto frame = audio_capture_->capture_frame();
         if (frame) {
+            // Returned once the whole frame is in, so it began one frame ago
+            int64_t duration_us = frame->sample_rate > 0
+                ? int64_t{frame->num_samples} * 1'000'000 / frame->sample_rate : 0;
+            frame->pts_us = media_clock_.now_us() - duration_us;
             audio_raw_queue_.push(std::move(*frame));
         }
     }
@@ -326,12 +1037,17 @@ void HostSession::audio_capture_loop(lancast::stop_token st) {
 
 void HostSession::audio_encode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Audio encode loop started");
+    Tracer::set_thread_name("audio_encode");
 
     while (!st.stop_requested() && running_->load()) {
         auto frame = audio_raw_queue_.wait_pop(std::chrono::milliseconds(50));
         if (frame) {
+            int64_t t0 = Tracer::enabled() ? Tracer::now_us() : 0;
             auto encoded = audio_encoder_->encode(*frame);
             if (encoded) {
+                // Audio frame ids come from the encoder, so record the span afterwards
+                if (t0) Tracer::complete("audio_encode", encoded->frame_id, t0, Tracer::now_us());
+                replay_.add_audio(*encoded);
                 audio_encoded_queue_.push(std::move(*encoded));
             }
         }
@@ -342,6 +1058,7 @@ void HostSession::audio_encode_loop(lancast::stop_token st) {
 
 void HostSession::client_audio_decode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Client audio decode loop started");
+    Tracer::set_thread_name("client_audio_decode");
 
     while (!st.stop_requested() && running_->load()) {
         auto packet = client_audio_queue_.wait_pop(std::chrono::milliseconds(50));
@@ -356,4 +1073,249 @@ void HostSession::client_audio_decode_loop(lancast::stop_token st) {
     LOG_INFO(TAG, "Client audio decode loop ended");
 }
 
+void HostSession::control_loop(lancast::stop_token st) {
+    Tracer::set_thread_name("control");
+
+    auto handler = [this](const ControlRequest& request) { return handle_control(request); };
+    while (!st.stop_requested() && running_->load()) {
+        control_.poll(100, handler);
+    }
+}
+
+static const char* log_level_name(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info: return "info";
+        case LogLevel::Warn: return "warn";
+        case LogLevel::Error: return "error";
+    }
+    return "info";
+}
+
+static std::optional<LogLevel> parse_log_level(const std::string& name) {
+    if (name == "debug") return LogLevel::Debug;
+    if (name == "info") return LogLevel::Info;
+    if (name == "warn") return LogLevel::Warn;
+    if (name == "error") return LogLevel::Error;
+    return std::nullopt;
+}
+
+std::string HostSession::handle_control(const ControlRequest& request) {
+    if (request.cmd == "status") return control_status();
+    if (request.cmd == "set") return control_set(request);
+    if (request.cmd == "replay") return control_replay(request);
+    return control_error("unknown command \"" + request.cmd + "\" (status, set, replay)");
+}
+
+std::string HostSession::control_status() {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t current_bitrate;
+    {
+        std::lock_guard lock(bitrate_mutex_);
+        current_bitrate = current_bitrate_;
+    }
+    auto net = server_->stats();
+    auto clients = server_->client_stats();
+
+    JsonWriter json;
+    json.begin_object().field("ok", true).field("log_level", log_level_name(Logger::level()));
+    json.begin_array("sessions").begin_object()
+        .field("role", "host")
+        .field("port", static_cast<uint32_t>(port_))
+        .field("uptime_s", std::chrono::duration<double>(now - started_).count())
+        .field("idle", idle_.load());
+
+    json.begin_object("encoder")
+        .field("codec", "h264")
+        .field("width", encoded_width_.load())
+        .field("height", encoded_height_.load())
+        .field("fps", fps_.load())
+        .field("capture_fps", capture_fps_.load())
+        .field("fps_limit", fps_limit_.load())
+        .field("width_limit", limit_width_.load())
+        .field("height_limit", limit_height_.load())
+        .field("bitrate", current_bitrate)
+        .field("target_bitrate", target_bitrate_.load())
+        .field("preset", ENCODER_PRESETS[encoder_->preset()])
+        .field("autotune", autotune_)
+        .field("autotune_scale", AUTOTUNE_SCALES[scale_step_.load()])
+        .field("viewport_scaling", viewport_scaling_)
+        .end_object();
+
+    if (replay_.is_running()) {
+        auto replay = replay_.stats();
+        json.begin_object("replay")
+            .field("seconds", replay.seconds)
+            .field("bytes", static_cast<uint64_t>(replay.bytes_used))
+            .field("capacity", static_cast<uint64_t>(replay.capacity))
+            .field("dropped", replay.packets_dropped)
+            .end_object();
+    }
+
+    json.begin_array("streams");
+    for (const auto& stream : streams_) {
+        auto config = server_->stream_config(stream->id);
+        json.begin_object()
+            .field("id", static_cast<uint32_t>(stream->id))
+            .field("width", config.width)
+            .field("height", config.height)
+            .field("fps", config.fps)
+            .field("subscribers", static_cast<uint64_t>(server_->subscribers(stream->id)))
+            .end_object();
+    }
+    json.end_array();
+
+    json.begin_object("network")
+        .field("clients", static_cast<uint64_t>(clients.size()))
+        .field("pacing_override_bps", server_->pacing_override())
+        .field("rx_packets", net.rx_packets)
+        .field("send_retries", net.send_retries)
+        .field("send_drops", net.send_drops)
+        .field("frames_cut", net.frames_cut)
+        .field("evictions", net.evictions)
+        .field("resumptions", net.resumptions)
+        .field("tx_queue_ms", net.tx_queue_ms)
+        .field("rx_queue_ms", net.rx_queue_ms)
+        .end_object();
+
+    json.begin_array("clients");
+    for (const auto& c : clients) {
+        json.begin_object()
+            .field("address", c.endpoint.ip + ":" + std::to_string(c.endpoint.port))
+            .field("state", c.probing ? "probing" : c.awaiting_keyframe ? "awaiting_keyframe" : "streaming")
+            .field("connected_s", c.connected_s)
+            .field("silent_ms", c.silent_ms)
+            .field("rtt_ms", c.rtt_ms)
+            .field("probed_bitrate", c.probed_bitrate)
+            .field("pacing_bps", c.pacing_bps)
+            .field("fps_limit", c.fps_limit)
+            .field("frames_sent", c.frames_sent)
+            .field("bytes_sent", c.bytes_sent)
+            .field("frames_cut", c.frames_cut)
+            .field("subscriptions", static_cast<uint32_t>(c.subscriptions))
+            .field("viewport_width", static_cast<uint32_t>(c.viewport.drawable_width))
+            .field("viewport_height", static_cast<uint32_t>(c.viewport.drawable_height))
+            .end_object();
+    }
+    json.end_array();
+
+    json.end_object().end_array().end_object();
+    return json.str();
+}
+
+std::string HostSession::control_set(const ControlRequest& request) {
+    // Validate everything first so a bad value changes nothing
+    std::optional<uint32_t> bitrate, fps, pacing;
+    uint32_t width = 0, height = 0;
+    std::optional<LogLevel> level;
+
+    for (const auto& [key, value] : request.args) {
+        if (key == "bitrate") {
+            auto v = request.uint_arg(key);
+            if (!v || *v < 100'000 || *v > 500'000'000) return control_error("bitrate: 100000..500000000 bps");
+            bitrate = static_cast<uint32_t>(*v);
+        } else if (key == "fps") {
+            auto v = request.uint_arg(key);
+            if (!v || *v < 1 || *v > 240) return control_error("fps: 1..240");
+            fps = static_cast<uint32_t>(*v);
+        } else if (key == "resolution") {
+            unsigned w = 0, h = 0;
+            if (sscanf(value.c_str(), "%ux%u", &w, &h) != 2 || w < 2 || h < 2 || w > 16384 || h > 16384) {
+                return control_error("resolution: WxH, e.g. 1920x1080");
+            }
+            width = w & ~1u;
+            height = h & ~1u;
+        } else if (key == "pacing") {
+            // "auto" (or 0) hands pacing back to each client's probe
+            auto v = request.uint_arg(key);
+            if (value == "auto") v = 0;
+            if (!v || (*v > 0 && *v < 100'000)) return control_error("pacing: \"auto\" or a rate of at least 100000 bps");
+            pacing = static_cast<uint32_t>(*v);
+        } else if (key == "fec") {
+            return control_error("fec: this build sends no FEC; loss is repaired by keyframe NACK");
+        } else if (key == "log_level") {
+            level = parse_log_level(value);
+            if (!level) return control_error("log_level: debug, info, warn or error");
+        } else {
+            return control_error("unknown setting \"" + key + "\" (bitrate, fps, resolution, pacing, fec, log_level)");
+        }
+    }
+    if (request.args.empty()) return control_error("nothing to set");
+
+    LOG_INFO(TAG, "Control: applying %zu setting(s)", request.args.size());
+    JsonWriter json;
+    json.begin_object().field("ok", true).begin_array("applied");
+    if (level) {
+        Logger::set_level(*level);
+        json.field(nullptr, "log_level");
+    }
+    if (bitrate) {
+        set_bitrate(*bitrate);
+        json.field(nullptr, "bitrate");
+    }
+    if (pacing) {
+        server_->set_pacing_override(*pacing);
+        LOG_INFO(TAG, "Pacing: %s", *pacing ? std::to_string(*pacing).c_str() : "per-client probe");
+        json.field(nullptr, "pacing");
+    }
+    if (width > 0 || fps) {
+        // Capture picks it up on its next frame; clients switch at the following keyframe
+        reconfigure(width, height, fps.value_or(0));
+        if (width > 0) json.field(nullptr, "resolution");
+        if (fps) json.field(nullptr, "fps");
+    }
+    json.end_array().end_object();
+    return json.str();
+}
+
+// lancast-replay-YYYYmmdd-HHMMSS.mkv in the working directory
+static std::string default_replay_path() {
+    std::time_t now = std::time(nullptr);
+    std::tm local{};
+#if defined(_WIN32)
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char name[64];
+    std::strftime(name, sizeof(name), "lancast-replay-%Y%m%d-%H%M%S.mkv", &local);
+    return name;
+}
+
+std::string HostSession::control_replay(const ControlRequest& request) {
+    if (!replay_.is_running()) return control_error("replay: the host was started without --replay");
+    uint64_t seconds = replay_seconds_;
+    if (request.has("seconds")) {
+        auto v = request.uint_arg("seconds");
+        if (!v || *v < 1 || *v > 3600) return control_error("seconds: 1..3600");
+        seconds = *v;
+    }
+    std::string path = request.string_arg("path").value_or(default_replay_path());
+
+    LOG_INFO(TAG, "Control: saving the last %llu s of replay", static_cast<unsigned long long>(seconds));
+    auto result = replay_.save(path, std::chrono::seconds(seconds));
+    if (!result.ok) return control_error("replay: " + result.error);
+
+    JsonWriter json;
+    json.begin_object().field("ok", true).begin_array("files");
+    for (const auto& file : result.files) json.field(nullptr, file);
+    json.end_array()
+        .field("seconds", result.seconds)
+        .field("packets", result.packets)
+        .field("bytes", result.bytes)
+        .end_object();
+    return json.str();
+}
+
+void HostSession::set_bitrate(uint32_t bitrate) {
+    std::lock_guard lock(bitrate_mutex_);
+    target_bitrate_ = bitrate;
+    uint32_t ceiling = server_ ? server_->probed_bitrate_ceiling() : 0;
+    uint32_t effective = ceiling > 0 ? std::min(bitrate, ceiling) : bitrate;
+    LOG_INFO(TAG, "Target bitrate set to %u (applying %u)", bitrate, effective);
+    if (effective != current_bitrate_ && encoder_ && encoder_->set_bitrate(effective)) {
+        current_bitrate_ = effective;
+    }
+}
+
 } // namespace lancast
@@ -7,12 +7,21 @@
 #include "decode/audio_decoder.h"
 #include "render/audio_player.h"
 #include "net/server.h"
+#include "net/control_socket.h"
+#include "record/replay_buffer.h"
+#include "core/autotune.h"
+#include "core/clock.h"
+#include "core/startup_timeline.h"
 #include "core/ring_buffer.h"
 #include "core/thread_safe_queue.h"
 #include "core/types.h"
 #include "core/jthread.h"
 #include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
 
 namespace lancast {
 
@@ -21,25 +30,140 @@ public:
     HostSession() = default;
     ~HostSession();
 
+    // Receive control/mic traffic on this many SO_REUSEPORT sockets (call before start)
+    void set_receive_shards(size_t shards) { receive_shards_ = shards; }
+
+    // Kernel TX timestamps on everything sent, for the send queue delay
+    // (default off; call before start)
+    void set_tx_timestamps(bool enabled) { tx_timestamps_ = enabled; }
+
+    // Evict clients silent for this long (call before start)
+    void set_client_timeout(std::chrono::milliseconds timeout) { liveness_.evict_after = timeout; }
+
+    // Follow viewer window sizes and zoom regions (default on; call before start)
+    void set_viewport_scaling(bool enabled) { viewport_scaling_ = enabled; }
+
+    // Let the host pick resolution, frame rate and encoder preset within the
+    // configured limits (default off; call before start)
+    void set_autotune(bool enabled) { autotune_ = enabled; }
+
+    // Serve status and live settings on a local control socket (call before start)
+    void set_control_socket(const std::string& path) { control_path_ = path; }
+
+    // Keep the last `seconds` of the primary stream and the audio in a
+    // replay buffer, saved on request over the control socket (call before
+    // start; 0 = off)
+    void set_replay_seconds(uint32_t seconds) { replay_seconds_ = seconds; }
+
+    // Offer another window (0 = whole screen) as an extra stream next to the
+    // primary one, at the primary's starting size and rate. Clients pick the
+    // streams they want. Call before start; up to MAX_STREAMS - 1.
+    void add_stream(uint64_t window_id) { extra_windows_.push_back(window_id); }
+
     bool start(uint16_t port, uint32_t fps, uint32_t bitrate,
                uint32_t width, uint32_t height, uint64_t window_id,
                std::atomic<bool>& running);
     void stop();
     bool is_running() const { return running_ != nullptr && running_->load(); }
 
+    // Switch capture size and frame rate mid-stream (0 keeps the current
+    // value). Safe from any thread; capture picks it up on its next frame,
+    // clients switch at the keyframe that follows. With viewport scaling
+    // the size becomes the upper limit for what viewers can ask for; with
+    // autotuning both become limits the controller works within.
+    void reconfigure(uint32_t width, uint32_t height, uint32_t fps);
+
+    // New target bitrate. The RTT controller and probed ceilings still
+    // apply on top of it. Safe from any thread.
+    void set_bitrate(uint32_t bitrate);
+
+    // Setup phases since the session was created, up to the first frame sent
+    const StartupTimeline& startup() const { return startup_; }
+
 private:
+    struct VideoStream;
+
+    // Setup steps start() runs side by side. Video leaves the stream's
+    // capture and encoder unset on failure; audio is optional.
+    bool init_stream_video(VideoStream& stream, uint32_t width, uint32_t height, uint32_t bitrate);
+    void init_audio();
+    void init_client_audio();
+    StreamConfig stream_config(const VideoStream& stream) const;
+    void add_extra_stream(std::unique_ptr<VideoStream> stream);
+    void shutdown_media();
     void capture_loop(lancast::stop_token st);
+    void extra_capture_loop(lancast::stop_token st, VideoStream& stream);
     void encode_loop(lancast::stop_token st);
+    void encode_frame(VideoStream& stream, RawVideoFrame& raw_frame);
     void network_send_loop(lancast::stop_token st);
     void server_poll_loop(lancast::stop_token st);
+    void server_shard_loop(lancast::stop_token st, size_t shard);
     void audio_capture_loop(lancast::stop_token st);
     void audio_encode_loop(lancast::stop_token st);
     void client_audio_decode_loop(lancast::stop_token st);
+    void control_loop(lancast::stop_token st);
+    std::string handle_control(const ControlRequest& request);
+    std::string control_status();
+    std::string control_set(const ControlRequest& request);
+    std::string control_replay(const ControlRequest& request);
 
     void check_adaptive_bitrate();
+    void apply_probed_bitrate(uint32_t start_bitrate);
+    void check_client_load();
+    void check_viewport();
+    void check_autotune();
+    void apply_size_limit();
+    void apply_pending_reconfigure();
+    void publish_stream_config(VideoStream& stream, uint16_t frame_id);
+    void log_stats();
+
+    // Idle mode: capture, encode and audio sleep while no clients are connected
+    void set_idle(bool idle);
+    bool wait_while_idle(lancast::stop_token st);
 
-    std::unique_ptr<ICaptureSource> capture_;
-    std::unique_ptr<VideoEncoder> encoder_;
+    // Live reconfiguration. Capture applies a request; encode rebuilds the
+    // encoder when frames change size; send announces the new config right
+    // before the first frame encoded with it.
+    struct VideoFormat {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t fps = 0;
+        std::optional<SourceRegion> region;  // Unset = unchanged
+    };
+    struct PendingStreamConfig {
+        StreamConfig config;
+        uint16_t frame_id = 0;  // First frame encoded with it
+    };
+
+    // One captured and encoded video stream. streams_[0] is the primary
+    // stream, which reconfiguration, viewport scaling and autotuning act on;
+    // extra streams keep their starting format and only capture while
+    // someone is subscribed. Encode workers share all of them: whoever
+    // claims a stream encodes its next frame, so each stream stays in order.
+    struct VideoStream {
+        uint8_t id = 0;
+        uint64_t window_id = 0;                         // 0 = whole screen
+        std::unique_ptr<ICaptureSource> capture;
+        std::unique_ptr<VideoEncoder> encoder;
+        uint32_t fps = 30;                              // Extra streams; the primary follows fps_
+        RingBuffer<RawVideoFrame, 4> raw_buffer;        // capture -> encode
+        RingBuffer<EncodedPacket, 4> encoded_buffer;    // encode -> send
+        std::atomic<bool> encoding{false};              // Claimed by an encode worker
+        uint16_t next_frame_id = 0;       // Capture thread only; assigned at capture
+        SourceRegion capture_region;      // Capture thread only; tags each raw frame
+        SourceRegion encoded_region;      // Claim holder only
+        uint32_t encoder_generation = 0;  // Claim holder only
+        std::mutex config_mutex;
+        std::optional<PendingStreamConfig> pending_config;  // Guarded by config_mutex
+        std::atomic<bool> config_pending{false};
+        lancast::jthread capture_thread;  // Extra streams; the primary's is capture_thread_
+    };
+
+    std::vector<std::unique_ptr<VideoStream>> streams_;
+    std::vector<uint64_t> extra_windows_;
+    // The primary stream's capture and encoder
+    ICaptureSource* capture_ = nullptr;
+    VideoEncoder* encoder_ = nullptr;
     std::unique_ptr<IAudioCapture> audio_capture_;
     std::unique_ptr<AudioEncoder> audio_encoder_;
     std::unique_ptr<Server> server_;
@@ -49,27 +173,118 @@ private:
     std::unique_ptr<AudioPlayer> client_audio_player_;
     ThreadSafeQueue<EncodedPacket> client_audio_queue_{8};
 
-    RingBuffer<RawVideoFrame, 4> raw_buffer_;       // capture -> encode
-    RingBuffer<EncodedPacket, 4> encoded_buffer_;    // encode -> send
-
     ThreadSafeQueue<RawAudioFrame> audio_raw_queue_{8};       // audio capture -> encode
     ThreadSafeQueue<EncodedPacket> audio_encoded_queue_{16};   // audio encode -> send
 
     std::atomic<bool>* running_ = nullptr;
-    uint32_t fps_ = 30;
-    uint32_t target_bitrate_ = 6000000;
+    // Capture times of video and audio frames. The capture sources' own
+    // stamps don't share an origin, so the session sets them from this.
+    Clock media_clock_;
+    std::atomic<uint32_t> fps_{30};          // Configured rate; changed by reconfigure()
+    std::atomic<uint32_t> capture_fps_{30};  // fps_, or lower while a viewer can't keep up
+    std::atomic<uint32_t> target_bitrate_{6000000};  // Written under bitrate_mutex_
     uint32_t current_bitrate_ = 6000000;
+    Server::LivenessConfig liveness_;
+    size_t receive_shards_ = 1;
+    bool tx_timestamps_ = false;
 
     lancast::jthread capture_thread_;
-    lancast::jthread encode_thread_;
+    std::vector<lancast::jthread> encode_threads_;  // Shared by every stream
     lancast::jthread send_thread_;
     lancast::jthread poll_thread_;
+    std::vector<lancast::jthread> shard_threads_;  // Receive shards 1..n-1
     lancast::jthread audio_capture_thread_;
     lancast::jthread audio_encode_thread_;
     lancast::jthread client_audio_decode_thread_;
+    lancast::jthread control_thread_;
+
+    // Primary stream reconfiguration requests
+    std::mutex reconfigure_mutex_;
+    std::optional<VideoFormat> pending_reconfigure_;
 
     // Adaptive bitrate timing
     std::chrono::steady_clock::time_point last_bitrate_check_;
+    std::mutex bitrate_mutex_;  // current_bitrate_ changes from the poll and receive threads
+
+    // Client load reports (poll thread only)
+    static constexpr auto LOAD_CHECK_INTERVAL = std::chrono::seconds(1);
+    std::chrono::steady_clock::time_point last_load_check_;
+
+    // Viewport-driven capture (poll thread only). The configured size caps
+    // what viewers can ask for; a new format waits for viewers to settle
+    // (window drags, zoom gestures) so it doesn't restart the encoder repeatedly.
+    static constexpr auto VIEWPORT_CHECK_INTERVAL = std::chrono::milliseconds(500);
+    static constexpr auto VIEWPORT_SETTLE = std::chrono::milliseconds(500);
+    bool viewport_scaling_ = true;
+    std::atomic<uint32_t> max_width_{0};   // Operator limit scaled by autotuning
+    std::atomic<uint32_t> max_height_{0};
+    std::atomic<bool> viewport_limit_changed_{false};
+    uint32_t source_width_ = 0;
+    uint32_t source_height_ = 0;
+    ViewportFormat viewport_;
+    std::optional<ViewportFormat> viewport_candidate_;
+    std::chrono::steady_clock::time_point viewport_candidate_since_;
+    std::chrono::steady_clock::time_point last_viewport_check_;
+
+    // Autotuning (poll thread only). The operator's size and frame rate are
+    // limits; the controller scales the size down a step at a time, picks a
+    // frame rate below the limit and an encoder preset. Stage times and
+    // motion are averaged over each window by the pipeline threads.
+    struct WindowMean {
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint32_t> count{0};
+        void add(uint64_t value) {
+            total.fetch_add(value, std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+        }
+        double take() {
+            uint64_t t = total.exchange(0, std::memory_order_relaxed);
+            uint32_t n = count.exchange(0, std::memory_order_relaxed);
+            return n > 0 ? static_cast<double>(t) / n : 0.0;
+        }
+    };
+    static constexpr auto AUTOTUNE_INTERVAL = std::chrono::seconds(2);
+    bool autotune_ = false;
+    Autotuner autotuner_;
+    std::atomic<uint32_t> limit_width_{0};
+    std::atomic<uint32_t> limit_height_{0};
+    std::atomic<uint32_t> fps_limit_{30};
+    std::atomic<uint32_t> scale_step_{0};       // Index into AUTOTUNE_SCALES
+    std::atomic<uint32_t> encoded_width_{0};    // Size of the last encoded frame
+    std::atomic<uint32_t> encoded_height_{0};
+    WindowMean capture_us_;
+    WindowMean encode_us_;
+    WindowMean send_us_;
+    WindowMean motion_ppm_;                     // Changed share of the picture, parts per million
+    MotionSampler motion_sampler_;              // Capture thread only
+    AutotuneSample autotune_sample_;            // Last window, for the stats log
+    uint64_t autotune_changes_ = 0;
+    uint64_t autotune_lost_ = 0;
+    int64_t autotune_cpu_ns_ = 0;
+    std::chrono::steady_clock::time_point last_autotune_;
+
+    // Control socket (control thread only)
+    std::string control_path_;
+    ControlSocket control_;
+    uint16_t port_ = 0;
+    std::chrono::steady_clock::time_point started_;
+
+    // Instant replay (encode and audio encode threads feed it; the control thread saves)
+    uint32_t replay_seconds_ = 0;
+    ReplayBuffer replay_;
+
+    StartupTimeline startup_;
+
+    // Periodic stats log (poll thread only)
+    std::chrono::steady_clock::time_point last_stats_log_;
+    int64_t last_stats_cpu_ns_ = 0;
+
+    // Idle state; transitions come from the receive threads (idle_mutex_)
+    std::atomic<bool> idle_{true};
+    std::mutex idle_mutex_;
+    std::condition_variable idle_cv_;
+    std::chrono::steady_clock::time_point idle_since_;
+    int64_t idle_cpu_start_ns_ = 0;
 };
 
 } // namespace lancast
@@ -0,0 +1,377 @@
+#include "app/mosaic_session.h"
+#include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/round_robin.h"
+#include "core/timing.h"
+#include "core/trace.h"
+#include "net/viewport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace lancast {
+
+static constexpr const char* TAG = "MosaicSession";
+static constexpr uint32_t WINDOW_WIDTH = 1280;
+static constexpr uint32_t WINDOW_HEIGHT = 720;
+static constexpr auto OVERLAY_REFRESH = std::chrono::milliseconds(500);
+static constexpr auto LOAD_REPORT_INTERVAL = std::chrono::seconds(1);
+static constexpr auto VIEWPORT_CHECK_INTERVAL = std::chrono::milliseconds(250);
+static constexpr auto VIEWPORT_RESEND_INTERVAL = std::chrono::seconds(2);  // Heals a lost VIEWPORT
+static constexpr double EWMA_ALPHA = 0.1;
+
+MosaicSession::~MosaicSession() {
+    stop();
+}
+
+bool MosaicSession::connect(const std::vector<MosaicSource>& sources) {
+    for (const auto& source : sources) {
+        auto tile = std::make_unique<Tile>();
+        tile->index = tiles_.size();
+        tile->source = source;
+        tiles_.push_back(std::move(tile));
+    }
+
+    // Handshakes run side by side so an unreachable host costs one timeout, not N
+    {
+        std::vector<lancast::jthread> connectors;
+        for (auto& t : tiles_) {
+            Tile& tile = *t;
+            connectors.emplace_back([&tile](lancast::stop_token) {
+                const auto& src = tile.source;
+                if (src.stream != 0) tile.client.subscribe(static_cast<uint16_t>(1u << src.stream));
+                if (!tile.client.connect(src.host_ip, src.port)) {
+                    LOG_WARN(TAG, "Tile %zu: failed to connect to %s:%u", tile.index, src.host_ip.c_str(), src.port);
+                    return;
+                }
+                if (src.stream != 0) {
+                    auto streams = tile.client.streams();
+                    bool offered = std::any_of(streams.begin(), streams.end(),
+                                               [&](const StreamListEntry& s) { return s.stream_id == src.stream; });
+                    if (!offered) {
+                        LOG_WARN(TAG, "Tile %zu: %s offers no stream %u", tile.index, src.host_ip.c_str(), src.stream);
+                        tile.client.disconnect();
+                        return;
+                    }
+                }
+                tile.connected = true;
+            });
+        }
+        // SDL video comes up on this thread meanwhile
+        renderer_.prepare();
+    }
+
+    size_t connected = std::count_if(tiles_.begin(), tiles_.end(),
+                                     [](const std::unique_ptr<Tile>& t) { return t->connected; });
+    LOG_INFO(TAG, "Connected to %zu of %zu sources", connected, tiles_.size());
+    return connected > 0;
+}
+
+bool MosaicSession::init_decoder(Tile& tile) {
+    uint8_t stream = tile.source.stream;
+    tile.decoder_generation = tile.client.config_generation(stream);
+    auto config = tile.client.stream_config(stream);
+    if (config.width == 0) {
+        // Its config arrives ahead of its first keyframe; the list has the size
+        for (const auto& s : tile.client.streams()) {
+            if (s.stream_id != stream) continue;
+            config.width = s.width;
+            config.height = s.height;
+            config.fps = s.fps;
+        }
+    }
+    tile.decoder_config = config;
+
+    // The shared pool provides the parallelism; slice threads per tile would
+    // only oversubscribe the cores
+    tile.decoder = std::make_unique<VideoDecoder>();
+    tile.decoder->set_thread_count(1);
+    if (!tile.decoder->init(config.width, config.height, config.codec_data)) {
+        LOG_ERROR(TAG, "Tile %zu: failed to initialize video decoder", tile.index);
+        tile.decoder.reset();
+        return false;
+    }
+    LOG_INFO(TAG, "Tile %zu: %s:%u stream %u, %ux%u @ %u fps", tile.index,
+             tile.source.host_ip.c_str(), tile.source.port, stream, config.width, config.height, config.fps);
+    return true;
+}
+
+void MosaicSession::run(std::atomic<bool>& running) {
+    running_ = &running;
+
+    for (auto& tile : tiles_) {
+        if (tile->connected && !init_decoder(*tile)) {
+            tile->client.disconnect();
+            tile->connected = false;
+        }
+    }
+
+    if (!renderer_.init(WINDOW_WIDTH, WINDOW_HEIGHT, "lancast - mosaic")) {
+        LOG_ERROR(TAG, "Failed to initialize SDL renderer");
+        return;
+    }
+    renderer_.set_tile_count(tiles_.size());
+
+    // Tile cell sizes are known now; report them before the first keyframe
+    // so hosts start out at the size shown
+    send_viewports();
+
+    size_t live = 0;
+    for (auto& t : tiles_) {
+        if (!t->connected) continue;
+        Tile& tile = *t;
+        tile.recv_thread = lancast::jthread([this, &tile](lancast::stop_token st) { recv_loop(st, tile); });
+        tile.client.request_keyframe(tile.source.stream);
+        live++;
+    }
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    size_t decode_workers = std::min<size_t>(live, std::max(1u, hw / 2));
+    for (size_t i = 0; i < decode_workers; ++i) {
+        decode_threads_.emplace_back([this](lancast::stop_token st) { decode_loop(st); });
+    }
+    LOG_INFO(TAG, "Render loop started (%zu tiles, %zu decode threads)", tiles_.size(), decode_workers);
+
+    uint32_t frames_presented = 0;
+    auto last_frame_time = std::chrono::steady_clock::now();
+    last_stats_time_ = last_frame_time;
+    last_load_report_ = last_frame_time;
+    Tracer::set_thread_name("render");
+
+    while (running_->load()) {
+        Tracer::dump_if_requested();
+
+        if (!renderer_.poll_events()) {
+            running_->store(false);
+            break;
+        }
+        if (std::none_of(tiles_.begin(), tiles_.end(),
+                         [](const std::unique_ptr<Tile>& t) { return t->client.is_connected(); })) {
+            LOG_INFO(TAG, "All hosts disconnected");
+            break;
+        }
+
+        // Upload each tile's latest frame, then present once for all of them
+        bool updated = false;
+        for (auto& t : tiles_) {
+            Tile& tile = *t;
+            std::optional<RawVideoFrame> frame;
+            while (auto f = tile.decoded_queue.try_pop()) {
+                if (frame) tile.frames_skipped++;
+                frame = std::move(f);
+            }
+            if (!frame) continue;
+            {
+                TRACE_SCOPE("render", frame->frame_id);
+                renderer_.update_tile(tile.index, *frame);
+            }
+            tile.frames_rendered++;
+            updated = true;
+        }
+        if (updated) {
+            renderer_.present_tiles();
+            frames_presented++;
+            auto now = std::chrono::steady_clock::now();
+            renderer_.overlay().add_frame_time(
+                std::chrono::duration<double, std::milli>(now - last_frame_time).count());
+            last_frame_time = now;
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_stats_time_ >= OVERLAY_REFRESH) refresh_overlay_stats(frames_presented);
+        if (now - last_load_report_ >= LOAD_REPORT_INTERVAL) send_load_reports();
+        if (now - last_viewport_check_ >= VIEWPORT_CHECK_INTERVAL) send_viewports();
+    }
+
+    LOG_INFO(TAG, "Render loop ended (total presents: %u)", frames_presented);
+}
+
+void MosaicSession::stop() {
+    for (auto& tile : tiles_) {
+        if (tile->recv_thread.joinable()) tile->recv_thread.request_stop();
+    }
+    for (auto& t : decode_threads_) t.request_stop();
+    for (auto& tile : tiles_) {
+        if (tile->recv_thread.joinable()) tile->recv_thread.join();
+    }
+    for (auto& t : decode_threads_) {
+        if (t.joinable()) t.join();
+    }
+    decode_threads_.clear();
+
+    for (auto& tile : tiles_) {
+        tile->video_queue.close();
+        tile->audio_queue.close();
+        tile->decoded_queue.close();
+        if (tile->decoder) tile->decoder->shutdown();
+        tile->client.disconnect();
+    }
+    renderer_.shutdown();
+
+    LOG_INFO(TAG, "Mosaic session stopped");
+}
+
+void MosaicSession::refresh_overlay_stats(uint32_t frames_presented) {
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_stats_time_).count();
+
+    // Totals across tiles; decode time is the mean of the live tiles
+    PerfOverlay::Stats stats;
+    uint64_t bytes = 0, received = 0, lost = 0;
+    size_t decoding = 0;
+    for (auto& t : tiles_) {
+        Tile& tile = *t;
+        auto net = tile.client.stats();
+        bytes += net.bytes_received;
+        received += net.packets_received;
+        lost += net.packets_lost;
+        stats.jitter_ms = std::max(stats.jitter_ms, net.jitter_ms);
+        stats.frames_dropped += net.frames_dropped;
+        stats.video_queue += tile.video_queue.size();
+        stats.decoded_queue += tile.decoded_queue.size();
+        double decode_ms = tile.decode_ms.load(std::memory_order_relaxed);
+        if (decode_ms > 0.0) {
+            stats.decode_ms += decode_ms;
+            decoding++;
+        }
+    }
+    if (decoding > 0) stats.decode_ms /= decoding;
+    stats.fps = (frames_presented - last_frames_presented_) / secs;
+    stats.bitrate_mbps = (bytes - last_bytes_received_) * 8.0 / secs / 1e6;
+    stats.loss_pct = received + lost > 0 ? 100.0 * lost / (received + lost) : 0.0;
+    renderer_.overlay().set_stats(stats);
+
+    last_stats_time_ = now;
+    last_bytes_received_ = bytes;
+    last_frames_presented_ = frames_presented;
+}
+
+void MosaicSession::send_load_reports() {
+    auto now = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(now - last_load_report_).count();
+    last_load_report_ = now;
+
+    // Each host sees only its own tile, as if it had a viewer of its own
+    for (auto& t : tiles_) {
+        Tile& tile = *t;
+        if (!tile.client.is_connected()) continue;
+        uint32_t decoded = tile.frames_decoded.load(std::memory_order_relaxed);
+        uint64_t discarded = tile.video_queue.dropped() + tile.decoded_queue.dropped() + tile.frames_skipped;
+
+        ClientReportPayload report;
+        report.rendered_fps_x10 = static_cast<uint16_t>(
+            std::min(10.0 * (tile.frames_rendered - tile.reported_rendered) / secs, 65535.0));
+        report.decoded = static_cast<uint16_t>(std::min<uint32_t>(decoded - tile.reported_decoded, 65535));
+        report.discarded = static_cast<uint16_t>(std::min<uint64_t>(discarded - tile.reported_discarded, 65535));
+        report.decode_us = static_cast<uint32_t>(tile.decode_ms.load(std::memory_order_relaxed) * 1000.0);
+        report.video_queue = static_cast<uint8_t>(tile.video_queue.size());
+        report.decoded_queue = static_cast<uint8_t>(tile.decoded_queue.size());
+        tile.client.send_report(report);
+
+        tile.reported_rendered = tile.frames_rendered;
+        tile.reported_decoded = decoded;
+        tile.reported_discarded = discarded;
+    }
+}
+
+void MosaicSession::send_viewports() {
+    auto now = std::chrono::steady_clock::now();
+    last_viewport_check_ = now;
+
+    // A tile shows the whole source in its cell, so the cell is the drawable
+    // size; the host never sends more pixels than that. Hosts scale only
+    // their primary stream, so tiles showing another stream don't report.
+    for (auto& t : tiles_) {
+        Tile& tile = *t;
+        if (!tile.client.is_connected() || tile.source.stream != 0) continue;
+        ViewportRequest request;
+        renderer_.tile_size(tile.index, request.drawable_width, request.drawable_height);
+        ViewportPayload viewport = viewport_payload(request);
+
+        bool changed = std::memcmp(&viewport, &tile.sent_viewport, sizeof(viewport)) != 0;
+        if (!changed && now - tile.last_viewport_sent < VIEWPORT_RESEND_INTERVAL) continue;
+        tile.client.send_viewport(viewport, tile.source.stream);
+        tile.sent_viewport = viewport;
+        tile.last_viewport_sent = now;
+    }
+}
+
+void MosaicSession::recv_loop(lancast::stop_token st, Tile& tile) {
+    LOG_INFO(TAG, "Tile %zu receive loop started", tile.index);
+    Tracer::set_thread_name("recv");
+
+    while (!st.stop_requested() && running_->load() && tile.client.is_connected()) {
+        tile.client.poll(tile.video_queue, tile.audio_queue);
+    }
+
+    LOG_INFO(TAG, "Tile %zu receive loop ended", tile.index);
+}
+
+void MosaicSession::decode_loop(lancast::stop_token st) {
+    LOG_INFO(TAG, "Decode loop started");
+    Tracer::set_thread_name("decode");
+    size_t first = 0;
+
+    while (!st.stop_requested() && running_->load()) {
+        bool decoded_any = serve_round_robin(tiles_, first, &Tile::decoding, [&](Tile& tile) {
+            if (!tile.decoder) return false;
+            auto packet = tile.video_queue.try_pop();
+            if (!packet) return false;
+            decode_packet(tile, *packet);
+            return true;
+        });
+
+        if (!decoded_any) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    LOG_INFO(TAG, "Decode loop ended");
+}
+
+void MosaicSession::decode_packet(Tile& tile, const EncodedPacket& packet) {
+    TRACE_SCOPE("decode", packet.frame_id);
+    if (packet.type == FrameType::VideoKeyframe) reinit_decoder_if_changed(tile);
+    int64_t start_us = steady_now_us();
+    std::optional<RawVideoFrame> decoded;
+    {
+        PerfScope perf(PerfStage::Decode);
+        decoded = tile.decoder->decode(packet);
+    }
+    tile.decode_ms.store(ewma(tile.decode_ms.load(std::memory_order_relaxed),
+                              (steady_now_us() - start_us) / 1000.0, EWMA_ALPHA),
+                         std::memory_order_relaxed);
+    if (decoded) {
+        decoded->region = tile.decoder_config.region;
+        tile.frames_decoded.fetch_add(1, std::memory_order_relaxed);
+        tile.decoded_queue.push(std::move(*decoded));
+    }
+}
+
+void MosaicSession::reinit_decoder_if_changed(Tile& tile) {
+    // Same rule as the single-stream viewer: switch at the first keyframe
+    // after a config change
+    uint8_t stream = tile.source.stream;
+    uint32_t generation = tile.client.config_generation(stream);
+    if (generation == tile.decoder_generation) return;
+    tile.decoder_generation = generation;
+
+    auto config = tile.client.stream_config(stream);
+    bool same_stream = config.width == tile.decoder_config.width &&
+                       config.height == tile.decoder_config.height &&
+                       config.codec_data == tile.decoder_config.codec_data;
+    tile.decoder_config = config;
+    if (same_stream) return;
+    tile.decoder->shutdown();
+    if (!tile.decoder->init(config.width, config.height, config.codec_data)) {
+        LOG_ERROR(TAG, "Tile %zu: failed to reinitialize video decoder for %ux%u",
+                  tile.index, config.width, config.height);
+        return;
+    }
+    LOG_INFO(TAG, "Tile %zu: decoder switched to %ux%u @ %u fps", tile.index, config.width, config.height, config.fps);
+}
+
+} // namespace lancast
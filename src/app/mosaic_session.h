@@ -0,0 +1,97 @@
+#pragma once
+
+#include "net/client.h"
+#include "decode/video_decoder.h"
+#include "render/sdl_renderer.h"
+#include "core/thread_safe_queue.h"
+#include "core/types.h"
+#include "core/jthread.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// One host stream shown as a tile of the mosaic
+struct MosaicSource {
+    std::string host_ip;
+    uint16_t port = 0;
+    uint8_t stream = 0;
+};
+
+// Watches several hosts at once in one window. Each source gets its own
+// Client, receive thread and decoder; a shared pool of decode threads
+// serves all of them, and each tile on a host's primary stream reports its
+// cell size as its viewport so the host scales down to what the tile
+// shows. Video only.
+class MosaicSession {
+public:
+    MosaicSession() = default;
+    ~MosaicSession();
+
+    // Connects to every source; sources that fail stay as empty tiles.
+    // Returns false if none could be reached.
+    bool connect(const std::vector<MosaicSource>& sources);
+
+    // Runs the SDL render loop on the main thread. Blocks until quit.
+    void run(std::atomic<bool>& running);
+
+    void stop();
+
+private:
+    struct Tile {
+        size_t index = 0;
+        MosaicSource source;
+        Client client;
+        bool connected = false;
+
+        ThreadSafeQueue<EncodedPacket> video_queue{3};
+        ThreadSafeQueue<EncodedPacket> audio_queue{2};  // Unplayed; bounded so it stays small
+        ThreadSafeQueue<RawVideoFrame> decoded_queue{2};
+
+        // Decoder state, owned by whichever pool thread holds the claim
+        std::atomic<bool> decoding{false};
+        std::unique_ptr<VideoDecoder> decoder;
+        StreamConfig decoder_config;
+        uint32_t decoder_generation = 0;
+        std::atomic<double> decode_ms{0.0};
+        std::atomic<uint32_t> frames_decoded{0};
+
+        // Render thread only
+        uint32_t frames_rendered = 0;
+        uint64_t frames_skipped = 0;
+        uint32_t reported_rendered = 0;
+        uint32_t reported_decoded = 0;
+        uint64_t reported_discarded = 0;
+        ViewportPayload sent_viewport;
+        std::chrono::steady_clock::time_point last_viewport_sent;
+
+        lancast::jthread recv_thread;
+    };
+
+    bool init_decoder(Tile& tile);
+    void recv_loop(lancast::stop_token st, Tile& tile);
+    void decode_loop(lancast::stop_token st);
+    void decode_packet(Tile& tile, const EncodedPacket& packet);
+    void reinit_decoder_if_changed(Tile& tile);
+    void refresh_overlay_stats(uint32_t frames_presented);
+    void send_load_reports();
+    void send_viewports();
+
+    std::vector<std::unique_ptr<Tile>> tiles_;
+    SdlRenderer renderer_;
+
+    // Overlay refresh and reports (render thread only)
+    std::chrono::steady_clock::time_point last_stats_time_;
+    std::chrono::steady_clock::time_point last_load_report_;
+    std::chrono::steady_clock::time_point last_viewport_check_;
+    uint64_t last_bytes_received_ = 0;
+    uint32_t last_frames_presented_ = 0;
+
+    std::atomic<bool>* running_ = nullptr;
+    std::vector<lancast::jthread> decode_threads_;
+};
+
+} // namespace lancast
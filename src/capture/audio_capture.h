@@ -12,6 +12,10 @@ public:
     virtual bool init(uint32_t sample_rate, uint16_t channels) = 0;
     virtual std::optional<RawAudioFrame> capture_frame() = 0;
     virtual void shutdown() = 0;
+
+    // Stop pulling audio from the device while nobody is listening.
+    // Called from the capturing thread; capture_frame() isn't called while paused.
+    virtual void set_paused(bool paused) { (void)paused; }
 };
 
 } // namespace lancast
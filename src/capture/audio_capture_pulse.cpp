@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <string>
+#include <thread>
 
 namespace lancast {
 
@@ -18,9 +19,21 @@ static constexpr const char* TAG = "AudioCapturePulse";
 // mic noise without affecting real audio.
 static constexpr float NOISE_GATE_THRESHOLD_SQ = 0.005f * 0.005f;
 
+// Source name the server resolves to the default sink's monitor (system
+// audio loopback) when the stream connects
+static constexpr const char* DEFAULT_MONITOR = "@DEFAULT_MONITOR@";
+
+// Reopening a stream that failed (server restarting, source gone) backs off
+// between attempts; capture_frame() sleeps through the wait in steps short
+// enough for the capture loop to notice a pause or stop
+static constexpr auto REOPEN_BACKOFF_MIN = std::chrono::milliseconds(250);
+static constexpr auto REOPEN_BACKOFF_MAX = std::chrono::milliseconds(5000);
+static constexpr auto NO_STREAM_WAIT = std::chrono::milliseconds(100);
+
 // Query PulseAudio for the monitor source of the default output sink.
 // Returns e.g. "alsa_output.pci-0000_00_1b.0.analog-stereo.monitor",
-// or empty string on failure.
+// or empty string on failure. Costs a connection and round trips of its
+// own, so only used when the server doesn't understand DEFAULT_MONITOR.
 static std::string get_default_monitor_source() {
     pa_mainloop* ml = pa_mainloop_new();
     if (!ml) return "";
@@ -81,28 +94,42 @@ bool AudioCapturePulse::init(uint32_t sample_rate, uint16_t channels) {
     channels_ = channels;
     frame_samples_ = sample_rate / 50; // 20ms worth of samples
 
-    pa_sample_spec spec{};
-    spec.format = PA_SAMPLE_FLOAT32LE;
-    spec.rate = sample_rate;
-    spec.channels = static_cast<uint8_t>(channels);
-
     // Use the monitor source (system audio loopback) instead of the
-    // default source (which is typically the microphone).
-    std::string monitor = get_default_monitor_source();
-    const char* device = monitor.empty() ? nullptr : monitor.c_str();
-
-    if (!monitor.empty()) {
-        LOG_INFO(TAG, "Using monitor source: %s", monitor.c_str());
+    // default source (which is typically the microphone). Naming it
+    // symbolically saves probing for it at startup, and reopening after a
+    // pause follows the default sink if it changed.
+    device_ = DEFAULT_MONITOR;
+    if (open_stream(false)) {
+        LOG_INFO(TAG, "Using monitor source: %s", device_.c_str());
     } else {
-        LOG_WARN(TAG, "Could not detect monitor source, falling back to default device");
+        device_ = get_default_monitor_source();
+        if (!device_.empty()) {
+            LOG_INFO(TAG, "Using monitor source: %s", device_.c_str());
+        } else {
+            LOG_WARN(TAG, "Could not detect monitor source, falling back to default device");
+        }
+        if (!open_stream()) return false;
     }
 
+    initialized_ = true;
+    paused_ = false;
+    LOG_INFO(TAG, "PulseAudio capture initialized: %u Hz, %u channels, %u samples/frame",
+             sample_rate, channels, frame_samples_);
+    return true;
+}
+
+bool AudioCapturePulse::open_stream(bool log_failure) {
+    pa_sample_spec spec{};
+    spec.format = PA_SAMPLE_FLOAT32LE;
+    spec.rate = sample_rate_;
+    spec.channels = static_cast<uint8_t>(channels_);
+
     int error = 0;
     pa_ = pa_simple_new(
         nullptr,              // default server
         "lancast",            // application name
         PA_STREAM_RECORD,     // recording stream
-        device,               // monitor source (system audio loopback)
+        device_.empty() ? nullptr : device_.c_str(),  // monitor source (system audio loopback)
         "audio capture",      // stream description
         &spec,                // sample spec
         nullptr,              // default channel map
@@ -111,18 +138,58 @@ bool AudioCapturePulse::init(uint32_t sample_rate, uint16_t channels) {
     );
 
     if (!pa_) {
-        LOG_ERROR(TAG, "Failed to open PulseAudio: %s", pa_strerror(error));
+        if (log_failure) LOG_ERROR(TAG, "Failed to open PulseAudio: %s", pa_strerror(error));
         return false;
     }
-
-    initialized_ = true;
-    LOG_INFO(TAG, "PulseAudio capture initialized: %u Hz, %u channels, %u samples/frame",
-             sample_rate, channels, frame_samples_);
     return true;
 }
 
+void AudioCapturePulse::set_paused(bool paused) {
+    if (!initialized_ || paused == paused_) return;
+    paused_ = paused;
+
+    // pa_simple has no cork call; closing the record stream has the same
+    // effect (the server stops feeding the monitor) and reopening is cheap.
+    if (paused) {
+        if (pa_) {
+            pa_simple_free(pa_);
+            pa_ = nullptr;
+        }
+        LOG_DEBUG(TAG, "Capture paused");
+    } else {
+        // A failed open is retried from capture_frame()
+        reopen_backoff_ = std::chrono::milliseconds(0);
+        reopen_at_ = {};
+        reopen();
+        LOG_DEBUG(TAG, "Capture resumed");
+    }
+}
+
+bool AudioCapturePulse::reopen() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < reopen_at_) return false;
+    bool retry = reopen_backoff_.count() > 0;
+    if (open_stream(!retry)) {
+        if (retry) LOG_INFO(TAG, "PulseAudio capture stream reopened");
+        reopen_backoff_ = std::chrono::milliseconds(0);
+        return true;
+    }
+    reopen_backoff_ = retry ? std::min(reopen_backoff_ * 2, REOPEN_BACKOFF_MAX) : REOPEN_BACKOFF_MIN;
+    reopen_at_ = now + reopen_backoff_;
+    if (!retry) LOG_WARN(TAG, "No capture stream; retrying, up to %lld ms apart",
+                         static_cast<long long>(REOPEN_BACKOFF_MAX.count()));
+    return false;
+}
+
 std::optional<RawAudioFrame> AudioCapturePulse::capture_frame() {
     if (!initialized_) return std::nullopt;
+    if (!pa_ && !reopen()) {
+        // Wait here rather than hand the caller an empty result to spin on
+        auto wait = reopen_at_ - std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::clamp<std::chrono::steady_clock::duration>(
+            wait, std::chrono::milliseconds(1), NO_STREAM_WAIT));
+        return std::nullopt;
+    }
 
     RawAudioFrame frame;
     frame.sample_rate = sample_rate_;
@@ -139,7 +206,13 @@ std::optional<RawAudioFrame> AudioCapturePulse::capture_frame() {
     );
 
     if (ret < 0) {
+        // The stream is dead (server restarted, source removed); every
+        // further read would fail at once, so drop it and reopen later
         LOG_ERROR(TAG, "PulseAudio read failed: %s", pa_strerror(error));
+        pa_simple_free(pa_);
+        pa_ = nullptr;
+        reopen_backoff_ = REOPEN_BACKOFF_MIN;
+        reopen_at_ = std::chrono::steady_clock::now() + REOPEN_BACKOFF_MIN;
         return std::nullopt;
     }
 
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "capture/audio_capture.h"
+#include <chrono>
 #include <cstdint>
 #include <optional>
+#include <string>
 
 struct pa_simple;
 
@@ -16,13 +18,24 @@ public:
     bool init(uint32_t sample_rate, uint16_t channels) override;
     std::optional<RawAudioFrame> capture_frame() override;
     void shutdown() override;
+    void set_paused(bool paused) override;
 
 private:
+    bool open_stream(bool log_failure = true);
+    // open_stream() unless the backoff after a failed attempt hasn't passed
+    bool reopen();
+
     pa_simple* pa_ = nullptr;
+    std::string device_;          // Monitor source, empty for the default device
     uint32_t sample_rate_ = 48000;
     uint16_t channels_ = 2;
     uint32_t frame_samples_ = 960; // 20ms at 48kHz
     bool initialized_ = false;
+    bool paused_ = false;
+
+    // No stream while this is nonzero: the wait before the next attempt
+    std::chrono::milliseconds reopen_backoff_{0};
+    std::chrono::steady_clock::time_point reopen_at_;
 };
 
 } // namespace lancast
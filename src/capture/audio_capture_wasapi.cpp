@@ -214,6 +214,22 @@ std::optional<RawAudioFrame> AudioCaptureWASAPI::capture_frame() {
     return frame;
 }
 
+void AudioCaptureWASAPI::set_paused(bool paused) {
+    if (!initialized_ || paused == paused_) return;
+    paused_ = paused;
+
+    if (paused) {
+        audio_client_->Stop();
+        LOG_DEBUG(TAG, "Capture paused");
+    } else {
+        // Drop whatever was buffered before the pause
+        audio_client_->Reset();
+        accumulator_.clear();
+        audio_client_->Start();
+        LOG_DEBUG(TAG, "Capture resumed");
+    }
+}
+
 void AudioCaptureWASAPI::shutdown() {
     if (!initialized_) return;
 
@@ -22,6 +22,7 @@ public:
     bool init(uint32_t sample_rate, uint16_t channels) override;
     std::optional<RawAudioFrame> capture_frame() override;
     void shutdown() override;
+    void set_paused(bool paused) override;
 
 private:
     IMMDevice* device_ = nullptr;
@@ -40,6 +41,7 @@ private:
     std::vector<float> accumulator_;
     bool initialized_ = false;
     bool com_initialized_ = false;
+    bool paused_ = false;
 };
 
 } // namespace lancast
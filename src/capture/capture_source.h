@@ -24,6 +24,14 @@ public:
     virtual std::optional<RawVideoFrame> capture_frame() = 0;
     virtual void shutdown() = 0;
 
+    // Change the size of subsequent frames (0 = native) without restarting
+    // the capture. Call from the capturing thread.
+    virtual bool set_target_size(uint32_t target_width, uint32_t target_height) = 0;
+
+    // Capture only part of the source, scaled to the target size. A full
+    // region restores the whole source. Call from the capturing thread.
+    virtual bool set_source_region(const SourceRegion& region) = 0;
+
     virtual uint32_t native_width() const = 0;
     virtual uint32_t native_height() const = 0;
     virtual uint32_t target_width() const = 0;
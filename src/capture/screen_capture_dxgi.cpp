@@ -98,15 +98,7 @@ bool ScreenCaptureDXGI::init(uint32_t target_width, uint32_t target_height,
     target_height_ &= ~1u;
 
     // Create swscale context for BGRA -> YUV420P
-    sws_ctx_ = sws_getContext(
-        static_cast<int>(screen_width_), static_cast<int>(screen_height_),
-        AV_PIX_FMT_BGRA,
-        static_cast<int>(target_width_), static_cast<int>(target_height_),
-        AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-    if (!sws_ctx_) {
-        LOG_ERROR(TAG, "Failed to create swscale context");
+    if (!rebuild_scaler(target_width_, target_height_)) {
         shutdown();
         return false;
     }
@@ -118,6 +110,59 @@ bool ScreenCaptureDXGI::init(uint32_t target_width, uint32_t target_height,
     return true;
 }
 
+bool ScreenCaptureDXGI::set_target_size(uint32_t target_width, uint32_t target_height) {
+    if (!initialized_) return false;
+
+    uint32_t w = ((target_width > 0) ? target_width : screen_width_) & ~1u;
+    uint32_t h = ((target_height > 0) ? target_height : screen_height_) & ~1u;
+    if (w == target_width_ && h == target_height_) return true;
+
+    uint32_t old_width = target_width_;
+    uint32_t old_height = target_height_;
+    if (!rebuild_scaler(w, h)) return false;
+
+    LOG_INFO(TAG, "Capture target: %ux%u -> %ux%u", old_width, old_height, w, h);
+    return true;
+}
+
+bool ScreenCaptureDXGI::set_source_region(const SourceRegion& region) {
+    if (!initialized_) return false;
+    if (region == region_) return true;
+
+    SourceRegion previous = region_;
+    region_ = region;
+    if (!rebuild_scaler(target_width_, target_height_)) {
+        region_ = previous;
+        return false;
+    }
+
+    LOG_INFO(TAG, "Capture region: %ux%u at (%u,%u) of %ux%u",
+             crop_.width, crop_.height, crop_.x, crop_.y, screen_width_, screen_height_);
+    return true;
+}
+
+bool ScreenCaptureDXGI::rebuild_scaler(uint32_t width, uint32_t height) {
+    PixelRect crop = region_pixels(region_, screen_width_, screen_height_);
+    SwsContext* ctx = sws_getContext(
+        static_cast<int>(crop.width), static_cast<int>(crop.height),
+        AV_PIX_FMT_BGRA,
+        static_cast<int>(width), static_cast<int>(height),
+        AV_PIX_FMT_YUV420P,
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!ctx) {
+        LOG_ERROR(TAG, "Failed to create swscale context for %ux%u -> %ux%u",
+                  crop.width, crop.height, width, height);
+        return false;
+    }
+    sws_freeContext(sws_ctx_);
+    sws_ctx_ = ctx;
+    crop_ = crop;
+    target_width_ = width;
+    target_height_ = height;
+    return true;
+}
+
 void ScreenCaptureDXGI::shutdown() {
     if (sws_ctx_) {
         sws_freeContext(sws_ctx_);
@@ -276,7 +321,10 @@ std::optional<RawVideoFrame> ScreenCaptureDXGI::capture_dxgi() {
     }
 
     // Convert BGRA -> YUV420P
-    const uint8_t* src_data[1] = { static_cast<const uint8_t*>(mapped.pData) };
+    const uint8_t* src_data[1] = {
+        static_cast<const uint8_t*>(mapped.pData) +
+        static_cast<size_t>(crop_.y) * mapped.RowPitch + crop_.x * 4
+    };
     int src_linesize[1] = { static_cast<int>(mapped.RowPitch) };
 
     int w = static_cast<int>(target_width_);
@@ -297,7 +345,7 @@ std::optional<RawVideoFrame> ScreenCaptureDXGI::capture_dxgi() {
     int dst_linesize[3] = { w, w / 2, w / 2 };
 
     sws_scale(sws_ctx_, src_data, src_linesize, 0,
-              static_cast<int>(screen_height_), dst_data, dst_linesize);
+              static_cast<int>(crop_.height), dst_data, dst_linesize);
 
     context_->Unmap(staging_.Get(), 0);
     duplication_->ReleaseFrame();
@@ -400,15 +448,7 @@ std::optional<RawVideoFrame> ScreenCaptureDXGI::capture_window() {
         bitmap_ = CreateCompatibleBitmap(window_dc_, screen_width_, screen_height_);
         old_bitmap_ = SelectObject(mem_dc_, bitmap_);
 
-        if (sws_ctx_) sws_freeContext(sws_ctx_);
-        sws_ctx_ = sws_getContext(
-            static_cast<int>(screen_width_), static_cast<int>(screen_height_),
-            AV_PIX_FMT_BGRA,
-            static_cast<int>(target_width_), static_cast<int>(target_height_),
-            AV_PIX_FMT_YUV420P,
-            SWS_BILINEAR, nullptr, nullptr, nullptr
-        );
-        if (!sws_ctx_) {
+        if (!rebuild_scaler(target_width_, target_height_)) {
             LOG_ERROR(TAG, "Failed to recreate swscale context after resize");
             return std::nullopt;
         }
@@ -441,7 +481,9 @@ std::optional<RawVideoFrame> ScreenCaptureDXGI::capture_window() {
               pixels.data(), reinterpret_cast<BITMAPINFO*>(&bi), DIB_RGB_COLORS);
 
     // Convert BGRA -> YUV420P
-    const uint8_t* src_data[1] = { pixels.data() };
+    const uint8_t* src_data[1] = {
+        pixels.data() + (static_cast<size_t>(crop_.y) * screen_width_ + crop_.x) * 4
+    };
     int src_linesize[1] = { static_cast<int>(screen_width_ * 4) };
 
     int w = static_cast<int>(target_width_);
@@ -462,7 +504,7 @@ std::optional<RawVideoFrame> ScreenCaptureDXGI::capture_window() {
     int dst_linesize[3] = { w, w / 2, w / 2 };
 
     sws_scale(sws_ctx_, src_data, src_linesize, 0,
-              static_cast<int>(screen_height_), dst_data, dst_linesize);
+              static_cast<int>(crop_.height), dst_data, dst_linesize);
 
     Clock clock;
     frame.pts_us = clock.now_us();
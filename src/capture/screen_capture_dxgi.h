@@ -21,6 +21,8 @@ public:
               uint64_t window_id = 0) override;
     std::optional<RawVideoFrame> capture_frame() override;
     void shutdown() override;
+    bool set_target_size(uint32_t target_width, uint32_t target_height) override;
+    bool set_source_region(const SourceRegion& region) override;
 
     uint32_t native_width() const override { return screen_width_; }
     uint32_t native_height() const override { return screen_height_; }
@@ -54,11 +56,16 @@ private:
     uint32_t window_height_ = 0;
 
     // Common
+    // (Re)create the BGRA -> YUV420P scaler for the current crop and the given output size
+    bool rebuild_scaler(uint32_t width, uint32_t height);
+
     SwsContext* sws_ctx_ = nullptr;
     uint32_t screen_width_ = 0;
     uint32_t screen_height_ = 0;
     uint32_t target_width_ = 0;
     uint32_t target_height_ = 0;
+    SourceRegion region_;
+    PixelRect crop_;  // region_ in source pixels
     bool use_window_ = false;
     bool initialized_ = false;
 };
@@ -10,10 +10,12 @@
 // Forward-declare Objective-C types for the C++ header
 #ifdef __OBJC__
 @class SCStream;
+@class SCStreamConfiguration;
 @class SCContentFilter;
 @class LancastStreamDelegate;
 #else
 typedef void SCStream;
+typedef void SCStreamConfiguration;
 typedef void SCContentFilter;
 typedef void LancastStreamDelegate;
 #endif
@@ -32,6 +34,10 @@ public:
     bool start(uint32_t target_width, uint32_t target_height,
                uint64_t window_id);
     void stop();
+    // Change the stream's output size in place (SCStream updateConfiguration)
+    bool set_output_size(uint32_t width, uint32_t height);
+    // Capture only part of the display (SCStreamConfiguration sourceRect)
+    bool set_source_region(const SourceRegion& region);
 
     // Called by the delegate when a video frame arrives
     void push_video_frame(RawVideoFrame frame);
@@ -56,8 +62,14 @@ private:
 
     uint32_t native_width_ = 0;
     uint32_t native_height_ = 0;
+    uint32_t output_width_ = 0;
+    uint32_t output_height_ = 0;
+    SourceRegion region_;
     bool running_ = false;
 
+    SCStreamConfiguration* make_config(uint32_t width, uint32_t height, const SourceRegion& region);
+    bool update_config(uint32_t width, uint32_t height, const SourceRegion& region);
+
     // Video frame queue
     std::mutex video_mutex_;
     std::condition_variable video_cv_;
@@ -80,6 +92,8 @@ public:
               uint64_t window_id = 0) override;
     std::optional<RawVideoFrame> capture_frame() override;
     void shutdown() override;
+    bool set_target_size(uint32_t target_width, uint32_t target_height) override;
+    bool set_source_region(const SourceRegion& region) override;
 
     uint32_t native_width() const override { return native_width_; }
     uint32_t native_height() const override { return native_height_; }
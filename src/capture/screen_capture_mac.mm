@@ -42,6 +42,8 @@ static constexpr const char* TAG = "ScreenCaptureMac";
     SwsContext* _swsCtx;
     uint32_t _lastSrcWidth;
     uint32_t _lastSrcHeight;
+    uint32_t _lastDstWidth;
+    uint32_t _lastDstHeight;
 }
 
 - (instancetype)initWithManager:(lancast::SCStreamManager*)manager
@@ -55,6 +57,8 @@ static constexpr const char* TAG = "ScreenCaptureMac";
         _swsCtx = nullptr;
         _lastSrcWidth = 0;
         _lastSrcHeight = 0;
+        _lastDstWidth = 0;
+        _lastDstHeight = 0;
     }
     return self;
 }
@@ -107,8 +111,9 @@ static constexpr const char* TAG = "ScreenCaptureMac";
     dstW &= ~1u;
     dstH &= ~1u;
 
-    // Recreate swscale context if source dimensions changed
-    if (_swsCtx == nullptr || _lastSrcWidth != srcWidth || _lastSrcHeight != srcHeight) {
+    // Recreate swscale context if source or target dimensions changed
+    if (_swsCtx == nullptr || _lastSrcWidth != srcWidth || _lastSrcHeight != srcHeight ||
+        _lastDstWidth != dstW || _lastDstHeight != dstH) {
         if (_swsCtx) sws_freeContext(_swsCtx);
         _swsCtx = sws_getContext(
             (int)srcWidth, (int)srcHeight, srcFmt,
@@ -116,6 +121,8 @@ static constexpr const char* TAG = "ScreenCaptureMac";
             SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
         _lastSrcWidth = (uint32_t)srcWidth;
         _lastSrcHeight = (uint32_t)srcHeight;
+        _lastDstWidth = dstW;
+        _lastDstHeight = dstH;
         if (!_swsCtx) {
             CVPixelBufferUnlockBaseAddress(imageBuffer, kCVPixelBufferLock_ReadOnly);
             LOG_ERROR("ScreenCaptureMac", "Failed to create swscale context");
@@ -271,19 +278,7 @@ bool SCStreamManager::start(uint32_t target_width, uint32_t target_height,
     outH &= ~1u;
 
     // Configure the stream
-    SCStreamConfiguration* config = [[SCStreamConfiguration alloc] init];
-    config.width = outW;
-    config.height = outH;
-    config.minimumFrameInterval = CMTimeMake(1, 60); // Up to 60fps
-    config.queueDepth = 4;
-    config.pixelFormat = kCVPixelFormatType_32BGRA;
-    config.showsCursor = YES;
-
-    // Enable audio capture
-    config.capturesAudio = YES;
-    config.sampleRate = 48000;
-    config.channelCount = 2;
-
+    SCStreamConfiguration* config = make_config(outW, outH, region_);
     audio_channels_ = 2;
 
     filter_ = captureFilter;
@@ -339,11 +334,70 @@ bool SCStreamManager::start(uint32_t target_width, uint32_t target_height,
     if (!startOk) return false;
 
     running_ = true;
+    output_width_ = outW;
+    output_height_ = outH;
     LOG_INFO(TAG, "SCStream started: native %ux%u, output %ux%u, audio 48kHz stereo",
              natW, natH, outW, outH);
     return true;
 }
 
+SCStreamConfiguration* SCStreamManager::make_config(uint32_t width, uint32_t height,
+                                                   const SourceRegion& region) {
+    SCStreamConfiguration* config = [[SCStreamConfiguration alloc] init];
+    config.width = width;
+    config.height = height;
+    if (!region.full()) {
+        // sourceRect is in display points, the same units as native_width_/native_height_
+        PixelRect rect = region_pixels(region, native_width_, native_height_);
+        config.sourceRect = CGRectMake(rect.x, rect.y, rect.width, rect.height);
+    }
+    config.minimumFrameInterval = CMTimeMake(1, 60); // Up to 60fps
+    config.queueDepth = 4;
+    config.pixelFormat = kCVPixelFormatType_32BGRA;
+    config.showsCursor = YES;
+
+    // Enable audio capture
+    config.capturesAudio = YES;
+    config.sampleRate = 48000;
+    config.channelCount = 2;
+    return config;
+}
+
+bool SCStreamManager::set_output_size(uint32_t width, uint32_t height) {
+    return update_config(width, height, region_);
+}
+
+bool SCStreamManager::set_source_region(const SourceRegion& region) {
+    return update_config(output_width_, output_height_, region);
+}
+
+bool SCStreamManager::update_config(uint32_t width, uint32_t height, const SourceRegion& region) {
+    if (!running_ || !stream_) return false;
+
+    __block bool ok = false;
+    dispatch_semaphore_t sem = dispatch_semaphore_create(0);
+    [stream_ updateConfiguration:make_config(width, height, region)
+               completionHandler:^(NSError* error) {
+        if (error) {
+            LOG_ERROR(TAG, "Failed to update stream configuration: %s",
+                      [[error localizedDescription] UTF8String]);
+        } else {
+            ok = true;
+        }
+        dispatch_semaphore_signal(sem);
+    }];
+    dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
+    if (!ok) return false;
+
+    LancastStreamDelegate* delegate = (LancastStreamDelegate*)delegate_;
+    delegate.targetWidth = width;
+    delegate.targetHeight = height;
+    output_width_ = width;
+    output_height_ = height;
+    region_ = region;
+    return true;
+}
+
 void SCStreamManager::stop() {
     if (!running_) return;
     running_ = false;
@@ -448,6 +502,30 @@ std::optional<RawVideoFrame> ScreenCaptureMac::capture_frame() {
     return manager_->pop_video_frame();
 }
 
+bool ScreenCaptureMac::set_target_size(uint32_t target_width, uint32_t target_height) {
+    if (!initialized_ || !manager_) return false;
+
+    uint32_t w = (target_width > 0 ? target_width : native_width_) & ~1u;
+    uint32_t h = (target_height > 0 ? target_height : native_height_) & ~1u;
+    if (w == target_width_ && h == target_height_) return true;
+    if (!manager_->set_output_size(w, h)) return false;
+
+    LOG_INFO(TAG, "Capture target: %ux%u -> %ux%u", target_width_, target_height_, w, h);
+    target_width_ = w;
+    target_height_ = h;
+    return true;
+}
+
+bool ScreenCaptureMac::set_source_region(const SourceRegion& region) {
+    if (!initialized_ || !manager_) return false;
+    if (!manager_->set_source_region(region)) return false;
+
+    PixelRect rect = region_pixels(region, native_width_, native_height_);
+    LOG_INFO(TAG, "Capture region: %ux%u at (%u,%u) of %ux%u",
+             rect.width, rect.height, rect.x, rect.y, native_width_, native_height_);
+    return true;
+}
+
 void ScreenCaptureMac::shutdown() {
     if (!initialized_) return;
 
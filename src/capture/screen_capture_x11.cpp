@@ -1,5 +1,6 @@
 #include "capture/screen_capture_x11.h"
 #include "core/logger.h"
+#include "core/perf_counters.h"
 
 #include <cinttypes>
 #include <X11/Xatom.h>
@@ -213,15 +214,7 @@ bool ScreenCaptureX11::init(uint32_t target_width, uint32_t target_height,
 
     // Create swscale context for BGRA -> YUV420P conversion
     // X11 captures in BGRA format (32-bit with alpha in high byte)
-    sws_ctx_ = sws_getContext(
-        static_cast<int>(screen_width_), static_cast<int>(screen_height_),
-        AV_PIX_FMT_BGRA,
-        static_cast<int>(target_width_), static_cast<int>(target_height_),
-        AV_PIX_FMT_YUV420P,
-        SWS_BILINEAR, nullptr, nullptr, nullptr
-    );
-    if (!sws_ctx_) {
-        LOG_ERROR(TAG, "Failed to create swscale context");
+    if (!rebuild_scaler(target_width_, target_height_)) {
         shutdown();
         return false;
     }
@@ -244,8 +237,9 @@ std::optional<RawVideoFrame> ScreenCaptureX11::capture_frame() {
             LOG_WARN(TAG, "XShmGetImage failed");
             return std::nullopt;
         }
-        src_ptr = reinterpret_cast<const uint8_t*>(ximage_->data);
         src_linesize_val = ximage_->bytes_per_line;
+        src_ptr = reinterpret_cast<const uint8_t*>(ximage_->data) +
+                  static_cast<size_t>(crop_.y) * src_linesize_val + crop_.x * 4;
     } else {
         // Window capture: use XGetImage (more compatible across compositors)
         // Re-query window geometry in case it was resized
@@ -263,23 +257,17 @@ std::optional<RawVideoFrame> ScreenCaptureX11::capture_frame() {
             screen_width_ = cur_w;
             screen_height_ = cur_h;
 
-            if (sws_ctx_) sws_freeContext(sws_ctx_);
-            sws_ctx_ = sws_getContext(
-                static_cast<int>(screen_width_), static_cast<int>(screen_height_),
-                AV_PIX_FMT_BGRA,
-                static_cast<int>(target_width_), static_cast<int>(target_height_),
-                AV_PIX_FMT_YUV420P,
-                SWS_BILINEAR, nullptr, nullptr, nullptr
-            );
-            if (!sws_ctx_) {
+            if (!rebuild_scaler(target_width_, target_height_)) {
                 LOG_ERROR(TAG, "Failed to recreate swscale context after resize");
                 return std::nullopt;
             }
             LOG_INFO(TAG, "Window resized to %ux%u", cur_w, cur_h);
         }
 
-        XImage* img = XGetImage(display_, target_window_, 0, 0,
-                                screen_width_, screen_height_,
+        // Only the captured region is transferred from the X server
+        XImage* img = XGetImage(display_, target_window_,
+                                static_cast<int>(crop_.x), static_cast<int>(crop_.y),
+                                crop_.width, crop_.height,
                                 AllPlanes, ZPixmap);
         if (!img) {
             LOG_WARN(TAG, "XGetImage failed");
@@ -310,8 +298,11 @@ std::optional<RawVideoFrame> ScreenCaptureX11::capture_frame() {
         };
         int dst_linesize[3] = { w, w / 2, w / 2 };
 
-        sws_scale(sws_ctx_, src_data, src_linesize, 0,
-                  static_cast<int>(screen_height_), dst_data, dst_linesize);
+        {
+            PerfScope perf(PerfStage::Convert);
+            sws_scale(sws_ctx_, src_data, src_linesize, 0,
+                      static_cast<int>(crop_.height), dst_data, dst_linesize);
+        }
 
         XDestroyImage(img);
         return frame;
@@ -338,12 +329,68 @@ std::optional<RawVideoFrame> ScreenCaptureX11::capture_frame() {
     };
     int dst_linesize[3] = { w, w / 2, w / 2 };
 
-    sws_scale(sws_ctx_, src_data, src_linesize, 0,
-              static_cast<int>(screen_height_), dst_data, dst_linesize);
+    {
+        PerfScope perf(PerfStage::Convert);
+        sws_scale(sws_ctx_, src_data, src_linesize, 0,
+                  static_cast<int>(crop_.height), dst_data, dst_linesize);
+    }
 
     return frame;
 }
 
+bool ScreenCaptureX11::set_target_size(uint32_t target_width, uint32_t target_height) {
+    if (!initialized_) return false;
+
+    uint32_t w = ((target_width > 0) ? target_width : screen_width_) & ~1u;
+    uint32_t h = ((target_height > 0) ? target_height : screen_height_) & ~1u;
+    if (w == target_width_ && h == target_height_) return true;
+
+    uint32_t old_width = target_width_;
+    uint32_t old_height = target_height_;
+    if (!rebuild_scaler(w, h)) return false;
+
+    LOG_INFO(TAG, "Capture target: %ux%u -> %ux%u", old_width, old_height, w, h);
+    return true;
+}
+
+bool ScreenCaptureX11::set_source_region(const SourceRegion& region) {
+    if (!initialized_) return false;
+    if (region == region_) return true;
+
+    SourceRegion previous = region_;
+    region_ = region;
+    if (!rebuild_scaler(target_width_, target_height_)) {
+        region_ = previous;
+        return false;
+    }
+
+    LOG_INFO(TAG, "Capture region: %ux%u at (%u,%u) of %ux%u",
+             crop_.width, crop_.height, crop_.x, crop_.y, screen_width_, screen_height_);
+    return true;
+}
+
+bool ScreenCaptureX11::rebuild_scaler(uint32_t width, uint32_t height) {
+    PixelRect crop = region_pixels(region_, screen_width_, screen_height_);
+    SwsContext* ctx = sws_getContext(
+        static_cast<int>(crop.width), static_cast<int>(crop.height),
+        AV_PIX_FMT_BGRA,
+        static_cast<int>(width), static_cast<int>(height),
+        AV_PIX_FMT_YUV420P,
+        SWS_BILINEAR, nullptr, nullptr, nullptr
+    );
+    if (!ctx) {
+        LOG_ERROR(TAG, "Failed to create swscale context for %ux%u -> %ux%u",
+                  crop.width, crop.height, width, height);
+        return false;
+    }
+    sws_freeContext(sws_ctx_);
+    sws_ctx_ = ctx;
+    crop_ = crop;
+    target_width_ = width;
+    target_height_ = height;
+    return true;
+}
+
 void ScreenCaptureX11::shutdown() {
     if (!display_) return;
 
@@ -0,0 +1,209 @@
+#include "core/autotune.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace lancast {
+
+// Overloaded: some stage takes more than this share of the frame budget,
+// or the process uses more than this share of the machine
+static constexpr double OVERLOAD_STAGE = 0.85;
+static constexpr double OVERLOAD_CPU = 0.90;
+// Relaxed enough to spend more
+static constexpr double RELAXED_STAGE = 0.5;
+static constexpr double RELAXED_CPU = 0.6;
+// Encode this far under budget before trying a slower preset
+static constexpr double SLOWER_PRESET_ENCODE = 0.35;
+// Bits per pixel per frame below which moving content smears. Raising
+// resolution or frame rate must leave this much with some margin.
+static constexpr double STARVED_BPP = 0.03;
+static constexpr double RAISE_BPP_MARGIN = 1.5;
+// Share of changed grid points that counts as static text / as video
+static constexpr double STATIC_MOTION = 0.02;
+static constexpr double MOVING_MOTION = 0.15;
+// Windows to wait after a change: one for the sample to reflect it,
+// more before spending what was just freed
+static constexpr uint32_t SETTLE_WINDOWS = 1;
+static constexpr uint32_t HOLD_WINDOWS = 3;
+
+// Motion grid and the luma difference that counts as a change
+static constexpr uint32_t MOTION_GRID_X = 64;
+static constexpr uint32_t MOTION_GRID_Y = 36;
+static constexpr int MOTION_THRESHOLD = 8;
+
+Autotuner::Autotuner(const AutotuneLimits& limits)
+    : limits_(limits), hold_(0) {}
+
+AutotuneSettings Autotuner::clamp(AutotuneSettings s) const {
+    uint32_t min_fps = std::min(limits_.min_fps, limits_.max_fps);
+    s.fps = std::clamp(s.fps, min_fps, limits_.max_fps);
+    s.scale_step = std::min(s.scale_step, std::max<uint32_t>(limits_.scale_steps, 1) - 1);
+    s.preset = std::min(s.preset, std::max<uint32_t>(limits_.presets, 1) - 1);
+    return s;
+}
+
+uint32_t Autotuner::fps_down(uint32_t fps) const {
+    return std::max(std::min(limits_.min_fps, fps), fps * 3 / 4);
+}
+
+uint32_t Autotuner::fps_up(uint32_t fps, uint32_t ceiling) const {
+    return std::max(fps, std::min(ceiling, std::max(fps * 4 / 3, fps + 1)));
+}
+
+AutotuneSettings Autotuner::update(const AutotuneSettings& current, const AutotuneSample& sample) {
+    reason_.clear();
+    AutotuneSettings cur = clamp(current);
+    if (cur != current) {
+        reason_ = "operator limits changed";
+        hold_ = HOLD_WINDOWS;
+        return cur;
+    }
+    if (cur.fps == 0) return cur;
+
+    uint32_t since_change = HOLD_WINDOWS - std::min(hold_, HOLD_WINDOWS);
+    if (hold_ > 0) hold_--;
+
+    double budget_ms = 1000.0 / cur.fps;
+    double stage_ms = std::max({sample.capture_ms, sample.encode_ms, sample.send_ms});
+    bool overloaded = stage_ms > OVERLOAD_STAGE * budget_ms || sample.cpu_load > OVERLOAD_CPU;
+    bool relaxed = stage_ms < RELAXED_STAGE * budget_ms && sample.cpu_load < RELAXED_CPU;
+
+    bool is_static = sample.motion < STATIC_MOTION;
+    bool moving = sample.motion > MOVING_MOTION;
+    uint32_t fps_ceiling = is_static ? std::max(limits_.min_fps, limits_.max_fps / 2)
+                                     : limits_.max_fps;
+
+    auto bpp = [&](const AutotuneSettings& s) {
+        double scale = AUTOTUNE_SCALES[s.scale_step];
+        double pixels = static_cast<double>(sample.full_pixels) * scale * scale;
+        if (sample.bitrate == 0 || pixels <= 0 || s.fps == 0) return 1.0;
+        return sample.bitrate / (pixels * s.fps);
+    };
+    bool starved = sample.network_loss || (!is_static && bpp(cur) < STARVED_BPP);
+
+    AutotuneSettings next = cur;
+    char why[192];
+
+    // Fewer frames for static content, fewer pixels for moving content,
+    // falling back to the other when one is already at its floor
+    auto shed = [&](const char* cause) {
+        bool can_fps = fps_down(cur.fps) < cur.fps;
+        bool can_scale = cur.scale_step + 1 < limits_.scale_steps;
+        bool prefer_fps = is_static || (!moving && cur.fps > fps_ceiling / 2);
+        if ((prefer_fps && can_fps) || (can_fps && !can_scale)) {
+            next.fps = fps_down(cur.fps);
+            snprintf(why, sizeof(why), "%s: frame rate %u -> %u", cause, cur.fps, next.fps);
+        } else if (can_scale) {
+            next.scale_step = cur.scale_step + 1;
+            snprintf(why, sizeof(why), "%s: resolution %.0f%% -> %.0f%%", cause,
+                     AUTOTUNE_SCALES[cur.scale_step] * 100, AUTOTUNE_SCALES[next.scale_step] * 100);
+        }
+    };
+
+    if (overloaded && since_change >= SETTLE_WINDOWS) {
+        char cause[96];
+        if (sample.cpu_load > OVERLOAD_CPU) {
+            snprintf(cause, sizeof(cause), "CPU at %.0f%%", sample.cpu_load * 100);
+        } else {
+            snprintf(cause, sizeof(cause), "pipeline at %.1f of %.1f ms", stage_ms, budget_ms);
+        }
+        if (cur.preset > 0) {
+            next.preset = cur.preset - 1;
+            snprintf(why, sizeof(why), "%s: faster preset", cause);
+        } else {
+            shed(cause);
+        }
+    } else if (starved && since_change >= SETTLE_WINDOWS) {
+        char cause[96];
+        if (sample.network_loss) {
+            snprintf(cause, sizeof(cause), "network loss at %u kbps", sample.bitrate / 1000);
+        } else {
+            snprintf(cause, sizeof(cause), "%.3f bits per pixel at %u kbps", bpp(cur),
+                     sample.bitrate / 1000);
+        }
+        shed(cause);
+    } else if (!overloaded && !starved && since_change >= HOLD_WINDOWS) {
+        auto affordable = [&](const AutotuneSettings& s) {
+            return is_static || bpp(s) >= STARVED_BPP * RAISE_BPP_MARGIN;
+        };
+        AutotuneSettings sharper = cur;
+        if (cur.scale_step > 0) sharper.scale_step = cur.scale_step - 1;
+        AutotuneSettings smoother = cur;
+        smoother.fps = fps_up(cur.fps, fps_ceiling);
+
+        if (is_static && cur.fps > fps_ceiling && cur.scale_step > 0) {
+            next.scale_step = sharper.scale_step;
+            next.fps = std::max(fps_ceiling, fps_down(cur.fps));
+            snprintf(why, sizeof(why), "static content: frame rate %u -> %u, resolution %.0f%% -> %.0f%%",
+                     cur.fps, next.fps, AUTOTUNE_SCALES[cur.scale_step] * 100,
+                     AUTOTUNE_SCALES[next.scale_step] * 100);
+        } else if (moving && !relaxed && smoother.fps > cur.fps &&
+                   cur.scale_step + 1 < limits_.scale_steps) {
+            next.scale_step = cur.scale_step + 1;
+            next.fps = smoother.fps;
+            snprintf(why, sizeof(why), "motion: resolution %.0f%% -> %.0f%%, frame rate %u -> %u",
+                     AUTOTUNE_SCALES[cur.scale_step] * 100, AUTOTUNE_SCALES[next.scale_step] * 100,
+                     cur.fps, next.fps);
+        } else if (relaxed) {
+            // Moving content gets its frames back first, everything else its pixels
+            const AutotuneSettings* order[2] = {&sharper, &smoother};
+            if (moving) std::swap(order[0], order[1]);
+            for (const AutotuneSettings* c : order) {
+                if (*c == cur || !affordable(*c)) continue;
+                next = *c;
+                break;
+            }
+            if (next.scale_step != cur.scale_step) {
+                snprintf(why, sizeof(why), "headroom: resolution %.0f%% -> %.0f%%",
+                         AUTOTUNE_SCALES[cur.scale_step] * 100, AUTOTUNE_SCALES[next.scale_step] * 100);
+            } else if (next.fps != cur.fps) {
+                snprintf(why, sizeof(why), "headroom: frame rate %u -> %u", cur.fps, next.fps);
+            } else if (cur.preset + 1 < limits_.presets &&
+                       sample.encode_ms < SLOWER_PRESET_ENCODE * budget_ms) {
+                next.preset = cur.preset + 1;
+                snprintf(why, sizeof(why), "headroom: slower preset, encode at %.1f of %.1f ms",
+                         sample.encode_ms, budget_ms);
+            }
+        }
+    }
+
+    if (next != cur) {
+        reason_ = why;
+        hold_ = HOLD_WINDOWS;
+    }
+    return next;
+}
+
+double MotionSampler::sample(const RawVideoFrame& frame) {
+    if (frame.width == 0 || frame.height == 0 ||
+        frame.data.size() < static_cast<size_t>(frame.width) * frame.height) {
+        return 0.0;
+    }
+
+    uint32_t cols = std::min(MOTION_GRID_X, frame.width);
+    uint32_t rows = std::min(MOTION_GRID_Y, frame.height);
+    bool fresh = frame.width != width_ || frame.height != height_;
+    if (fresh) {
+        previous_.assign(static_cast<size_t>(cols) * rows, 0);
+        width_ = frame.width;
+        height_ = frame.height;
+    }
+
+    // Y plane comes first in YUV420P
+    const uint8_t* luma = frame.data.data();
+    uint32_t changed = 0;
+    size_t i = 0;
+    for (uint32_t r = 0; r < rows; ++r) {
+        size_t y = (static_cast<size_t>(r) * 2 + 1) * frame.height / (rows * 2);
+        for (uint32_t c = 0; c < cols; ++c, ++i) {
+            size_t x = (static_cast<size_t>(c) * 2 + 1) * frame.width / (cols * 2);
+            uint8_t v = luma[y * frame.width + x];
+            if (std::abs(static_cast<int>(v) - previous_[i]) > MOTION_THRESHOLD) changed++;
+            previous_[i] = v;
+        }
+    }
+    return fresh ? 0.0 : static_cast<double>(changed) / previous_.size();
+}
+
+} // namespace lancast
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "core/types.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// Closed-loop stream autotuning.
+//
+// Every couple of seconds the host feeds the controller what the last window
+// looked like: how long capture, encode and send took per frame against the
+// frame budget, how busy the machine was, what the network allows and how
+// much of the picture moved. The controller answers with the resolution
+// scale, frame rate and encoder preset to use next, one change per window.
+//
+// Overload is handled first: a faster preset, then fewer pixels or fewer
+// frames. Which of the two goes depends on the content: static text keeps
+// its resolution and gives up frames, video keeps its frame rate and gives up
+// pixels. With headroom the same preference decides what comes back first,
+// and a slower (better) preset is only tried once everything else is at the
+// operator limit.
+
+// Share of the source each resolution step keeps, per axis
+static constexpr double AUTOTUNE_SCALES[] = {1.0, 0.75, 0.5};
+static constexpr uint32_t AUTOTUNE_SCALE_STEPS = sizeof(AUTOTUNE_SCALES) / sizeof(AUTOTUNE_SCALES[0]);
+
+// Operator limits the controller stays within
+struct AutotuneLimits {
+    uint32_t max_fps = 60;
+    uint32_t min_fps = 15;
+    uint32_t presets = 1;           // Preset levels allowed, 0 = fastest
+    uint32_t scale_steps = AUTOTUNE_SCALE_STEPS;
+};
+
+// One observation window
+struct AutotuneSample {
+    double capture_ms = 0.0;        // Mean per frame
+    double encode_ms = 0.0;
+    double send_ms = 0.0;
+    double cpu_load = 0.0;          // Process CPU as a share of all cores, 0..1
+    double motion = 0.0;            // Share of sampled pixels that changed per frame, 0..1
+    uint32_t bitrate = 0;           // What the network controller allows now (bps)
+    uint64_t full_pixels = 0;       // Pixels per frame at scale step 0
+    bool network_loss = false;      // Frames cut or dropped in the window
+};
+
+struct AutotuneSettings {
+    uint32_t scale_step = 0;        // Index into AUTOTUNE_SCALES
+    uint32_t fps = 0;
+    uint32_t preset = 0;
+
+    bool operator==(const AutotuneSettings& o) const {
+        return scale_step == o.scale_step && fps == o.fps && preset == o.preset;
+    }
+    bool operator!=(const AutotuneSettings& o) const { return !(*this == o); }
+};
+
+class Autotuner {
+public:
+    explicit Autotuner(const AutotuneLimits& limits = {});
+
+    void set_limits(const AutotuneLimits& limits) { limits_ = limits; }
+    const AutotuneLimits& limits() const { return limits_; }
+
+    // Settings for the next window given those in effect during the sample.
+    // When they differ, reason() says why.
+    AutotuneSettings update(const AutotuneSettings& current, const AutotuneSample& sample);
+
+    const std::string& reason() const { return reason_; }
+
+private:
+    AutotuneSettings clamp(AutotuneSettings s) const;
+    uint32_t fps_down(uint32_t fps) const;
+    uint32_t fps_up(uint32_t fps, uint32_t ceiling) const;
+
+    AutotuneLimits limits_;
+    uint32_t hold_ = 0;             // Windows left before a non-urgent change
+    std::string reason_;
+};
+
+// Estimates how much of the picture changes from frame to frame by comparing
+// a sparse luma grid against the previous frame. Cheap enough to run on
+// every captured frame.
+class MotionSampler {
+public:
+    // Share of grid points that changed since the previous frame, 0..1.
+    // A frame of a different size starts over and reports 0.
+    double sample(const RawVideoFrame& frame);
+
+private:
+    std::vector<uint8_t> previous_;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+};
+
+} // namespace lancast
@@ -0,0 +1,227 @@
+#include "core/perf_counters.h"
+#include "core/logger.h"
+
+#include <array>
+#include <cstdio>
+#include <ctime>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "PerfCounters";
+
+std::atomic<bool> PerfCounters::enabled_{false};
+
+namespace {
+
+enum Counter { CYCLES = 0, INSTRUCTIONS, LLC_MISSES, CONTEXT_SWITCHES, NUM_COUNTERS };
+
+constexpr const char* STAGE_NAMES[] = {
+    "convert", "encode", "fragment", "send", "assemble", "decode",
+};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) ==
+              static_cast<size_t>(PerfStage::Count), "Stage names out of sync");
+
+struct StageTotals {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> cycles{0};
+    std::atomic<uint64_t> instructions{0};
+    std::atomic<uint64_t> llc_misses{0};
+    std::atomic<uint64_t> context_switches{0};
+    std::atomic<int64_t> cpu_ns{0};
+};
+
+std::array<StageTotals, static_cast<size_t>(PerfStage::Count)> g_totals;
+
+// Which counters any thread managed to open, for "n/a" reporting
+std::atomic<uint32_t> g_available_mask{0};
+
+int64_t thread_cpu_ns() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+#endif
+    return 0;
+}
+
+#if defined(__linux__)
+int open_counter(uint32_t type, uint64_t config, bool exclude_kernel, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+// Counter group for the calling thread. Opened on first use, closed at thread exit.
+struct ThreadCounters {
+    int leader = -1;
+    std::array<int, NUM_COUNTERS> fds{-1, -1, -1, -1};
+    std::array<int, NUM_COUNTERS> slot{-1, -1, -1, -1}; // Position in the group read
+    int num_open = 0;
+
+    ThreadCounters() {
+        struct Spec { uint32_t type; uint64_t config; bool exclude_kernel; };
+        const Spec specs[NUM_COUNTERS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true},
+            // Context switches happen in the kernel; fall back to user-only if refused
+            {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false},
+        };
+
+        for (int i = 0; i < NUM_COUNTERS; ++i) {
+            int fd = open_counter(specs[i].type, specs[i].config, specs[i].exclude_kernel, leader);
+            if (fd < 0 && !specs[i].exclude_kernel) {
+                fd = open_counter(specs[i].type, specs[i].config, true, leader);
+            }
+            if (fd < 0) continue;
+
+            if (leader < 0) leader = fd;
+            fds[i] = fd;
+            slot[i] = num_open++;
+            g_available_mask.fetch_or(1u << i, std::memory_order_relaxed);
+        }
+
+        if (num_open == 0) {
+            LOG_DEBUG(TAG, "perf_event_open unavailable (%s); CPU time only", strerror(errno));
+        }
+    }
+
+    ~ThreadCounters() {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+
+    void read_into(PerfScope::Sample& s) const {
+        if (leader < 0) return;
+        struct { uint64_t nr; uint64_t values[NUM_COUNTERS]; } buf{};
+        if (read(leader, &buf, sizeof(buf)) < static_cast<ssize_t>(sizeof(uint64_t))) return;
+
+        auto value = [&](int counter) -> uint64_t {
+            int pos = slot[counter];
+            return (pos >= 0 && static_cast<uint64_t>(pos) < buf.nr) ? buf.values[pos] : 0;
+        };
+        s.cycles = value(CYCLES);
+        s.instructions = value(INSTRUCTIONS);
+        s.llc_misses = value(LLC_MISSES);
+        s.context_switches = value(CONTEXT_SWITCHES);
+    }
+};
+#endif
+
+void read_sample(PerfScope::Sample& s) {
+#if defined(__linux__)
+    thread_local ThreadCounters counters;
+    counters.read_into(s);
+#endif
+    s.cpu_ns = thread_cpu_ns();
+}
+
+} // namespace
+
+void PerfCounters::enable() {
+    enabled_.store(true, std::memory_order_relaxed);
+    LOG_INFO(TAG, "Per-stage performance counters enabled");
+}
+
+void PerfCounters::count_frame(PerfStage stage) {
+    if (!enabled()) return;
+    g_totals[static_cast<size_t>(stage)].frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string PerfCounters::report() {
+    if (!enabled()) return {};
+
+    uint32_t mask = g_available_mask.load(std::memory_order_relaxed);
+    std::string out;
+    char line[256];
+
+    for (size_t i = 0; i < g_totals.size(); ++i) {
+        auto& t = g_totals[i];
+        uint64_t frames = t.frames.exchange(0, std::memory_order_relaxed);
+        uint64_t cycles = t.cycles.exchange(0, std::memory_order_relaxed);
+        uint64_t instructions = t.instructions.exchange(0, std::memory_order_relaxed);
+        uint64_t llc = t.llc_misses.exchange(0, std::memory_order_relaxed);
+        uint64_t cs = t.context_switches.exchange(0, std::memory_order_relaxed);
+        int64_t cpu_ns = t.cpu_ns.exchange(0, std::memory_order_relaxed);
+        if (frames == 0) continue;
+
+        double f = static_cast<double>(frames);
+        char cyc[32] = "n/a", ipc[32] = "n/a", llcs[32] = "n/a", css[32] = "n/a";
+        if (mask & (1u << CYCLES)) snprintf(cyc, sizeof(cyc), "%.0fk", cycles / f / 1000.0);
+        if ((mask & (1u << CYCLES)) && (mask & (1u << INSTRUCTIONS)) && cycles > 0) {
+            snprintf(ipc, sizeof(ipc), "%.2f", static_cast<double>(instructions) / cycles);
+        }
+        if (mask & (1u << LLC_MISSES)) snprintf(llcs, sizeof(llcs), "%.0f", llc / f);
+        if (mask & (1u << CONTEXT_SWITCHES)) snprintf(css, sizeof(css), "%.2f", cs / f);
+
+        snprintf(line, sizeof(line),
+                 "%s%-8s %6llu frames  cpu %7.3f ms  cycles %s  ipc %s  llc-miss %s  ctx-sw %s",
+                 out.empty() ? "" : "\n", STAGE_NAMES[i],
+                 static_cast<unsigned long long>(frames), cpu_ns / f / 1e6,
+                 cyc, ipc, llcs, css);
+        out += line;
+    }
+    return out;
+}
+
+int64_t PerfCounters::process_cpu_ns() {
+#if defined(_WIN32)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return 0;
+    auto to_100ns = [](const FILETIME& ft) {
+        return (static_cast<int64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    };
+    return (to_100ns(kernel) + to_100ns(user)) * 100;
+#elif defined(CLOCK_PROCESS_CPUTIME_ID)
+    timespec ts{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0) {
+        return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+    }
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+PerfScope::PerfScope(PerfStage stage, bool counts_frame)
+    : stage_(stage), active_(PerfCounters::enabled()), counts_frame_(counts_frame) {
+    if (active_) read_sample(start_);
+}
+
+PerfScope::~PerfScope() {
+    if (!active_) return;
+
+    Sample end;
+    read_sample(end);
+
+    auto& t = g_totals[static_cast<size_t>(stage_)];
+    if (counts_frame_) t.frames.fetch_add(1, std::memory_order_relaxed);
+    t.cycles.fetch_add(end.cycles - start_.cycles, std::memory_order_relaxed);
+    t.instructions.fetch_add(end.instructions - start_.instructions, std::memory_order_relaxed);
+    t.llc_misses.fetch_add(end.llc_misses - start_.llc_misses, std::memory_order_relaxed);
+    t.context_switches.fetch_add(end.context_switches - start_.context_switches,
+                                 std::memory_order_relaxed);
+    t.cpu_ns.fetch_add(end.cpu_ns - start_.cpu_ns, std::memory_order_relaxed);
+}
+
+} // namespace lancast
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace lancast {
+
+// Pipeline stages sampled by PerfScope
+enum class PerfStage : uint8_t {
+    Convert = 0,   // Host: BGRA -> YUV420P (swscale)
+    Encode,        // Host: VideoEncoder::encode
+    Fragment,      // Host: PacketFragmenter::fragment + serialize
+    Send,          // Host: socket sends for one frame
+    Assemble,      // Client: PacketAssembler::feed (per packet, averaged per frame)
+    Decode,        // Client: VideoDecoder::decode
+    Count,
+};
+
+// Optional per-stage hardware counters.
+//
+// On Linux each sampling thread opens a perf_event_open group (cycles,
+// instructions, LLC misses, context switches) on first use. Per-thread CPU
+// time comes from CLOCK_THREAD_CPUTIME_ID. Counters the kernel refuses
+// (no PMU in a VM, perf_event_paranoid, non-Linux) are skipped quietly and
+// reported as "n/a".
+class PerfCounters {
+public:
+    static void enable();
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    // Count one completed frame for a stage whose scopes don't map 1:1 to frames
+    static void count_frame(PerfStage stage);
+
+    // Per-frame averages since the last call, one line per active stage.
+    // Resets the accumulators. Empty when disabled or nothing was sampled.
+    static std::string report();
+
+    // CPU time consumed by the whole process (all threads), 0 if unavailable.
+    // Always available, independent of enable().
+    static int64_t process_cpu_ns();
+
+private:
+    friend class PerfScope;
+    static std::atomic<bool> enabled_;
+};
+
+// Samples counters around a stage on the calling thread
+class PerfScope {
+public:
+    explicit PerfScope(PerfStage stage, bool counts_frame = true);
+    ~PerfScope();
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+    struct Sample {
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        uint64_t llc_misses = 0;
+        uint64_t context_switches = 0;
+        int64_t cpu_ns = 0;
+    };
+
+private:
+    PerfStage stage_;
+    bool active_;
+    bool counts_frame_;
+    Sample start_;
+};
+
+} // namespace lancast
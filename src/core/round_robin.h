@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace lancast {
+
+// One pass of a worker pool over items any worker may serve, such as
+// streams to encode or tiles to decode. Each item is claimed through its
+// atomic flag, so only one worker serves it at a time and it stays in
+// order; one another worker holds is skipped. Passes start one item
+// further on (first advances) so none is always served last.
+// serve(item) returns whether it did any work; so does the pass.
+template <typename Item, typename Serve>
+bool serve_round_robin(std::vector<std::unique_ptr<Item>>& items, size_t& first,
+                       std::atomic<bool> Item::*claimed, Serve&& serve) {
+    bool worked = false;
+    for (size_t i = 0; i < items.size(); ++i) {
+        Item& item = *items[(first + i) % items.size()];
+        if ((item.*claimed).exchange(true, std::memory_order_acquire)) continue;
+        if (serve(item)) worked = true;
+        (item.*claimed).store(false, std::memory_order_release);
+    }
+    first++;
+    return worked;
+}
+
+} // namespace lancast
@@ -0,0 +1,62 @@
+#include "core/startup_timeline.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace lancast {
+
+double StartupTimeline::since_origin_ms(Clock::time_point t) const {
+    return std::chrono::duration<double, std::milli>(t - origin_).count();
+}
+
+void StartupTimeline::record(const std::string& name, Clock::time_point start, Clock::time_point end) {
+    Phase phase{name, since_origin_ms(start), since_origin_ms(end)};
+    std::lock_guard lock(mutex_);
+    phases_.push_back(std::move(phase));
+}
+
+bool StartupTimeline::mark_once(const std::string& name) {
+    double now = since_origin_ms(Clock::now());
+    std::lock_guard lock(mutex_);
+    for (const auto& p : phases_) {
+        if (p.name == name) return false;
+    }
+    phases_.push_back(Phase{name, now, now});
+    return true;
+}
+
+std::optional<double> StartupTimeline::at(const std::string& name) const {
+    std::lock_guard lock(mutex_);
+    for (const auto& p : phases_) {
+        if (p.name == name) return p.end_ms;
+    }
+    return std::nullopt;
+}
+
+std::vector<StartupTimeline::Phase> StartupTimeline::phases() const {
+    std::vector<Phase> sorted;
+    {
+        std::lock_guard lock(mutex_);
+        sorted = phases_;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Phase& a, const Phase& b) { return a.start_ms < b.start_ms; });
+    return sorted;
+}
+
+std::string StartupTimeline::summary() const {
+    std::string out;
+    char buf[128];
+    for (const auto& p : phases()) {
+        if (p.end_ms > p.start_ms) {
+            snprintf(buf, sizeof(buf), "%s %.1f-%.1f", p.name.c_str(), p.start_ms, p.end_ms);
+        } else {
+            snprintf(buf, sizeof(buf), "%s @%.1f", p.name.c_str(), p.end_ms);
+        }
+        if (!out.empty()) out += ", ";
+        out += buf;
+    }
+    return out + " ms";
+}
+
+} // namespace lancast
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// Where the time from launch to the first frame goes.
+//
+// Phases record their start and end relative to a common origin, so setup
+// that runs side by side shows up as overlapping spans rather than as a
+// sum. Milestones (first viewer, first frame) are phases of zero length.
+// Safe to record from any thread.
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase {
+        std::string name;
+        double start_ms = 0.0;
+        double end_ms = 0.0;
+    };
+
+    explicit StartupTimeline(Clock::time_point origin = Clock::now()) : origin_(origin) {}
+
+    // Records [construction, destruction) as one phase
+    class Scope {
+    public:
+        Scope(StartupTimeline& timeline, std::string name)
+            : timeline_(timeline), name_(std::move(name)), start_(Clock::now()) {}
+        ~Scope() { timeline_.record(name_, start_, Clock::now()); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupTimeline& timeline_;
+        std::string name_;
+        Clock::time_point start_;
+    };
+
+    void record(const std::string& name, Clock::time_point start, Clock::time_point end);
+
+    // Records a milestone the first time only; later calls return false
+    bool mark_once(const std::string& name);
+
+    // End of the named phase or milestone, relative to the origin
+    std::optional<double> at(const std::string& name) const;
+
+    // All phases, ordered by start
+    std::vector<Phase> phases() const;
+
+    // One line: "name start-end, ..." in milliseconds, milestones as "name @t"
+    std::string summary() const;
+
+private:
+    double since_origin_ms(Clock::time_point t) const;
+
+    Clock::time_point origin_;
+    mutable std::mutex mutex_;
+    std::vector<Phase> phases_;
+};
+
+} // namespace lancast
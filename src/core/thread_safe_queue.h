@@ -5,6 +5,7 @@
 #include <condition_variable>
 #include <optional>
 #include <chrono>
+#include <cstdint>
 
 namespace lancast {
 
@@ -21,6 +22,7 @@ public:
             std::lock_guard lock(mutex_);
             if (max_size_ > 0 && queue_.size() >= max_size_) {
                 queue_.pop(); // drop oldest
+                dropped_++;
             }
             queue_.push(std::move(item));
         }
@@ -70,11 +72,18 @@ public:
         return queue_.empty();
     }
 
+    // Items discarded by push() because the queue was full
+    uint64_t dropped() const {
+        std::lock_guard lock(mutex_);
+        return dropped_;
+    }
+
 private:
     std::queue<T> queue_;
     mutable std::mutex mutex_;
     std::condition_variable cv_;
     size_t max_size_ = 0;
+    uint64_t dropped_ = 0;
     bool closed_ = false;
 };
 
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace lancast {
+
+// Steady-clock time in microseconds since its epoch. Kernel timestamps,
+// receive times and render times are all converted to this timeline, so
+// they can be compared across threads and stages.
+inline int64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Exponentially weighted moving average. The first sample (prev == 0)
+// seeds it.
+inline double ewma(double prev, double sample, double alpha) {
+    return prev == 0.0 ? sample : prev + alpha * (sample - prev);
+}
+
+} // namespace lancast
@@ -0,0 +1,180 @@
+#include "core/trace.h"
+#include "core/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define LANCAST_GETPID _getpid
+#else
+#include <unistd.h>
+#define LANCAST_GETPID getpid
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "Tracer";
+
+std::atomic<bool> Tracer::enabled_{false};
+std::atomic<bool> Tracer::dump_requested_{false};
+
+namespace {
+
+struct TraceEvent {
+    int64_t ts_us = 0;
+    int64_t dur_us = 0;         // Only for 'X' (complete) events
+    const char* name = nullptr;
+    uint32_t frame_id = 0;
+    uint32_t tid = 0;
+    char phase = 0;             // 'B', 'E' or 'X'
+};
+
+struct ThreadName {
+    uint32_t tid;
+    const char* name;
+};
+
+std::unique_ptr<TraceEvent[]> g_ring;
+size_t g_mask = 0;
+std::atomic<uint64_t> g_head{0};
+std::string g_path;
+
+std::mutex g_names_mutex;
+std::vector<ThreadName> g_thread_names;
+
+std::atomic<uint32_t> g_next_tid{1};
+
+uint32_t current_tid() {
+    thread_local uint32_t tid = g_next_tid.fetch_add(1, std::memory_order_relaxed);
+    return tid;
+}
+
+void record(char phase, const char* name, uint32_t frame_id, int64_t ts_us, int64_t dur_us) {
+    uint64_t idx = g_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& ev = g_ring[idx & g_mask];
+    ev.ts_us = ts_us;
+    ev.dur_us = dur_us;
+    ev.name = name;
+    ev.frame_id = frame_id;
+    ev.tid = current_tid();
+    ev.phase = phase;
+}
+
+} // namespace
+
+void Tracer::enable(const std::string& path, size_t capacity) {
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+
+    g_ring = std::make_unique<TraceEvent[]>(cap);
+    g_mask = cap - 1;
+    g_head.store(0, std::memory_order_relaxed);
+    g_path = path;
+    enabled_.store(true, std::memory_order_release);
+
+    LOG_INFO(TAG, "Tracing enabled: %zu events, output %s", cap, path.c_str());
+}
+
+int64_t Tracer::now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::begin(const char* name, uint32_t frame_id) {
+    if (!enabled()) return;
+    record('B', name, frame_id, now_us(), 0);
+}
+
+void Tracer::end(const char* name, uint32_t frame_id) {
+    if (!enabled()) return;
+    record('E', name, frame_id, now_us(), 0);
+}
+
+void Tracer::complete(const char* name, uint32_t frame_id, int64_t start_us, int64_t end_us) {
+    if (!enabled()) return;
+    record('X', name, frame_id, start_us, end_us > start_us ? end_us - start_us : 0);
+}
+
+void Tracer::set_thread_name(const char* name) {
+    if (!enabled()) return;
+    uint32_t tid = current_tid();
+    std::lock_guard lock(g_names_mutex);
+    for (auto& tn : g_thread_names) {
+        if (tn.tid == tid) {
+            tn.name = name;
+            return;
+        }
+    }
+    g_thread_names.push_back({tid, name});
+}
+
+bool Tracer::dump_if_requested() {
+    if (!dump_requested_.load(std::memory_order_relaxed)) return false;
+    if (!dump_requested_.exchange(false, std::memory_order_relaxed)) return false;
+    return dump();
+}
+
+bool Tracer::dump() {
+    return dump(g_path);
+}
+
+bool Tracer::dump(const std::string& path) {
+    if (!g_ring || path.empty()) return false;
+
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        LOG_ERROR(TAG, "Failed to open trace output %s", path.c_str());
+        return false;
+    }
+
+    // Events still being written by other threads may appear torn; the
+    // viewer tolerates unmatched B/E pairs at the edges of the window.
+    uint64_t head = g_head.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(head, g_mask + 1);
+    uint64_t first = head - count;
+    int pid = static_cast<int>(LANCAST_GETPID());
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool need_comma = false;
+    {
+        std::lock_guard lock(g_names_mutex);
+        for (const auto& tn : g_thread_names) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                       "\"args\":{\"name\":\"%s\"}}",
+                    need_comma ? ",\n" : "", pid, tn.tid, tn.name);
+            need_comma = true;
+        }
+    }
+
+    for (uint64_t i = first; i < head; ++i) {
+        const TraceEvent& ev = g_ring[i & g_mask];
+        if (!ev.name) continue;
+        fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"lancast\",\"ph\":\"%c\",\"ts\":%lld,",
+                need_comma ? ",\n" : "", ev.name, ev.phase, static_cast<long long>(ev.ts_us));
+        if (ev.phase == 'X') {
+            fprintf(f, "\"dur\":%lld,", static_cast<long long>(ev.dur_us));
+        }
+        fprintf(f, "\"pid\":%d,\"tid\":%u,\"args\":{\"frame_id\":%u}}",
+                pid, ev.tid, ev.frame_id);
+        need_comma = true;
+    }
+    fprintf(f, "\n]}\n");
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+
+    if (ok) {
+        LOG_INFO(TAG, "Wrote %llu trace events to %s",
+                 static_cast<unsigned long long>(count), path.c_str());
+    } else {
+        LOG_ERROR(TAG, "Error writing trace output %s", path.c_str());
+    }
+    return ok;
+}
+
+} // namespace lancast
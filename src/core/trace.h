@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace lancast {
+
+// Opt-in per-frame pipeline tracing.
+//
+// Stages record begin/end events keyed by frame_id into a preallocated ring.
+// A host video frame's id is assigned at capture and replaces the encoder's
+// own count on the wire, so host and client stages of one frame share it.
+// Those ids have gaps wherever a captured frame wasn't sent (encode buffer
+// full, unchanged picture the encoder skipped); loss detection uses the
+// packet sequence numbers instead.
+// When tracing is disabled every call is a single relaxed atomic load.
+// The ring is dumped as Chrome trace-event JSON (chrome://tracing, Perfetto)
+// on request (SIGUSR1) or on exit.
+//
+// Event names must be string literals (only the pointer is stored).
+class Tracer {
+public:
+    // Allocates the ring (capacity rounded up to a power of 2) and enables tracing.
+    // Events are written to `path` by dump().
+    static void enable(const std::string& path, size_t capacity = 1 << 18);
+    static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+    static void begin(const char* name, uint32_t frame_id);
+    static void end(const char* name, uint32_t frame_id);
+    // Records a span that was timed elsewhere (e.g. on another thread)
+    static void complete(const char* name, uint32_t frame_id,
+                         int64_t start_us, int64_t end_us);
+
+    // Names the calling thread in the trace viewer
+    static void set_thread_name(const char* name);
+
+    // Monotonic timestamp shared by all trace events (steady_clock, microseconds)
+    static int64_t now_us();
+
+    // Async-signal-safe: only sets a flag. The owner of the main loop calls
+    // dump_if_requested() to do the actual write.
+    static void request_dump() { dump_requested_.store(true, std::memory_order_relaxed); }
+    static bool dump_if_requested();
+
+    // Writes all buffered events to the configured path. Returns false on I/O error.
+    static bool dump();
+    static bool dump(const std::string& path);
+
+private:
+    static std::atomic<bool> enabled_;
+    static std::atomic<bool> dump_requested_;
+};
+
+// RAII begin/end pair for a pipeline stage
+class TraceScope {
+public:
+    TraceScope(const char* name, uint32_t frame_id)
+        : name_(Tracer::enabled() ? name : nullptr), frame_id_(frame_id) {
+        if (name_) Tracer::begin(name_, frame_id_);
+    }
+    ~TraceScope() {
+        if (name_) Tracer::end(name_, frame_id_);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+    uint32_t frame_id_;
+};
+
+#define LANCAST_TRACE_CONCAT_(a, b) a##b
+#define LANCAST_TRACE_CONCAT(a, b) LANCAST_TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, frame_id) \
+    ::lancast::TraceScope LANCAST_TRACE_CONCAT(trace_scope_, __LINE__)(name, frame_id)
+
+} // namespace lancast
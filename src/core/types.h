@@ -6,6 +6,47 @@
 
 namespace lancast {
 
+// Part of the captured source a video frame shows, in 1/65536ths of the
+// source width and height. A zero width or height means the whole source.
+struct SourceRegion {
+    uint16_t x = 0;
+    uint16_t y = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+
+    bool full() const { return width == 0 || height == 0; }
+    bool operator==(const SourceRegion& o) const {
+        return full() ? o.full() : x == o.x && y == o.y && width == o.width && height == o.height;
+    }
+    bool operator!=(const SourceRegion& o) const { return !(*this == o); }
+};
+
+struct PixelRect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+// Pixels a region covers in a width x height source, rounded outwards and
+// at least 2x2 so it still scales to a YUV420P frame
+inline PixelRect region_pixels(const SourceRegion& region, uint32_t width, uint32_t height) {
+    if (region.full() || width < 2 || height < 2) return {0, 0, width, height};
+    auto span = [](uint32_t start, uint32_t length, uint32_t size, uint32_t& pos, uint32_t& len) {
+        uint64_t lo = (static_cast<uint64_t>(start) * size) >> 16;
+        uint64_t hi = (static_cast<uint64_t>(start + length) * size + 65535) >> 16;
+        if (hi > size) hi = size;
+        if (lo > size - 2) lo = size - 2;
+        if (hi < lo + 2) hi = lo + 2;
+        pos = static_cast<uint32_t>(lo);
+        len = static_cast<uint32_t>(hi - lo);
+    };
+    PixelRect rect;
+    span(region.x, region.width, width, rect.x, rect.width);
+    span(region.y, region.height, height, rect.y, rect.height);
+    return rect;
+}
+
 struct StreamConfig {
     uint32_t width = 1920;
     uint32_t height = 1080;
@@ -14,6 +55,7 @@ struct StreamConfig {
     uint32_t audio_sample_rate = 48000;
     uint16_t audio_channels = 2;
     std::vector<uint8_t> codec_data;  // SPS/PPS extradata (Annex B)
+    SourceRegion region;              // Part of the source the video shows
 };
 
 struct RawVideoFrame {
@@ -21,6 +63,9 @@ struct RawVideoFrame {
     uint32_t width = 0;
     uint32_t height = 0;
     int64_t pts_us = 0;           // Presentation timestamp in microseconds
+    uint16_t frame_id = 0;        // Assigned at capture on the host, carried through decode on the client
+    int64_t recv_us = 0;          // Client: steady-clock time the frame finished assembly
+    SourceRegion region;          // Part of the source the frame was captured from
 };
 
 struct RawAudioFrame {
@@ -42,7 +87,9 @@ struct EncodedPacket {
     std::vector<uint8_t> data;
     FrameType type = FrameType::VideoPFrame;
     int64_t pts_us = 0;
-    uint16_t frame_id = 0;
+    uint16_t frame_id = 0;        // Host video: the capture id (trace key), so not contiguous
+    int64_t recv_us = 0;          // Client: steady-clock time the last fragment arrived
+    uint8_t stream_id = 0;        // Video: which of the host's streams (0 = primary)
 };
 
 } // namespace lancast
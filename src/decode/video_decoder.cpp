@@ -34,7 +34,7 @@ bool VideoDecoder::init(uint32_t width, uint32_t height, const std::vector<uint8
     ctx_->width = static_cast<int>(width);
     ctx_->height = static_cast<int>(height);
     ctx_->pix_fmt = AV_PIX_FMT_YUV420P;
-    ctx_->thread_count = 4;
+    ctx_->thread_count = thread_count_;
     ctx_->thread_type = FF_THREAD_SLICE;
 
     // Set extradata (SPS/PPS) with required padding
@@ -105,6 +105,8 @@ std::optional<RawVideoFrame> VideoDecoder::decode(const EncodedPacket& packet) {
         frame.width = static_cast<uint32_t>(w);
         frame.height = static_cast<uint32_t>(h);
         frame.pts_us = packet.pts_us;
+        frame.frame_id = packet.frame_id;
+        frame.recv_us = packet.recv_us;
         frame.data.resize(w * h + 2 * half_w * half_h);
 
         // Copy Y plane row-by-row (linesize may differ from width)
@@ -13,6 +13,10 @@ public:
     VideoDecoder() = default;
     ~VideoDecoder();
 
+    // Slice threads for the next init (default 4). Callers that decode many
+    // streams on their own thread pool use 1.
+    void set_thread_count(int threads) { thread_count_ = threads; }
+
     bool init(uint32_t width, uint32_t height, const std::vector<uint8_t>& extradata);
     std::optional<RawVideoFrame> decode(const EncodedPacket& packet);
     void shutdown();
@@ -24,6 +28,7 @@ private:
 
     uint32_t width_ = 0;
     uint32_t height_ = 0;
+    int thread_count_ = 4;
     bool initialized_ = false;
 };
 
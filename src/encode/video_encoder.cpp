@@ -13,6 +13,30 @@ namespace lancast {
 
 static constexpr const char* TAG = "VideoEncoder";
 
+// Static-content refinement
+static constexpr uint32_t REFINE_AFTER_STATIC = 3;   // Unchanged inputs before refining
+static constexpr uint32_t MAX_REFINE_FRAMES = 8;     // Longest refinement run
+static constexpr uint32_t REFINE_BITRATE_BOOST = 4;  // Rate-control target while refining
+static constexpr uint32_t CONVERGED_FRACTION = 16;   // Converged below 1/16 of a frame's budget
+static constexpr uint32_t CONVERGED_REFRESH_HZ = 2;   // Near-empty frames a second once converged
+
+// Copies one plane into FFmpeg's padded layout. With compare set, rows that
+// already hold these pixels are left alone. Returns true if any row changed.
+static bool copy_plane(uint8_t* dst, int dst_stride, const uint8_t* src,
+                       int width, int height, bool compare) {
+    bool changed = false;
+    for (int y = 0; y < height; ++y) {
+        uint8_t* dst_row = dst + y * dst_stride;
+        const uint8_t* src_row = src + y * width;
+        if (compare && std::memcmp(dst_row, src_row, width) == 0) continue;
+        std::memcpy(dst_row, src_row, width);
+        if (dst_stride > width)
+            std::memset(dst_row + width, 0, dst_stride - width);
+        changed = true;
+    }
+    return changed;
+}
+
 VideoEncoder::~VideoEncoder() {
     shutdown();
 }
@@ -49,7 +73,7 @@ bool VideoEncoder::init(uint32_t width, uint32_t height, uint32_t fps, uint32_t
     ctx_->thread_type = FF_THREAD_SLICE;
     ctx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
 
-    av_opt_set(ctx_->priv_data, "preset", "ultrafast", 0);
+    av_opt_set(ctx_->priv_data, "preset", ENCODER_PRESETS[preset_.load()], 0);
     av_opt_set(ctx_->priv_data, "tune", "zerolatency", 0);
     av_opt_set(ctx_->priv_data, "forced-idr", "1", 0);
 
@@ -82,7 +106,11 @@ bool VideoEncoder::init(uint32_t width, uint32_t height, uint32_t fps, uint32_t
         return false;
     }
 
+    static_state_ = StaticState::Moving;
+    static_frames_ = 0;
+    refine_frames_ = 0;
     initialized_ = true;
+    generation_++;
     LOG_INFO(TAG, "Encoder initialized: %ux%u @ %u fps, bitrate %u",
              width, height, fps, bitrate);
     return true;
@@ -99,43 +127,48 @@ std::optional<EncodedPacket> VideoEncoder::encode(const RawVideoFrame& frame) {
 
     // Copy YUV planes from compact RawVideoFrame into FFmpeg's padded frame.
     // FFmpeg's linesize[] may be larger than width due to alignment padding.
+    // The frame still holds the previous input, so refinement compares as it copies.
     const uint8_t* src = frame.data.data();
     int w = static_cast<int>(width_);
     int h = static_cast<int>(height_);
     int half_w = w / 2;
     int half_h = h / 2;
-
-    // Y plane
-    int y_stride = av_frame_->linesize[0];
-    for (int y = 0; y < h; ++y) {
-        uint8_t* dst_row = av_frame_->data[0] + y * y_stride;
-        std::memcpy(dst_row, src + y * w, w);
-        if (y_stride > w)
-            std::memset(dst_row + w, 0, y_stride - w);
-    }
-    // U plane
     const uint8_t* u_src = src + w * h;
-    int u_stride = av_frame_->linesize[1];
-    for (int y = 0; y < half_h; ++y) {
-        uint8_t* dst_row = av_frame_->data[1] + y * u_stride;
-        std::memcpy(dst_row, u_src + y * half_w, half_w);
-        if (u_stride > half_w)
-            std::memset(dst_row + half_w, 0, u_stride - half_w);
-    }
-    // V plane
     const uint8_t* v_src = u_src + half_w * half_h;
-    int v_stride = av_frame_->linesize[2];
-    for (int y = 0; y < half_h; ++y) {
-        uint8_t* dst_row = av_frame_->data[2] + y * v_stride;
-        std::memcpy(dst_row, v_src + y * half_w, half_w);
-        if (v_stride > half_w)
-            std::memset(dst_row + half_w, 0, v_stride - half_w);
+    bool changed = copy_plane(av_frame_->data[0], av_frame_->linesize[0], src, w, h, static_refinement_);
+    changed |= copy_plane(av_frame_->data[1], av_frame_->linesize[1], u_src, half_w, half_h, static_refinement_);
+    changed |= copy_plane(av_frame_->data[2], av_frame_->linesize[2], v_src, half_w, half_h, static_refinement_);
+
+    bool keyframe = force_keyframe_.exchange(false);
+    if (static_refinement_) {
+        if (changed || keyframe) {
+            if (static_state_ == StaticState::Refining) set_rate(bitrate_);
+            static_state_ = StaticState::Moving;
+            static_frames_ = 0;
+        } else {
+            static_frames_++;
+        }
+        // Nothing left to improve: the receivers already show this picture.
+        // A refresh now and then still reaches them, so a lost refinement
+        // frame shows up as a sequence gap, for which the viewer asks for a
+        // keyframe, and the stream never looks silent.
+        if (static_state_ == StaticState::Converged &&
+            ++converged_frames_ < std::max(fps_ / CONVERGED_REFRESH_HZ, 1u)) {
+            return std::nullopt;
+        }
+        converged_frames_ = 0;
+        if (static_state_ == StaticState::Moving && static_frames_ >= REFINE_AFTER_STATIC) {
+            LOG_DEBUG(TAG, "Input static for %u frames, refining", static_frames_);
+            static_state_ = StaticState::Refining;
+            refine_frames_ = 0;
+            set_rate(static_cast<uint64_t>(bitrate_) * REFINE_BITRATE_BOOST);
+        }
     }
 
     av_frame_->pts = pts_++;
 
     // Force keyframe if requested
-    if (force_keyframe_.exchange(false)) {
+    if (keyframe) {
         av_frame_->pict_type = AV_PICTURE_TYPE_I;
     } else {
         av_frame_->pict_type = AV_PICTURE_TYPE_NONE;
@@ -170,12 +203,38 @@ std::optional<EncodedPacket> VideoEncoder::encode(const RawVideoFrame& frame) {
 
     if (result.data.empty()) return std::nullopt;
 
+    if (static_state_ == StaticState::Refining) {
+        refine_frames_++;
+        size_t budget = bitrate_ / 8 / std::max(fps_, 1u);
+        if (result.data.size() < budget / CONVERGED_FRACTION || refine_frames_ >= MAX_REFINE_FRAMES) {
+            LOG_DEBUG(TAG, "Refinement done after %u frames (last %zu bytes)", refine_frames_, result.data.size());
+            static_state_ = StaticState::Converged;
+            set_rate(bitrate_);
+        }
+    }
+
     LOG_DEBUG(TAG, "Encoded frame %u: %zu bytes, %s",
               result.frame_id, result.data.size(),
               result.type == FrameType::VideoKeyframe ? "keyframe" : "P-frame");
     return result;
 }
 
+void VideoEncoder::set_static_refinement(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (enabled == static_refinement_) return;
+    if (initialized_ && static_state_ == StaticState::Refining) set_rate(bitrate_);
+    static_refinement_ = enabled;
+    static_state_ = StaticState::Moving;
+    static_frames_ = 0;
+}
+
+void VideoEncoder::set_rate(uint64_t bitrate) {
+    // libx264 picks up rate-control changes on the next frame without a re-init
+    ctx_->bit_rate = static_cast<int64_t>(bitrate);
+    ctx_->rc_max_rate = static_cast<int64_t>(bitrate);
+    ctx_->rc_buffer_size = static_cast<int>(bitrate / 2);
+}
+
 void VideoEncoder::request_keyframe() {
     force_keyframe_.store(true);
     LOG_DEBUG(TAG, "Keyframe requested");
@@ -197,6 +256,46 @@ bool VideoEncoder::set_bitrate(uint32_t bitrate) {
     return ok;
 }
 
+bool VideoEncoder::reconfigure(uint32_t width, uint32_t height, uint32_t fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (width == width_ && height == height_ && fps == fps_) return initialized_;
+    if (width_ == 0) return false;  // Never initialized
+
+    uint32_t bitrate = bitrate_;
+    LOG_INFO(TAG, "Reconfiguring: %ux%u @ %u fps -> %ux%u @ %u fps",
+             width_, height_, fps_, width, height, fps);
+
+    shutdown();
+    bool ok = init(width, height, fps, bitrate);
+    if (ok) {
+        request_keyframe();
+    }
+    return ok;
+}
+
+bool VideoEncoder::set_preset(uint32_t level) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (level >= NUM_ENCODER_PRESETS) return false;
+    if (level == preset_.load()) return initialized_;
+    if (!initialized_) return false;
+
+    uint32_t w = width_, h = height_, fps = fps_, bitrate = bitrate_;
+    LOG_INFO(TAG, "Changing preset: %s -> %s", ENCODER_PRESETS[preset_.load()], ENCODER_PRESETS[level]);
+
+    shutdown();
+    preset_.store(level);
+    bool ok = init(w, h, fps, bitrate);
+    if (ok) {
+        request_keyframe();
+    }
+    return ok;
+}
+
+std::vector<uint8_t> VideoEncoder::extradata() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return extradata_;
+}
+
 void VideoEncoder::shutdown() {
     if (!initialized_) return;
     av_packet_.reset();
@@ -10,6 +10,10 @@
 
 namespace lancast {
 
+// x264 presets the encoder may run at, fastest first. Level 0 is the default.
+static constexpr const char* ENCODER_PRESETS[] = {"ultrafast", "superfast", "veryfast", "faster"};
+static constexpr uint32_t NUM_ENCODER_PRESETS = sizeof(ENCODER_PRESETS) / sizeof(ENCODER_PRESETS[0]);
+
 class VideoEncoder {
 public:
     VideoEncoder() = default;
@@ -19,11 +23,31 @@ public:
     std::optional<EncodedPacket> encode(const RawVideoFrame& frame);
     void request_keyframe();
     bool set_bitrate(uint32_t bitrate);
+    // Reinitialize at a new size and frame rate, keeping the bitrate; the
+    // next frame is a keyframe. No-op when nothing changes.
+    bool reconfigure(uint32_t width, uint32_t height, uint32_t fps);
+    // Reinitialize with another preset level (index into ENCODER_PRESETS)
+    bool set_preset(uint32_t level);
+    uint32_t preset() const { return preset_.load(); }
     uint32_t current_bitrate() const { return bitrate_; }
-    const std::vector<uint8_t>& extradata() const { return extradata_; }
+    // Static-content refinement (off by default). Once the input has not
+    // changed for a few frames, the following frames are encoded at a
+    // boosted bitrate, so x264 drops the QP and sharpens what motion left
+    // blurry, until one comes out small enough to show the picture has
+    // converged. Identical frames after that are not encoded (encode returns
+    // nothing) except for a near-empty refresh twice a second. Any change or
+    // keyframe request starts over.
+    void set_static_refinement(bool enabled);
+    std::vector<uint8_t> extradata() const;
+    // Bumped by every successful (re)initialization; extradata may differ after it
+    uint32_t generation() const { return generation_.load(); }
     void shutdown();
 
 private:
+    enum class StaticState { Moving, Refining, Converged };
+
+    void set_rate(uint64_t bitrate);
+
     AVCodecContextPtr ctx_;
     AVFramePtr av_frame_;
     AVPacketPtr av_packet_;
@@ -32,12 +56,19 @@ private:
     uint32_t height_ = 0;
     uint32_t fps_ = 0;
     uint32_t bitrate_ = 0;
+    std::atomic<uint32_t> preset_{0};
     int64_t pts_ = 0;
-    uint16_t frame_id_ = 0;
+    uint16_t frame_id_ = 0;  // Contiguous; HostSession sends capture ids instead
     std::atomic<bool> force_keyframe_{false};
+    std::atomic<uint32_t> generation_{0};
     std::vector<uint8_t> extradata_;
+    bool static_refinement_ = false;
+    StaticState static_state_ = StaticState::Moving;
+    uint32_t static_frames_ = 0;   // Consecutive inputs identical to the previous one
+    uint32_t refine_frames_ = 0;   // Frames sent in the current refinement run
+    uint32_t converged_frames_ = 0;  // Inputs skipped since the last converged refresh
     bool initialized_ = false;
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
 };
 
 } // namespace lancast
@@ -1,7 +1,10 @@
 #include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/trace.h"
 #include "net/protocol.h"
 #include "app/host_session.h"
 #include "app/client_session.h"
+#include "app/mosaic_session.h"
 #include "app/launcher_ui.h"
 
 #if defined(LANCAST_PLATFORM_LINUX)
@@ -14,6 +17,7 @@
 #include "net/winsock_init.h"
 #endif
 
+#include <cerrno>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
@@ -23,6 +27,7 @@
 #include <chrono>
 #include <csignal>
 #include <atomic>
+#include <vector>
 
 using namespace lancast;
 
@@ -32,13 +37,85 @@ static void signal_handler(int) {
     g_running = false;
 }
 
+#ifdef SIGUSR1
+static void trace_dump_handler(int) {
+    Tracer::request_dump();
+}
+#endif
+
 static void print_usage(const char* prog) {
     fprintf(stderr, "Usage:\n");
     fprintf(stderr, "  %s                                                        Launch UI\n", prog);
     fprintf(stderr, "  %s --host [--port PORT] [--fps FPS] [--bitrate BITRATE]   Start as host\n", prog);
     fprintf(stderr, "             [--resolution WxH] [--window WID]\n");
     fprintf(stderr, "  %s --client IP [--port PORT]                              Connect to host\n", prog);
+    fprintf(stderr, "  %s --mosaic IP[:PORT][/STREAM],...                        Watch several hosts in one window\n", prog);
     fprintf(stderr, "  %s --list-windows                                         List available windows\n", prog);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  --trace FILE     Record per-frame pipeline events, written as Chrome trace JSON\n");
+    fprintf(stderr, "                   on exit or on SIGUSR1 (open in chrome://tracing or Perfetto)\n");
+    fprintf(stderr, "  --perf-counters  Log per-stage CPU time and hardware counters every 5s\n");
+    fprintf(stderr, "  --record-packets FILE  Client: record received datagrams for lancast_replay\n");
+    fprintf(stderr, "  --client-timeout SEC   Host: evict clients silent for SEC seconds (default 10)\n");
+    fprintf(stderr, "  --rx-shards N          Host: receive client traffic on N SO_REUSEPORT sockets (Linux)\n");
+    fprintf(stderr, "  --tx-timestamps        Host: kernel-timestamp every send for the send queue delay (Linux;\n");
+    fprintf(stderr, "                         costs receive buffer space under heavy output)\n");
+    fprintf(stderr, "  --fixed-viewport       Host: always send the full capture, ignoring viewer window size and zoom\n");
+    fprintf(stderr, "  --autotune             Host: adapt resolution, frame rate and x264 preset to load, network\n");
+    fprintf(stderr, "                         and content, within --resolution/--fps\n");
+    fprintf(stderr, "  --control-socket PATH  Host: serve status and live settings on a UNIX socket (see lancast_ctl)\n");
+    fprintf(stderr, "  --replay SECONDS       Host: keep the last SECONDS of video and audio, saved on request\n");
+    fprintf(stderr, "                         with lancast_ctl replay\n");
+    fprintf(stderr, "  --extra-window WID     Host: also offer this window (0 = whole screen) as its own stream;\n");
+    fprintf(stderr, "                         repeatable, streams are numbered from 1\n");
+    fprintf(stderr, "  --stream N             Client: watch stream N of a multi-stream host (default 0)\n");
+    fprintf(stderr, "  --xdp IFACE            Client: receive media through AF_XDP on IFACE (Linux, needs\n");
+    fprintf(stderr, "                         CAP_NET_ADMIN; falls back to the socket)\n");
+    fprintf(stderr, "  --record FILE          Client: save the received stream to FILE (.mkv/.mp4) without\n");
+    fprintf(stderr, "                         re-encoding\n");
+    fprintf(stderr, "  --share-frames NAME    Client: publish decoded frames in shared memory as NAME for local\n");
+    fprintf(stderr, "                         tools (Linux; read with lancast_frames NAME)\n");
+}
+
+// A whole decimal number within [min, max]; trailing text or overflow fails
+static bool parse_number(const char* str, long min, long max, long& value) {
+    if (*str < '0' || *str > '9') return false;
+    char* end = nullptr;
+    errno = 0;
+    value = strtol(str, &end, 10);
+    return *end == '\0' && errno == 0 && value >= min && value <= max;
+}
+
+// "IP[:PORT][/STREAM],IP..." -> one source per entry; PORT defaults to --port
+static bool parse_mosaic(const std::string& spec, uint16_t default_port, std::vector<MosaicSource>& sources) {
+    size_t start = 0;
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) end = spec.size();
+        std::string entry = spec.substr(start, end - start);
+        start = end + 1;
+
+        MosaicSource source;
+        source.port = default_port;
+        size_t slash = entry.find('/');
+        if (slash != std::string::npos) {
+            long stream = 0;
+            if (!parse_number(entry.c_str() + slash + 1, 0, MAX_STREAMS - 1, stream)) return false;
+            source.stream = static_cast<uint8_t>(stream);
+            entry.resize(slash);
+        }
+        size_t colon = entry.find(':');
+        if (colon != std::string::npos) {
+            long port = 0;
+            if (!parse_number(entry.c_str() + colon + 1, 1, 65535, port)) return false;
+            source.port = static_cast<uint16_t>(port);
+            entry.resize(colon);
+        }
+        if (entry.empty()) return false;
+        source.host_ip = entry;
+        sources.push_back(std::move(source));
+    }
+    return !sources.empty();
 }
 
 static bool parse_resolution(const char* str, uint32_t& w, uint32_t& h) {
@@ -53,8 +130,21 @@ static bool parse_resolution(const char* str, uint32_t& w, uint32_t& h) {
 }
 
 static int run_host(uint16_t port, uint32_t fps, uint32_t bitrate,
-                    uint32_t width, uint32_t height, uint64_t window_id) {
+                    uint32_t width, uint32_t height, uint64_t window_id,
+                    uint32_t client_timeout_s, uint32_t rx_shards, bool tx_timestamps, bool fixed_viewport,
+                    bool autotune, const std::string& control_socket,
+                    const std::vector<uint64_t>& extra_windows, uint32_t replay_seconds) {
     HostSession session;
+    session.set_receive_shards(rx_shards);
+    session.set_tx_timestamps(tx_timestamps);
+    session.set_viewport_scaling(!fixed_viewport);
+    session.set_autotune(autotune);
+    session.set_control_socket(control_socket);
+    session.set_replay_seconds(replay_seconds);
+    for (uint64_t wid : extra_windows) session.add_stream(wid);
+    if (client_timeout_s > 0) {
+        session.set_client_timeout(std::chrono::seconds(client_timeout_s));
+    }
     if (!session.start(port, fps, bitrate, width, height, window_id, g_running)) {
         return 1;
     }
@@ -62,20 +152,42 @@ static int run_host(uint16_t port, uint32_t fps, uint32_t bitrate,
     LOG_INFO("Main", "Host running (Ctrl+C to stop)");
     while (g_running && session.is_running()) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        Tracer::dump_if_requested();
     }
 
     session.stop();
+    if (Tracer::enabled()) Tracer::dump();
     return 0;
 }
 
-static int run_client(const std::string& ip, uint16_t port) {
+static int run_client(const std::string& ip, uint16_t port, const std::string& record_path,
+                      uint8_t stream, const std::string& xdp_interface, const std::string& recording_path,
+                      const std::string& frame_share_name) {
     ClientSession session;
+    session.set_packet_record_path(record_path);
+    session.set_stream(stream);
+    session.set_xdp_interface(xdp_interface);
+    session.set_recording_path(recording_path);
+    session.set_frame_share_name(frame_share_name);
     if (!session.connect(ip, port)) {
         return 1;
     }
 
     session.run(g_running);
     session.stop();
+    if (Tracer::enabled()) Tracer::dump();
+    return 0;
+}
+
+static int run_mosaic(const std::vector<MosaicSource>& sources) {
+    MosaicSession session;
+    if (!session.connect(sources)) {
+        return 1;
+    }
+
+    session.run(g_running);
+    session.stop();
+    if (Tracer::enabled()) Tracer::dump();
     return 0;
 }
 
@@ -111,6 +223,9 @@ int main(int argc, char* argv[]) {
 
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+#ifdef SIGUSR1
+    signal(SIGUSR1, trace_dump_handler);
+#endif
 
     bool host_mode = false;
     bool do_list_windows = false;
@@ -121,6 +236,22 @@ int main(int argc, char* argv[]) {
     uint32_t width = 0;   // 0 = auto (capture full screen)
     uint32_t height = 0;
     uint64_t window_id = 0;
+    std::string trace_path;
+    bool perf_counters = false;
+    std::string record_path;
+    std::string xdp_interface;
+    std::string recording_path;
+    std::string frame_share_name;
+    uint32_t client_timeout_s = 0;  // 0 = default
+    uint32_t rx_shards = 1;
+    bool tx_timestamps = false;
+    bool fixed_viewport = false;
+    bool autotune = false;
+    std::string control_socket;
+    uint32_t replay_seconds = 0;
+    std::vector<uint64_t> extra_windows;
+    uint32_t stream = 0;
+    std::string mosaic;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--host") == 0) {
@@ -140,6 +271,42 @@ int main(int argc, char* argv[]) {
             }
         } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
             window_id = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            perf_counters = true;
+        } else if (strcmp(argv[i], "--record-packets") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--client-timeout") == 0 && i + 1 < argc) {
+            client_timeout_s = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--rx-shards") == 0 && i + 1 < argc) {
+            rx_shards = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--tx-timestamps") == 0) {
+            tx_timestamps = true;
+        } else if (strcmp(argv[i], "--fixed-viewport") == 0) {
+            fixed_viewport = true;
+        } else if (strcmp(argv[i], "--autotune") == 0) {
+            autotune = true;
+        } else if (strcmp(argv[i], "--control-socket") == 0 && i + 1 < argc) {
+            control_socket = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_seconds = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--extra-window") == 0 && i + 1 < argc) {
+            extra_windows.push_back(strtoull(argv[++i], nullptr, 0));
+        } else if (strcmp(argv[i], "--stream") == 0 && i + 1 < argc) {
+            stream = static_cast<uint32_t>(atoi(argv[++i]));
+            if (stream >= MAX_STREAMS) {
+                fprintf(stderr, "Stream must be below %u\n", static_cast<unsigned>(MAX_STREAMS));
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--xdp") == 0 && i + 1 < argc) {
+            xdp_interface = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recording_path = argv[++i];
+        } else if (strcmp(argv[i], "--share-frames") == 0 && i + 1 < argc) {
+            frame_share_name = argv[++i];
+        } else if (strcmp(argv[i], "--mosaic") == 0 && i + 1 < argc) {
+            mosaic = argv[++i];
         } else if (strcmp(argv[i], "--list-windows") == 0) {
             do_list_windows = true;
         } else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
@@ -159,6 +326,22 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    if (perf_counters) {
+        PerfCounters::enable();
+    }
+    if (!trace_path.empty()) {
+        Tracer::enable(trace_path);
+    }
+
+    if (!mosaic.empty()) {
+        std::vector<MosaicSource> sources;
+        if (!parse_mosaic(mosaic, port, sources)) {
+            fprintf(stderr, "Invalid mosaic list. Use IP[:PORT][/STREAM],... (e.g. 10.0.0.2,10.0.0.3:9000/1)\n");
+            return 1;
+        }
+        return run_mosaic(sources);
+    }
+
     // If no mode specified, launch the UI
     if (!host_mode && client_ip.empty()) {
         LauncherUI launcher;
@@ -172,9 +355,12 @@ int main(int argc, char* argv[]) {
 
         switch (config.mode) {
             case LaunchMode::Host:
-                return run_host(port, fps, bitrate, width, height, config.window_id);
+                return run_host(port, fps, bitrate, width, height, config.window_id,
+                                client_timeout_s, rx_shards, tx_timestamps, fixed_viewport, autotune,
+                                control_socket, extra_windows, replay_seconds);
             case LaunchMode::Client:
-                return run_client(config.host_ip, port);
+                return run_client(config.host_ip, port, record_path, static_cast<uint8_t>(stream), xdp_interface,
+                                  recording_path, frame_share_name);
             case LaunchMode::None:
             default:
                 return 0;
@@ -182,8 +368,11 @@ int main(int argc, char* argv[]) {
     }
 
     if (host_mode) {
-        return run_host(port, fps, bitrate, width, height, window_id);
+        return run_host(port, fps, bitrate, width, height, window_id,
+                        client_timeout_s, rx_shards, tx_timestamps, fixed_viewport, autotune,
+                        control_socket, extra_windows, replay_seconds);
     } else {
-        return run_client(client_ip, port);
+        return run_client(client_ip, port, record_path, static_cast<uint8_t>(stream), xdp_interface,
+                          recording_path, frame_share_name);
     }
 }
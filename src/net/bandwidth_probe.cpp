@@ -0,0 +1,120 @@
+#include "net/bandwidth_probe.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace lancast {
+
+// Below this a train is too unreliable to measure
+static constexpr uint16_t MIN_MEASURED_PACKETS = 2;
+// A train is path-limited if it arrives slower than this fraction of its send rate
+static constexpr double BOTTLENECK_RATIO = 0.8;
+static constexpr double MAX_CLEAN_LOSS = 0.1;
+// Start well under capacity: the link also carries audio, NACK repairs and cross traffic
+static constexpr double START_HEADROOM = 0.6;
+static constexpr uint32_t MIN_START_BITRATE = 500'000;
+
+uint32_t ProbeResult::start_bitrate(uint32_t target_bps) const {
+    if (!valid || !bottlenecked) return target_bps;
+    auto start = static_cast<uint32_t>(capacity_bps * START_HEADROOM);
+    return std::clamp(start, std::min(MIN_START_BITRATE, target_bps), target_bps);
+}
+
+std::vector<std::vector<uint8_t>> make_probe_train(uint8_t train, uint8_t trains,
+                                                   uint16_t count, uint32_t rate_bps) {
+    std::vector<std::vector<uint8_t>> out;
+    out.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        Packet pkt;
+        pkt.header.magic = PROTOCOL_MAGIC;
+        pkt.header.version = PROTOCOL_VERSION;
+        pkt.header.type = static_cast<uint8_t>(PacketType::PROBE);
+
+        ProbePayload pp;
+        pp.train = train;
+        pp.trains = trains;
+        pp.index = i;
+        pp.count = count;
+        pp.rate_kbps = rate_bps / 1000;
+        pkt.payload.resize(MAX_FRAGMENT_DATA);
+        std::memcpy(pkt.payload.data(), &pp, sizeof(pp));
+        out.push_back(pkt.serialize());
+    }
+    return out;
+}
+
+uint32_t probe_train_rate(uint32_t bitrate_bps, size_t train) {
+    uint64_t rate = static_cast<uint64_t>(bitrate_bps) << std::min<size_t>(train, 8);
+    return static_cast<uint32_t>(std::min<uint64_t>(rate, UINT32_MAX));
+}
+
+ProbeResult evaluate_probe(const ProbeReportPayload& report) {
+    ProbeResult result;
+    size_t trains = std::min<size_t>(report.trains, PROBE_MAX_TRAINS);
+
+    for (size_t i = 0; i < trains; ++i) {
+        const auto& t = report.train[i];
+        if (t.count == 0) continue;
+
+        result.loss = 1.0 - std::min<double>(t.received, t.count) / t.count;
+        if (t.received < MIN_MEASURED_PACKETS) {
+            result.bottlenecked = true;
+            break;
+        }
+
+        double measured_bps = t.measured_kbps * 1000.0;
+        double capacity = std::min(measured_bps * (1.0 - result.loss), double(UINT32_MAX));
+        result.capacity_bps = std::max(result.capacity_bps, static_cast<uint32_t>(capacity));
+        result.valid = true;
+        if (result.loss > MAX_CLEAN_LOSS || measured_bps < BOTTLENECK_RATIO * t.sent_kbps * 1000.0) {
+            result.bottlenecked = true;
+            break;
+        }
+    }
+    return result;
+}
+
+void ProbeReceiver::on_packet(const Packet& pkt, size_t wire_size, int64_t arrival_us) {
+    if (pkt.payload.size() < sizeof(ProbePayload)) return;
+    ProbePayload pp;
+    std::memcpy(&pp, pkt.payload.data(), sizeof(pp));
+    if (pp.train >= PROBE_MAX_TRAINS || pp.trains == 0 || pp.trains > PROBE_MAX_TRAINS) return;
+
+    trains_ = std::max(trains_, pp.trains);
+    Train& t = trains_data_[pp.train];
+    t.sent_kbps = pp.rate_kbps;
+    t.count = pp.count;
+    if (t.received == 0) {
+        t.first_us = arrival_us;
+    } else {
+        t.bytes_after_first += wire_size;
+    }
+    t.last_us = arrival_us;
+    t.received++;
+
+    if (pp.train + 1 == pp.trains && pp.index + 1 == pp.count) complete_ = true;
+}
+
+ProbeReportPayload ProbeReceiver::report() const {
+    ProbeReportPayload report;
+    report.trains = trains_;
+    for (size_t i = 0; i < trains_; ++i) {
+        const Train& t = trains_data_[i];
+        auto& out = report.train[i];
+        out.sent_kbps = t.sent_kbps;
+        out.count = t.count;
+        out.received = t.received;
+        int64_t dispersion_us = t.last_us - t.first_us;
+        if (t.received < MIN_MEASURED_PACKETS) continue;
+        if (dispersion_us > 0) {
+            out.measured_kbps = static_cast<uint32_t>(
+                std::min<uint64_t>(t.bytes_after_first * 8 * 1000 / dispersion_us, UINT32_MAX));
+        } else {
+            out.measured_kbps = t.sent_kbps;  // Faster than the clock resolves
+        }
+    }
+    return report;
+}
+
+} // namespace lancast
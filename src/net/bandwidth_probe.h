@@ -0,0 +1,68 @@
+#pragma once
+
+#include "net/protocol.h"
+#include <cstdint>
+#include <vector>
+
+namespace lancast {
+
+// Join-time bandwidth probe.
+//
+// After WELCOME/STREAM_CONFIG the host sends a few short trains of full-size
+// PROBE packets, each paced at twice the rate of the previous one. The client
+// times each train's dispersion and reports received count and measured rate.
+// A train that arrives slower than it was sent, or with loss, has hit the
+// bottleneck; the fastest clean train bounds the link capacity from below.
+static constexpr size_t PROBE_TRAINS = 3;
+static constexpr uint16_t PROBE_TRAIN_LENGTH = 16;
+
+struct ProbeResult {
+    bool valid = false;
+    bool bottlenecked = false;   // Some train was limited by the path, not by the host
+    uint32_t capacity_bps = 0;   // Estimated path capacity (lower bound if not bottlenecked)
+    double loss = 0.0;           // Loss of the train that ended the probe
+
+    // Encoder bitrate to start this client at, at most target_bps
+    uint32_t start_bitrate(uint32_t target_bps) const;
+    // Fragment pacing rate for this client, 0 = unpaced
+    uint32_t pacing_bps() const { return bottlenecked ? capacity_bps : 0; }
+};
+
+// Host: one serialized train, paced by the caller at rate_bps
+std::vector<std::vector<uint8_t>> make_probe_train(uint8_t train, uint8_t trains,
+                                                   uint16_t count, uint32_t rate_bps);
+
+// Host: pacing rate of train i for a stream targeting bitrate_bps,
+// saturating rather than wrapping for high bitrates
+uint32_t probe_train_rate(uint32_t bitrate_bps, size_t train);
+
+// Host: interpret a client's report
+ProbeResult evaluate_probe(const ProbeReportPayload& report);
+
+// Client: accumulates probe packet arrivals
+class ProbeReceiver {
+public:
+    void on_packet(const Packet& pkt, size_t wire_size, int64_t arrival_us);
+
+    bool started() const { return trains_ > 0; }
+    // The last packet of the last train arrived
+    bool complete() const { return complete_; }
+
+    ProbeReportPayload report() const;
+
+private:
+    struct Train {
+        uint32_t sent_kbps = 0;
+        uint16_t count = 0;
+        uint16_t received = 0;
+        int64_t first_us = 0;
+        int64_t last_us = 0;
+        uint64_t bytes_after_first = 0;
+    };
+
+    Train trains_data_[PROBE_MAX_TRAINS];
+    uint8_t trains_ = 0;
+    bool complete_ = false;
+};
+
+} // namespace lancast
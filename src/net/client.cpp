@@ -1,9 +1,21 @@
 #include "net/client.h"
 #include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
 namespace lancast {
 
 static constexpr const char* TAG = "Client";
+static constexpr double STATS_EWMA_ALPHA = 1.0 / 16.0;
+
+// Kernel arrival time when available, so our own scheduling isn't measured
+static int64_t arrival_us(const UdpSocket::RecvResult& result) {
+    return result.kernel_rx_us > 0 ? result.kernel_rx_us : steady_now_us();
+}
 
 Client::Client() = default;
 Client::~Client() { disconnect(); }
@@ -19,22 +31,17 @@ bool Client::connect(const std::string& host_ip, uint16_t port) {
     // Bind to any available port
     socket_.set_recv_timeout(1000);
     socket_.set_recv_buffer(2 * 1024 * 1024);
+    if (socket_.enable_timestamping()) {
+        LOG_DEBUG(TAG, "Kernel TX/RX timestamping enabled");
+    }
 
     server_ = {host_ip, port};
 
-    // Send HELLO
-    Packet hello;
-    hello.header.magic = PROTOCOL_MAGIC;
-    hello.header.version = PROTOCOL_VERSION;
-    hello.header.type = static_cast<uint8_t>(PacketType::HELLO);
-    hello.header.sequence = 0;
-
-    auto data = hello.serialize();
-    socket_.send_to(data, server_);
+    send_hello();
     LOG_INFO(TAG, "Sent HELLO to %s:%u", host_ip.c_str(), port);
 
     // Wait for WELCOME
-    auto result = socket_.recv_from();
+    auto result = recv();
     if (!result) {
         LOG_ERROR(TAG, "No WELCOME received (timeout)");
         state_ = ConnectionState::Disconnected;
@@ -52,33 +59,103 @@ bool Client::connect(const std::string& host_ip, uint16_t port) {
     if (pkt.payload.size() >= sizeof(WelcomePayload)) {
         WelcomePayload wp;
         std::memcpy(&wp, pkt.payload.data(), sizeof(WelcomePayload));
-        config_.width = wp.width;
-        config_.height = wp.height;
-        config_.fps = wp.fps;
-        config_.video_bitrate = wp.video_bitrate;
-        config_.audio_sample_rate = wp.audio_sample_rate;
-        config_.audio_channels = wp.audio_channels;
+        std::lock_guard lock(config_mutex_);
+        auto& config = configs_[0];
+        config.width = wp.width;
+        config.height = wp.height;
+        config.fps = wp.fps;
+        config.video_bitrate = wp.video_bitrate;
+        config.audio_sample_rate = wp.audio_sample_rate;
+        config.audio_channels = wp.audio_channels;
     }
 
-    // Wait for STREAM_CONFIG packet (codec extradata / SPS/PPS)
-    auto config_result = socket_.recv_from();
+    // Wait for STREAM_CONFIG packet (codec extradata / SPS/PPS); probe trains follow it
+    ProbeReceiver probe;
+    auto config_result = recv();
     if (config_result) {
         auto config_pkt = Packet::deserialize(config_result->data.data(), config_result->data.size());
-        if (config_pkt.header.is_valid() &&
-            static_cast<PacketType>(config_pkt.header.type) == PacketType::STREAM_CONFIG) {
-            config_.codec_data = std::move(config_pkt.payload);
-            LOG_INFO(TAG, "Received STREAM_CONFIG: %zu bytes codec data", config_.codec_data.size());
+        auto config_type = static_cast<PacketType>(config_pkt.header.type);
+        if (config_pkt.header.is_valid() && config_type == PacketType::STREAM_CONFIG) {
+            LOG_INFO(TAG, "Received STREAM_CONFIG: %zu bytes codec data", config_pkt.payload.size());
+            std::lock_guard lock(config_mutex_);
+            configs_[0].codec_data = std::move(config_pkt.payload);
+        } else if (config_pkt.header.is_valid() && config_type == PacketType::STREAM_LIST) {
+            handle_stream_list(config_pkt);
+        } else if (config_pkt.header.is_valid() && config_type == PacketType::PROBE) {
+            probe.on_packet(config_pkt, config_result->data.size(), arrival_us(*config_result));
         }
     }
+    receive_probe(probe);
 
     // Short timeout for low-latency streaming
     socket_.set_recv_timeout(5);
+    last_rx_time_ = std::chrono::steady_clock::now();
+    last_probe_time_ = last_rx_time_;
     state_ = ConnectionState::Connected;
+    subscribe_pending_ = false;
+    if (subscriptions_.load() != 1) send_subscribe();
+    auto config = stream_config();
     LOG_INFO(TAG, "Connected to %s:%u (%ux%u@%u)", host_ip.c_str(), port,
-             config_.width, config_.height, config_.fps);
+             config.width, config.height, config.fps);
     return true;
 }
 
+void Client::receive_probe(ProbeReceiver& probe) {
+    // The host withholds media until we report (or its probe times out)
+    socket_.set_recv_timeout(PROBE_IDLE_MS);
+    auto start = std::chrono::steady_clock::now();
+    auto last_probe = start;
+    while (!probe.complete()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - start > PROBE_MAX_WAIT) break;
+        if (probe.started() && now - last_probe > std::chrono::milliseconds(PROBE_IDLE_MS)) break;
+
+        auto result = recv();
+        if (!result) continue;
+        auto pkt = Packet::deserialize(result->data.data(), result->data.size());
+        if (!pkt.header.is_valid()) continue;
+        // A multi-stream host lists its streams between STREAM_CONFIG and the probe
+        if (static_cast<PacketType>(pkt.header.type) == PacketType::STREAM_LIST) {
+            handle_stream_list(pkt);
+            continue;
+        }
+        if (static_cast<PacketType>(pkt.header.type) != PacketType::PROBE) continue;
+        probe.on_packet(pkt, result->data.size(), arrival_us(*result));
+        last_probe = std::chrono::steady_clock::now();
+    }
+    if (!probe.started()) {
+        LOG_WARN(TAG, "No bandwidth probe received");
+        return;
+    }
+
+    ProbeReportPayload report = probe.report();
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::PROBE_REPORT);
+    pkt.payload.resize(sizeof(report));
+    std::memcpy(pkt.payload.data(), &report, sizeof(report));
+    socket_.send_to(pkt.serialize(), server_);
+
+    for (size_t i = 0; i < report.trains; ++i) {
+        const auto& t = report.train[i];
+        LOG_DEBUG(TAG, "Probe train %zu: sent at %u kbps, received %u/%u at %u kbps",
+                  i, t.sent_kbps, t.received, t.count, t.measured_kbps);
+    }
+}
+
+bool Client::start_recording(const std::string& path) {
+    return recorder_.open(path);
+}
+
+std::optional<UdpSocket::RecvResult> Client::recv() {
+    auto result = socket_.recv_from();
+    if (result && recorder_.is_open()) {
+        recorder_.record(result->data.data(), result->data.size(), arrival_us(*result));
+    }
+    return result;
+}
+
 void Client::disconnect() {
     if (state_.load() == ConnectionState::Disconnected) return;
 
@@ -91,40 +168,289 @@ void Client::disconnect() {
     socket_.send_to(data, server_);
 
     state_ = ConnectionState::Disconnected;
+    recorder_.close();
     LOG_INFO(TAG, "Disconnected");
 }
 
 void Client::poll(ThreadSafeQueue<EncodedPacket>& video_queue,
                   ThreadSafeQueue<EncodedPacket>& audio_queue) {
-    auto result = socket_.recv_from();
-    if (!result) return;
+    if (subscribe_pending_.exchange(false, std::memory_order_relaxed) ||
+        (subscriptions_.load(std::memory_order_relaxed) != 1 &&
+         std::chrono::steady_clock::now() - last_subscribe_time_ >= SUBSCRIBE_INTERVAL)) {
+        send_subscribe();
+    }
 
-    auto pkt = Packet::deserialize(result->data.data(), result->data.size());
-    if (!pkt.header.is_valid()) return;
+    bool received = false;
+    if (xdp_.is_open()) {
+        received = xdp_.poll(XDP_POLL_MS, [&](const XdpReceiver::Datagram& dgram) {
+            if (recorder_.is_open()) recorder_.record(dgram.data, dgram.size, steady_now_us());
+            handle_datagram(dgram.data, dgram.size, 0, video_queue, audio_queue);
+        }) > 0;
+    }
+    // With AF_XDP the socket is nonblocking and only gets what the XDP
+    // program leaves to the stack (IP fragments, other interfaces)
+    if (auto result = recv()) {
+        handle_datagram(result->data.data(), result->data.size(), result->kernel_rx_us,
+                        video_queue, audio_queue);
+        received = true;
+    }
+    if (!received) {
+        // The host evicts clients it hasn't heard from; a silent stream means
+        // we may have been dropped, so re-announce until media flows again.
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_rx_time_ >= RESUME_PROBE_INTERVAL &&
+            now - last_probe_time_ >= RESUME_PROBE_INTERVAL) {
+            LOG_INFO(TAG, "Nothing received for %lld ms, re-announcing to host",
+                     static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                         now - last_rx_time_).count()));
+            send_hello();
+            last_probe_time_ = now;
+        }
+        return;
+    }
+
+    // Check for incomplete keyframes and send NACKs
+    auto incomplete = assembler_.check_incomplete_keyframes(100);
+    for (const auto& kf : incomplete) {
+        send_nack(kf.stream_id, kf.frame_id, kf.missing_indices);
+    }
+
+    // Periodically purge stale incomplete frames
+    size_t purged = assembler_.purge_stale();
+    if (purged > 0) {
+        frames_dropped_.fetch_add(purged, std::memory_order_relaxed);
+    }
+
+    request_repairs(last_rx_time_);
+}
+
+void Client::request_repairs(std::chrono::steady_clock::time_point now) {
+    uint16_t subscribed = subscriptions_.load(std::memory_order_relaxed);
+    for (uint8_t stream = 0; stream < MAX_STREAMS; ++stream) {
+        auto& repair = repairs_[stream];
+        if (!repair.pending || now - repair.since < REPAIR_GRACE) continue;
+        // Only reordered, or the stream was dropped and its count reset
+        if (!(subscribed & (1u << stream)) || sequences_[stream].lost() <= repair.lost_before) {
+            repair.pending = false;
+            continue;
+        }
+        // One request at a time: the keyframe it brings clears the loss
+        if (now - repair.last_request < KEYFRAME_REQ_INTERVAL) continue;
+        LOG_INFO(TAG, "Video loss on stream %u not repaired, requesting a keyframe", stream);
+        request_keyframe(stream);
+        repair.pending = false;
+        repair.last_request = now;
+        keyframes_requested_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
 
-    auto type = static_cast<PacketType>(pkt.header.type);
+bool Client::enable_xdp(const std::string& interface) {
+    uint16_t port = socket_.local_port();
+    if (port == 0 || !xdp_.open(interface, port)) {
+        LOG_WARN(TAG, "AF_XDP unavailable on %s, receiving through the socket", interface.c_str());
+        return false;
+    }
+    socket_.set_nonblocking(true);
+    return true;
+}
+
+// One datagram, parsed in place: media fragments go to the assembler
+// straight from the receive buffer, control packets are rare enough to copy
+void Client::handle_datagram(const uint8_t* data, size_t len, int64_t kernel_rx_us,
+                             ThreadSafeQueue<EncodedPacket>& video_queue,
+                             ThreadSafeQueue<EncodedPacket>& audio_queue) {
+    if (len < HEADER_SIZE) return;
+    auto header = PacketHeader::from_network(data);
+    if (!header.is_valid()) return;
+    last_rx_time_ = std::chrono::steady_clock::now();
+
+    bytes_received_.fetch_add(len, std::memory_order_relaxed);
+    packets_received_.fetch_add(1, std::memory_order_relaxed);
+
+    auto type = static_cast<PacketType>(header.type);
+    if (header.flags & FLAG_RETRANSMIT) {
+        packets_repaired_.fetch_add(1, std::memory_order_relaxed);
+    } else if (type == PacketType::AUDIO_DATA) {
+        track_sequence(audio_sequence_, header.sequence);
+    } else if (type == PacketType::VIDEO_DATA) {
+        // Video still in flight from a stream we just left isn't counted
+        uint8_t stream = header.stream_id();
+        if (subscriptions_.load(std::memory_order_relaxed) & (1u << stream)) {
+            uint64_t lost = sequences_[stream].lost();
+            track_sequence(sequences_[stream], header.sequence);
+            auto& repair = repairs_[stream];
+            if (sequences_[stream].lost() > lost && !repair.pending) {
+                repair.pending = true;
+                repair.lost_before = lost;
+                repair.since = last_rx_time_;
+            }
+        }
+    }
 
     if (type == PacketType::VIDEO_DATA || type == PacketType::AUDIO_DATA) {
-        auto frame = assembler_.feed(pkt);
+        const uint8_t* payload = data + HEADER_SIZE;
+        size_t payload_len = len - HEADER_SIZE;
+        std::optional<EncodedPacket> frame;
+        if (type == PacketType::VIDEO_DATA) {
+            // Sampled per packet; frames are counted when they complete
+            PerfScope perf(PerfStage::Assemble, false);
+            frame = assembler_.feed(header, payload, payload_len);
+        } else {
+            frame = assembler_.feed(header, payload, payload_len);
+        }
+        if (kernel_rx_us > 0) {
+            double queued_ms = (steady_now_us() - kernel_rx_us) / 1000.0;
+            double rx_ms = ewma(rx_queue_ms_.load(std::memory_order_relaxed), queued_ms, STATS_EWMA_ALPHA);
+            rx_queue_ms_.store(rx_ms, std::memory_order_relaxed);
+        }
         if (frame) {
+            frames_completed_.fetch_add(1, std::memory_order_relaxed);
             if (frame->type == FrameType::Audio) {
                 audio_queue.push(std::move(*frame));
             } else {
+                PerfCounters::count_frame(PerfStage::Assemble);
+                // A keyframe, NACK-repaired or new, resets the decoder
+                if (frame->type == FrameType::VideoKeyframe && frame->stream_id < MAX_STREAMS) {
+                    repairs_[frame->stream_id].pending = false;
+                }
+                // Kernel arrival time keeps our own scheduling out of the jitter estimate
+                update_jitter(*frame, kernel_rx_us > 0 ? kernel_rx_us : frame->recv_us);
                 video_queue.push(std::move(*frame));
             }
         }
     } else if (type == PacketType::PING) {
-        handle_ping(pkt);
+        handle_ping(Packet::deserialize(data, len));
+    } else if (type == PacketType::STREAM_UPDATE) {
+        handle_stream_update(Packet::deserialize(data, len));
+    } else if (type == PacketType::STREAM_LIST) {
+        handle_stream_list(Packet::deserialize(data, len));
     }
+}
 
-    // Check for incomplete keyframes and send NACKs
-    auto incomplete = assembler_.check_incomplete_keyframes(100);
-    for (const auto& kf : incomplete) {
-        send_nack(kf.frame_id, kf.missing_indices);
+void Client::handle_stream_update(const Packet& pkt) {
+    if (pkt.payload.size() < sizeof(StreamUpdatePayload)) return;
+    StreamUpdatePayload up;
+    std::memcpy(&up, pkt.payload.data(), sizeof(up));
+    if (up.width == 0 || up.height == 0) return;
+    SourceRegion region{up.region_x, up.region_y, up.region_width, up.region_height};
+    uint8_t stream = pkt.header.stream_id();
+
+    {
+        std::lock_guard lock(config_mutex_);
+        auto& config = configs_[stream];
+        // Sent ahead of every keyframe; usually nothing changed
+        if (up.width == config.width && up.height == config.height && up.fps == config.fps &&
+            region == config.region &&
+            pkt.payload.size() - sizeof(up) == config.codec_data.size() &&
+            std::equal(config.codec_data.begin(), config.codec_data.end(),
+                       pkt.payload.begin() + sizeof(up))) {
+            return;
+        }
+        config.width = up.width;
+        config.height = up.height;
+        config.fps = up.fps;
+        config.video_bitrate = up.video_bitrate;
+        config.codec_data.assign(pkt.payload.begin() + sizeof(up), pkt.payload.end());
+        config.region = region;
     }
+    config_generations_[stream].fetch_add(1, std::memory_order_release);
+    LOG_INFO(TAG, "Stream %u config changed: %ux%u @ %u fps, codec_data %zu bytes, region %s(%u,%u %ux%u)",
+             stream, up.width, up.height, up.fps, pkt.payload.size() - sizeof(up),
+             region.full() ? "full " : "", region.x, region.y, region.width, region.height);
+}
 
-    // Periodically purge stale incomplete frames
-    assembler_.purge_stale();
+void Client::handle_stream_list(const Packet& pkt) {
+    std::vector<StreamListEntry> streams;
+    for (size_t offset = 0; offset + sizeof(StreamListEntry) <= pkt.payload.size();
+         offset += sizeof(StreamListEntry)) {
+        StreamListEntry entry;
+        std::memcpy(&entry, pkt.payload.data() + offset, sizeof(entry));
+        if (entry.stream_id >= MAX_STREAMS) continue;
+        entry.name[sizeof(entry.name) - 1] = '\0';
+        streams.push_back(entry);
+    }
+
+    std::lock_guard lock(config_mutex_);
+    // Repeated with every handshake
+    if (streams.size() == streams_.size() &&
+        std::equal(streams.begin(), streams.end(), streams_.begin(),
+                   [](const StreamListEntry& a, const StreamListEntry& b) {
+                       return std::memcmp(&a, &b, sizeof(a)) == 0;
+                   })) {
+        return;
+    }
+    streams_ = std::move(streams);
+    for (const auto& s : streams_) {
+        LOG_INFO(TAG, "Host stream %u: \"%s\" %ux%u @ %u fps", s.stream_id, s.name, s.width, s.height, s.fps);
+    }
+}
+
+std::vector<StreamListEntry> Client::streams() const {
+    std::lock_guard lock(config_mutex_);
+    return streams_;
+}
+
+StreamConfig Client::stream_config(uint8_t stream) const {
+    if (stream >= MAX_STREAMS) return {};
+    std::lock_guard lock(config_mutex_);
+    return configs_[stream];
+}
+
+Client::Stats Client::stats() const {
+    Stats s;
+    s.bytes_received = bytes_received_.load(std::memory_order_relaxed);
+    s.packets_received = packets_received_.load(std::memory_order_relaxed);
+    s.packets_lost = packets_lost_.load(std::memory_order_relaxed);
+    s.packets_repaired = packets_repaired_.load(std::memory_order_relaxed);
+    s.frames_completed = frames_completed_.load(std::memory_order_relaxed);
+    s.frames_dropped = frames_dropped_.load(std::memory_order_relaxed);
+    s.keyframes_requested = keyframes_requested_.load(std::memory_order_relaxed);
+    s.jitter_ms = jitter_ms_.load(std::memory_order_relaxed);
+    s.rx_queue_ms = rx_queue_ms_.load(std::memory_order_relaxed);
+    s.tx_queue_ms = tx_queue_ms_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void Client::track_sequence(SequenceTracker& tracker, uint32_t sequence) {
+    // Only this flow changed, so adjust the total by its difference
+    uint64_t before = tracker.lost();
+    tracker.on_packet(sequence);
+    uint64_t after = tracker.lost();
+    if (after != before) {
+        packets_lost_.store(packets_lost_.load(std::memory_order_relaxed) + after - before,
+                            std::memory_order_relaxed);
+    }
+}
+
+void Client::reset_sequence(SequenceTracker& tracker) {
+    packets_lost_.store(packets_lost_.load(std::memory_order_relaxed) - tracker.lost(),
+                        std::memory_order_relaxed);
+    tracker.reset();
+}
+
+void Client::update_jitter(const EncodedPacket& frame, int64_t arrival_us) {
+    // The capture timestamp is the sender timeline. Frame ids can't stand in
+    // for it: the host lowers its capture rate when a client falls behind.
+    // The header carries its low 32 bits, so extend it across wraps.
+    auto pts = static_cast<uint32_t>(frame.pts_us);
+
+    if (!jitter_initialized_) {
+        jitter_initialized_ = true;
+        last_pts_us_ = pts;
+        last_transit_us_ = arrival_us - last_pts_us_;
+        return;
+    }
+
+    int32_t delta = static_cast<int32_t>(pts - static_cast<uint32_t>(last_pts_us_));
+    if (delta <= 0) return; // Reordered or duplicate
+    last_pts_us_ += delta;
+
+    int64_t transit = arrival_us - last_pts_us_;
+    double d_ms = std::abs(static_cast<double>(transit - last_transit_us_)) / 1000.0;
+    last_transit_us_ = transit;
+
+    double j = jitter_ms_.load(std::memory_order_relaxed);
+    jitter_ms_.store(j + (d_ms - j) / 16.0, std::memory_order_relaxed);
 }
 
 void Client::send_audio(const EncodedPacket& packet) {
@@ -137,11 +463,82 @@ void Client::send_audio(const EncodedPacket& packet) {
     }
 }
 
-void Client::request_keyframe() {
+void Client::send_report(const ClientReportPayload& report) {
+    if (state_.load() != ConnectionState::Connected) return;
+
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::CLIENT_REPORT);
+    pkt.payload.resize(sizeof(report));
+    std::memcpy(pkt.payload.data(), &report, sizeof(report));
+
+    auto data = pkt.serialize();
+    socket_.send_to(data, server_);
+}
+
+void Client::send_viewport(const ViewportPayload& viewport, uint8_t stream) {
+    if (state_.load() != ConnectionState::Connected) return;
+
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::VIEWPORT);
+    pkt.header.set_stream_id(stream);
+    pkt.payload.resize(sizeof(viewport));
+    std::memcpy(pkt.payload.data(), &viewport, sizeof(viewport));
+
+    auto data = pkt.serialize();
+    socket_.send_to(data, server_);
+}
+
+void Client::subscribe(uint16_t stream_mask) {
+    if (stream_mask == 0 || stream_mask == subscriptions_.exchange(stream_mask)) return;
+    // Sent from the recv thread, which also repeats it
+    subscribe_pending_ = true;
+}
+
+void Client::send_subscribe() {
+    SubscribePayload payload;
+    payload.stream_mask = subscriptions_.load();
+
+    // A stream taken again later starts a fresh count rather than
+    // reporting everything sent meanwhile as lost
+    for (size_t i = 0; i < MAX_STREAMS; ++i) {
+        if (!(payload.stream_mask & (1u << i)) && sequences_[i].started()) {
+            reset_sequence(sequences_[i]);
+        }
+    }
+
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::SUBSCRIBE);
+    pkt.payload.resize(sizeof(payload));
+    std::memcpy(pkt.payload.data(), &payload, sizeof(payload));
+
+    auto data = pkt.serialize();
+    socket_.send_to(data, server_);
+    last_subscribe_time_ = std::chrono::steady_clock::now();
+}
+
+void Client::send_hello() {
+    Packet hello;
+    hello.header.magic = PROTOCOL_MAGIC;
+    hello.header.version = PROTOCOL_VERSION;
+    hello.header.type = static_cast<uint8_t>(PacketType::HELLO);
+    hello.header.sequence = 0;
+
+    auto data = hello.serialize();
+    socket_.send_to(data, server_);
+}
+
+void Client::request_keyframe(uint8_t stream) {
     Packet req;
     req.header.magic = PROTOCOL_MAGIC;
     req.header.version = PROTOCOL_VERSION;
     req.header.type = static_cast<uint8_t>(PacketType::KEYFRAME_REQ);
+    req.header.set_stream_id(stream);
 
     auto data = req.serialize();
     socket_.send_to(data, server_);
@@ -158,9 +555,23 @@ void Client::handle_ping(const Packet& pkt) {
 
     auto data = pong.serialize();
     socket_.send_to(data, server_);
+
+    // The client sends little, so TX reports are only collected once per PING
+    collect_tx_timestamps();
+}
+
+void Client::collect_tx_timestamps() {
+    tx_delays_.clear();
+    if (socket_.drain_tx_timestamps(tx_delays_) == 0) return;
+
+    double tx = tx_queue_ms_.load(std::memory_order_relaxed);
+    for (int64_t d : tx_delays_) {
+        tx = ewma(tx, d / 1000.0, STATS_EWMA_ALPHA);
+    }
+    tx_queue_ms_.store(tx, std::memory_order_relaxed);
 }
 
-void Client::send_nack(uint16_t frame_id, const std::vector<uint16_t>& missing) {
+void Client::send_nack(uint8_t stream, uint16_t frame_id, const std::vector<uint16_t>& missing) {
     if (missing.empty()) return;
 
     Packet nack;
@@ -168,6 +579,7 @@ void Client::send_nack(uint16_t frame_id, const std::vector<uint16_t>& missing)
     nack.header.version = PROTOCOL_VERSION;
     nack.header.type = static_cast<uint8_t>(PacketType::NACK);
     nack.header.frame_id = frame_id;
+    nack.header.set_stream_id(stream);
 
     NackPayload np;
     np.frame_id = frame_id;
@@ -181,8 +593,8 @@ void Client::send_nack(uint16_t frame_id, const std::vector<uint16_t>& missing)
     auto data = nack.serialize();
     socket_.send_to(data, server_);
 
-    LOG_INFO(TAG, "Sent NACK for keyframe %u (%zu missing fragments)",
-             frame_id, missing.size());
+    LOG_INFO(TAG, "Sent NACK for stream %u keyframe %u (%zu missing fragments)",
+             stream, frame_id, missing.size());
 }
 
 } // namespace lancast
@@ -4,10 +4,18 @@
 #include "net/protocol.h"
 #include "net/packet_assembler.h"
 #include "net/packet_fragmenter.h"
+#include "net/packet_trace.h"
+#include "net/bandwidth_probe.h"
+#include "net/sequence_tracker.h"
+#include "net/xdp_receiver.h"
 #include "core/types.h"
 #include "core/thread_safe_queue.h"
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <functional>
+#include <mutex>
+#include <vector>
 
 namespace lancast {
 
@@ -30,24 +38,138 @@ public:
     void poll(ThreadSafeQueue<EncodedPacket>& video_queue,
               ThreadSafeQueue<EncodedPacket>& audio_queue);
 
-    void request_keyframe();
+    // Record every received datagram to a packet trace (call before connect)
+    bool start_recording(const std::string& path);
+
+    // Receive through AF_XDP on this interface (Linux, privileged; call after
+    // connect, before polling). Returns false and stays on the socket if
+    // AF_XDP can't be set up there.
+    bool enable_xdp(const std::string& interface);
+    bool xdp_enabled() const { return xdp_.is_open(); }
+
+    void request_keyframe(uint8_t stream = 0);
     void send_audio(const EncodedPacket& packet);
+    // Tell the host how well we keep up with the stream (any thread)
+    void send_report(const ClientReportPayload& report);
+    // Tell the host what we show of a stream: drawable size and zoomed region (any thread)
+    void send_viewport(const ViewportPayload& viewport, uint8_t stream = 0);
+
+    // Take video from these streams (bit n = stream n) instead of stream 0.
+    // Sent and repeated from the recv thread. Any thread.
+    void subscribe(uint16_t stream_mask);
+    uint16_t subscriptions() const { return subscriptions_.load(std::memory_order_relaxed); }
+    // Streams the host offers; empty for a single-stream host
+    std::vector<StreamListEntry> streams() const;
+
+    // Receive-side counters (snapshot, safe to call from any thread)
+    struct Stats {
+        uint64_t bytes_received = 0;
+        uint64_t packets_received = 0;
+        uint64_t packets_lost = 0;      // Gaps in the packet sequence of subscribed streams and audio
+        uint64_t packets_repaired = 0;  // Keyframe fragments resent after a NACK
+        uint64_t frames_completed = 0;  // Video + audio frames fully assembled
+        uint64_t frames_dropped = 0;    // Incomplete frames purged by the assembler
+        uint64_t keyframes_requested = 0;  // Sent after video loss a NACK couldn't repair
+        double jitter_ms = 0.0;         // Interarrival jitter of video frames (RFC 3550 style)
+        double rx_queue_ms = 0.0;       // Kernel arrival -> assembled, per packet (EWMA)
+        double tx_queue_ms = 0.0;       // send -> handed to the NIC driver (EWMA)
+    };
+    Stats stats() const;
 
     bool is_connected() const { return state_.load() == ConnectionState::Connected; }
     ConnectionState state() const { return state_.load(); }
-    const StreamConfig& stream_config() const { return config_; }
+    // Current config of a stream (copy; the host can change it mid-stream).
+    // Only stream 0 carries the audio settings.
+    StreamConfig stream_config(uint8_t stream = 0) const;
+    // Bumped whenever a STREAM_UPDATE changes a stream's video config. The
+    // decoder switches at the first keyframe after a change.
+    uint32_t config_generation(uint8_t stream = 0) const {
+        return stream < MAX_STREAMS ? config_generations_[stream].load(std::memory_order_acquire) : 0;
+    }
 
 private:
-    void send_nack(uint16_t frame_id, const std::vector<uint16_t>& missing);
+    std::optional<UdpSocket::RecvResult> recv();
+    void handle_datagram(const uint8_t* data, size_t len, int64_t kernel_rx_us,
+                         ThreadSafeQueue<EncodedPacket>& video_queue,
+                         ThreadSafeQueue<EncodedPacket>& audio_queue);
+    void send_hello();
+    void receive_probe(ProbeReceiver& probe);
+    void send_nack(uint8_t stream, uint16_t frame_id, const std::vector<uint16_t>& missing);
+    void request_repairs(std::chrono::steady_clock::time_point now);
+    void send_subscribe();
     void handle_ping(const Packet& pkt);
+    void handle_stream_update(const Packet& pkt);
+    void handle_stream_list(const Packet& pkt);
+    void update_jitter(const EncodedPacket& frame, int64_t arrival_us);
+    void collect_tx_timestamps();
 
     UdpSocket socket_;
+    XdpReceiver xdp_;             // Media receive path when enabled; the socket still sends
+    static constexpr int XDP_POLL_MS = 5;  // Same wait as the socket's recv timeout
+    PacketTraceWriter recorder_;  // Written by whichever thread is receiving
     PacketAssembler assembler_;
     PacketFragmenter fragmenter_;
-    uint16_t mic_sequence_ = 0;
+    uint32_t mic_sequence_ = 0;
     Endpoint server_;
-    StreamConfig config_;
+    mutable std::mutex config_mutex_;  // configs_ and streams_ are updated by the recv thread
+    std::array<StreamConfig, MAX_STREAMS> configs_;
+    std::array<std::atomic<uint32_t>, MAX_STREAMS> config_generations_{};
+    std::vector<StreamListEntry> streams_;
+    std::atomic<uint16_t> subscriptions_{1};
+    std::atomic<bool> subscribe_pending_{false};
     std::atomic<ConnectionState> state_{ConnectionState::Disconnected};
+
+    // Stats (written by the recv thread only)
+    std::atomic<uint64_t> bytes_received_{0};
+    std::atomic<uint64_t> packets_received_{0};
+    std::atomic<uint64_t> packets_lost_{0};
+    std::atomic<uint64_t> packets_repaired_{0};
+    std::atomic<uint64_t> frames_completed_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> keyframes_requested_{0};
+    std::atomic<double> jitter_ms_{0.0};
+    std::atomic<double> rx_queue_ms_{0.0};
+    std::atomic<double> tx_queue_ms_{0.0};
+    std::vector<int64_t> tx_delays_;  // Scratch for drain_tx_timestamps
+
+    // Join-time bandwidth probe
+    static constexpr int PROBE_IDLE_MS = 150;  // Gap that ends the probe
+    static constexpr auto PROBE_MAX_WAIT = std::chrono::milliseconds(800);
+
+    // Silence detection (recv thread only): re-announce so the host resumes us
+    static constexpr auto RESUME_PROBE_INTERVAL = std::chrono::seconds(1);
+    std::chrono::steady_clock::time_point last_rx_time_;
+    std::chrono::steady_clock::time_point last_probe_time_;
+
+    // SUBSCRIBE is repeated so a lost one, or a host that resumed us, catches up
+    static constexpr auto SUBSCRIBE_INTERVAL = std::chrono::seconds(2);
+    std::chrono::steady_clock::time_point last_subscribe_time_;
+
+    // Each stream numbers its video packets separately and audio has its
+    // own numbering, so loss is tracked per flow (recv thread only)
+    void track_sequence(SequenceTracker& tracker, uint32_t sequence);
+    void reset_sequence(SequenceTracker& tracker);
+    std::array<SequenceTracker, MAX_STREAMS> sequences_;
+    SequenceTracker audio_sequence_;
+
+    // Video loss repair (recv thread only). A lost packet leaves the decoder
+    // without a reference until the next keyframe, however long the encoder
+    // goes without one. Keyframe fragments are NACKed; any other loss, or a
+    // keyframe the NACK didn't complete, makes us ask the host for a
+    // keyframe once it has lasted REPAIR_GRACE.
+    static constexpr auto REPAIR_GRACE = std::chrono::milliseconds(250);
+    static constexpr auto KEYFRAME_REQ_INTERVAL = std::chrono::seconds(1);
+    struct Repair {
+        bool pending = false;
+        uint64_t lost_before = 0;  // The stream's loss count before the gap; late packets bring it back
+        std::chrono::steady_clock::time_point since;
+        std::chrono::steady_clock::time_point last_request;
+    };
+    std::array<Repair, MAX_STREAMS> repairs_{};
+
+    bool jitter_initialized_ = false;
+    int64_t last_pts_us_ = 0;        // Extended capture timestamp of the previous video frame
+    int64_t last_transit_us_ = 0;
 };
 
 } // namespace lancast
@@ -0,0 +1,47 @@
+#include "net/client_load.h"
+
+#include <algorithm>
+
+namespace lancast {
+
+// Overloaded: more than this share of offered frames never shown,
+// or decode takes more than this share of the frame interval
+static constexpr double OVERLOAD_DISCARD = 0.10;
+static constexpr double OVERLOAD_DECODE = 0.9;
+// Healthy enough to step the rate back up
+static constexpr double HEALTHY_DECODE = 0.6;
+static constexpr uint8_t HEALTHY_QUEUE = 1;
+
+uint32_t client_fps_limit(const ClientReportPayload& report, uint32_t stream_fps,
+                          uint32_t limit_fps) {
+    if (stream_fps == 0) return 0;
+    uint32_t fps = limit_fps > 0 ? std::min(limit_fps, stream_fps) : stream_fps;
+    double interval_us = 1e6 / fps;
+
+    uint32_t offered = report.decoded + report.discarded;
+    bool discarding = offered > 0 && report.discarded > OVERLOAD_DISCARD * offered;
+    bool slow_decode = report.decode_us > OVERLOAD_DECODE * interval_us;
+
+    if (discarding || slow_decode) {
+        double sustainable = fps;
+        if (slow_decode) {
+            sustainable = std::min(sustainable, OVERLOAD_DECODE * 1e6 / report.decode_us);
+        }
+        // Frames are being thrown away, so what reaches the screen is the real capacity
+        if (discarding) sustainable = std::min(sustainable, report.rendered_fps_x10 / 10.0);
+
+        auto next = static_cast<uint32_t>(sustainable);
+        if (next >= fps) next = fps * 3 / 4;  // Still overloaded at its own estimate
+        return std::max(next, std::min(MIN_CLIENT_FPS, stream_fps));
+    }
+
+    if (limit_fps == 0) return 0;
+    bool healthy = report.discarded == 0 && report.decode_us < HEALTHY_DECODE * interval_us &&
+                   report.video_queue <= HEALTHY_QUEUE;
+    if (!healthy) return limit_fps;
+
+    uint32_t next = limit_fps + std::max<uint32_t>(stream_fps / 6, 1);
+    return next >= stream_fps ? 0 : next;
+}
+
+} // namespace lancast
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "net/protocol.h"
+#include <cstdint>
+
+namespace lancast {
+
+// Client load feedback.
+//
+// Each viewer sends a CLIENT_REPORT about once a second describing what it
+// actually manages to decode and show. The host turns it into a per-client
+// frame rate limit: a client that discards frames or whose decode time eats
+// most of the frame interval is cut straight to the rate it can sustain;
+// one that has stayed comfortably within budget earns the rate back a step
+// at a time.
+static constexpr uint32_t MIN_CLIENT_FPS = 10;
+
+// New frame rate limit for a client, 0 = none. limit_fps is the current
+// limit (0 = none) and stream_fps the configured stream rate.
+uint32_t client_fps_limit(const ClientReportPayload& report, uint32_t stream_fps,
+                          uint32_t limit_fps);
+
+} // namespace lancast
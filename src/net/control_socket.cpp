@@ -0,0 +1,517 @@
+#include "net/control_socket.h"
+#include "core/logger.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <sys/socket.h>
+#  include <sys/stat.h>
+#  include <sys/un.h>
+#  include <unistd.h>
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "Control";
+
+// --- Request parsing ---
+
+std::optional<std::string> ControlRequest::string_arg(const std::string& key) const {
+    auto it = args.find(key);
+    if (it == args.end()) return std::nullopt;
+    return it->second;
+}
+
+std::optional<uint64_t> ControlRequest::uint_arg(const std::string& key) const {
+    auto it = args.find(key);
+    if (it == args.end() || it->second.empty()) return std::nullopt;
+    uint64_t value = 0;
+    for (char c : it->second) {
+        if (c < '0' || c > '9') return std::nullopt;
+        auto digit = static_cast<uint64_t>(c - '0');
+        if (value > (UINT64_MAX - digit) / 10) return std::nullopt;  // Would overflow
+        value = value * 10 + digit;
+    }
+    return value;
+}
+
+namespace {
+
+struct Parser {
+    const std::string& text;
+    size_t pos = 0;
+
+    void skip_space() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+    bool consume(char c) {
+        skip_space();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool string(std::string& out, std::string& error) {
+        if (!consume('"')) {
+            error = "expected a string";
+            return false;
+        }
+        out.clear();
+        while (pos < text.size()) {
+            char c = text[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) break;
+            char e = text[pos++];
+            switch (e) {
+                case '"': case '\\': case '/': out += e; break;
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) break;
+                    unsigned code = std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    out += code < 0x80 ? static_cast<char>(code) : '?';
+                    break;
+                }
+                default:
+                    error = "bad escape in string";
+                    return false;
+            }
+        }
+        error = "unterminated string";
+        return false;
+    }
+
+    // Scalar value as text: strings unquoted, numbers and literals verbatim
+    bool value(std::string& out, std::string& error) {
+        skip_space();
+        if (pos >= text.size()) {
+            error = "expected a value";
+            return false;
+        }
+        char c = text[pos];
+        if (c == '"') return string(out, error);
+        if (c == '{' || c == '[') {
+            error = "nested values are not supported";
+            return false;
+        }
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) ||
+                                     text[pos] == '-' || text[pos] == '+' || text[pos] == '.')) {
+            pos++;
+        }
+        out = text.substr(start, pos - start);
+        if (out.empty()) {
+            error = "expected a value";
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+std::optional<ControlRequest> parse_control_request(const std::string& line, std::string& error) {
+    Parser p{line};
+    ControlRequest request;
+    if (!p.consume('{')) {
+        error = "expected a JSON object";
+        return std::nullopt;
+    }
+    if (!p.consume('}')) {
+        for (;;) {
+            std::string key, value;
+            if (!p.string(key, error)) return std::nullopt;
+            if (!p.consume(':')) {
+                error = "expected ':' after \"" + key + "\"";
+                return std::nullopt;
+            }
+            if (!p.value(value, error)) return std::nullopt;
+            if (key == "cmd") {
+                request.cmd = value;
+            } else {
+                request.args[key] = value;
+            }
+            if (p.consume(',')) continue;
+            if (p.consume('}')) break;
+            error = "expected ',' or '}'";
+            return std::nullopt;
+        }
+    }
+    p.skip_space();
+    if (p.pos != line.size()) {
+        error = "trailing data after the object";
+        return std::nullopt;
+    }
+    if (request.cmd.empty()) {
+        error = "missing \"cmd\"";
+        return std::nullopt;
+    }
+    return request;
+}
+
+// --- Response building ---
+
+static void append_escaped(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void JsonWriter::prefix(const char* key) {
+    if (!first_.empty()) {
+        if (!first_.back()) out_ += ',';
+        first_.back() = false;
+    }
+    if (key) {
+        append_escaped(out_, key);
+        out_ += ':';
+    }
+}
+
+JsonWriter& JsonWriter::begin_object(const char* key) {
+    prefix(key);
+    out_ += '{';
+    first_.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+    out_ += '}';
+    first_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::begin_array(const char* key) {
+    prefix(key);
+    out_ += '[';
+    first_.push_back(true);
+    return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+    out_ += ']';
+    first_.pop_back();
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* key, const std::string& value) {
+    prefix(key);
+    append_escaped(out_, value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* key, const char* value) {
+    return field(key, std::string(value ? value : ""));
+}
+
+JsonWriter& JsonWriter::field(const char* key, double value) {
+    prefix(key);
+    if (!std::isfinite(value)) {
+        out_ += "null";
+        return *this;
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.3f", value);
+    out_ += buf;
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* key, uint64_t value) {
+    prefix(key);
+    out_ += std::to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* key, bool value) {
+    prefix(key);
+    out_ += value ? "true" : "false";
+    return *this;
+}
+
+std::string control_error(const std::string& message) {
+    JsonWriter json;
+    json.begin_object().field("ok", false).field("error", message).end_object();
+    return json.str();
+}
+
+// --- Socket ---
+
+ControlSocket::~ControlSocket() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool ControlSocket::open(const std::string& path) {
+    (void)path;
+    LOG_WARN(TAG, "Control socket is not supported on Windows");
+    return false;
+}
+
+void ControlSocket::close() {}
+
+void ControlSocket::poll(int timeout_ms, const Handler& handler) {
+    (void)timeout_ms;
+    (void)handler;
+}
+
+void ControlSocket::accept_pending() {}
+
+bool ControlSocket::service(Connection& conn, const Handler& handler) {
+    (void)conn;
+    (void)handler;
+    return false;
+}
+
+std::optional<std::string> ControlSocket::request(const std::string& path, const std::string& line,
+                                                  int timeout_ms) {
+    (void)path;
+    (void)line;
+    (void)timeout_ms;
+    return std::nullopt;
+}
+
+#else
+
+#ifndef MSG_NOSIGNAL
+#  define MSG_NOSIGNAL 0  // macOS: SO_NOSIGPIPE on the socket instead
+#endif
+
+static void no_sigpipe(int fd) {
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#else
+    (void)fd;
+#endif
+}
+
+static bool make_address(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+static int connect_to(const sockaddr_un& addr) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    no_sigpipe(fd);
+    return fd;
+}
+
+bool ControlSocket::open(const std::string& path) {
+    close();
+    sockaddr_un addr;
+    if (!make_address(path, addr)) {
+        LOG_ERROR(TAG, "Control socket path too long: %s", path.c_str());
+        return false;
+    }
+
+    // Only a socket nobody answers on may be replaced
+    int probe = connect_to(addr);
+    if (probe >= 0) {
+        ::close(probe);
+        LOG_ERROR(TAG, "Another process is listening on %s", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            LOG_ERROR(TAG, "%s exists and is not a socket", path.c_str());
+            return false;
+        }
+        ::unlink(path.c_str());
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        LOG_ERROR(TAG, "socket(AF_UNIX) failed: %s", strerror(errno));
+        return false;
+    }
+    // Owner only: the socket can change the stream and the log level
+    mode_t old_mask = ::umask(0077);
+    bool bound = ::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::umask(old_mask);
+    if (!bound || ::listen(fd, 4) < 0) {
+        LOG_ERROR(TAG, "Can't listen on %s: %s", path.c_str(), strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    listen_fd_ = fd;
+    path_ = path;
+    LOG_INFO(TAG, "Listening on %s", path.c_str());
+    return true;
+}
+
+void ControlSocket::close() {
+    for (auto& conn : connections_) ::close(conn.fd);
+    connections_.clear();
+    if (listen_fd_ < 0) return;
+    ::close(listen_fd_);
+    ::unlink(path_.c_str());
+    listen_fd_ = -1;
+}
+
+void ControlSocket::accept_pending() {
+    for (;;) {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) return;
+        no_sigpipe(fd);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        connections_.push_back({fd, {}});
+    }
+}
+
+bool ControlSocket::service(Connection& conn, const Handler& handler) {
+    char buf[1024];
+    for (;;) {
+        ssize_t n = ::recv(conn.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn.buffer.append(buf, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) return false;
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return false;
+    }
+
+    size_t newline;
+    while ((newline = conn.buffer.find('\n')) != std::string::npos) {
+        std::string line = conn.buffer.substr(0, newline);
+        conn.buffer.erase(0, newline + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        std::string error;
+        auto request = parse_control_request(line, error);
+        std::string response = request ? handler(*request) : control_error(error);
+        response += '\n';
+
+        // Responses are small; a reader that stops reading loses its connection
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = ::send(conn.fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                pollfd pfd{conn.fd, POLLOUT, 0};
+                if (::poll(&pfd, 1, 100) > 0) continue;
+            }
+            return false;
+        }
+    }
+    if (conn.buffer.size() > MAX_CONTROL_LINE) {
+        LOG_WARN(TAG, "Dropping control connection: line over %zu bytes", MAX_CONTROL_LINE);
+        return false;
+    }
+    return true;
+}
+
+void ControlSocket::poll(int timeout_ms, const Handler& handler) {
+    if (listen_fd_ < 0) return;
+
+    std::vector<pollfd> fds;
+    fds.reserve(connections_.size() + 1);
+    fds.push_back({listen_fd_, POLLIN, 0});
+    for (const auto& conn : connections_) fds.push_back({conn.fd, POLLIN, 0});
+    if (::poll(fds.data(), fds.size(), timeout_ms) <= 0) return;
+
+    // Existing connections first: fds[i + 1] belongs to connections_[i]
+    size_t kept = 0;
+    for (size_t i = 0; i < connections_.size(); ++i) {
+        bool open = true;
+        if (fds[i + 1].revents != 0) open = service(connections_[i], handler);
+        if (open) {
+            connections_[kept++] = std::move(connections_[i]);
+        } else {
+            ::close(connections_[i].fd);
+        }
+    }
+    connections_.resize(kept);
+
+    if (fds[0].revents & POLLIN) accept_pending();
+}
+
+std::optional<std::string> ControlSocket::request(const std::string& path, const std::string& line,
+                                                  int timeout_ms) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return std::nullopt;
+    int fd = connect_to(addr);
+    if (fd < 0) return std::nullopt;
+
+    std::string out = line + "\n";
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            ::close(fd);
+            return std::nullopt;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    std::string response;
+    char buf[4096];
+    while (response.find('\n') == std::string::npos) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, timeout_ms) <= 0) break;
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) break;
+        response.append(buf, static_cast<size_t>(n));
+    }
+    ::close(fd);
+
+    size_t newline = response.find('\n');
+    if (newline == std::string::npos) return std::nullopt;
+    return response.substr(0, newline);
+}
+
+#endif
+
+} // namespace lancast
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// Local control interface.
+//
+// A running host listens on a UNIX socket for line-delimited JSON. Each
+// request is one flat object naming a command, e.g.
+//
+//   {"cmd":"status"}
+//   {"cmd":"set","bitrate":4000000,"resolution":"1280x720","log_level":"debug"}
+//
+// and gets exactly one JSON line back with "ok" and either the result or an
+// "error". Nested values are only produced, never parsed. lancast_ctl is a
+// command-line front end.
+static constexpr const char* DEFAULT_CONTROL_SOCKET = "/tmp/lancast.sock";
+static constexpr size_t MAX_CONTROL_LINE = 4096;
+
+// A parsed request: "cmd" plus every other member, strings and numbers
+// alike kept as text
+struct ControlRequest {
+    std::string cmd;
+    std::map<std::string, std::string> args;
+
+    bool has(const std::string& key) const { return args.count(key) > 0; }
+    std::optional<std::string> string_arg(const std::string& key) const;
+    // Non-negative integer argument; nullopt when absent, not a number or
+    // too large for 64 bits
+    std::optional<uint64_t> uint_arg(const std::string& key) const;
+};
+
+// Parses one request line. On failure returns nullopt and sets error.
+std::optional<ControlRequest> parse_control_request(const std::string& line, std::string& error);
+
+// Builds one JSON line. Keys are only needed inside objects.
+class JsonWriter {
+public:
+    JsonWriter& begin_object(const char* key = nullptr);
+    JsonWriter& end_object();
+    JsonWriter& begin_array(const char* key = nullptr);
+    JsonWriter& end_array();
+
+    JsonWriter& field(const char* key, const std::string& value);
+    JsonWriter& field(const char* key, const char* value);
+    JsonWriter& field(const char* key, double value);
+    JsonWriter& field(const char* key, uint64_t value);
+    JsonWriter& field(const char* key, uint32_t value) { return field(key, static_cast<uint64_t>(value)); }
+    JsonWriter& field(const char* key, bool value);
+
+    const std::string& str() const { return out_; }
+
+private:
+    void prefix(const char* key);
+
+    std::string out_;
+    std::vector<bool> first_;  // Per open container: nothing written yet
+};
+
+// {"ok":false,"error":"..."}
+std::string control_error(const std::string& message);
+
+class ControlSocket {
+public:
+    // Takes a request, returns the response line (without the newline)
+    using Handler = std::function<std::string(const ControlRequest&)>;
+
+    ControlSocket() = default;
+    ~ControlSocket();
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    // Listens at path. A socket file left by a dead process is replaced;
+    // one with a live listener makes this fail. Not available on Windows.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return listen_fd_ >= 0; }
+    const std::string& path() const { return path_; }
+
+    // Accepts connections and answers every complete line, waiting up to
+    // timeout_ms for activity. Call from one thread.
+    void poll(int timeout_ms, const Handler& handler);
+
+    // Client side: send one line to the socket at path and wait for the reply
+    static std::optional<std::string> request(const std::string& path, const std::string& line,
+                                              int timeout_ms = 2000);
+
+private:
+    struct Connection {
+        int fd = -1;
+        std::string buffer;
+    };
+
+    void accept_pending();
+    bool service(Connection& conn, const Handler& handler);  // False once closed
+
+    int listen_fd_ = -1;
+    std::string path_;
+    std::vector<Connection> connections_;
+};
+
+} // namespace lancast
@@ -1,13 +1,28 @@
 #include "net/packet_assembler.h"
+#include "core/trace.h"
 
 namespace lancast {
 
 std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet) {
-    const auto& h = packet.header;
+    return feed(packet, std::chrono::steady_clock::now());
+}
+
+std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet, TimePoint now) {
+    return feed(packet.header, packet.payload.data(), packet.payload.size(), now);
+}
+
+std::optional<EncodedPacket> PacketAssembler::feed(const PacketHeader& header, const uint8_t* payload,
+                                                   size_t len) {
+    return feed(header, payload, len, std::chrono::steady_clock::now());
+}
+
+std::optional<EncodedPacket> PacketAssembler::feed(const PacketHeader& header, const uint8_t* payload,
+                                                   size_t len, TimePoint now) {
+    const auto& h = header;
     if (!h.is_valid()) return std::nullopt;
     if (h.frag_total == 0) return std::nullopt;
 
-    FrameKey key{h.frame_id, h.type};
+    FrameKey key{h.frame_id, h.type, h.stream_id()};
 
     auto it = pending_.find(key);
     if (it == pending_.end()) {
@@ -17,9 +32,10 @@ std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet) {
         state.frags_received = 0;
         state.type = static_cast<PacketType>(h.type);
         state.flags = h.flags;
+        state.stream_id = h.stream_id();
         state.timestamp_us = h.timestamp_us;
         state.fragments.resize(h.frag_total);
-        state.created = std::chrono::steady_clock::now();
+        state.created = now;
         auto [inserted, _] = pending_.emplace(key, std::move(state));
         it = inserted;
     }
@@ -31,7 +47,7 @@ std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet) {
     // Avoid duplicate fragments
     if (!state.fragments[h.frag_idx].empty()) return std::nullopt;
 
-    state.fragments[h.frag_idx] = packet.payload;
+    state.fragments[h.frag_idx].assign(payload, payload + len);
     state.frags_received++;
     state.flags |= h.flags; // Accumulate flags (e.g. KEYFRAME)
 
@@ -48,7 +64,10 @@ std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet) {
         result.data.insert(result.data.end(), frag.begin(), frag.end());
     }
     result.frame_id = state.frame_id;
+    result.stream_id = state.stream_id;
     result.pts_us = static_cast<int64_t>(state.timestamp_us);
+    result.recv_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        now.time_since_epoch()).count();
 
     if (state.type == PacketType::CLIENT_AUDIO_DATA) {
         result.type = FrameType::ClientAudio;
@@ -60,6 +79,14 @@ std::optional<EncodedPacket> PacketAssembler::feed(const Packet& packet) {
         result.type = FrameType::VideoPFrame;
     }
 
+    if (Tracer::enabled()) {
+        // Span from first fragment arrival to completion, on the receiving thread
+        int64_t created_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            state.created.time_since_epoch()).count();
+        const char* name = state.type == PacketType::VIDEO_DATA ? "assemble" : "assemble_audio";
+        Tracer::complete(name, state.frame_id, created_us, result.recv_us);
+    }
+
     pending_.erase(it);
     return result;
 }
@@ -76,6 +103,7 @@ std::vector<IncompleteKeyframe> PacketAssembler::check_incomplete_keyframes(int6
         if (now - state.created < threshold) continue;
 
         IncompleteKeyframe kf;
+        kf.stream_id = state.stream_id;
         kf.frame_id = state.frame_id;
         kf.frag_total = state.frag_total;
 
@@ -94,17 +122,23 @@ std::vector<IncompleteKeyframe> PacketAssembler::check_incomplete_keyframes(int6
     return result;
 }
 
-void PacketAssembler::purge_stale(int64_t timeout_ms) {
-    auto now = std::chrono::steady_clock::now();
+size_t PacketAssembler::purge_stale(int64_t timeout_ms) {
+    return purge_stale(timeout_ms, std::chrono::steady_clock::now());
+}
+
+size_t PacketAssembler::purge_stale(int64_t timeout_ms, TimePoint now) {
     auto timeout = std::chrono::milliseconds(timeout_ms);
+    size_t purged = 0;
 
     for (auto it = pending_.begin(); it != pending_.end();) {
         if (now - it->second.created > timeout) {
             it = pending_.erase(it);
+            purged++;
         } else {
             ++it;
         }
     }
+    return purged;
 }
 
 } // namespace lancast
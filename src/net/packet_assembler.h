@@ -10,6 +10,7 @@
 namespace lancast {
 
 struct IncompleteKeyframe {
+    uint8_t stream_id = 0;
     uint16_t frame_id = 0;
     uint16_t frag_total = 0;
     std::vector<uint16_t> missing_indices;
@@ -17,15 +18,26 @@ struct IncompleteKeyframe {
 
 class PacketAssembler {
 public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
     // Feed a received packet. Returns a complete EncodedPacket when all fragments arrive.
+    // The overloads taking `now` let offline replay drive the assembler on trace time.
     std::optional<EncodedPacket> feed(const Packet& packet);
+    std::optional<EncodedPacket> feed(const Packet& packet, TimePoint now);
+
+    // Same, for a fragment still sitting in the receive buffer: the payload
+    // is copied once, straight into reassembly storage.
+    std::optional<EncodedPacket> feed(const PacketHeader& header, const uint8_t* payload, size_t len);
+    std::optional<EncodedPacket> feed(const PacketHeader& header, const uint8_t* payload, size_t len,
+                                      TimePoint now);
 
     // Check for incomplete keyframes older than age_ms. Returns info for NACKing.
     // Each frame is only reported once (marks nack_sent).
     std::vector<IncompleteKeyframe> check_incomplete_keyframes(int64_t age_ms = 100);
 
-    // Purge stale incomplete frames older than timeout_ms
-    void purge_stale(int64_t timeout_ms = 200);
+    // Purge stale incomplete frames older than timeout_ms. Returns the number dropped.
+    size_t purge_stale(int64_t timeout_ms = 200);
+    size_t purge_stale(int64_t timeout_ms, TimePoint now);
 
 private:
     struct FrameState {
@@ -34,21 +46,25 @@ private:
         uint16_t frags_received = 0;
         PacketType type = PacketType::VIDEO_DATA;
         uint8_t flags = 0;
+        uint8_t stream_id = 0;
         uint32_t timestamp_us = 0;
         std::vector<std::vector<uint8_t>> fragments; // indexed by frag_idx
         std::chrono::steady_clock::time_point created;
         bool nack_sent = false;
     };
 
-    // Key: frame_id (combined with type to handle video/audio with same IDs)
+    // Key: frame_id combined with type and stream, which number frames independently
     struct FrameKey {
         uint16_t frame_id;
         uint8_t type;
-        bool operator==(const FrameKey& o) const { return frame_id == o.frame_id && type == o.type; }
+        uint8_t stream_id;
+        bool operator==(const FrameKey& o) const {
+            return frame_id == o.frame_id && type == o.type && stream_id == o.stream_id;
+        }
     };
     struct FrameKeyHash {
         size_t operator()(const FrameKey& k) const {
-            return std::hash<uint32_t>()(k.frame_id | (k.type << 16));
+            return std::hash<uint32_t>()(k.frame_id | (k.type << 16) | (static_cast<uint32_t>(k.stream_id) << 24));
         }
     };
 
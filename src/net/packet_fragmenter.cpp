@@ -3,7 +3,7 @@
 
 namespace lancast {
 
-std::vector<Packet> PacketFragmenter::fragment(const EncodedPacket& encoded, uint16_t& sequence) {
+std::vector<Packet> PacketFragmenter::fragment(const EncodedPacket& encoded, uint32_t& sequence) {
     std::vector<Packet> fragments;
 
     const size_t data_size = encoded.data.size();
@@ -38,6 +38,7 @@ std::vector<Packet> PacketFragmenter::fragment(const EncodedPacket& encoded, uin
         pkt.header.flags = flags;
         if (i == 0) pkt.header.flags |= FLAG_FIRST;
         if (i == num_frags - 1) pkt.header.flags |= FLAG_LAST;
+        pkt.header.set_stream_id(encoded.stream_id);
         pkt.header.sequence = sequence++;
         pkt.header.timestamp_us = static_cast<uint32_t>(encoded.pts_us & 0xFFFFFFFF);
         pkt.header.frame_id = encoded.frame_id;
@@ -0,0 +1,247 @@
+#include "net/packet_trace.h"
+#include "core/logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifndef _WIN32
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "PacketTrace";
+
+static void fill_header(uint8_t* out, uint64_t count) {
+    std::memcpy(out, PACKET_TRACE_MAGIC, 4);
+    uint16_t version = PACKET_TRACE_VERSION;
+    uint16_t reserved = 0;
+    std::memcpy(out + 4, &version, 2);
+    std::memcpy(out + 6, &reserved, 2);
+    std::memcpy(out + 8, &count, 8);
+}
+
+// --- Writer ---
+
+PacketTraceWriter::~PacketTraceWriter() {
+    close();
+}
+
+bool PacketTraceWriter::open(const std::string& path, size_t capacity_bytes) {
+    close();
+    path_ = path;
+    count_ = 0;
+    last_us_ = 0;
+    full_ = false;
+
+    uint8_t header[PACKET_TRACE_HEADER_SIZE];
+    fill_header(header, 0);
+
+#ifdef _WIN32
+    (void)capacity_bytes;
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        LOG_ERROR(TAG, "Cannot open %s for writing", path.c_str());
+        return false;
+    }
+    fwrite(header, 1, sizeof(header), file_);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR(TAG, "Cannot open %s for writing: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    capacity_ = std::max(capacity_bytes, PACKET_TRACE_HEADER_SIZE + 4096);
+    if (ftruncate(fd_, static_cast<off_t>(capacity_)) < 0) {
+        LOG_ERROR(TAG, "Cannot size %s: %s", path.c_str(), strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    void* map = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(TAG, "Cannot map %s: %s", path.c_str(), strerror(errno));
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    map_ = static_cast<uint8_t*>(map);
+    std::memcpy(map_, header, sizeof(header));
+    used_ = sizeof(header);
+#endif
+
+    open_ = true;
+    LOG_INFO(TAG, "Recording received packets to %s", path.c_str());
+    return true;
+}
+
+bool PacketTraceWriter::append(const uint8_t* bytes, size_t len) {
+#ifdef _WIN32
+    return fwrite(bytes, 1, len, file_) == len;
+#else
+    if (used_ + len > capacity_) return false;
+    std::memcpy(map_ + used_, bytes, len);
+    used_ += len;
+    return true;
+#endif
+}
+
+bool PacketTraceWriter::record(const uint8_t* data, size_t len, int64_t arrival_us) {
+    if (!open_ || full_) return false;
+    if (len == 0 || len > std::numeric_limits<uint16_t>::max()) return false;
+
+    int64_t delta = count_ == 0 ? 0 : arrival_us - last_us_;
+    delta = std::clamp<int64_t>(delta, 0, std::numeric_limits<uint32_t>::max());
+    last_us_ = arrival_us;
+
+    uint8_t rec[PACKET_TRACE_RECORD_HEADER];
+    uint32_t delta_us = static_cast<uint32_t>(delta);
+    uint16_t length = static_cast<uint16_t>(len);
+    std::memcpy(rec, &delta_us, 4);
+    std::memcpy(rec + 4, &length, 2);
+
+#ifndef _WIN32
+    if (used_ + sizeof(rec) + len > capacity_) {
+        full_ = true;
+        LOG_WARN(TAG, "Packet trace %s is full after %llu packets; recording stopped",
+                 path_.c_str(), static_cast<unsigned long long>(count_));
+        return false;
+    }
+#endif
+    if (!append(rec, sizeof(rec)) || !append(data, len)) {
+        full_ = true;
+        LOG_WARN(TAG, "Write to packet trace %s failed; recording stopped", path_.c_str());
+        return false;
+    }
+    count_++;
+    return true;
+}
+
+void PacketTraceWriter::close() {
+    if (!open_) return;
+    open_ = false;
+
+    uint8_t header[PACKET_TRACE_HEADER_SIZE];
+    fill_header(header, count_);
+
+#ifdef _WIN32
+    fseek(file_, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), file_);
+    fclose(file_);
+    file_ = nullptr;
+#else
+    std::memcpy(map_, header, sizeof(header));
+    munmap(map_, capacity_);
+    map_ = nullptr;
+    if (ftruncate(fd_, static_cast<off_t>(used_)) < 0) {
+        LOG_WARN(TAG, "Cannot trim %s: %s", path_.c_str(), strerror(errno));
+    }
+    ::close(fd_);
+    fd_ = -1;
+#endif
+
+    LOG_INFO(TAG, "Packet trace %s closed (%llu packets)",
+             path_.c_str(), static_cast<unsigned long long>(count_));
+}
+
+// --- Reader ---
+
+PacketTraceReader::~PacketTraceReader() {
+    close();
+}
+
+bool PacketTraceReader::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOG_ERROR(TAG, "Cannot open %s", path.c_str());
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buffer_.resize(len > 0 ? static_cast<size_t>(len) : 0);
+    size_t got = fread(buffer_.data(), 1, buffer_.size(), f);
+    fclose(f);
+    buffer_.resize(got);
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR(TAG, "Cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) < 0 || st.st_size < static_cast<off_t>(PACKET_TRACE_HEADER_SIZE)) {
+        LOG_ERROR(TAG, "%s is not a packet trace", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(TAG, "Cannot map %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    map_ = map;
+    data_ = static_cast<const uint8_t*>(map);
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+
+    uint16_t version = 0;
+    if (size_ >= PACKET_TRACE_HEADER_SIZE) std::memcpy(&version, data_ + 4, 2);
+    if (size_ < PACKET_TRACE_HEADER_SIZE || std::memcmp(data_, PACKET_TRACE_MAGIC, 4) != 0 ||
+        version != PACKET_TRACE_VERSION) {
+        LOG_ERROR(TAG, "%s is not a version %u packet trace", path.c_str(), PACKET_TRACE_VERSION);
+        close();
+        return false;
+    }
+
+    rewind();
+    return true;
+}
+
+void PacketTraceReader::close() {
+#ifdef _WIN32
+    buffer_.clear();
+#else
+    if (map_) munmap(map_, size_);
+    map_ = nullptr;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void PacketTraceReader::rewind() {
+    pos_ = PACKET_TRACE_HEADER_SIZE;
+    offset_us_ = 0;
+}
+
+std::optional<PacketTraceReader::Record> PacketTraceReader::next() {
+    if (!data_ || pos_ + PACKET_TRACE_RECORD_HEADER > size_) return std::nullopt;
+
+    uint32_t delta_us = 0;
+    uint16_t length = 0;
+    std::memcpy(&delta_us, data_ + pos_, 4);
+    std::memcpy(&length, data_ + pos_ + 4, 2);
+    // Zero length marks the unused tail of an untrimmed (crashed) recording
+    if (length == 0 || pos_ + PACKET_TRACE_RECORD_HEADER + length > size_) return std::nullopt;
+
+    offset_us_ += delta_us;
+    Record rec;
+    rec.offset_us = offset_us_;
+    rec.data = data_ + pos_ + PACKET_TRACE_RECORD_HEADER;
+    rec.size = length;
+    pos_ += PACKET_TRACE_RECORD_HEADER + length;
+    return rec;
+}
+
+} // namespace lancast
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// Compact on-disk capture of received datagrams, for offline replay.
+//
+// Layout (little-endian):
+//   header  : "LCPT" magic, uint16 version, uint16 reserved, uint64 record count
+//   records : uint32 delta_us (since the previous record), uint16 length, payload
+//
+// The writer maps a preallocated file and appends records with memcpy, so
+// recording on the receive thread costs no syscalls. The file is truncated
+// to the used size on close; a reader stops at the first zero-length record,
+// so a trace from a crashed process is still readable.
+static constexpr char PACKET_TRACE_MAGIC[4] = {'L', 'C', 'P', 'T'};
+static constexpr uint16_t PACKET_TRACE_VERSION = 1;
+static constexpr size_t PACKET_TRACE_HEADER_SIZE = 16;
+static constexpr size_t PACKET_TRACE_RECORD_HEADER = 6;
+
+class PacketTraceWriter {
+public:
+    PacketTraceWriter() = default;
+    ~PacketTraceWriter();
+
+    PacketTraceWriter(const PacketTraceWriter&) = delete;
+    PacketTraceWriter& operator=(const PacketTraceWriter&) = delete;
+
+    bool open(const std::string& path, size_t capacity_bytes = 256u << 20);
+    void close();
+    bool is_open() const { return open_; }
+
+    // Append one datagram. Returns false once the file is full.
+    bool record(const uint8_t* data, size_t len, int64_t arrival_us);
+
+    uint64_t records() const { return count_; }
+
+private:
+    bool append(const uint8_t* bytes, size_t len);
+
+    bool open_ = false;
+    bool full_ = false;
+    uint64_t count_ = 0;
+    int64_t last_us_ = 0;
+    std::string path_;
+
+#ifdef _WIN32
+    FILE* file_ = nullptr;
+#else
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+#endif
+};
+
+class PacketTraceReader {
+public:
+    struct Record {
+        int64_t offset_us = 0;      // Arrival time relative to the first record
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    PacketTraceReader() = default;
+    ~PacketTraceReader();
+
+    PacketTraceReader(const PacketTraceReader&) = delete;
+    PacketTraceReader& operator=(const PacketTraceReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // Next record, or nullopt at end of trace. Data stays valid until close().
+    std::optional<Record> next();
+    void rewind();
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t pos_ = PACKET_TRACE_HEADER_SIZE;
+    int64_t offset_us_ = 0;
+
+#ifdef _WIN32
+    std::vector<uint8_t> buffer_;
+#else
+    void* map_ = nullptr;
+#endif
+};
+
+} // namespace lancast
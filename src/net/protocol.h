@@ -7,14 +7,19 @@
 
 namespace lancast {
 
-// 16-byte UDP packet header
-// | Magic(1) | Version(1) | Type(1) | Flags(1) | Sequence(2) | Timestamp_us(4) | FrameID(2) | FragIdx(2) | FragTotal(2) |
+// 18-byte UDP packet header
+// | Magic(1) | Version(1) | Type(1) | Flags(1) | Sequence(4) | Timestamp_us(4) | FrameID(2) | FragIdx(2) | FragTotal(2) |
+// The high nibble of Flags is the stream id (see PacketHeader::stream_id).
+// Sequence numbers count packets, so they are 32 bits wide: 16 bits wrap
+// every 65536 packets, well under a second at gigabit rates, and a longer
+// gap than half of that can't be told apart from reordering. Frame ids
+// count frames and stay 16 bits.
 static constexpr uint8_t  PROTOCOL_MAGIC   = 0xAA;
-static constexpr uint8_t  PROTOCOL_VERSION = 2;
+static constexpr uint8_t  PROTOCOL_VERSION = 3;
 static constexpr uint16_t DEFAULT_PORT     = 7878;
 static constexpr size_t   MAX_UDP_PAYLOAD  = 1200;   // Safe for most MTUs
-static constexpr size_t   HEADER_SIZE      = 16;
-static constexpr size_t   MAX_FRAGMENT_DATA = MAX_UDP_PAYLOAD - HEADER_SIZE; // 1184 bytes
+static constexpr size_t   HEADER_SIZE      = 18;
+static constexpr size_t   MAX_FRAGMENT_DATA = MAX_UDP_PAYLOAD - HEADER_SIZE; // 1182 bytes
 
 enum class PacketType : uint8_t {
     VIDEO_DATA        = 0x01,
@@ -27,8 +32,15 @@ enum class PacketType : uint8_t {
     KEYFRAME_REQ      = 0x14,
     PING              = 0x20,
     PONG              = 0x21,
+    PROBE             = 0x22,
+    PROBE_REPORT      = 0x23,
+    CLIENT_REPORT     = 0x24,
+    VIEWPORT          = 0x25,
+    SUBSCRIBE         = 0x26,
     BYE               = 0x30,
     STREAM_CONFIG     = 0x40,
+    STREAM_UPDATE     = 0x41,
+    STREAM_LIST       = 0x42,
 };
 
 enum PacketFlags : uint8_t {
@@ -36,15 +48,23 @@ enum PacketFlags : uint8_t {
     FLAG_KEYFRAME = 0x01,
     FLAG_FIRST    = 0x02, // First fragment of frame
     FLAG_LAST     = 0x04, // Last fragment of frame
+    FLAG_RETRANSMIT = 0x08, // Resent after a NACK; its sequence number was used before
 };
 
+// Multi-stream hosts: video, STREAM_UPDATE, NACK, KEYFRAME_REQ and VIEWPORT
+// carry the stream they refer to in the high nibble of the flags. Stream 0
+// is the primary stream, which is all a single-stream host (or a client
+// that never subscribes) ever uses; audio always goes out as stream 0.
+static constexpr uint8_t MAX_STREAMS = 16;
+static constexpr uint8_t FLAG_STREAM_SHIFT = 4;
+
 #pragma pack(push, 1)
 struct PacketHeader {
     uint8_t  magic    = 0;
     uint8_t  version  = 0;
     uint8_t  type     = 0;
     uint8_t  flags    = 0;
-    uint16_t sequence = 0;
+    uint32_t sequence = 0;
     uint32_t timestamp_us = 0;
     uint16_t frame_id = 0;
     uint16_t frag_idx = 0;
@@ -63,10 +83,15 @@ struct PacketHeader {
     bool is_valid() const {
         return magic == 0xAA && version == PROTOCOL_VERSION;
     }
+
+    uint8_t stream_id() const { return static_cast<uint8_t>(flags >> FLAG_STREAM_SHIFT); }
+    void set_stream_id(uint8_t stream) {
+        flags = static_cast<uint8_t>((flags & ((1u << FLAG_STREAM_SHIFT) - 1)) | (stream << FLAG_STREAM_SHIFT));
+    }
 };
 #pragma pack(pop)
 
-static_assert(sizeof(PacketHeader) == 16, "PacketHeader must be exactly 16 bytes");
+static_assert(sizeof(PacketHeader) == HEADER_SIZE, "PacketHeader must be exactly 18 bytes");
 
 // Control message payloads
 
@@ -83,6 +108,21 @@ struct WelcomePayload {
     uint16_t audio_channels = 0;
 };
 
+// Video config in effect from the next keyframe on; codec extradata follows.
+// Repeated ahead of every keyframe so a lost update heals at the next one.
+#pragma pack(push, 1)
+struct StreamUpdatePayload {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t fps = 0;
+    uint32_t video_bitrate = 0;
+    uint16_t region_x = 0;       // Source region the video shows (see SourceRegion)
+    uint16_t region_y = 0;
+    uint16_t region_width = 0;
+    uint16_t region_height = 0;
+};
+#pragma pack(pop)
+
 #pragma pack(push, 1)
 struct PingPayload {
     uint64_t timestamp_us = 0; // Sender's monotonic timestamp
@@ -97,6 +137,80 @@ struct NackPayload {
 };
 #pragma pack(pop)
 
+// Bandwidth probe trains, sent by the host right after the handshake
+static constexpr size_t PROBE_MAX_TRAINS = 4;
+
+#pragma pack(push, 1)
+struct ProbePayload {
+    uint8_t  train = 0;      // Train index, in increasing rate order
+    uint8_t  trains = 0;     // Trains in this probe
+    uint16_t index = 0;      // Packet index within the train
+    uint16_t count = 0;      // Packets per train
+    uint32_t rate_kbps = 0;  // Rate the host paced this train at
+    // Padded with zeros to MAX_FRAGMENT_DATA
+};
+
+struct ProbeTrainReport {
+    uint32_t sent_kbps = 0;      // Pacing rate of the train
+    uint32_t measured_kbps = 0;  // Bytes after the first packet / first-to-last dispersion
+    uint16_t received = 0;
+    uint16_t count = 0;
+};
+
+struct ProbeReportPayload {
+    uint8_t trains = 0;
+    uint8_t reserved = 0;
+    ProbeTrainReport train[PROBE_MAX_TRAINS];
+};
+#pragma pack(pop)
+
+// Periodic client load report: what the viewer actually manages to show
+#pragma pack(push, 1)
+struct ClientReportPayload {
+    uint16_t rendered_fps_x10 = 0;  // Frames presented per second, x10
+    uint16_t decoded = 0;           // Frames decoded since the last report
+    uint16_t discarded = 0;         // Frames received but never shown since the last report
+    uint32_t decode_us = 0;         // Mean decode time per frame
+    uint8_t  video_queue = 0;       // Assembled frames waiting for the decoder
+    uint8_t  decoded_queue = 0;     // Decoded frames waiting for the renderer
+};
+#pragma pack(pop)
+
+// What the viewer shows: its drawable size in pixels and the part of the
+// source it is zoomed into (see SourceRegion; zero width = whole source).
+// Sent on change and repeated every few seconds.
+#pragma pack(push, 1)
+struct ViewportPayload {
+    uint16_t drawable_width = 0;
+    uint16_t drawable_height = 0;
+    uint16_t region_x = 0;
+    uint16_t region_y = 0;
+    uint16_t region_width = 0;
+    uint16_t region_height = 0;
+};
+#pragma pack(pop)
+
+// Streams a multi-stream host offers, sent after WELCOME: one entry per
+// stream, as many as fit the payload
+#pragma pack(push, 1)
+struct StreamListEntry {
+    uint8_t  stream_id = 0;
+    uint8_t  reserved = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint16_t fps = 0;
+    char     name[24] = {};  // NUL-padded
+};
+#pragma pack(pop)
+
+// Streams the client wants video for (bit n = stream n). Clients that never
+// send one get stream 0. Repeated every few seconds.
+#pragma pack(push, 1)
+struct SubscribePayload {
+    uint16_t stream_mask = 1;
+};
+#pragma pack(pop)
+
 // A complete UDP packet (header + payload data)
 struct Packet {
     PacketHeader header;
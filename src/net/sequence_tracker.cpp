@@ -0,0 +1,18 @@
+#include "net/sequence_tracker.h"
+
+namespace lancast {
+
+int64_t SequenceTracker::on_packet(uint32_t sequence) {
+    received_++;
+    if (!started_) {
+        started_ = true;
+        base_ = sequence;
+        max_ = sequence;
+        return max_;
+    }
+    int32_t delta = static_cast<int32_t>(sequence - static_cast<uint32_t>(max_));
+    if (delta > 0) max_ += delta;
+    return max_ + (delta > 0 ? 0 : delta);
+}
+
+} // namespace lancast
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lancast {
+
+// Loss accounting for one numbered packet flow (a stream's video, audio).
+//
+// The 32-bit wire sequence is extended to 64 bits relative to the highest
+// number seen so far: a packet less than 2^31 behind it is late, one ahead
+// of it moves it on. At a million packets a second that leaves over half an
+// hour either way, so wraps, reordering and long outages all count exactly.
+class SequenceTracker {
+public:
+    // Returns the packet's extended sequence number
+    int64_t on_packet(uint32_t sequence);
+    void reset() { *this = SequenceTracker{}; }
+
+    bool started() const { return started_; }
+    int64_t highest() const { return max_; }
+    uint64_t received() const { return received_; }
+    // Packets numbered from the first one seen up to the highest
+    uint64_t expected() const { return started_ ? static_cast<uint64_t>(max_ - base_ + 1) : 0; }
+    // Expected but not received. Duplicates make up for losses, as in RTP
+    // receiver reports; the host flags retransmissions so they aren't counted.
+    uint64_t lost() const { return expected() > received_ ? expected() - received_ : 0; }
+
+private:
+    bool started_ = false;
+    int64_t base_ = 0;  // First extended sequence number seen
+    int64_t max_ = 0;   // Highest extended sequence number seen
+    uint64_t received_ = 0;
+};
+
+} // namespace lancast
@@ -1,12 +1,29 @@
 #include "net/server.h"
 #include "core/logger.h"
+#include "core/perf_counters.h"
+#include "core/timing.h"
+#include "core/trace.h"
 #include <algorithm>
+#include <cstdlib>
+#include <optional>
+#include <thread>
 
 namespace lancast {
 
 static constexpr const char* TAG = "Server";
+static constexpr double STATS_EWMA_ALPHA = 1.0 / 16.0;
 
-Server::Server(uint16_t port) : port_(port) {}
+// Qdisc ENOBUFS leaves the socket writable, so POLLOUT alone would spin
+static constexpr auto SEND_RETRY_BACKOFF = std::chrono::microseconds(200);
+// Handshake and control replies are worth a short wait
+static constexpr auto CONTROL_SEND_TIMEOUT = std::chrono::milliseconds(100);
+static constexpr auto PROBE_TRAIN_GAP = std::chrono::milliseconds(10);
+
+Server::Server(uint16_t port) : port_(port) {
+    // The primary stream always exists
+    streams_[0].active = true;
+    streams_[0].name = "screen";
+}
 
 Server::~Server() {
     stop();
@@ -18,74 +35,515 @@ bool Server::start() {
         return false;
     }
 
-    if (!socket_.bind(port_)) return false;
+    bool sharded = requested_shards_ > 1;
+    // A second host binding its shards to this port would join our group
+    // and silently get a share of our clients' packets. Each host checks
+    // that nobody holds the port before creating its group, so the later
+    // of two is refused.
+    if (sharded && UdpSocket::port_in_use(port_)) {
+        LOG_ERROR(TAG, "Port %u is already in use", port_);
+        return false;
+    }
+    if (sharded && !socket_.bind(port_, true)) {
+        LOG_WARN(TAG, "Receive sharding unavailable, using a single socket");
+        socket_ = UdpSocket();
+        sharded = false;
+    }
+    if (!sharded && !socket_.bind(port_)) return false;
     socket_.set_recv_timeout(100);
     socket_.set_recv_buffer(2 * 1024 * 1024);
-    socket_.set_send_buffer(2 * 1024 * 1024);
+
+    shards_.clear();
+    shards_.push_back(std::make_unique<RecvShard>());
+    for (size_t i = 1; sharded && i < requested_shards_; ++i) {
+        auto shard = std::make_unique<RecvShard>();
+        shard->socket = std::make_unique<UdpSocket>();
+        if (!shard->socket->bind(port_, true)) {
+            LOG_WARN(TAG, "Receive shard %zu failed to bind, continuing with %zu", i, shards_.size());
+            break;
+        }
+        shard->socket->set_recv_timeout(100);
+        shard->socket->set_recv_buffer(2 * 1024 * 1024);
+        shard->socket->enable_timestamping(false);  // Receive only
+        shards_.push_back(std::move(shard));
+    }
+    if (shards_.size() > 1) {
+        LOG_INFO(TAG, "Receiving on %zu SO_REUSEPORT shards", shards_.size());
+    }
+    tune_send_buffer(stream_config().video_bitrate, 0.0);
+    // Sends report a full buffer instead of blocking; broadcast() decides whether to wait
+    socket_.set_send_nonblocking(true);
+    socket_.enable_send_errors();
+    if (socket_.enable_timestamping(tx_timestamps_)) {
+        LOG_INFO(TAG, "Kernel %s timestamping enabled", socket_.tx_timestamping_enabled() ? "TX/RX" : "RX");
+    }
 
     last_ping_time_ = std::chrono::steady_clock::now();
     running_ = true;
+    pacer_thread_ = lancast::jthread([this](lancast::stop_token st) { pacer_loop(st); });
     LOG_INFO(TAG, "Server started on port %u", port_);
     return true;
 }
 
 void Server::stop() {
     running_ = false;
+    if (pacer_thread_.joinable()) {
+        pacer_thread_.request_stop();
+        {
+            std::lock_guard lock(pacer_mutex_);
+            pacer_cv_.notify_all();
+        }
+        pacer_thread_.join();
+    }
     LOG_INFO(TAG, "Server stopped");
 }
 
 void Server::broadcast(const EncodedPacket& packet) {
-    auto fragments = fragmenter_.fragment(packet, sequence_);
+    bool is_video = packet.type == FrameType::VideoKeyframe || packet.type == FrameType::VideoPFrame;
+    uint8_t stream = is_video ? packet.stream_id : 0;
+    if (stream >= MAX_STREAMS) return;
+    auto stream_bit = static_cast<uint16_t>(1u << stream);
+    // Only video frames are sampled so per-frame averages aren't diluted by audio
+    bool sample = PerfCounters::enabled() && is_video;
+    std::optional<PerfScope> fragment_scope;
+    if (sample) fragment_scope.emplace(PerfStage::Fragment);
+
+    // Each stream numbers its own video, so a client sees no gaps for
+    // streams it doesn't take
+    uint32_t& sequence = is_video ? streams_[stream].sequence : audio_sequence_;
+    auto fragments = fragmenter_.fragment(packet, sequence);
 
     // Cache keyframe fragments for NACK retransmission
     if (packet.type == FrameType::VideoKeyframe) {
         std::lock_guard lock(keyframe_mutex_);
-        last_keyframe_.frame_id = packet.frame_id;
-        last_keyframe_.fragments = fragments;
+        auto& cache = streams_[stream].last_keyframe;
+        cache.frame_id = packet.frame_id;
+        cache.fragments = fragments;
     }
 
-    std::lock_guard lock(clients_mutex_);
-    for (const auto& client : clients_) {
-        for (const auto& frag : fragments) {
-            auto data = frag.serialize();
-            socket_.send_to(data, client.endpoint);
+    // Serialize once, not once per client; paced clients share it with the pacer
+    auto frame = std::make_shared<std::vector<std::vector<uint8_t>>>();
+    frame->reserve(fragments.size());
+    for (const auto& frag : fragments) {
+        frame->push_back(frag.serialize());
+    }
+    const auto& wire = *frame;
+    fragment_scope.reset();
+
+    std::optional<PerfScope> send_scope;
+    if (sample) send_scope.emplace(PerfStage::Send);
+
+    // Retry budget when the send buffer is full: one frame interval, two for
+    // keyframes since nothing decodes without them
+    uint32_t fps;
+    {
+        std::lock_guard lock(config_mutex_);
+        fps = streams_[stream].config.fps;
+    }
+    auto frame_interval = std::chrono::microseconds(1'000'000 / std::max<uint32_t>(fps, 1));
+    auto budget = packet.type == FrameType::VideoKeyframe ? 2 * frame_interval : frame_interval;
+    auto start = std::chrono::steady_clock::now();
+
+    // Snapshot so the poll thread isn't locked out while a send waits.
+    // Clients still being probed get no media until the probe settles.
+    struct Target {
+        Endpoint endpoint;
+        uint32_t pacing_bps;
+        bool cut = false;
+        uint64_t bytes = 0;
+    };
+    std::vector<Target> targets;
+    SendCounters counters;
+    {
+        uint32_t pacing_override = pacing_override_bps_.load();
+        std::lock_guard lock(clients_mutex_);
+        targets.reserve(clients_.size());
+        for (const auto& client : clients_) {
+            if (client.probing) continue;
+            if (is_video && !(client.subscriptions & stream_bit)) continue;
+            // A P-frame is useless to a client that lost its reference
+            if (packet.type == FrameType::VideoPFrame && (client.awaiting_keyframe & stream_bit)) {
+                counters.drops += wire.size();
+                continue;
+            }
+            uint32_t pacing = pacing_override > 0 ? pacing_override : client.pacing_bps;
+            targets.push_back({client.endpoint, pacing});
+        }
+    }
+
+    // Paced clients (a probed bottleneck below line rate) are handed to the
+    // pacer thread, which spaces each one's fragments without holding up
+    // anyone else. So is a client that still has paced sends queued, so its
+    // datagrams stay in order when pacing is switched off.
+    auto update = packet.type == FrameType::VideoKeyframe && !targets.empty()
+        ? std::make_shared<std::vector<std::vector<uint8_t>>>(1, stream_update_datagram(stream))
+        : nullptr;
+    bool queued = false;
+    {
+        std::lock_guard lock(pacer_mutex_);
+        std::erase_if(targets, [&](const Target& t) {
+            PacedClient* paced = find_paced(t.endpoint);
+            if (t.pacing_bps == 0 && (!paced || paced->jobs.empty())) return false;
+            if (!paced) paced = &paced_.emplace_back(PacedClient{t.endpoint, {}, start});
+            if (paced->jobs.empty()) paced->due = std::max(paced->due, start);
+            if (update) {
+                PacedJob job;
+                job.wire = update;
+                job.rate_bps = t.pacing_bps;
+                paced->jobs.push_back(std::move(job));
+            }
+            PacedJob job;
+            job.wire = frame;
+            job.rate_bps = t.pacing_bps;
+            job.expires = start + budget;
+            if (t.pacing_bps > 0) {
+                job.expires += std::chrono::microseconds(
+                    static_cast<int64_t>(packet.data.size()) * 8 * 1'000'000 / t.pacing_bps);
+            }
+            job.video = is_video;
+            job.type = packet.type;
+            job.stream = stream;
+            paced->jobs.push_back(std::move(job));
+            queued = true;
+            return true;
+        });
+    }
+    if (queued) pacer_cv_.notify_one();
+
+    // Every keyframe is preceded by the config it was encoded with, so a
+    // client that missed a mid-stream switch catches up at the next one
+    if (update) {
+        for (const auto& target : targets) {
+            send_until(update->front(), target.endpoint, start + budget, counters);
+        }
+    }
+
+    // Unpaced clients get the whole frame back to back
+    bool need_keyframe = false;
+    for (auto& target : targets) {
+        for (size_t i = 0; i < wire.size(); ++i) {
+            if (send_until(wire[i], target.endpoint, start + budget, counters)) {
+                target.bytes += wire[i].size();
+                continue;
+            }
+
+            // Audio loses only this datagram. Video abandons the rest of the
+            // frame for this client: a P-frame cut leaves the client without a
+            // reference until the next keyframe, a cut keyframe is repaired by NACK.
+            if (!is_video) continue;
+            counters.drops += wire.size() - i - 1;
+            counters.frames_cut++;
+            target.cut = true;
+            break;
+        }
+    }
+    send_scope.reset();
+
+    if (is_video && !targets.empty()) {
+        std::lock_guard lock(clients_mutex_);
+        for (const auto& target : targets) {
+            auto it = std::find_if(clients_.begin(), clients_.end(),
+                                   [&](const ClientInfo& c) { return c.endpoint == target.endpoint; });
+            if (it == clients_.end()) continue;
+            if (account_frame(*it, stream, packet.type, target.bytes, target.cut)) need_keyframe = true;
+        }
+    }
+    add_send_counters(counters);
+
+    if (need_keyframe) {
+        LOG_DEBUG(TAG, "Send buffer full past the frame deadline, stream %u frame %u cut; requesting keyframe",
+                  stream, packet.frame_id);
+        if (keyframe_cb_) keyframe_cb_(stream);
+    }
+
+    // Reports for the previous frame's datagrams have normally arrived by now
+    drain_error_queue();
+}
+
+bool Server::account_frame(ClientInfo& client, uint8_t stream, FrameType type, uint64_t bytes, bool cut) {
+    auto stream_bit = static_cast<uint16_t>(1u << stream);
+    bool had_reference = !(client.awaiting_keyframe & stream_bit);
+    client.bytes_sent += bytes;
+    if (cut) {
+        client.frames_cut++;
+    } else if (bytes > 0) {
+        client.frames_sent++;
+    }
+    if (type == FrameType::VideoKeyframe) {
+        client.awaiting_keyframe &= static_cast<uint16_t>(~stream_bit);
+    } else if (cut) {
+        client.awaiting_keyframe |= stream_bit;
+    }
+    // Only the first P-frame cut since the last keyframe asks for another
+    return cut && type == FrameType::VideoPFrame && had_reference;
+}
+
+Server::PacedClient* Server::find_paced(const Endpoint& endpoint) {
+    for (auto& p : paced_) {
+        if (p.endpoint == endpoint) return &p;
+    }
+    return nullptr;
+}
+
+void Server::pacer_loop(lancast::stop_token st) {
+    Tracer::set_thread_name("pacer");
+    std::unique_lock lock(pacer_mutex_);
+    while (!st.stop_requested() && running_) {
+        std::erase_if(paced_, [](const PacedClient& p) { return p.jobs.empty(); });
+
+        PacedClient* client = nullptr;
+        for (auto& p : paced_) {
+            if (!client || p.due < client->due) client = &p;
+        }
+        if (!client) {
+            pacer_cv_.wait_for(lock, std::chrono::milliseconds(100));
+            continue;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (client->due > now) {
+            pacer_cv_.wait_until(lock, client->due);
+            continue;
+        }
+
+        // A client that left takes its queue with it
+        PacedJob& job = client->jobs.front();
+        if (job.next == 0) {
+            std::lock_guard clients_lock(clients_mutex_);
+            if (std::none_of(clients_.begin(), clients_.end(),
+                             [&](const ClientInfo& c) { return c.endpoint == client->endpoint; })) {
+                client->jobs.clear();
+                continue;
+            }
+        }
+
+        const auto& wire = *job.wire;
+        if (now > job.expires) {
+            cut_paced(*client, lock);
+            continue;
+        }
+
+        // paced_ is a deque that only this thread erases from, so client and
+        // job stay valid while the send runs unlocked
+        size_t i = job.next++;
+        if (job.rate_bps > 0) {
+            client->due += std::chrono::microseconds(
+                static_cast<int64_t>(wire[i].size()) * 8 * 1'000'000 / job.rate_bps);
+        }
+        Endpoint dest = client->endpoint;
+        lock.unlock();
+        SendCounters counters;
+        bool sent = send_until(wire[i], dest, std::min(job.expires, now + CONTROL_SEND_TIMEOUT), counters);
+        add_send_counters(counters);
+        lock.lock();
+
+        if (sent) job.bytes += wire[i].size();
+        if (!sent && job.video) {
+            cut_paced(*client, lock);
+        } else if (job.next == wire.size()) {
+            finish_paced(*client, lock);
+        }
+    }
+}
+
+void Server::finish_paced(PacedClient& client, std::unique_lock<std::mutex>& lock) {
+    PacedJob job = std::move(client.jobs.front());
+    client.jobs.pop_front();
+    client.due += job.gap_after;
+    if (!job.video && !job.probe_end) return;
+
+    Endpoint dest = client.endpoint;
+    lock.unlock();
+    {
+        std::lock_guard clients_lock(clients_mutex_);
+        for (auto& c : clients_) {
+            if (!(c.endpoint == dest)) continue;
+            if (job.video) account_frame(c, job.stream, job.type, job.bytes, false);
+            if (job.probe_end) c.probe_sent = std::chrono::steady_clock::now();
         }
     }
+    lock.lock();
+}
+
+void Server::cut_paced(PacedClient& client, std::unique_lock<std::mutex>& lock) {
+    PacedJob job = std::move(client.jobs.front());
+    client.jobs.pop_front();
+    SendCounters counters;
+    counters.drops = job.wire->size() - job.next;
+
+    // Video abandons the rest of the frame, as in broadcast(), and the
+    // P-frames queued behind a cut one have lost their reference
+    if (job.video) {
+        counters.frames_cut++;
+        if (job.type == FrameType::VideoPFrame) {
+            std::erase_if(client.jobs, [&](const PacedJob& queued) {
+                if (!queued.video || queued.stream != job.stream ||
+                    queued.type != FrameType::VideoPFrame) {
+                    return false;
+                }
+                counters.drops += queued.wire->size();
+                return true;
+            });
+        }
+    }
+
+    Endpoint dest = client.endpoint;
+    lock.unlock();
+    bool need_keyframe = false;
+    if (job.video) {
+        std::lock_guard clients_lock(clients_mutex_);
+        for (auto& c : clients_) {
+            if (c.endpoint == dest) need_keyframe = account_frame(c, job.stream, job.type, job.bytes, true);
+        }
+    }
+    add_send_counters(counters);
+    if (need_keyframe) {
+        LOG_DEBUG(TAG, "Paced send to %s:%u past the frame deadline, stream %u cut; requesting keyframe",
+                  dest.ip.c_str(), dest.port, job.stream);
+        if (keyframe_cb_) keyframe_cb_(job.stream);
+    }
+    lock.lock();
+}
+
+bool Server::send_until(const std::vector<uint8_t>& data, const Endpoint& dest,
+                        std::chrono::steady_clock::time_point deadline, SendCounters& counters) {
+    bool waited = false;
+    int unreachable_retries = 0;
+    for (;;) {
+        ssize_t n = socket_.send_to(data, dest);
+        if (n == static_cast<ssize_t>(data.size())) return true;
+
+        auto now = std::chrono::steady_clock::now();
+        if (n < 0 && UdpSocket::last_send_error_unreachable()) {
+            // The shared socket reports an ICMP error on whichever send comes
+            // next. Only give up if it was about this destination.
+            drain_error_queue();
+            if (recently_unreachable(dest, now) || ++unreachable_retries > MAX_UNREACHABLE_RETRIES) {
+                counters.drops++;
+                return false;
+            }
+            continue;
+        }
+        if (n >= 0 || !UdpSocket::last_send_error_transient() || now >= deadline) {
+            counters.drops++;
+            return false;
+        }
+
+        if (!waited) counters.retries++;
+        waited = true;
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+        if (!socket_.wait_writable(std::max<int>(1, static_cast<int>(remaining.count())))) {
+            counters.drops++;
+            return false;
+        }
+        std::this_thread::sleep_for(SEND_RETRY_BACKOFF);
+    }
+}
+
+void Server::add_send_counters(const SendCounters& counters) {
+    if (counters.retries == 0 && counters.drops == 0) return;
+    std::lock_guard lock(stats_mutex_);
+    stats_.send_retries += counters.retries;
+    stats_.send_drops += counters.drops;
+    stats_.frames_cut += counters.frames_cut;
+}
+
+void Server::tune_send_buffer(uint32_t bitrate_bps, double rtt_ms) {
+    // A keyframe burst is roughly a quarter second of stream; each client
+    // also needs an RTT's worth in flight for NACK repairs to fit.
+    size_t clients = std::max<size_t>(client_count(), 1);
+    double bytes = bitrate_bps / 8.0 * (0.25 + clients * rtt_ms / 1000.0);
+    int target = std::clamp(static_cast<int>(std::min(bytes, double(MAX_SEND_BUFFER))),
+                            MIN_SEND_BUFFER, MAX_SEND_BUFFER);
+
+    if (send_buffer_target_ > 0 &&
+        std::abs(target - send_buffer_target_) < send_buffer_target_ / 4) {
+        return;
+    }
+    send_buffer_target_ = target;
+    socket_.set_send_buffer(target);
+    // The kernel may clamp (net.core.wmem_max) or double the request
+    LOG_INFO(TAG, "Send buffer %d KB requested, %d KB granted (%u bps, RTT %.1f ms)",
+             target / 1024, socket_.send_buffer_size() / 1024, bitrate_bps, rtt_ms);
 }
 
 void Server::send_to(const Packet& packet, const Endpoint& dest) {
     auto data = packet.serialize();
-    socket_.send_to(data, dest);
+    SendCounters counters;
+    send_until(data, dest, std::chrono::steady_clock::now() + CONTROL_SEND_TIMEOUT, counters);
+    add_send_counters(counters);
 }
 
 void Server::poll() {
+    if (shards_.empty()) return;  // Not started
+
     // Send periodic PINGs
     auto now = std::chrono::steady_clock::now();
     if (now - last_ping_time_ >= PING_INTERVAL) {
         send_pings();
         last_ping_time_ = now;
     }
+    if (now - last_liveness_check_ >= LIVENESS_CHECK_INTERVAL) {
+        evict_silent_clients(now);
+        expire_probes(now);
+        last_liveness_check_ = now;
+    }
+
+    drain_error_queue();
+    receive(*shards_.front());
+}
+
+void Server::poll_shard(size_t index) {
+    if (index == 0 || index >= shards_.size()) return;
+    receive(*shards_[index]);
+}
 
-    auto result = socket_.recv_from();
+void Server::receive(RecvShard& shard) {
+    UdpSocket& sock = shard.socket ? *shard.socket : socket_;
+    auto result = sock.recv_from();
     if (!result) return;
 
+    {
+        std::lock_guard lock(shard.stats_mutex);
+        shard.rx_packets++;
+        if (result->kernel_rx_us > 0) {
+            double queued_ms = (steady_now_us() - result->kernel_rx_us) / 1000.0;
+            shard.rx_queue_ms = ewma(shard.rx_queue_ms, queued_ms, STATS_EWMA_ALPHA);
+        }
+    }
+
     auto packet = Packet::deserialize(result->data.data(), result->data.size());
     if (!packet.header.is_valid()) return;
 
     auto type = static_cast<PacketType>(packet.header.type);
+
+    // Any traffic proves liveness; traffic from a recently evicted client resumes it
+    if (type != PacketType::HELLO && type != PacketType::BYE) {
+        auto rx_time = std::chrono::steady_clock::now();
+        if (!touch_client(result->source, rx_time) && take_evicted(result->source, rx_time)) {
+            resume_client(result->source, rx_time);
+        }
+    }
+
     switch (type) {
         case PacketType::HELLO:
             handle_hello(packet, result->source);
             break;
         case PacketType::BYE: {
-            std::lock_guard lock(clients_mutex_);
-            std::erase_if(clients_, [&](const ClientInfo& c) { return c.endpoint == result->source; });
+            size_t removed;
+            {
+                std::lock_guard lock(clients_mutex_);
+                removed = std::erase_if(clients_, [&](const ClientInfo& c) { return c.endpoint == result->source; });
+            }
+            take_evicted(result->source, std::chrono::steady_clock::now());
+            if (removed == 0) break;
             LOG_INFO(TAG, "Client disconnected: %s:%u", result->source.ip.c_str(), result->source.port);
+            notify_client_count();
             break;
         }
         case PacketType::KEYFRAME_REQ:
-            LOG_INFO(TAG, "Keyframe requested by %s:%u", result->source.ip.c_str(), result->source.port);
-            if (keyframe_cb_) keyframe_cb_();
+            LOG_INFO(TAG, "Keyframe requested by %s:%u (stream %u)", result->source.ip.c_str(),
+                     result->source.port, packet.header.stream_id());
+            if (keyframe_cb_) keyframe_cb_(packet.header.stream_id());
             break;
         case PacketType::PONG:
             handle_pong(packet, result->source);
@@ -93,18 +551,30 @@ void Server::poll() {
         case PacketType::NACK:
             handle_nack(packet, result->source);
             break;
+        case PacketType::PROBE_REPORT:
+            handle_probe_report(packet, result->source);
+            break;
+        case PacketType::CLIENT_REPORT:
+            handle_client_report(packet, result->source);
+            break;
+        case PacketType::VIEWPORT:
+            handle_viewport(packet, result->source);
+            break;
+        case PacketType::SUBSCRIBE:
+            handle_subscribe(packet, result->source);
+            break;
         case PacketType::CLIENT_AUDIO_DATA: {
+            std::lock_guard lock(client_audio_mutex_);
             auto frame = client_audio_assembler_.feed(packet);
             if (frame && client_audio_cb_) {
                 client_audio_cb_(std::move(*frame));
             }
+            client_audio_assembler_.purge_stale();
             break;
         }
         default:
             break;
     }
-
-    client_audio_assembler_.purge_stale();
 }
 
 size_t Server::client_count() const {
@@ -112,10 +582,66 @@ size_t Server::client_count() const {
     return clients_.size();
 }
 
+Server::Stats Server::stats() const {
+    Stats out;
+    {
+        std::lock_guard lock(stats_mutex_);
+        out = stats_;
+    }
+    size_t stamped = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard lock(shard->stats_mutex);
+        out.rx_packets += shard->rx_packets;
+        if (shard->rx_queue_ms > 0.0) {
+            out.rx_queue_ms += shard->rx_queue_ms;
+            stamped++;
+        }
+    }
+    if (stamped > 0) out.rx_queue_ms /= stamped;
+    return out;
+}
+
+void Server::drain_error_queue() {
+    // Also drains IP_RECVERR entries when timestamping is off
+    thread_local std::vector<int64_t> delays;
+    thread_local std::vector<Endpoint> unreachable;
+    delays.clear();
+    unreachable.clear();
+    socket_.drain_tx_timestamps(delays, &unreachable);
+
+    if (!unreachable.empty()) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard lock(unreachable_mutex_);
+        for (const auto& ep : unreachable) {
+            LOG_DEBUG(TAG, "ICMP: %s:%u unreachable", ep.ip.c_str(), ep.port);
+            unreachable_.push_back({ep, now});
+        }
+    }
+    if (delays.empty()) return;
+
+    std::lock_guard lock(stats_mutex_);
+    for (int64_t d : delays) {
+        stats_.tx_queue_ms = ewma(stats_.tx_queue_ms, d / 1000.0, STATS_EWMA_ALPHA);
+    }
+    stats_.tx_timestamps += delays.size();
+}
+
+bool Server::recently_unreachable(const Endpoint& dest, std::chrono::steady_clock::time_point now) {
+    std::lock_guard lock(unreachable_mutex_);
+    std::erase_if(unreachable_, [&](const UnreachableEndpoint& u) {
+        return now - u.reported > UNREACHABLE_MEMORY;
+    });
+    return std::any_of(unreachable_.begin(), unreachable_.end(),
+                       [&](const UnreachableEndpoint& u) { return u.endpoint == dest; });
+}
+
 double Server::max_rtt_ms() const {
+    auto now = std::chrono::steady_clock::now();
     std::lock_guard lock(clients_mutex_);
     double max_rtt = 0.0;
     for (const auto& c : clients_) {
+        // A client that stopped answering PINGs must not drag the bitrate down
+        if (now - c.last_pong > liveness_.rtt_stale_after) continue;
         if (c.rtt_valid && c.rtt_ms > max_rtt) {
             max_rtt = c.rtt_ms;
         }
@@ -123,39 +649,392 @@ double Server::max_rtt_ms() const {
     return max_rtt;
 }
 
-void Server::handle_hello(const Packet& pkt, const Endpoint& source) {
+bool Server::touch_client(const Endpoint& source, std::chrono::steady_clock::time_point now) {
+    std::lock_guard lock(clients_mutex_);
+    for (auto& c : clients_) {
+        if (c.endpoint == source) {
+            c.last_seen = now;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Server::take_evicted(const Endpoint& source, std::chrono::steady_clock::time_point now) {
+    std::lock_guard lock(clients_mutex_);
+    auto it = std::find_if(evicted_.begin(), evicted_.end(),
+                           [&](const EvictedClient& e) { return e.endpoint == source; });
+    if (it == evicted_.end()) return false;
+    bool fresh = now - it->evicted_at <= liveness_.resume_window;
+    evicted_.erase(it);
+    return fresh;
+}
+
+void Server::resume_client(const Endpoint& source, std::chrono::steady_clock::time_point now) {
     {
         std::lock_guard lock(clients_mutex_);
-        // Check if already connected
+        ClientInfo info;
+        info.endpoint = source;
+        info.last_seen = now;
+        info.joined = now;
+        clients_.push_back(info);
+    }
+    {
+        std::lock_guard lock(stats_mutex_);
+        stats_.resumptions++;
+    }
+    LOG_INFO(TAG, "Client resumed: %s:%u", source.ip.c_str(), source.port);
+
+    // Back on stream 0 until its next SUBSCRIBE
+    request_keyframes(1);
+    notify_client_count();
+}
+
+void Server::notify_client_count() {
+    // Receive shards add and drop clients concurrently. Reading the count
+    // inside the callback lock keeps the last call the current count.
+    std::lock_guard lock(client_count_mutex_);
+    size_t count;
+    {
+        std::lock_guard clients_lock(clients_mutex_);
+        count = clients_.size();
+    }
+    if (client_count_cb_) client_count_cb_(count);
+}
+
+void Server::evict_silent_clients(std::chrono::steady_clock::time_point now) {
+    std::vector<ClientInfo> silent;
+    {
+        std::lock_guard lock(clients_mutex_);
+        std::erase_if(evicted_, [&](const EvictedClient& e) {
+            return now - e.evicted_at > liveness_.resume_window;
+        });
+        std::erase_if(clients_, [&](const ClientInfo& c) {
+            if (now - c.last_seen <= liveness_.evict_after) return false;
+            silent.push_back(c);
+            evicted_.push_back({c.endpoint, now});
+            return true;
+        });
+    }
+    if (silent.empty()) return;
+
+    for (const auto& c : silent) {
+        LOG_WARN(TAG, "Evicting silent client %s:%u (nothing received for %lld ms)",
+                 c.endpoint.ip.c_str(), c.endpoint.port,
+                 static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                     now - c.last_seen).count()));
+    }
+    {
+        std::lock_guard lock(stats_mutex_);
+        stats_.evictions += silent.size();
+    }
+    notify_client_count();
+}
+
+void Server::handle_hello(const Packet& pkt, const Endpoint& source) {
+    auto now = std::chrono::steady_clock::now();
+    bool known = touch_client(source, now);
+    bool resumed = false;
+    uint16_t subscriptions = 1;
+
+    if (known) {
+        std::lock_guard lock(clients_mutex_);
         for (const auto& c : clients_) {
-            if (c.endpoint == source) return;
+            if (c.endpoint == source) subscriptions = c.subscriptions;
         }
+    } else {
+        resumed = take_evicted(source, now);
+        std::lock_guard lock(clients_mutex_);
         ClientInfo info;
         info.endpoint = source;
+        info.last_seen = now;
+        info.probing = !resumed;
+        info.probe_sent = now;
+        info.joined = now;
         clients_.push_back(info);
     }
-    LOG_INFO(TAG, "Client connected: %s:%u", source.ip.c_str(), source.port);
+
+    // A known client repeats HELLO when its WELCOME was lost or its stream
+    // went silent, so the handshake is always (re)sent.
+    if (known) {
+        LOG_INFO(TAG, "Client re-announced: %s:%u", source.ip.c_str(), source.port);
+    } else if (resumed) {
+        LOG_INFO(TAG, "Client resumed: %s:%u", source.ip.c_str(), source.port);
+        std::lock_guard lock(stats_mutex_);
+        stats_.resumptions++;
+    } else {
+        LOG_INFO(TAG, "Client connected: %s:%u", source.ip.c_str(), source.port);
+    }
 
     // Send WELCOME with stream config
+    StreamConfig config = stream_config();
     Packet welcome;
     welcome.header.magic = PROTOCOL_MAGIC;
     welcome.header.version = PROTOCOL_VERSION;
     welcome.header.type = static_cast<uint8_t>(PacketType::WELCOME);
-    welcome.header.sequence = sequence_++;
+    welcome.header.sequence = control_sequence_++;
 
     WelcomePayload wp;
-    wp.width = config_.width;
-    wp.height = config_.height;
-    wp.fps = config_.fps;
-    wp.video_bitrate = config_.video_bitrate;
-    wp.audio_sample_rate = config_.audio_sample_rate;
-    wp.audio_channels = config_.audio_channels;
+    wp.width = config.width;
+    wp.height = config.height;
+    wp.fps = config.fps;
+    wp.video_bitrate = config.video_bitrate;
+    wp.audio_sample_rate = config.audio_sample_rate;
+    wp.audio_channels = config.audio_channels;
 
     welcome.payload.resize(sizeof(WelcomePayload));
     std::memcpy(welcome.payload.data(), &wp, sizeof(WelcomePayload));
 
     send_to(welcome, source);
     send_stream_config(source);
+    if (stream_count() > 1) send_stream_list(source);
+
+    // A new client is admitted (count callback, keyframe) when its probe
+    // report arrives or the probe times out
+    if (!known && !resumed) {
+        send_probe(source);
+        return;
+    }
+
+    // Mid-stream either way: a resumed client, or a known one that heard
+    // nothing for a second (even a still picture is refreshed more often)
+    // and needs a picture straight away
+    request_keyframes(subscriptions);
+
+    // After the handshake, so no media reaches the client before its config
+    if (resumed) notify_client_count();
+}
+
+void Server::send_probe(const Endpoint& dest) {
+    // Queued on the pacer, so this receive thread is free while it goes out
+    uint32_t bitrate = stream_config().video_bitrate;
+    {
+        std::lock_guard lock(pacer_mutex_);
+        PacedClient* paced = find_paced(dest);
+        if (!paced) paced = &paced_.emplace_back(PacedClient{dest, {}, {}});
+        if (paced->jobs.empty()) paced->due = std::max(paced->due, std::chrono::steady_clock::now());
+        for (size_t t = 0; t < PROBE_TRAINS; ++t) {
+            uint32_t rate = probe_train_rate(bitrate, t);
+            PacedJob job;
+            job.wire = std::make_shared<std::vector<std::vector<uint8_t>>>(
+                make_probe_train(static_cast<uint8_t>(t), PROBE_TRAINS, PROBE_TRAIN_LENGTH, rate));
+            job.rate_bps = std::max<uint32_t>(rate, 1);
+            job.gap_after = PROBE_TRAIN_GAP;  // Let the bottleneck queue drain between trains
+            job.probe_end = t + 1 == PROBE_TRAINS;
+            paced->jobs.push_back(std::move(job));
+        }
+    }
+    pacer_cv_.notify_one();
+}
+
+void Server::handle_probe_report(const Packet& pkt, const Endpoint& source) {
+    if (pkt.payload.size() < sizeof(ProbeReportPayload)) return;
+    ProbeReportPayload report;
+    std::memcpy(&report, pkt.payload.data(), sizeof(report));
+    ProbeResult result = evaluate_probe(report);
+    finish_probe(source, &result);
+}
+
+void Server::finish_probe(const Endpoint& dest, const ProbeResult* result) {
+    uint32_t target_bitrate = stream_config().video_bitrate;
+    uint32_t start_bitrate = target_bitrate;
+    uint16_t subscriptions;
+    {
+        std::lock_guard lock(clients_mutex_);
+        auto it = std::find_if(clients_.begin(), clients_.end(),
+                               [&](const ClientInfo& c) { return c.endpoint == dest; });
+        if (it == clients_.end() || !it->probing) return;
+        it->probing = false;
+        if (result && result->valid) {
+            start_bitrate = result->start_bitrate(target_bitrate);
+            it->probed_bitrate = start_bitrate;
+            it->pacing_bps = result->pacing_bps();
+        }
+        subscriptions = it->subscriptions;
+    }
+
+    if (result && result->valid) {
+        LOG_INFO(TAG, "Probe %s:%u: capacity %s%.1f Mbps, loss %.0f%%, start %.1f Mbps, %s",
+                 dest.ip.c_str(), dest.port, result->bottlenecked ? "" : ">= ",
+                 result->capacity_bps / 1e6, result->loss * 100.0, start_bitrate / 1e6,
+                 result->pacing_bps() ? "paced" : "unpaced");
+    } else {
+        LOG_INFO(TAG, "Probe %s:%u: no usable report, starting at %.1f Mbps",
+                 dest.ip.c_str(), dest.port, start_bitrate / 1e6);
+    }
+
+    // Bitrate first, so the keyframe the new client starts on is encoded at it
+    if (probe_cb_) probe_cb_(start_bitrate);
+    request_keyframes(subscriptions);
+    notify_client_count();
+}
+
+void Server::expire_probes(std::chrono::steady_clock::time_point now) {
+    std::vector<Endpoint> expired;
+    {
+        std::lock_guard lock(clients_mutex_);
+        for (const auto& c : clients_) {
+            if (c.probing && now - c.probe_sent > PROBE_TIMEOUT) expired.push_back(c.endpoint);
+        }
+    }
+    for (const auto& ep : expired) finish_probe(ep, nullptr);
+}
+
+uint32_t Server::probed_bitrate_ceiling() const {
+    std::lock_guard lock(clients_mutex_);
+    uint32_t ceiling = 0;
+    for (const auto& c : clients_) {
+        if (c.probed_bitrate > 0 && (ceiling == 0 || c.probed_bitrate < ceiling)) {
+            ceiling = c.probed_bitrate;
+        }
+    }
+    return ceiling;
+}
+
+void Server::handle_client_report(const Packet& pkt, const Endpoint& source) {
+    if (pkt.payload.size() < sizeof(ClientReportPayload)) return;
+    ClientReportPayload report;
+    std::memcpy(&report, pkt.payload.data(), sizeof(report));
+
+    uint32_t stream_fps = stream_config().fps;
+    uint32_t previous, limit;
+    {
+        std::lock_guard lock(clients_mutex_);
+        auto it = std::find_if(clients_.begin(), clients_.end(),
+                               [&](const ClientInfo& c) { return c.endpoint == source; });
+        if (it == clients_.end()) return;
+        previous = it->fps_limit;
+        limit = client_fps_limit(report, stream_fps, previous);
+        it->fps_limit = limit;
+    }
+    if (limit == previous) return;
+
+    LOG_INFO(TAG, "Client %s:%u load: %.1f fps shown, decode %.1f ms, %u/%u discarded, "
+             "queues %u/%u -> %s%u fps",
+             source.ip.c_str(), source.port, report.rendered_fps_x10 / 10.0,
+             report.decode_us / 1000.0, report.discarded, report.decoded + report.discarded,
+             report.video_queue, report.decoded_queue,
+             limit ? "limit " : "unlimited, ", limit ? limit : stream_fps);
+}
+
+uint32_t Server::fps_ceiling() const {
+    std::lock_guard lock(clients_mutex_);
+    uint32_t ceiling = 0;
+    for (const auto& c : clients_) {
+        if (c.fps_limit > 0 && (ceiling == 0 || c.fps_limit < ceiling)) {
+            ceiling = c.fps_limit;
+        }
+    }
+    return ceiling;
+}
+
+void Server::handle_viewport(const Packet& pkt, const Endpoint& source) {
+    if (pkt.payload.size() < sizeof(ViewportPayload)) return;
+    ViewportPayload payload;
+    std::memcpy(&payload, pkt.payload.data(), sizeof(payload));
+    ViewportRequest viewport = viewport_request(payload);
+    uint8_t stream = pkt.header.stream_id();
+
+    {
+        std::lock_guard lock(clients_mutex_);
+        auto it = std::find_if(clients_.begin(), clients_.end(),
+                               [&](const ClientInfo& c) { return c.endpoint == source; });
+        if (it == clients_.end()) return;
+        // Repeated periodically; only log changes
+        auto& current = it->viewports[stream];
+        if (current.drawable_width == viewport.drawable_width &&
+            current.drawable_height == viewport.drawable_height &&
+            current.region == viewport.region) {
+            return;
+        }
+        current = viewport;
+    }
+
+    LOG_INFO(TAG, "Client %s:%u stream %u viewport: %ux%u drawable, region %s(%u,%u %ux%u)/65536",
+             source.ip.c_str(), source.port, stream, viewport.drawable_width, viewport.drawable_height,
+             viewport.region.full() ? "full " : "", viewport.region.x, viewport.region.y,
+             viewport.region.width, viewport.region.height);
+}
+
+std::vector<Server::ClientStats> Server::client_stats() const {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t pacing_override = pacing_override_bps_.load();
+    std::lock_guard lock(clients_mutex_);
+    std::vector<ClientStats> out;
+    out.reserve(clients_.size());
+    for (const auto& c : clients_) {
+        ClientStats s;
+        s.endpoint = c.endpoint;
+        s.rtt_ms = c.rtt_valid ? c.rtt_ms : 0.0;
+        s.probing = c.probing;
+        s.awaiting_keyframe = (c.awaiting_keyframe & c.subscriptions) != 0;
+        s.subscriptions = c.subscriptions;
+        s.probed_bitrate = c.probed_bitrate;
+        s.pacing_bps = pacing_override > 0 ? pacing_override : c.pacing_bps;
+        s.fps_limit = c.fps_limit;
+        s.viewport = c.viewports[0];
+        s.connected_s = std::chrono::duration<double>(now - c.joined).count();
+        s.silent_ms = std::chrono::duration<double, std::milli>(now - c.last_seen).count();
+        s.frames_sent = c.frames_sent;
+        s.bytes_sent = c.bytes_sent;
+        s.frames_cut = c.frames_cut;
+        out.push_back(s);
+    }
+    return out;
+}
+
+std::vector<ViewportRequest> Server::viewports(uint8_t stream) const {
+    if (stream >= MAX_STREAMS) return {};
+    std::lock_guard lock(clients_mutex_);
+    std::vector<ViewportRequest> out;
+    out.reserve(clients_.size());
+    for (const auto& c : clients_) {
+        if (!c.probing && (c.subscriptions & (1u << stream))) out.push_back(c.viewports[stream]);
+    }
+    return out;
+}
+
+size_t Server::subscribers(uint8_t stream) const {
+    if (stream >= MAX_STREAMS) return 0;
+    std::lock_guard lock(clients_mutex_);
+    return static_cast<size_t>(std::count_if(clients_.begin(), clients_.end(), [&](const ClientInfo& c) {
+        return !c.probing && (c.subscriptions & (1u << stream));
+    }));
+}
+
+void Server::handle_subscribe(const Packet& pkt, const Endpoint& source) {
+    if (pkt.payload.size() < sizeof(SubscribePayload)) return;
+    SubscribePayload payload;
+    std::memcpy(&payload, pkt.payload.data(), sizeof(payload));
+    auto mask = static_cast<uint16_t>(payload.stream_mask & active_streams());
+    if (mask == 0) return;
+
+    uint16_t added;
+    bool probing;
+    {
+        std::lock_guard lock(clients_mutex_);
+        auto it = std::find_if(clients_.begin(), clients_.end(),
+                               [&](const ClientInfo& c) { return c.endpoint == source; });
+        if (it == clients_.end()) return;
+        // Repeated periodically; only changes matter
+        if (it->subscriptions == mask) return;
+        added = static_cast<uint16_t>(mask & ~it->subscriptions);
+        it->subscriptions = mask;
+        // Nothing of a newly subscribed stream decodes before its keyframe
+        it->awaiting_keyframe = static_cast<uint16_t>((it->awaiting_keyframe & mask) | added);
+        probing = it->probing;
+    }
+
+    LOG_INFO(TAG, "Client %s:%u subscribed to streams 0x%04x", source.ip.c_str(), source.port, mask);
+    // A client still being probed gets its keyframes when it is admitted
+    if (!probing) request_keyframes(added);
+}
+
+void Server::request_keyframes(uint16_t streams) {
+    if (!keyframe_cb_) return;
+    for (uint8_t i = 0; i < MAX_STREAMS; ++i) {
+        if (streams & (1u << i)) keyframe_cb_(i);
+    }
 }
 
 void Server::handle_pong(const Packet& pkt, const Endpoint& source) {
@@ -176,6 +1055,7 @@ void Server::handle_pong(const Packet& pkt, const Endpoint& source) {
         if (c.endpoint == source) {
             c.rtt_ms = rtt;
             c.rtt_valid = true;
+            c.last_pong = now;
             LOG_DEBUG(TAG, "RTT to %s:%u = %.1f ms", source.ip.c_str(), source.port, rtt);
             break;
         }
@@ -187,17 +1067,20 @@ void Server::handle_nack(const Packet& pkt, const Endpoint& source) {
 
     NackPayload np;
     std::memcpy(&np, pkt.payload.data(), sizeof(NackPayload));
+    uint8_t stream = pkt.header.stream_id();
 
     std::lock_guard lock(keyframe_mutex_);
-    if (np.frame_id != last_keyframe_.frame_id) {
+    const auto& last_keyframe = streams_[stream].last_keyframe;
+    if (np.frame_id != last_keyframe.frame_id) {
         LOG_DEBUG(TAG, "NACK for old keyframe %u (current: %u), ignoring",
-                  np.frame_id, last_keyframe_.frame_id);
+                  np.frame_id, last_keyframe.frame_id);
         return;
     }
 
     // Parse and resend missing fragments
     size_t offset = sizeof(NackPayload);
     uint16_t resent = 0;
+    SendCounters counters;
     for (uint16_t i = 0; i < np.num_missing; ++i) {
         if (offset + sizeof(uint16_t) > pkt.payload.size()) break;
 
@@ -205,15 +1088,25 @@ void Server::handle_nack(const Packet& pkt, const Endpoint& source) {
         std::memcpy(&frag_idx, pkt.payload.data() + offset, sizeof(uint16_t));
         offset += sizeof(uint16_t);
 
-        if (frag_idx < last_keyframe_.fragments.size()) {
-            auto data = last_keyframe_.fragments[frag_idx].serialize();
-            socket_.send_to(data, source);
+        if (frag_idx < last_keyframe.fragments.size()) {
+            // Retransmits yield to live media: no waiting, the client NACKs again.
+            // Flagged so the client doesn't count the reused sequence number twice.
+            const auto& frag = last_keyframe.fragments[frag_idx];
+            auto data = frag.serialize();
+            PacketHeader header = frag.header;
+            header.flags |= FLAG_RETRANSMIT;
+            header.to_network(data.data());
+            if (!send_until(data, source, std::chrono::steady_clock::now(), counters)) {
+                counters.drops += np.num_missing - i - 1;
+                break;
+            }
             resent++;
         }
     }
+    add_send_counters(counters);
 
-    LOG_INFO(TAG, "NACK from %s:%u: resent %u/%u fragments for keyframe %u",
-             source.ip.c_str(), source.port, resent, np.num_missing, np.frame_id);
+    LOG_INFO(TAG, "NACK from %s:%u: resent %u/%u fragments for stream %u keyframe %u",
+             source.ip.c_str(), source.port, resent, np.num_missing, stream, np.frame_id);
 }
 
 void Server::send_pings() {
@@ -225,7 +1118,7 @@ void Server::send_pings() {
     ping.header.magic = PROTOCOL_MAGIC;
     ping.header.version = PROTOCOL_VERSION;
     ping.header.type = static_cast<uint8_t>(PacketType::PING);
-    ping.header.sequence = sequence_++;
+    ping.header.sequence = control_sequence_++;
 
     PingPayload pp;
     pp.timestamp_us = timestamp_us;
@@ -234,25 +1127,131 @@ void Server::send_pings() {
 
     auto data = ping.serialize();
 
-    std::lock_guard lock(clients_mutex_);
-    for (const auto& client : clients_) {
-        socket_.send_to(data, client.endpoint);
+    SendCounters counters;
+    {
+        std::lock_guard lock(clients_mutex_);
+        for (const auto& client : clients_) {
+            send_until(data, client.endpoint, now, counters);
+        }
     }
+    add_send_counters(counters);
 }
 
 void Server::send_stream_config(const Endpoint& dest) {
-    if (config_.codec_data.empty()) return;
+    auto codec_data = stream_config().codec_data;
+    if (codec_data.empty()) return;
 
     Packet pkt;
     pkt.header.magic = PROTOCOL_MAGIC;
     pkt.header.version = PROTOCOL_VERSION;
     pkt.header.type = static_cast<uint8_t>(PacketType::STREAM_CONFIG);
-    pkt.header.sequence = sequence_++;
-    pkt.payload = config_.codec_data;
+    pkt.header.sequence = control_sequence_++;
+    pkt.payload = std::move(codec_data);
 
     send_to(pkt, dest);
     LOG_INFO(TAG, "Sent STREAM_CONFIG (%zu bytes) to %s:%u",
-             config_.codec_data.size(), dest.ip.c_str(), dest.port);
+             pkt.payload.size(), dest.ip.c_str(), dest.port);
+}
+
+void Server::send_stream_list(const Endpoint& dest) {
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::STREAM_LIST);
+    pkt.header.sequence = control_sequence_++;
+    {
+        std::lock_guard lock(config_mutex_);
+        for (uint8_t i = 0; i < MAX_STREAMS; ++i) {
+            const auto& stream = streams_[i];
+            if (!stream.active) continue;
+            StreamListEntry entry;
+            entry.stream_id = i;
+            entry.width = static_cast<uint16_t>(stream.config.width);
+            entry.height = static_cast<uint16_t>(stream.config.height);
+            entry.fps = static_cast<uint16_t>(stream.config.fps);
+            std::memcpy(entry.name, stream.name.data(), std::min(stream.name.size(), sizeof(entry.name) - 1));
+            size_t offset = pkt.payload.size();
+            pkt.payload.resize(offset + sizeof(entry));
+            std::memcpy(pkt.payload.data() + offset, &entry, sizeof(entry));
+        }
+    }
+    send_to(pkt, dest);
+}
+
+void Server::add_stream(uint8_t stream, const std::string& name, const StreamConfig& config) {
+    if (stream >= MAX_STREAMS) return;
+    std::lock_guard lock(config_mutex_);
+    streams_[stream].active = true;
+    streams_[stream].name = name;
+    streams_[stream].config = config;
+}
+
+size_t Server::stream_count() const {
+    std::lock_guard lock(config_mutex_);
+    return static_cast<size_t>(std::count_if(streams_.begin(), streams_.end(),
+                                             [](const Stream& s) { return s.active; }));
+}
+
+uint16_t Server::active_streams() const {
+    std::lock_guard lock(config_mutex_);
+    uint16_t mask = 0;
+    for (uint8_t i = 0; i < MAX_STREAMS; ++i) {
+        if (streams_[i].active) mask |= static_cast<uint16_t>(1u << i);
+    }
+    return mask;
+}
+
+void Server::update_stream_config(const StreamConfig& config, uint8_t stream) {
+    if (stream >= MAX_STREAMS) return;
+    {
+        std::lock_guard lock(config_mutex_);
+        auto& current = streams_[stream].config;
+        current.width = config.width;
+        current.height = config.height;
+        current.fps = config.fps;
+        current.video_bitrate = config.video_bitrate;
+        current.codec_data = config.codec_data;
+        current.region = config.region;
+    }
+    LOG_INFO(TAG, "Stream %u config updated: %ux%u @ %u fps, codec_data %zu bytes, region %s(%u,%u %ux%u)",
+             stream, config.width, config.height, config.fps, config.codec_data.size(),
+             config.region.full() ? "full " : "", config.region.x, config.region.y,
+             config.region.width, config.region.height);
+}
+
+std::vector<uint8_t> Server::stream_update_datagram(uint8_t stream) {
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(PacketType::STREAM_UPDATE);
+    pkt.header.sequence = control_sequence_++;
+    pkt.header.set_stream_id(stream);
+
+    StreamUpdatePayload up;
+    {
+        std::lock_guard lock(config_mutex_);
+        const auto& config = streams_[stream].config;
+        up.width = config.width;
+        up.height = config.height;
+        up.fps = config.fps;
+        up.video_bitrate = config.video_bitrate;
+        if (!config.region.full()) {
+            up.region_x = config.region.x;
+            up.region_y = config.region.y;
+            up.region_width = config.region.width;
+            up.region_height = config.region.height;
+        }
+        pkt.payload.resize(sizeof(up) + config.codec_data.size());
+        std::memcpy(pkt.payload.data() + sizeof(up), config.codec_data.data(), config.codec_data.size());
+    }
+    std::memcpy(pkt.payload.data(), &up, sizeof(up));
+    return pkt.serialize();
+}
+
+StreamConfig Server::stream_config(uint8_t stream) const {
+    if (stream >= MAX_STREAMS) return {};
+    std::lock_guard lock(config_mutex_);
+    return streams_[stream].config;
 }
 
 } // namespace lancast
@@ -4,7 +4,17 @@
 #include "net/protocol.h"
 #include "net/packet_fragmenter.h"
 #include "net/packet_assembler.h"
+#include "net/bandwidth_probe.h"
+#include "net/client_load.h"
+#include "net/viewport.h"
 #include "core/types.h"
+#include "core/jthread.h"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <string>
 #include <vector>
 #include <mutex>
 #include <atomic>
@@ -21,20 +31,55 @@ public:
     bool start();
     void stop();
 
-    // Send an encoded packet to all connected clients
+    // Send an encoded packet to all connected clients; video only to those
+    // subscribed to its stream_id
     void broadcast(const EncodedPacket& packet);
 
     // Send a raw packet to a specific endpoint
     void send_to(const Packet& packet, const Endpoint& dest);
 
-    // Process incoming packets (call from recv thread)
+    // Process incoming packets (call from recv thread). Also runs the PING
+    // and liveness timers, so exactly one thread must call it.
     void poll();
 
+    // Receive sharding: with n > 1, start() binds n SO_REUSEPORT sockets to
+    // the port and the kernel hashes each client to one of them, so a given
+    // client's packets are always handled by the same shard. poll() reads
+    // shard 0; poll_shard(i) must be called from its own thread for each
+    // i in [1, receive_shards()). Set before start().
+    void set_receive_shards(size_t n) { requested_shards_ = std::clamp<size_t>(n, 1, MAX_RECEIVE_SHARDS); }
+    size_t receive_shards() const { return shards_.size(); }
+    void poll_shard(size_t index);
+
+    // Kernel TX timestamps on every datagram sent, for tx_queue_ms (default
+    // off). Each one is an error-queue entry charged to the receive buffer,
+    // so under heavy output they crowd out client traffic. RX timestamps
+    // are always on. Set before start().
+    void set_tx_timestamps(bool enabled) { tx_timestamps_ = enabled; }
+
     using ClientAudioCallback = std::function<void(EncodedPacket)>;
 
-    void set_stream_config(const StreamConfig& config) { config_ = config; }
-    void set_keyframe_callback(std::function<void()> cb) { keyframe_cb_ = std::move(cb); }
+    // Config of the primary stream (0), which also carries the audio settings
+    void set_stream_config(const StreamConfig& config) { add_stream(0, "screen", config); }
+    // Offer another video stream (call before start). Clients that never
+    // subscribe only get stream 0; the rest are listed in STREAM_LIST.
+    void add_stream(uint8_t stream, const std::string& name, const StreamConfig& config);
+    size_t stream_count() const;
+    // Switch a stream's video config mid-stream (size, fps, codec extradata).
+    // Call from the broadcasting thread, right before the first keyframe
+    // encoded with it; clients switch decoders at that keyframe.
+    void update_stream_config(const StreamConfig& config, uint8_t stream = 0);
+    StreamConfig stream_config(uint8_t stream = 0) const;
+    // Called with the stream a client needs a keyframe on
+    void set_keyframe_callback(std::function<void(uint8_t)> cb) { keyframe_cb_ = std::move(cb); }
     void set_client_audio_callback(ClientAudioCallback cb) { client_audio_cb_ = std::move(cb); }
+    // Called from a receive thread whenever a client joins or leaves, with the
+    // new count. A new client counts once its bandwidth probe has settled.
+    // Calls are serialized and each carries the count current at the call.
+    void set_client_count_callback(std::function<void(size_t)> cb) { client_count_cb_ = std::move(cb); }
+    // Called when a joining client's probe settles, before its count callback
+    // and first keyframe, with the bitrate the stream should start at for it
+    void set_probe_callback(std::function<void(uint32_t)> cb) { probe_cb_ = std::move(cb); }
 
     bool is_running() const { return running_.load(); }
     size_t client_count() const;
@@ -42,11 +87,135 @@ public:
     // RTT measurement (max across all clients with valid RTT)
     double max_rtt_ms() const;
 
+    // Lowest probed start bitrate among connected clients, 0 if none was probed
+    uint32_t probed_bitrate_ceiling() const;
+
+    // Lowest frame rate limit from client load reports, 0 if every client keeps up
+    uint32_t fps_ceiling() const;
+
+    // Viewport of every admitted client subscribed to the stream; clients
+    // that haven't reported one have a zero drawable size and the full region
+    std::vector<ViewportRequest> viewports(uint8_t stream = 0) const;
+
+    // Admitted clients subscribed to the stream
+    size_t subscribers(uint8_t stream) const;
+
+    // Liveness: a client that sends nothing (not even PONGs) is evicted
+    struct LivenessConfig {
+        std::chrono::milliseconds rtt_stale_after{5000};  // RTT ignored by max_rtt_ms() after this
+        std::chrono::milliseconds evict_after{10000};     // Silent clients are dropped after this
+        std::chrono::milliseconds resume_window{60000};   // Evicted clients rejoin without a new session
+    };
+    void set_liveness_config(const LivenessConfig& config) { liveness_ = config; }
+
+    // Size SO_SNDBUF for a keyframe burst plus the bandwidth-delay product of
+    // every client. Skips small changes; call again when bitrate or RTT moves.
+    void tune_send_buffer(uint32_t bitrate_bps, double rtt_ms);
+
+    struct Stats {
+        // Kernel-timestamp delay breakdown (EWMA; zero where timestamping is unavailable)
+        double tx_queue_ms = 0.0;   // send_to() -> handed to the NIC driver
+        double rx_queue_ms = 0.0;   // Kernel arrival -> handled by poll() (mean over shards)
+        uint64_t rx_packets = 0;    // Valid and invalid datagrams received, all shards
+        uint64_t tx_timestamps = 0; // TX completion reports received
+        uint64_t evictions = 0;     // Clients dropped for silence
+        uint64_t resumptions = 0;   // Evicted clients that came back within the resume window
+        // Local send backpressure (datagrams the host never put on the wire)
+        uint64_t send_retries = 0;  // Sends that waited for buffer space
+        uint64_t send_drops = 0;    // Datagrams dropped after the deadline or a hard error
+        uint64_t frames_cut = 0;    // Video frames abandoned part-way for a client
+    };
+    Stats stats() const;
+
+    // Per-client view for introspection (control socket)
+    struct ClientStats {
+        Endpoint endpoint;
+        double rtt_ms = 0.0;             // 0 until measured
+        bool probing = false;
+        bool awaiting_keyframe = false;  // On any subscribed stream
+        uint16_t subscriptions = 1;      // Bit n = stream n
+        uint32_t probed_bitrate = 0;
+        uint32_t pacing_bps = 0;         // Effective rate, 0 = unpaced
+        uint32_t fps_limit = 0;
+        ViewportRequest viewport;        // Of stream 0
+        double connected_s = 0.0;
+        double silent_ms = 0.0;          // Since its last packet
+        uint64_t frames_sent = 0;        // Video frames delivered whole
+        uint64_t bytes_sent = 0;         // Video datagram bytes
+        uint64_t frames_cut = 0;
+    };
+    std::vector<ClientStats> client_stats() const;
+
+    // Pace every client's fragments at this rate instead of its probed one;
+    // 0 returns to the probed rates. Takes effect on the next frame.
+    void set_pacing_override(uint32_t bps) { pacing_override_bps_ = bps; }
+    uint32_t pacing_override() const { return pacing_override_bps_.load(); }
+
 private:
     struct ClientInfo {
         Endpoint endpoint;
         double rtt_ms = 0.0;
         bool rtt_valid = false;
+        std::chrono::steady_clock::time_point last_seen;  // Any packet from the client
+        std::chrono::steady_clock::time_point last_pong;
+        uint16_t subscriptions = 1;      // Bit n = stream n
+        uint16_t awaiting_keyframe = 0;  // Per stream: P-frames are skipped after a cut frame
+        bool probing = false;            // Joined, bandwidth probe not yet reported
+        std::chrono::steady_clock::time_point probe_sent;
+        uint32_t probed_bitrate = 0;     // Start bitrate from the probe, 0 = unknown
+        uint32_t pacing_bps = 0;         // Fragment pacing rate, 0 = unpaced
+        uint32_t fps_limit = 0;          // From its load reports, 0 = keeps up
+        std::array<ViewportRequest, MAX_STREAMS> viewports;  // Last VIEWPORT it sent per stream
+        std::chrono::steady_clock::time_point joined;
+        uint64_t frames_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t frames_cut = 0;
+    };
+
+    struct SendCounters {
+        uint64_t retries = 0;
+        uint64_t drops = 0;
+        uint64_t frames_cut = 0;
+    };
+
+    struct EvictedClient {
+        Endpoint endpoint;
+        std::chrono::steady_clock::time_point evicted_at;
+    };
+
+    // Datagrams queued for one client on the pacer thread: a frame, a
+    // keyframe's stream update or a probe train
+    struct PacedJob {
+        std::shared_ptr<const std::vector<std::vector<uint8_t>>> wire;
+        size_t next = 0;
+        uint32_t rate_bps = 0;  // 0 = back to back
+        std::chrono::steady_clock::time_point expires = std::chrono::steady_clock::time_point::max();
+        std::chrono::steady_clock::duration gap_after{0};
+        bool video = false;      // Accounted and cut like broadcast() does
+        FrameType type = FrameType::Audio;
+        uint8_t stream = 0;
+        bool probe_end = false;  // Last probe train: the probe timeout starts
+        uint64_t bytes = 0;
+    };
+
+    struct PacedClient {
+        Endpoint endpoint;
+        std::deque<PacedJob> jobs;
+        std::chrono::steady_clock::time_point due;  // Next fragment
+    };
+
+    struct UnreachableEndpoint {
+        Endpoint endpoint;
+        std::chrono::steady_clock::time_point reported;
+    };
+
+    // One receive socket; shard 0 reads socket_, which also sends.
+    // Counters are per shard so receive threads never share a lock.
+    struct RecvShard {
+        std::unique_ptr<UdpSocket> socket;  // Null for shard 0
+        std::mutex stats_mutex;
+        uint64_t rx_packets = 0;
+        double rx_queue_ms = 0.0;
     };
 
     struct KeyframeCache {
@@ -54,33 +223,117 @@ private:
         std::vector<Packet> fragments;
     };
 
+    struct Stream {
+        bool active = false;
+        std::string name;
+        StreamConfig config;     // Guarded by config_mutex_
+        uint32_t sequence = 0;   // Video packets, send thread
+        KeyframeCache last_keyframe;  // Guarded by keyframe_mutex_
+    };
+
+    void receive(RecvShard& shard);
     void handle_hello(const Packet& pkt, const Endpoint& source);
     void handle_pong(const Packet& pkt, const Endpoint& source);
     void handle_nack(const Packet& pkt, const Endpoint& source);
+    void handle_probe_report(const Packet& pkt, const Endpoint& source);
+    void handle_client_report(const Packet& pkt, const Endpoint& source);
+    void handle_viewport(const Packet& pkt, const Endpoint& source);
+    void handle_subscribe(const Packet& pkt, const Endpoint& source);
+    void send_probe(const Endpoint& dest);
+    void finish_probe(const Endpoint& dest, const ProbeResult* result);
+    void expire_probes(std::chrono::steady_clock::time_point now);
     void send_stream_config(const Endpoint& dest);
+    void send_stream_list(const Endpoint& dest);
+    std::vector<uint8_t> stream_update_datagram(uint8_t stream);
+    void request_keyframes(uint16_t streams);
+    uint16_t active_streams() const;
     void send_pings();
+    bool account_frame(ClientInfo& client, uint8_t stream, FrameType type, uint64_t bytes, bool cut);
+    PacedClient* find_paced(const Endpoint& endpoint);
+    void pacer_loop(lancast::stop_token st);
+    void finish_paced(PacedClient& client, std::unique_lock<std::mutex>& lock);
+    void cut_paced(PacedClient& client, std::unique_lock<std::mutex>& lock);
+    void drain_error_queue();
+    bool recently_unreachable(const Endpoint& dest, std::chrono::steady_clock::time_point now);
+    bool send_until(const std::vector<uint8_t>& data, const Endpoint& dest,
+                    std::chrono::steady_clock::time_point deadline, SendCounters& counters);
+    void add_send_counters(const SendCounters& counters);
+    bool touch_client(const Endpoint& source, std::chrono::steady_clock::time_point now);
+    bool take_evicted(const Endpoint& source, std::chrono::steady_clock::time_point now);
+    void resume_client(const Endpoint& source, std::chrono::steady_clock::time_point now);
+    void evict_silent_clients(std::chrono::steady_clock::time_point now);
+    void notify_client_count();
 
     uint16_t port_;
     UdpSocket socket_;
     PacketFragmenter fragmenter_;
-    uint16_t sequence_ = 0;
+    // Media packets are numbered per stream, audio on its own, so a client
+    // can count loss from gaps in what it takes. Control packets go to single
+    // clients and share a counter that nobody checks for gaps.
+    uint32_t audio_sequence_ = 0;  // Audio send path
+    std::atomic<uint32_t> control_sequence_{0};
 
     mutable std::mutex clients_mutex_;
     std::vector<ClientInfo> clients_;
 
     std::atomic<bool> running_{false};
-    StreamConfig config_;
-    std::function<void()> keyframe_cb_;
+    std::atomic<uint32_t> pacing_override_bps_{0};
+    mutable std::mutex config_mutex_;  // Stream configs change on the send thread mid-stream
+    std::array<Stream, MAX_STREAMS> streams_;
+    std::function<void(uint8_t)> keyframe_cb_;
     ClientAudioCallback client_audio_cb_;
+    std::function<void(size_t)> client_count_cb_;
+    std::mutex client_count_mutex_;  // Serializes client_count_cb_ calls
+    std::function<void(uint32_t)> probe_cb_;
+
+    // Mic audio from every client funnels into one assembler and callback
+    std::mutex client_audio_mutex_;
     PacketAssembler client_audio_assembler_;
 
-    // Keyframe NACK retransmission cache
+    static constexpr size_t MAX_RECEIVE_SHARDS = 16;
+    size_t requested_shards_ = 1;
+    bool tx_timestamps_ = false;
+    std::vector<std::unique_ptr<RecvShard>> shards_;
+
+    // Paced sends and bandwidth probes, one queue per client, go out on the
+    // pacer thread so a slow client never holds up the others. Only the
+    // pacer erases from paced_; a deque keeps its entries in place meanwhile.
+    std::mutex pacer_mutex_;
+    std::condition_variable pacer_cv_;
+    std::deque<PacedClient> paced_;
+    lancast::jthread pacer_thread_;
+
+    // Guards every stream's keyframe NACK retransmission cache
     std::mutex keyframe_mutex_;
-    KeyframeCache last_keyframe_;
 
     // PING/PONG timing
     static constexpr auto PING_INTERVAL = std::chrono::seconds(2);
     std::chrono::steady_clock::time_point last_ping_time_;
+
+    // A client that never reports its probe is admitted unprobed after this
+    static constexpr auto PROBE_TIMEOUT = std::chrono::milliseconds(1000);
+
+    // Liveness (evicted_ is guarded by clients_mutex_)
+    static constexpr auto LIVENESS_CHECK_INTERVAL = std::chrono::milliseconds(250);
+    LivenessConfig liveness_;
+    std::vector<EvictedClient> evicted_;
+    std::chrono::steady_clock::time_point last_liveness_check_;
+
+    // Destinations named by ICMP errors on the shared socket. A send that
+    // fails with another client's error is retried; one to these is not.
+    static constexpr auto UNREACHABLE_MEMORY = std::chrono::seconds(2);
+    static constexpr int MAX_UNREACHABLE_RETRIES = 4;
+    std::mutex unreachable_mutex_;
+    std::vector<UnreachableEndpoint> unreachable_;
+
+    // Send buffer sizing
+    static constexpr int MIN_SEND_BUFFER = 256 * 1024;
+    static constexpr int MAX_SEND_BUFFER = 16 * 1024 * 1024;
+    int send_buffer_target_ = 0;
+
+    // Kernel timestamp and send stats (written by the send and receive threads)
+    mutable std::mutex stats_mutex_;
+    Stats stats_;
 };
 
 } // namespace lancast
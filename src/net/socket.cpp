@@ -1,16 +1,29 @@
 #include "net/socket.h"
 #include "core/logger.h"
+#include "core/timing.h"
 
 #ifdef _WIN32
 #  include <cstring>
 #else
 #  include <unistd.h>
 #  include <fcntl.h>
+#  include <poll.h>
 #  include <arpa/inet.h>
 #  include <cerrno>
 #  include <cstring>
 #endif
 
+#if defined(__linux__)
+#  include <linux/errqueue.h>
+#  include <linux/net_tstamp.h>
+#  include <sys/uio.h>
+#  include <ctime>
+#endif
+
+#include <array>
+#include <chrono>
+#include <mutex>
+
 namespace lancast {
 
 static constexpr const char* TAG = "Socket";
@@ -31,6 +44,35 @@ static std::string last_error_string() { return wsa_error_string(WSAGetLastError
 static std::string last_error_string() { return strerror(errno); }
 #endif
 
+// Enqueue times of recent sends, indexed by the kernel's per-socket
+// timestamp key (SOF_TIMESTAMPING_OPT_ID counts datagrams from zero).
+struct UdpSocket::TxStamps {
+    static constexpr uint32_t SLOTS = 4096;  // Power of two
+    std::mutex mutex;                         // Keeps key assignment in send order
+    uint32_t next_id = 0;
+    std::array<int64_t, SLOTS> enqueue_us{};
+};
+
+#if defined(__linux__)
+// Software timestamps are CLOCK_REALTIME; the pipeline works in steady time
+static int64_t kernel_to_steady_us(const timespec& ts) {
+    timespec real{};
+    clock_gettime(CLOCK_REALTIME, &real);
+    int64_t real_us = static_cast<int64_t>(real.tv_sec) * 1'000'000 + real.tv_nsec / 1000;
+    int64_t stamp_us = static_cast<int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1000;
+    return steady_now_us() - (real_us - stamp_us);
+}
+
+static const scm_timestamping* find_timestamps(msghdr& msg) {
+    for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+            return reinterpret_cast<const scm_timestamping*>(CMSG_DATA(c));
+        }
+    }
+    return nullptr;
+}
+#endif
+
 sockaddr_in Endpoint::to_sockaddr() const {
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
@@ -65,7 +107,9 @@ UdpSocket::~UdpSocket() {
     }
 }
 
-UdpSocket::UdpSocket(UdpSocket&& other) noexcept : fd_(other.fd_) {
+UdpSocket::UdpSocket(UdpSocket&& other) noexcept
+    : fd_(other.fd_), tx_stamps_(std::move(other.tx_stamps_)), rx_stamps_(other.rx_stamps_),
+      send_flags_(other.send_flags_), send_errors_(other.send_errors_) {
     other.fd_ = INVALID_SOCK;
 }
 
@@ -80,19 +124,34 @@ UdpSocket& UdpSocket::operator=(UdpSocket&& other) noexcept {
         }
         fd_ = other.fd_;
         other.fd_ = INVALID_SOCK;
+        tx_stamps_ = std::move(other.tx_stamps_);
+        rx_stamps_ = other.rx_stamps_;
+        send_flags_ = other.send_flags_;
+        send_errors_ = other.send_errors_;
     }
     return *this;
 }
 
-bool UdpSocket::bind(uint16_t port) {
+bool UdpSocket::bind(uint16_t port, bool reuse_port) {
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
     addr.sin_port = htons(port);
 
-    int reuse = 1;
-    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR,
-               reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    // No SO_REUSEADDR: for UDP it lets another socket bind the same port
+    // and quietly take its unicast traffic
+    if (reuse_port) {
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+        int reuse = 1;
+        if (setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) < 0) {
+            LOG_ERROR(TAG, "SO_REUSEPORT failed: %s", last_error_string().c_str());
+            return false;
+        }
+#else
+        LOG_ERROR(TAG, "SO_REUSEPORT is not supported on this platform");
+        return false;
+#endif
+    }
 
     if (::bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
         LOG_ERROR(TAG, "Bind to port %u failed: %s", port, last_error_string().c_str());
@@ -102,6 +161,21 @@ bool UdpSocket::bind(uint16_t port) {
     return true;
 }
 
+bool UdpSocket::port_in_use(uint16_t port) {
+    UdpSocket probe;
+    if (!probe.is_valid()) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (::bind(probe.fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) return false;
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEADDRINUSE;
+#else
+    return errno == EADDRINUSE;
+#endif
+}
+
 bool UdpSocket::set_nonblocking(bool nonblocking) {
 #ifdef _WIN32
     u_long mode = nonblocking ? 1 : 0;
@@ -117,6 +191,13 @@ bool UdpSocket::set_nonblocking(bool nonblocking) {
 #endif
 }
 
+uint16_t UdpSocket::local_port() const {
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) != 0) return 0;
+    return ntohs(addr.sin_port);
+}
+
 bool UdpSocket::set_recv_buffer(int size) {
     return setsockopt(fd_, SOL_SOCKET, SO_RCVBUF,
                       reinterpret_cast<const char*>(&size), sizeof(size)) >= 0;
@@ -127,10 +208,89 @@ bool UdpSocket::set_send_buffer(int size) {
                       reinterpret_cast<const char*>(&size), sizeof(size)) >= 0;
 }
 
+int UdpSocket::send_buffer_size() const {
+    int size = 0;
+#ifdef _WIN32
+    int len = sizeof(size);
+#else
+    socklen_t len = sizeof(size);
+#endif
+    if (getsockopt(fd_, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<char*>(&size), &len) < 0) return 0;
+    return size;
+}
+
+bool UdpSocket::set_send_nonblocking(bool nonblocking) {
+#if defined(MSG_DONTWAIT)
+    send_flags_ = nonblocking ? MSG_DONTWAIT : 0;
+    return true;
+#else
+    (void)nonblocking;
+    return false;
+#endif
+}
+
+bool UdpSocket::enable_send_errors() {
+#if defined(__linux__)
+    int on = 1;
+    if (setsockopt(fd_, SOL_IP, IP_RECVERR, &on, sizeof(on)) < 0) {
+        LOG_DEBUG(TAG, "IP_RECVERR unavailable: %s", last_error_string().c_str());
+        return false;
+    }
+    send_errors_ = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UdpSocket::last_send_error_transient() {
+#ifdef _WIN32
+    int err = WSAGetLastError();
+    return err == WSAEWOULDBLOCK || err == WSAENOBUFS;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+#endif
+}
+
+bool UdpSocket::last_send_error_unreachable() {
+#ifdef _WIN32
+    return false;  // Winsock reports ICMP errors on receive, not on send
+#else
+    return errno == ECONNREFUSED || errno == EHOSTUNREACH || errno == ENETUNREACH;
+#endif
+}
+
+bool UdpSocket::wait_writable(int timeout_ms) {
+#ifdef _WIN32
+    WSAPOLLFD pfd{fd_, POLLWRNORM, 0};
+    return WSAPoll(&pfd, 1, timeout_ms) > 0;
+#else
+    pollfd pfd{fd_, POLLOUT, 0};
+    int n;
+    do {
+        n = ::poll(&pfd, 1, timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    return n > 0 && (pfd.revents & POLLOUT);
+#endif
+}
+
 ssize_t UdpSocket::send_to(const uint8_t* data, size_t len, const Endpoint& dest) {
     sockaddr_in addr = dest.to_sockaddr();
-    return sendto(fd_, reinterpret_cast<const char*>(data), static_cast<int>(len), 0,
-                  reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    if (!tx_stamps_) {
+        return sendto(fd_, reinterpret_cast<const char*>(data), static_cast<int>(len), send_flags_,
+                      reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+
+    std::lock_guard lock(tx_stamps_->mutex);
+    uint32_t id = tx_stamps_->next_id;
+    tx_stamps_->enqueue_us[id & (TxStamps::SLOTS - 1)] = steady_now_us();
+    ssize_t n = sendto(fd_, reinterpret_cast<const char*>(data), static_cast<int>(len), send_flags_,
+                       reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    // A datagram that got as far as the send buffer or qdisc consumed a key
+    if (n >= 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        tx_stamps_->next_id = id + 1;
+    }
+    return n;
 }
 
 ssize_t UdpSocket::send_to(const std::vector<uint8_t>& data, const Endpoint& dest) {
@@ -146,6 +306,31 @@ std::optional<UdpSocket::RecvResult> UdpSocket::recv_from(size_t max_size) {
     socklen_t addr_len = sizeof(src_addr);
 #endif
 
+#if defined(__linux__)
+    if (rx_stamps_) {
+        iovec iov{buf.data(), buf.size()};
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+        msghdr msg{};
+        msg.msg_name = &src_addr;
+        msg.msg_namelen = addr_len;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd_, &msg, 0);
+        if (n <= 0) return std::nullopt;
+
+        buf.resize(static_cast<size_t>(n));
+        RecvResult result{std::move(buf), Endpoint::from_sockaddr(src_addr)};
+        const scm_timestamping* ts = find_timestamps(msg);
+        if (ts && (ts->ts[0].tv_sec != 0 || ts->ts[0].tv_nsec != 0)) {
+            result.kernel_rx_us = kernel_to_steady_us(ts->ts[0]);
+        }
+        return result;
+    }
+#endif
+
     ssize_t n = recvfrom(fd_, reinterpret_cast<char*>(buf.data()),
                          static_cast<int>(buf.size()), 0,
                          reinterpret_cast<sockaddr*>(&src_addr), &addr_len);
@@ -168,4 +353,89 @@ bool UdpSocket::set_recv_timeout(int ms) {
 #endif
 }
 
+bool UdpSocket::enable_timestamping(bool tx) {
+    if (rx_stamps_ && (tx_stamps_ || !tx)) return true;
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (tx) {
+        flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    }
+    if (setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0) {
+        LOG_DEBUG(TAG, "SO_TIMESTAMPING unavailable: %s", last_error_string().c_str());
+        return false;
+    }
+    rx_stamps_ = true;
+    if (tx) tx_stamps_ = std::make_unique<TxStamps>();
+    return true;
+#else
+    (void)tx;
+    return false;
+#endif
+}
+
+size_t UdpSocket::drain_tx_timestamps(std::vector<int64_t>& delays_us,
+                                      std::vector<Endpoint>* unreachable) {
+#if defined(__linux__)
+    if (!tx_stamps_ && !send_errors_) return 0;
+
+    // Bounded so a flood of reports can't stall the caller
+    constexpr int MAX_REPORTS = 512;
+    size_t appended = 0;
+
+    for (int i = 0; i < MAX_REPORTS; ++i) {
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping)) +
+                                      CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in))];
+        sockaddr_in dest{};
+        msghdr msg{};
+        msg.msg_name = &dest;
+        msg.msg_namelen = sizeof(dest);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+
+        const sock_extended_err* err = nullptr;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) {
+                err = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(c));
+            }
+        }
+        if (!err) continue;
+
+        // An ICMP error names the original destination, not the router
+        if (err->ee_origin == SO_EE_ORIGIN_ICMP) {
+            if (unreachable && msg.msg_namelen >= sizeof(dest) && dest.sin_family == AF_INET) {
+                unreachable->push_back(Endpoint::from_sockaddr(dest));
+            }
+            continue;
+        }
+
+        const scm_timestamping* ts = tx_stamps_ ? find_timestamps(msg) : nullptr;
+        if (!ts || err->ee_errno != ENOMSG || err->ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+            continue;
+        }
+
+        int64_t wire_us = kernel_to_steady_us(ts->ts[0]);
+        int64_t enqueue_us;
+        {
+            std::lock_guard lock(tx_stamps_->mutex);
+            uint32_t id = err->ee_data;
+            uint32_t age = tx_stamps_->next_id - id;
+            if (age == 0 || age > TxStamps::SLOTS) continue;  // Unknown or overwritten
+            enqueue_us = tx_stamps_->enqueue_us[id & (TxStamps::SLOTS - 1)];
+        }
+
+        int64_t delay = wire_us - enqueue_us;
+        if (delay < 0) continue;  // Key drift after a failed send
+        delays_us.push_back(delay);
+        appended++;
+    }
+    return appended;
+#else
+    (void)delays_us;
+    (void)unreachable;
+    return 0;
+#endif
+}
+
 } // namespace lancast
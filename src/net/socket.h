@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <optional>
@@ -38,30 +39,89 @@ public:
     UdpSocket(UdpSocket&& other) noexcept;
     UdpSocket& operator=(UdpSocket&& other) noexcept;
 
-    bool bind(uint16_t port);
+    // Without reuse_port the port is this socket's alone. reuse_port joins
+    // an SO_REUSEPORT group: the kernel spreads datagrams across all sockets
+    // bound to the port by source address hash. Any socket of the same user
+    // may join, so check port_in_use() before creating a group. Fails where
+    // SO_REUSEPORT is unavailable.
+    bool bind(uint16_t port, bool reuse_port = false);
+    // True if some socket, in any process, is bound to the UDP port
+    static bool port_in_use(uint16_t port);
     bool set_nonblocking(bool nonblocking);
+
+    // Port the socket is bound to (explicitly or by its first send), 0 if none
+    uint16_t local_port() const;
     bool set_recv_buffer(int size);
     bool set_send_buffer(int size);
 
+    int send_buffer_size() const;
+
+    // Sends fail with EAGAIN instead of blocking when the send buffer is full
+    // (recv keeps its timeout). Linux/macOS only; a no-op returning false elsewhere.
+    bool set_send_nonblocking(bool nonblocking);
+
+    // Report datagrams the local qdisc refuses as ENOBUFS instead of letting
+    // the kernel discard them silently (Linux IP_RECVERR). The error queue is
+    // drained by drain_tx_timestamps(). On an unconnected socket this also
+    // reports ICMP errors: the next send fails with ECONNREFUSED (or
+    // EHOSTUNREACH) whatever its destination, and the error queue names the
+    // destination the ICMP was actually about.
+    bool enable_send_errors();
+
     // Send data to endpoint. Returns bytes sent or -1.
     ssize_t send_to(const uint8_t* data, size_t len, const Endpoint& dest);
     ssize_t send_to(const std::vector<uint8_t>& data, const Endpoint& dest);
 
+    // True if the last failed send was local backpressure (EAGAIN/ENOBUFS)
+    // that may succeed on retry, rather than a hard error.
+    static bool last_send_error_transient();
+
+    // True if the last failed send carried an ICMP unreachable report. With
+    // enable_send_errors() that report may belong to an earlier datagram to
+    // another destination; the datagram itself was not sent.
+    static bool last_send_error_unreachable();
+
+    // Wait until the send buffer has room. Returns false on timeout.
+    bool wait_writable(int timeout_ms);
+
     // Receive data. Returns bytes received and source endpoint, or nullopt on timeout/error.
     struct RecvResult {
         std::vector<uint8_t> data;
         Endpoint source;
+        int64_t kernel_rx_us = 0;  // Steady-clock time the kernel received it (0 if unavailable)
     };
     std::optional<RecvResult> recv_from(size_t max_size = 1500);
 
     // Set receive timeout in milliseconds
     bool set_recv_timeout(int ms);
 
+    // Kernel software timestamps (SO_TIMESTAMPING): RX arrival time on every
+    // received datagram and, with tx, TX completion reports on the error
+    // queue. Each report is an error-queue entry charged to the receive
+    // buffer, so a socket sending heavily should leave tx off. Returns false
+    // (and stays a no-op) where the platform lacks support.
+    bool enable_timestamping(bool tx = true);
+    bool timestamping_enabled() const { return rx_stamps_; }
+    bool tx_timestamping_enabled() const { return tx_stamps_ != nullptr; }
+
+    // Appends the enqueue -> wire delay (us) of each send the kernel has
+    // reported since the last call. Destinations named by ICMP errors are
+    // appended to unreachable when given; other entries are discarded.
+    // Returns the number of delays appended.
+    size_t drain_tx_timestamps(std::vector<int64_t>& delays_us,
+                               std::vector<Endpoint>* unreachable = nullptr);
+
     socket_t fd() const { return fd_; }
     bool is_valid() const { return fd_ != INVALID_SOCK; }
 
 private:
+    struct TxStamps;
+
     socket_t fd_ = INVALID_SOCK;
+    std::unique_ptr<TxStamps> tx_stamps_;  // Set once TX timestamping is enabled
+    bool rx_stamps_ = false;
+    int send_flags_ = 0;
+    bool send_errors_ = false;
 };
 
 } // namespace lancast
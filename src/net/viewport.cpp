@@ -0,0 +1,85 @@
+#include "net/viewport.h"
+
+#include <algorithm>
+
+namespace lancast {
+
+ViewportRequest viewport_request(const ViewportPayload& payload) {
+    ViewportRequest request;
+    request.drawable_width = payload.drawable_width;
+    request.drawable_height = payload.drawable_height;
+    request.region = {payload.region_x, payload.region_y, payload.region_width, payload.region_height};
+    return request;
+}
+
+ViewportPayload viewport_payload(const ViewportRequest& request) {
+    ViewportPayload payload;
+    payload.drawable_width = static_cast<uint16_t>(std::min<uint32_t>(request.drawable_width, 65535));
+    payload.drawable_height = static_cast<uint16_t>(std::min<uint32_t>(request.drawable_height, 65535));
+    if (!request.region.full()) {
+        payload.region_x = request.region.x;
+        payload.region_y = request.region.y;
+        payload.region_width = request.region.width;
+        payload.region_height = request.region.height;
+    }
+    return payload;
+}
+
+SourceRegion union_regions(const std::vector<ViewportRequest>& viewports) {
+    if (viewports.empty()) return {};
+
+    uint32_t x0 = 65536, y0 = 65536, x1 = 0, y1 = 0;
+    for (const auto& v : viewports) {
+        if (v.region.full()) return {};
+        x0 = std::min<uint32_t>(x0, v.region.x);
+        y0 = std::min<uint32_t>(y0, v.region.y);
+        x1 = std::max<uint32_t>(x1, v.region.x + v.region.width);
+        y1 = std::max<uint32_t>(y1, v.region.y + v.region.height);
+    }
+
+    x0 -= x0 % VIEWPORT_REGION_GRID;
+    y0 -= y0 % VIEWPORT_REGION_GRID;
+    x1 = std::min<uint32_t>((x1 + VIEWPORT_REGION_GRID - 1) / VIEWPORT_REGION_GRID * VIEWPORT_REGION_GRID, 65536);
+    y1 = std::min<uint32_t>((y1 + VIEWPORT_REGION_GRID - 1) / VIEWPORT_REGION_GRID * VIEWPORT_REGION_GRID, 65536);
+    if (x0 == 0 && y0 == 0 && x1 == 65536 && y1 == 65536) return {};
+
+    // 65536 doesn't fit; region_pixels rounds 65535 up to the source edge
+    return {static_cast<uint16_t>(x0), static_cast<uint16_t>(y0),
+            static_cast<uint16_t>(std::min<uint32_t>(x1 - x0, 65535)),
+            static_cast<uint16_t>(std::min<uint32_t>(y1 - y0, 65535))};
+}
+
+ViewportFormat viewport_format(const std::vector<ViewportRequest>& viewports,
+                               uint32_t source_width, uint32_t source_height,
+                               uint32_t max_width, uint32_t max_height) {
+    ViewportFormat format;
+    format.region = union_regions(viewports);
+    PixelRect rect = region_pixels(format.region, source_width, source_height);
+
+    // Encoded pixels per source pixel each viewer needs, at most 1:1
+    double scale_x = viewports.empty() ? 1.0 : 0.0;
+    double scale_y = scale_x;
+    for (const auto& v : viewports) {
+        if (v.drawable_width == 0 || v.drawable_height == 0) {
+            scale_x = scale_y = 1.0;
+            break;
+        }
+        PixelRect shown = region_pixels(v.region, source_width, source_height);
+        scale_x = std::max(scale_x, static_cast<double>(v.drawable_width) / shown.width);
+        scale_y = std::max(scale_y, static_cast<double>(v.drawable_height) / shown.height);
+    }
+    double width = rect.width * std::min(scale_x, 1.0);
+    double height = rect.height * std::min(scale_y, 1.0);
+
+    double fit = 1.0;
+    if (max_width > 0) fit = std::min(fit, max_width / width);
+    if (max_height > 0) fit = std::min(fit, max_height / height);
+    width *= fit;
+    height *= fit;
+
+    format.width = std::max(static_cast<uint32_t>(width) & ~1u, MIN_VIEWPORT_DIMENSION);
+    format.height = std::max(static_cast<uint32_t>(height) & ~1u, MIN_VIEWPORT_DIMENSION);
+    return format;
+}
+
+} // namespace lancast
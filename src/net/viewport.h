@@ -0,0 +1,55 @@
+#pragma once
+
+#include "net/protocol.h"
+#include "core/types.h"
+#include <cstdint>
+#include <vector>
+
+namespace lancast {
+
+// Viewport-driven streaming.
+//
+// Each viewer reports its drawable size and the part of the source it is
+// zoomed into (VIEWPORT). There is one encoder for all viewers, so the host
+// captures the union of their regions at the smallest size that still gives
+// every viewer one encoded pixel per drawable pixel: a viewer in a small
+// window lowers the resolution, one zoomed into a corner gets that corner
+// at full detail instead of the whole desktop scaled down.
+static constexpr uint32_t MIN_VIEWPORT_DIMENSION = 64;
+
+// Regions are widened to this grid (1/64 of the source) so small pans don't
+// each restart the encoder
+static constexpr uint32_t VIEWPORT_REGION_GRID = 1024;
+
+struct ViewportRequest {
+    uint32_t drawable_width = 0;   // 0 = not reported: wants the full resolution
+    uint32_t drawable_height = 0;
+    SourceRegion region;
+};
+
+ViewportRequest viewport_request(const ViewportPayload& payload);
+ViewportPayload viewport_payload(const ViewportRequest& request);
+
+// What to capture and the size to scale it to
+struct ViewportFormat {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    SourceRegion region;
+
+    bool operator==(const ViewportFormat& o) const {
+        return width == o.width && height == o.height && region == o.region;
+    }
+    bool operator!=(const ViewportFormat& o) const { return !(*this == o); }
+};
+
+// Smallest grid-aligned region covering every viewer's region (full if none)
+SourceRegion union_regions(const std::vector<ViewportRequest>& viewports);
+
+// Capture format for a set of viewers of a source_width x source_height
+// source. Never scales the source up, and shrinks uniformly to fit within
+// max_width x max_height (the operator's configured size).
+ViewportFormat viewport_format(const std::vector<ViewportRequest>& viewports,
+                               uint32_t source_width, uint32_t source_height,
+                               uint32_t max_width, uint32_t max_height);
+
+} // namespace lancast
@@ -0,0 +1,452 @@
+#include "net/xdp_receiver.h"
+#include "core/logger.h"
+
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/if_xdp.h>) && __has_include(<linux/bpf.h>)
+#define LANCAST_HAVE_AF_XDP 1
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <filesystem>
+#endif
+
+#if defined(LANCAST_HAVE_AF_XDP)
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "XdpReceiver";
+
+static constexpr size_t ETH_HEADER = 14;
+static constexpr size_t UDP_HEADER = 8;
+
+bool XdpReceiver::parse_frame(const uint8_t* frame, size_t len, Datagram& out) {
+    if (len < ETH_HEADER + 20 + UDP_HEADER) return false;
+    if (frame[12] != 0x08 || frame[13] != 0x00) return false;  // IPv4 only
+
+    const uint8_t* ip = frame + ETH_HEADER;
+    if ((ip[0] >> 4) != 4) return false;
+    size_t ip_header = static_cast<size_t>(ip[0] & 0x0f) * 4;
+    if (ip_header < 20 || len < ETH_HEADER + ip_header + UDP_HEADER) return false;
+    if (ip[9] != 17) return false;  // UDP
+    if (((ip[6] & 0x3f) | ip[7]) != 0) return false;  // MF set or non-zero offset
+
+    const uint8_t* udp = ip + ip_header;
+    size_t udp_len = (static_cast<size_t>(udp[4]) << 8) | udp[5];
+    size_t available = len - ETH_HEADER - ip_header;
+    if (udp_len < UDP_HEADER || udp_len > available) return false;
+
+    std::memcpy(&out.source_addr, ip + 12, sizeof(out.source_addr));
+    out.source_port = static_cast<uint16_t>((udp[0] << 8) | udp[1]);
+    out.data = udp + UDP_HEADER;
+    out.size = udp_len - UDP_HEADER;
+    return true;
+}
+
+#if defined(LANCAST_HAVE_AF_XDP)
+
+namespace {
+
+constexpr uint32_t FRAME_SIZE = 2048;   // UMEM chunk, holds a full Ethernet frame
+constexpr uint32_t FRAME_COUNT = 4096;  // Per queue: 8 MB of UMEM
+constexpr uint32_t FILL_RING_SIZE = FRAME_COUNT;  // Every idle frame fits
+constexpr uint32_t COMPLETION_RING_SIZE = 64;     // Unused (receive only), but required
+constexpr uint32_t RX_RING_SIZE = 2048;
+
+int sys_bpf(int cmd, bpf_attr& attr) {
+    return static_cast<int>(syscall(__NR_bpf, cmd, &attr, sizeof(attr)));
+}
+
+uint64_t ptr_to_u64(const void* ptr) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr));
+}
+
+bpf_insn insn(uint8_t code, uint8_t dst, uint8_t src, int16_t off, int32_t imm) {
+    bpf_insn i{};
+    i.code = code;
+    i.dst_reg = dst & 0x0f;
+    i.src_reg = src & 0x0f;
+    i.off = off;
+    i.imm = imm;
+    return i;
+}
+
+// XDP program: IPv4 UDP datagrams to `port` (unfragmented, no IP options)
+// go to the AF_XDP socket of the queue they arrived on; everything else,
+// and anything on a queue without a socket, continues to the stack.
+std::vector<bpf_insn> build_redirect_program(int map_fd, uint16_t port) {
+    constexpr uint8_t LDX_W = BPF_LDX | BPF_MEM | BPF_W;
+    constexpr uint8_t LDX_H = BPF_LDX | BPF_MEM | BPF_H;
+    constexpr uint8_t LDX_B = BPF_LDX | BPF_MEM | BPF_B;
+    constexpr uint8_t MOV_X = BPF_ALU64 | BPF_MOV | BPF_X;
+    constexpr uint8_t MOV_K = BPF_ALU64 | BPF_MOV | BPF_K;
+    constexpr uint8_t ADD_K = BPF_ALU64 | BPF_ADD | BPF_K;
+    constexpr uint8_t AND_K = BPF_ALU64 | BPF_AND | BPF_K;
+    constexpr uint8_t JGT_X = BPF_JMP | BPF_JGT | BPF_X;
+    constexpr uint8_t JNE_K = BPF_JMP | BPF_JNE | BPF_K;
+
+    // Packet loads read network byte order into a little- or big-endian
+    // register; compare against the same bytes loaded the same way.
+    auto be16 = [](uint16_t v) { return static_cast<int32_t>(htons(v)); };
+
+    std::vector<bpf_insn> prog;
+    std::vector<size_t> to_pass;  // Jumps to patch to the XDP_PASS exit
+    auto jump_to_pass = [&](bpf_insn i) {
+        to_pass.push_back(prog.size());
+        prog.push_back(i);
+    };
+
+    prog.push_back(insn(MOV_X, 6, 1, 0, 0));                  // r6 = ctx
+    prog.push_back(insn(LDX_W, 2, 6, 0, 0));                  // r2 = ctx->data
+    prog.push_back(insn(LDX_W, 3, 6, 4, 0));                  // r3 = ctx->data_end
+    prog.push_back(insn(MOV_X, 4, 2, 0, 0));
+    prog.push_back(insn(ADD_K, 4, 0, 0, 42));                 // eth + ip + udp
+    jump_to_pass(insn(JGT_X, 4, 3, 0, 0));
+    prog.push_back(insn(LDX_H, 5, 2, 12, 0));                 // ethertype
+    jump_to_pass(insn(JNE_K, 5, 0, 0, be16(0x0800)));
+    prog.push_back(insn(LDX_B, 5, 2, 14, 0));                 // version + IHL
+    jump_to_pass(insn(JNE_K, 5, 0, 0, 0x45));
+    prog.push_back(insn(LDX_B, 5, 2, 23, 0));                 // protocol
+    jump_to_pass(insn(JNE_K, 5, 0, 0, 17));
+    prog.push_back(insn(LDX_H, 5, 2, 20, 0));                 // flags + fragment offset
+    prog.push_back(insn(AND_K, 5, 0, 0, be16(0x3fff)));
+    jump_to_pass(insn(JNE_K, 5, 0, 0, 0));
+    prog.push_back(insn(LDX_H, 5, 2, 36, 0));                 // UDP destination port
+    jump_to_pass(insn(JNE_K, 5, 0, 0, be16(port)));
+    prog.push_back(insn(LDX_W, 2, 6, 16, 0));                 // r2 = ctx->rx_queue_index
+    prog.push_back(insn(BPF_LD | BPF_DW | BPF_IMM, 1, BPF_PSEUDO_MAP_FD, 0, map_fd));
+    prog.push_back(insn(0, 0, 0, 0, 0));                      // Upper half of the map address
+    prog.push_back(insn(MOV_K, 3, 0, 0, XDP_PASS));           // Fallback if the slot is empty
+    prog.push_back(insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map));
+    prog.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    size_t pass = prog.size();
+    prog.push_back(insn(MOV_K, 0, 0, 0, XDP_PASS));
+    prog.push_back(insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0));
+
+    for (size_t at : to_pass) {
+        prog[at].off = static_cast<int16_t>(pass - at - 1);
+    }
+    return prog;
+}
+
+// Queues the interface receives on, from sysfs (1 if it can't be read)
+uint32_t rx_queue_count(const std::string& interface) {
+    std::error_code ec;
+    uint32_t count = 0;
+    std::filesystem::directory_iterator it("/sys/class/net/" + interface + "/queues", ec);
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        if (it->path().filename().string().rfind("rx-", 0) == 0) ++count;
+    }
+    return count > 0 ? count : 1;
+}
+
+// Producer/consumer ring shared with the kernel. Our side's index is only
+// written by us; the other side's is read with acquire, ours published
+// with release.
+struct Ring {
+    uint32_t* producer = nullptr;
+    uint32_t* consumer = nullptr;
+    uint32_t* flags = nullptr;
+    void* entries = nullptr;
+    uint32_t mask = 0;
+    void* map = nullptr;
+    size_t map_len = 0;
+
+    uint32_t load(uint32_t* index) const {
+        return std::atomic_ref<uint32_t>(*index).load(std::memory_order_acquire);
+    }
+    void store(uint32_t* index, uint32_t value) const {
+        std::atomic_ref<uint32_t>(*index).store(value, std::memory_order_release);
+    }
+    bool needs_wakeup() const {
+        return flags && (std::atomic_ref<uint32_t>(*flags).load(std::memory_order_relaxed) & XDP_RING_NEED_WAKEUP);
+    }
+    void unmap() {
+        if (map) munmap(map, map_len);
+        map = nullptr;
+    }
+};
+
+bool map_ring(int fd, const xdp_ring_offset& off, uint64_t pgoff, uint32_t size,
+              size_t entry_size, Ring& ring) {
+    ring.map_len = off.desc + size * entry_size;
+    void* map = mmap(nullptr, ring.map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                     static_cast<off_t>(pgoff));
+    if (map == MAP_FAILED) return false;
+    auto* base = static_cast<uint8_t*>(map);
+    ring.map = map;
+    ring.producer = reinterpret_cast<uint32_t*>(base + off.producer);
+    ring.consumer = reinterpret_cast<uint32_t*>(base + off.consumer);
+    ring.flags = reinterpret_cast<uint32_t*>(base + off.flags);
+    ring.entries = base + off.desc;
+    ring.mask = size - 1;
+    return true;
+}
+
+} // namespace
+
+struct XdpReceiver::Queue {
+    int fd = -1;
+    uint32_t index = 0;
+    uint8_t* umem = nullptr;
+    size_t umem_size = 0;
+    Ring fill;
+    Ring completion;
+    Ring rx;
+
+    ~Queue() {
+        fill.unmap();
+        completion.unmap();
+        rx.unmap();
+        if (fd >= 0) ::close(fd);
+        if (umem) munmap(umem, umem_size);
+    }
+
+    // Socket bound to queue `index`, zero-copy if the driver allows it
+    bool open(int ifindex, bool& zero_copy) {
+        umem_size = static_cast<size_t>(FRAME_SIZE) * FRAME_COUNT;
+        void* mem = mmap(nullptr, umem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            umem = nullptr;
+            LOG_WARN(TAG, "UMEM allocation failed: %s", strerror(errno));
+            return false;
+        }
+        umem = static_cast<uint8_t*>(mem);
+
+        fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            LOG_WARN(TAG, "AF_XDP socket: %s", strerror(errno));
+            return false;
+        }
+
+        xdp_umem_reg reg{};
+        reg.addr = ptr_to_u64(umem);
+        reg.len = umem_size;
+        reg.chunk_size = FRAME_SIZE;
+        reg.headroom = 0;
+        uint32_t fill_size = FILL_RING_SIZE;
+        uint32_t completion_size = COMPLETION_RING_SIZE;
+        uint32_t rx_size = RX_RING_SIZE;
+        if (setsockopt(fd, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0 ||
+            setsockopt(fd, SOL_XDP, XDP_UMEM_FILL_RING, &fill_size, sizeof(fill_size)) != 0 ||
+            setsockopt(fd, SOL_XDP, XDP_UMEM_COMPLETION_RING, &completion_size, sizeof(completion_size)) != 0 ||
+            setsockopt(fd, SOL_XDP, XDP_RX_RING, &rx_size, sizeof(rx_size)) != 0) {
+            LOG_WARN(TAG, "AF_XDP ring setup: %s", strerror(errno));
+            return false;
+        }
+
+        xdp_mmap_offsets off{};
+        socklen_t off_len = sizeof(off);
+        if (getsockopt(fd, SOL_XDP, XDP_MMAP_OFFSETS, &off, &off_len) != 0 ||
+            !map_ring(fd, off.fr, XDP_UMEM_PGOFF_FILL_RING, fill_size, sizeof(uint64_t), fill) ||
+            !map_ring(fd, off.cr, XDP_UMEM_PGOFF_COMPLETION_RING, completion_size, sizeof(uint64_t), completion) ||
+            !map_ring(fd, off.rx, XDP_PGOFF_RX_RING, rx_size, sizeof(xdp_desc), rx)) {
+            LOG_WARN(TAG, "AF_XDP ring mmap: %s", strerror(errno));
+            return false;
+        }
+
+        // Hand every frame to the kernel up front
+        auto* fill_addrs = static_cast<uint64_t*>(fill.entries);
+        for (uint32_t i = 0; i < FRAME_COUNT; ++i) {
+            fill_addrs[i & fill.mask] = static_cast<uint64_t>(i) * FRAME_SIZE;
+        }
+        fill.store(fill.producer, FRAME_COUNT);
+
+        sockaddr_xdp addr{};
+        addr.sxdp_family = AF_XDP;
+        addr.sxdp_ifindex = static_cast<uint32_t>(ifindex);
+        addr.sxdp_queue_id = index;
+        addr.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            zero_copy = true;
+            return true;
+        }
+        addr.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            zero_copy = false;
+            return true;
+        }
+        LOG_WARN(TAG, "AF_XDP bind to queue %u: %s", index, strerror(errno));
+        return false;
+    }
+};
+
+XdpReceiver::XdpReceiver() = default;
+
+XdpReceiver::~XdpReceiver() {
+    close();
+}
+
+bool XdpReceiver::open(const std::string& interface, uint16_t port) {
+    close();
+
+    int ifindex = static_cast<int>(if_nametoindex(interface.c_str()));
+    if (ifindex == 0) {
+        LOG_WARN(TAG, "No interface %s", interface.c_str());
+        return false;
+    }
+    uint32_t queue_count = rx_queue_count(interface);
+
+    bpf_attr attr{};
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(uint32_t);
+    attr.value_size = sizeof(uint32_t);
+    attr.max_entries = queue_count;
+    map_fd_ = sys_bpf(BPF_MAP_CREATE, attr);
+    if (map_fd_ < 0) {
+        LOG_WARN(TAG, "XSKMAP create failed: %s", strerror(errno));
+        close();
+        return false;
+    }
+
+    auto prog = build_redirect_program(map_fd_, port);
+    std::vector<char> verifier_log(16 * 1024);
+    attr = {};
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = ptr_to_u64(prog.data());
+    attr.insn_cnt = static_cast<uint32_t>(prog.size());
+    attr.license = ptr_to_u64("Dual MIT/GPL");
+    attr.log_buf = ptr_to_u64(verifier_log.data());
+    attr.log_size = static_cast<uint32_t>(verifier_log.size());
+    attr.log_level = 1;
+    prog_fd_ = sys_bpf(BPF_PROG_LOAD, attr);
+    if (prog_fd_ < 0) {
+        LOG_WARN(TAG, "XDP program rejected: %s %s", strerror(errno), verifier_log.data());
+        close();
+        return false;
+    }
+
+    for (uint32_t q = 0; q < queue_count; ++q) {
+        auto queue = std::make_unique<Queue>();
+        queue->index = q;
+        bool zero_copy = false;
+        if (!queue->open(ifindex, zero_copy)) {
+            close();
+            return false;
+        }
+        zero_copy_ = q == 0 ? zero_copy : zero_copy_ && zero_copy;
+
+        attr = {};
+        attr.map_fd = static_cast<uint32_t>(map_fd_);
+        attr.key = ptr_to_u64(&queue->index);
+        attr.value = ptr_to_u64(&queue->fd);
+        if (sys_bpf(BPF_MAP_UPDATE_ELEM, attr) != 0) {
+            LOG_WARN(TAG, "XSKMAP insert failed: %s", strerror(errno));
+            close();
+            return false;
+        }
+        queues_.push_back(std::move(queue));
+    }
+
+    // A link detaches the program when its fd closes, including on crash
+    attr = {};
+    attr.link_create.prog_fd = static_cast<uint32_t>(prog_fd_);
+    attr.link_create.target_fd = static_cast<uint32_t>(ifindex);
+    attr.link_create.attach_type = BPF_XDP;
+    link_fd_ = sys_bpf(BPF_LINK_CREATE, attr);
+    if (link_fd_ < 0) {
+        LOG_WARN(TAG, "XDP attach to %s failed: %s", interface.c_str(), strerror(errno));
+        close();
+        return false;
+    }
+
+    LOG_INFO(TAG, "AF_XDP on %s port %u: %u queue(s), %s mode", interface.c_str(), port,
+             queue_count, zero_copy_ ? "zero-copy" : "copy");
+    return true;
+}
+
+void XdpReceiver::close() {
+    if (link_fd_ >= 0) ::close(link_fd_);
+    link_fd_ = -1;
+    queues_.clear();
+    if (prog_fd_ >= 0) ::close(prog_fd_);
+    prog_fd_ = -1;
+    if (map_fd_ >= 0) ::close(map_fd_);
+    map_fd_ = -1;
+    zero_copy_ = false;
+}
+
+size_t XdpReceiver::drain(Queue& queue, const Handler& handler) {
+    uint32_t rx_cons = *queue.rx.consumer;
+    uint32_t available = queue.rx.load(queue.rx.producer) - rx_cons;
+    if (available == 0) return 0;
+
+    // Every frame we hold came off the fill ring, so returning it always fits
+    auto* descs = static_cast<const xdp_desc*>(queue.rx.entries);
+    auto* fill_addrs = static_cast<uint64_t*>(queue.fill.entries);
+    uint32_t fill_prod = *queue.fill.producer;
+    for (uint32_t i = 0; i < available; ++i) {
+        const xdp_desc& desc = descs[(rx_cons + i) & queue.rx.mask];
+        Datagram dgram;
+        if (desc.addr + desc.len <= queue.umem_size && parse_frame(queue.umem + desc.addr, desc.len, dgram)) {
+            handler(dgram);
+        }
+        fill_addrs[(fill_prod + i) & queue.fill.mask] = desc.addr & ~static_cast<uint64_t>(FRAME_SIZE - 1);
+    }
+    queue.rx.store(queue.rx.consumer, rx_cons + available);
+    queue.fill.store(queue.fill.producer, fill_prod + available);
+
+    if (queue.fill.needs_wakeup()) {
+        recvfrom(queue.fd, nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+    }
+    return available;
+}
+
+size_t XdpReceiver::poll(int timeout_ms, const Handler& handler) {
+    size_t handled = 0;
+    for (auto& q : queues_) handled += drain(*q, handler);
+    if (handled > 0 || queues_.empty()) return handled;
+
+    std::vector<pollfd> fds(queues_.size());
+    for (size_t i = 0; i < queues_.size(); ++i) {
+        fds[i].fd = queues_[i]->fd;
+        fds[i].events = POLLIN;
+    }
+    if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), timeout_ms) <= 0) return 0;
+    for (auto& q : queues_) handled += drain(*q, handler);
+    return handled;
+}
+
+#else
+
+struct XdpReceiver::Queue {};
+
+XdpReceiver::XdpReceiver() = default;
+XdpReceiver::~XdpReceiver() = default;
+
+bool XdpReceiver::open(const std::string& interface, uint16_t) {
+    LOG_WARN(TAG, "AF_XDP is not available on this platform, staying on the socket for %s",
+             interface.c_str());
+    return false;
+}
+
+void XdpReceiver::close() {}
+
+size_t XdpReceiver::drain(Queue&, const Handler&) {
+    return 0;
+}
+
+size_t XdpReceiver::poll(int, const Handler&) {
+    return 0;
+}
+
+#endif
+
+} // namespace lancast
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// AF_XDP receive path for one local UDP port (Linux 5.9+, CAP_NET_ADMIN
+// and CAP_BPF or root).
+//
+// A small XDP program on the interface redirects IPv4 UDP datagrams for the
+// port into AF_XDP sockets, one per RX queue; all other traffic continues up
+// the normal stack. Datagrams are handed out as views into the UMEM frame
+// they arrived in, and each frame goes back to the kernel once the callback
+// returns. The payload is never copied on its way to the caller, and there
+// are no per-datagram syscalls. Receive only: sends keep using the UDP
+// socket, which also keeps the port reserved.
+//
+// Zero-copy binding is used where the driver supports it, copy mode
+// otherwise (veth, generic XDP). Everything else is a reason for open()
+// to fail, so the caller stays on its socket.
+class XdpReceiver {
+public:
+    // One received UDP payload, valid only during the callback
+    struct Datagram {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        uint32_t source_addr = 0;  // IPv4, network byte order
+        uint16_t source_port = 0;
+    };
+    using Handler = std::function<void(const Datagram&)>;
+
+    XdpReceiver();
+    ~XdpReceiver();
+
+    XdpReceiver(const XdpReceiver&) = delete;
+    XdpReceiver& operator=(const XdpReceiver&) = delete;
+
+    // Attaches to every RX queue of the interface. Returns false (and logs
+    // why) when AF_XDP can't be used there.
+    bool open(const std::string& interface, uint16_t port);
+    void close();
+    bool is_open() const { return !queues_.empty(); }
+    bool zero_copy() const { return zero_copy_; }
+    size_t queue_count() const { return queues_.size(); }
+
+    // Hands every datagram that has arrived to handler, waiting up to
+    // timeout_ms for the first one. Returns the number handled.
+    size_t poll(int timeout_ms, const Handler& handler);
+
+    // UDP payload of an IPv4 Ethernet frame. False for anything else,
+    // including IP fragments and truncated frames.
+    static bool parse_frame(const uint8_t* frame, size_t len, Datagram& out);
+
+private:
+    struct Queue;
+
+    size_t drain(Queue& queue, const Handler& handler);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    int map_fd_ = -1;
+    int prog_fd_ = -1;
+    int link_fd_ = -1;
+    bool zero_copy_ = false;
+};
+
+} // namespace lancast
@@ -0,0 +1,219 @@
+#include "record/container_writer.h"
+#include "core/logger.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/mathematics.h>
+}
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+
+namespace lancast {
+
+static constexpr const char* TAG = "ContainerWriter";
+static constexpr AVRational MICROSECONDS = {1, 1000000};
+static constexpr uint32_t OPUS_RATE = 48000;  // Opus always decodes at 48 kHz
+static constexpr int OPUS_FRAME_SAMPLES = 960;  // The AudioEncoder's 20 ms frames at OPUS_RATE
+
+static std::string av_error(int err) {
+    char buf[128];
+    av_strerror(err, buf, sizeof(buf));
+    return buf;
+}
+
+static bool set_extradata(AVCodecParameters* par, const std::vector<uint8_t>& data) {
+    if (data.empty()) return true;
+    par->extradata = static_cast<uint8_t*>(av_mallocz(data.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!par->extradata) return false;
+    std::memcpy(par->extradata, data.data(), data.size());
+    par->extradata_size = static_cast<int>(data.size());
+    return true;
+}
+
+// OpusHead (RFC 7845), which MKV and MP4 carry as the track's codec setup.
+// Pre-skip stays 0 because the viewer's decoder doesn't trim the encoder
+// delay either.
+static std::vector<uint8_t> opus_head(uint32_t input_rate, uint16_t channels) {
+    std::vector<uint8_t> head(19, 0);
+    std::memcpy(head.data(), "OpusHead", 8);
+    head[8] = 1;  // Version
+    head[9] = static_cast<uint8_t>(channels);
+    for (int i = 0; i < 4; ++i) head[12 + i] = static_cast<uint8_t>(input_rate >> (8 * i));
+    // Output gain 0, channel mapping family 0 (mono or stereo)
+    return head;
+}
+
+ContainerWriter::~ContainerWriter() {
+    close();
+}
+
+bool ContainerWriter::supports(const std::string& path) {
+    return av_guess_format(nullptr, path.c_str(), nullptr) != nullptr;
+}
+
+std::string ContainerWriter::segment_path(const std::string& path, uint32_t segment) {
+    if (segment <= 1) return path;
+    std::filesystem::path p(path);
+    std::string name = p.stem().string() + "-" + std::to_string(segment) + p.extension().string();
+    return (p.parent_path() / name).string();
+}
+
+bool ContainerWriter::open(const std::string& path, const StreamConfig& config) {
+    close();
+
+    int ret = avformat_alloc_output_context2(&ctx_, nullptr, nullptr, path.c_str());
+    if (ret < 0 || !ctx_) {
+        LOG_ERROR(TAG, "No container format for %s", path.c_str());
+        ctx_ = nullptr;
+        return false;
+    }
+    path_ = path;
+
+    // Cleanup for failures before the header is written (no trailer)
+    auto fail = [this](const char* what, int err) {
+        LOG_ERROR(TAG, "%s for %s: %s", what, path_.c_str(), av_error(err).c_str());
+        if (ctx_->pb && !(ctx_->oformat->flags & AVFMT_NOFILE)) avio_closep(&ctx_->pb);
+        avformat_free_context(ctx_);
+        ctx_ = nullptr;
+        video_index_ = -1;
+        audio_index_ = -1;
+        return false;
+    };
+
+    AVStream* video = avformat_new_stream(ctx_, nullptr);
+    if (!video) return fail("Adding the video track failed", AVERROR(ENOMEM));
+    video->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    video->codecpar->codec_id = AV_CODEC_ID_H264;
+    video->codecpar->width = static_cast<int>(config.width);
+    video->codecpar->height = static_cast<int>(config.height);
+    if (!set_extradata(video->codecpar, config.codec_data)) return fail("SPS/PPS copy failed", AVERROR(ENOMEM));
+    video->time_base = MICROSECONDS;  // A hint; the muxer settles on its own
+    if (config.fps > 0) video->avg_frame_rate = {static_cast<int>(config.fps), 1};
+    video_index_ = video->index;
+
+    if (config.audio_channels > 0) {
+        AVStream* audio = avformat_new_stream(ctx_, nullptr);
+        if (!audio) return fail("Adding the audio track failed", AVERROR(ENOMEM));
+        audio->codecpar->codec_type = AVMEDIA_TYPE_AUDIO;
+        audio->codecpar->codec_id = AV_CODEC_ID_OPUS;
+        audio->codecpar->sample_rate = static_cast<int>(OPUS_RATE);
+        audio->codecpar->frame_size = OPUS_FRAME_SAMPLES;
+        av_channel_layout_default(&audio->codecpar->ch_layout, config.audio_channels);
+        if (!set_extradata(audio->codecpar, opus_head(config.audio_sample_rate, config.audio_channels))) {
+            return fail("OpusHead copy failed", AVERROR(ENOMEM));
+        }
+        audio->time_base = {1, static_cast<int>(OPUS_RATE)};
+        audio_index_ = audio->index;
+    }
+
+    // A track that goes quiet (a host without audio) mustn't make the
+    // interleaver hold the other one back for long
+    ctx_->max_interleave_delta = AV_TIME_BASE / 2;
+
+    if (!(ctx_->oformat->flags & AVFMT_NOFILE)) {
+        ret = avio_open(&ctx_->pb, path.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0) return fail("Opening the file failed", ret);
+    }
+
+    AVDictionary* opts = nullptr;
+    const char* format = ctx_->oformat->name;
+    if (std::strcmp(format, "mp4") == 0 || std::strcmp(format, "mov") == 0) {
+        av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+    ret = avformat_write_header(ctx_, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) return fail("Writing the header failed", ret);
+
+    packet_ = av_packet_alloc();
+    if (!packet_) {
+        close();
+        return false;
+    }
+    started_ = false;
+    last_dts_.fill(std::numeric_limits<int64_t>::min());
+    packets_written_ = 0;
+    bytes_written_ = 0;
+    // Fragmented MP4 needs each packet's duration to close a fragment
+    // without guessing the last one. The header may have changed the
+    // tracks' time bases.
+    durations_.fill(0);
+    if (config.fps > 0) {
+        durations_[static_cast<size_t>(video_index_)] =
+            av_rescale_q(1, {1, static_cast<int>(config.fps)}, ctx_->streams[video_index_]->time_base);
+    }
+    if (audio_index_ >= 0) {
+        durations_[static_cast<size_t>(audio_index_)] = av_rescale_q(
+            OPUS_FRAME_SAMPLES, {1, static_cast<int>(OPUS_RATE)}, ctx_->streams[audio_index_]->time_base);
+    }
+    LOG_INFO(TAG, "Recording to %s (%s, %ux%u%s)", path.c_str(), format, config.width, config.height,
+             audio_index_ >= 0 ? " + Opus" : "");
+    return true;
+}
+
+bool ContainerWriter::write(const EncodedPacket& packet) {
+    if (!ctx_ || packet.data.empty()) return false;
+    bool is_audio = packet.type == FrameType::Audio;
+    int index = is_audio ? audio_index_ : video_index_;
+    if (index < 0) return false;
+
+    // Extend the capture time against the newest one seen so far
+    int64_t pts_us = packet.pts_us;
+    if (!started_) {
+        started_ = true;
+        origin_us_ = pts_us;
+        last_pts_us_ = pts_us;
+    } else {
+        auto delta = static_cast<int32_t>(static_cast<uint32_t>(packet.pts_us) -
+                                          static_cast<uint32_t>(last_pts_us_));
+        pts_us = last_pts_us_ + delta;
+        if (delta > 0) last_pts_us_ = pts_us;
+    }
+    if (pts_us < origin_us_) return false;
+
+    AVStream* stream = ctx_->streams[index];
+    int64_t ts = av_rescale_q(pts_us - origin_us_, MICROSECONDS, stream->time_base);
+    // Muxers need strictly increasing timestamps per track; a rounding
+    // collision or a capture clock step back only nudges this one
+    auto& last = last_dts_[static_cast<size_t>(index)];
+    if (ts <= last) ts = last + 1;
+    last = ts;
+
+    // Not reference counted: the muxer copies what it has to hold on to
+    packet_->data = const_cast<uint8_t*>(packet.data.data());
+    packet_->size = static_cast<int>(packet.data.size());
+    packet_->stream_index = index;
+    packet_->pts = ts;
+    packet_->dts = ts;
+    packet_->duration = durations_[static_cast<size_t>(index)];
+    packet_->flags = (is_audio || packet.type == FrameType::VideoKeyframe) ? AV_PKT_FLAG_KEY : 0;
+    int ret = av_interleaved_write_frame(ctx_, packet_);
+    if (ret < 0) {
+        LOG_WARN(TAG, "Write to %s failed: %s", path_.c_str(), av_error(ret).c_str());
+        return false;
+    }
+    packets_written_++;
+    bytes_written_ += packet.data.size();
+    return true;
+}
+
+void ContainerWriter::close() {
+    if (ctx_) {
+        int ret = av_write_trailer(ctx_);
+        if (ret < 0) LOG_WARN(TAG, "Finishing %s failed: %s", path_.c_str(), av_error(ret).c_str());
+        if (!(ctx_->oformat->flags & AVFMT_NOFILE)) avio_closep(&ctx_->pb);
+        avformat_free_context(ctx_);
+        ctx_ = nullptr;
+        LOG_INFO(TAG, "Closed %s: %llu packets, %llu bytes", path_.c_str(),
+                 static_cast<unsigned long long>(packets_written_),
+                 static_cast<unsigned long long>(bytes_written_));
+    }
+    av_packet_free(&packet_);
+    video_index_ = -1;
+    audio_index_ = -1;
+}
+
+} // namespace lancast
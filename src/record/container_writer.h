@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/types.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+struct AVFormatContext;
+struct AVPacket;
+
+namespace lancast {
+
+// Remuxes encoded H.264 video and Opus audio into a container file with
+// libavformat; nothing is decoded or re-encoded. The format follows the
+// file extension (.mkv, .mp4, .mov, ...). MP4/MOV are written fragmented,
+// so a file cut short by a crash still plays up to its last keyframe.
+//
+// Timestamps are the packets' capture times, so gaps from lost frames stay
+// gaps instead of shifting everything after them. They are taken modulo
+// 2^32 us and extended against the previous packet, which also covers the
+// 32-bit timestamps a viewer receives (they wrap every ~71 minutes). The
+// first packet written is time zero; it should be a video keyframe.
+class ContainerWriter {
+public:
+    ContainerWriter() = default;
+    ~ContainerWriter();
+
+    ContainerWriter(const ContainerWriter&) = delete;
+    ContainerWriter& operator=(const ContainerWriter&) = delete;
+
+    // Video track from config (size, frame rate, Annex B SPS/PPS); an Opus
+    // track too if config.audio_channels > 0
+    bool open(const std::string& path, const StreamConfig& config);
+    // Writes to the video or audio track by packet type. Packets from
+    // before the first one written are dropped.
+    bool write(const EncodedPacket& packet);
+    // Writes the trailer and closes the file
+    void close();
+
+    bool is_open() const { return ctx_ != nullptr; }
+    bool has_audio() const { return audio_index_ >= 0; }
+    const std::string& path() const { return path_; }
+    uint64_t packets_written() const { return packets_written_; }
+    uint64_t bytes_written() const { return bytes_written_; }
+
+    // True if the muxer understands this file name's extension
+    static bool supports(const std::string& path);
+    // Name for the n-th file of a recording split where the stream changed:
+    // path itself for the first, then <stem>-2<ext>, <stem>-3<ext>, ...
+    static std::string segment_path(const std::string& path, uint32_t segment);
+
+private:
+    AVFormatContext* ctx_ = nullptr;
+    AVPacket* packet_ = nullptr;
+    std::string path_;
+    int video_index_ = -1;
+    int audio_index_ = -1;
+
+    bool started_ = false;
+    int64_t last_pts_us_ = 0;      // Extended timestamp of the previous packet
+    int64_t origin_us_ = 0;        // Extended timestamp written as zero
+    std::array<int64_t, 2> last_dts_{};  // Per track, in the track's time base
+    std::array<int64_t, 2> durations_{};  // Per track, one packet's length in its time base
+    uint64_t packets_written_ = 0;
+    uint64_t bytes_written_ = 0;
+};
+
+} // namespace lancast
@@ -0,0 +1,152 @@
+#include "record/media_recorder.h"
+#include "core/logger.h"
+#include "core/trace.h"
+
+namespace lancast {
+
+static constexpr const char* TAG = "MediaRecorder";
+
+MediaRecorder::~MediaRecorder() {
+    stop();
+}
+
+bool MediaRecorder::start(const std::string& path, uint32_t audio_sample_rate, uint16_t audio_channels) {
+    stop();
+    if (!ContainerWriter::supports(path)) {
+        LOG_ERROR(TAG, "Unknown container for %s (use .mkv or .mp4)", path.c_str());
+        return false;
+    }
+    path_ = path;
+    audio_sample_rate_ = audio_sample_rate;
+    audio_channels_ = audio_channels;
+    config_.reset();
+    segment_config_.reset();
+    seen_dropped_ = queue_.dropped();
+    need_keyframe_ = true;
+    failed_ = false;
+    packets_written_ = 0;
+    bytes_written_ = 0;
+    packets_skipped_ = 0;
+    segments_ = 0;
+
+    recording_ = true;
+    writer_thread_ = lancast::jthread([this](lancast::stop_token st) { writer_loop(st); });
+    LOG_INFO(TAG, "Recording to %s from the next keyframe", path.c_str());
+    return true;
+}
+
+void MediaRecorder::stop() {
+    if (!writer_thread_.joinable()) return;
+    recording_ = false;
+    writer_thread_.request_stop();
+    writer_thread_.join();
+
+    // The writer thread is gone; finish what it left behind here
+    while (auto item = queue_.try_pop()) write(*item);
+    writer_.close();
+
+    auto s = stats();
+    LOG_INFO(TAG, "Recording stopped: %u segment(s), %llu packets, %.1f MB, %llu dropped",
+             s.segments, static_cast<unsigned long long>(s.packets_written), s.bytes_written / 1e6,
+             static_cast<unsigned long long>(s.packets_dropped));
+}
+
+void MediaRecorder::add_video(EncodedPacket packet, const StreamConfig& config, uint32_t generation) {
+    if (!is_recording()) return;
+    if (!config_ || generation != generation_) {
+        config_ = std::make_shared<const StreamConfig>(config);
+        generation_ = generation;
+    }
+    queue_.push(Item{std::move(packet), config_});
+}
+
+void MediaRecorder::add_audio(EncodedPacket packet) {
+    if (!is_recording() || audio_channels_ == 0) return;
+    queue_.push(Item{std::move(packet), nullptr});
+}
+
+MediaRecorder::Stats MediaRecorder::stats() const {
+    Stats s;
+    s.packets_written = packets_written_.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    s.packets_dropped = queue_.dropped() + packets_skipped_.load(std::memory_order_relaxed);
+    s.segments = segments_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void MediaRecorder::writer_loop(lancast::stop_token st) {
+    Tracer::set_thread_name("recorder");
+    while (!st.stop_requested()) {
+        auto item = queue_.wait_pop(std::chrono::milliseconds(50));
+        if (item) write(*item);
+    }
+}
+
+void MediaRecorder::write(Item& item) {
+    const EncodedPacket& packet = item.packet;
+    if (failed_) return;
+
+    if (packet.type == FrameType::Audio) {
+        if (!writer_.is_open()) return;  // Nothing before the first keyframe
+        if (writer_.write(packet)) {
+            packets_written_.fetch_add(1, std::memory_order_relaxed);
+            bytes_written_.fetch_add(packet.data.size(), std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    // Frames shed by the queue leave the next P-frames without a reference
+    uint64_t dropped = queue_.dropped();
+    if (dropped != seen_dropped_) {
+        if (writer_.is_open() && !need_keyframe_) {
+            LOG_WARN(TAG, "Writer fell behind (%llu packets shed); video resumes at the next keyframe",
+                     static_cast<unsigned long long>(dropped - seen_dropped_));
+        }
+        seen_dropped_ = dropped;
+        need_keyframe_ = true;
+    }
+
+    if (packet.type == FrameType::VideoKeyframe) {
+        const StreamConfig& config = *item.config;
+        bool same_stream = segment_config_ && config.width == segment_config_->width &&
+                           config.height == segment_config_->height &&
+                           config.codec_data == segment_config_->codec_data;
+        if (!writer_.is_open() || !same_stream) {
+            if (!open_segment(item.config)) return;
+        }
+        need_keyframe_ = false;
+    } else if (need_keyframe_) {
+        packets_skipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (writer_.write(packet)) {
+        packets_written_.fetch_add(1, std::memory_order_relaxed);
+        bytes_written_.fetch_add(packet.data.size(), std::memory_order_relaxed);
+    }
+}
+
+bool MediaRecorder::open_segment(const std::shared_ptr<const StreamConfig>& config) {
+    writer_.close();
+
+    StreamConfig container = *config;
+    container.audio_sample_rate = audio_sample_rate_;
+    container.audio_channels = audio_channels_;
+    uint32_t segment = segments_.load(std::memory_order_relaxed) + 1;
+    std::string path = ContainerWriter::segment_path(path_, segment);
+    if (!writer_.open(path, container)) {
+        // Most likely the disk or directory; retrying every keyframe won't help
+        LOG_ERROR(TAG, "Recording stopped: could not open %s", path.c_str());
+        recording_ = false;
+        failed_ = true;
+        return false;
+    }
+    if (segment > 1) {
+        LOG_INFO(TAG, "Stream changed to %ux%u; continuing in %s", config->width, config->height, path.c_str());
+    }
+    segment_config_ = config;
+    segments_.store(segment, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace lancast
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/jthread.h"
+#include "core/thread_safe_queue.h"
+#include "core/types.h"
+#include "record/container_writer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lancast {
+
+// Saves a viewer's stream as it arrives, without re-encoding. The decode
+// threads hand over each packet after decoding it; a writer thread remuxes
+// them through ContainerWriter, so a slow disk never holds up playback.
+//
+// Recording begins at the first video keyframe. A keyframe with a new size
+// or SPS/PPS (the host switched source or resolution) closes the file and
+// continues in <stem>-2<ext>, <stem>-3<ext>, ..., since an H.264 track can't
+// change its parameter sets midway. If the writer falls behind, the queue
+// sheds the oldest packets and video resumes at the next keyframe.
+class MediaRecorder {
+public:
+    struct Stats {
+        uint64_t packets_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t packets_dropped = 0;  // Shed by the queue or waiting for a keyframe
+        uint32_t segments = 0;
+    };
+
+    MediaRecorder() = default;
+    ~MediaRecorder();
+
+    MediaRecorder(const MediaRecorder&) = delete;
+    MediaRecorder& operator=(const MediaRecorder&) = delete;
+
+    // audio_channels 0 records video only
+    bool start(const std::string& path, uint32_t audio_sample_rate, uint16_t audio_channels);
+    // Drains what's queued and finishes the file
+    void stop();
+    bool is_recording() const { return recording_.load(std::memory_order_relaxed); }
+
+    // config/generation: what the packet was encoded with (the viewer's
+    // decoder config); only copied when the generation changes
+    void add_video(EncodedPacket packet, const StreamConfig& config, uint32_t generation);
+    void add_audio(EncodedPacket packet);
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 512;  // Several seconds of video plus audio
+
+    struct Item {
+        EncodedPacket packet;
+        std::shared_ptr<const StreamConfig> config;  // Video only
+    };
+
+    void writer_loop(lancast::stop_token st);
+    void write(Item& item);
+    bool open_segment(const std::shared_ptr<const StreamConfig>& config);
+
+    std::string path_;
+    uint32_t audio_sample_rate_ = 48000;
+    uint16_t audio_channels_ = 0;
+    std::atomic<bool> recording_{false};
+    ThreadSafeQueue<Item> queue_{QUEUE_CAPACITY};
+    lancast::jthread writer_thread_;
+
+    // Video decode thread only
+    uint32_t generation_ = 0;
+    std::shared_ptr<const StreamConfig> config_;
+
+    // Writer thread only
+    ContainerWriter writer_;
+    std::shared_ptr<const StreamConfig> segment_config_;
+    uint64_t seen_dropped_ = 0;
+    bool need_keyframe_ = true;
+    bool failed_ = false;
+
+    std::atomic<uint64_t> packets_written_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> packets_skipped_{0};
+    std::atomic<uint32_t> segments_{0};
+};
+
+} // namespace lancast
@@ -0,0 +1,188 @@
+#include "record/replay_buffer.h"
+#include "record/container_writer.h"
+#include "core/logger.h"
+#include "core/trace.h"
+
+#include <algorithm>
+
+namespace lancast {
+
+static constexpr const char* TAG = "ReplayBuffer";
+static constexpr size_t AUDIO_BYTES_PER_SECOND = 32'000;  // Opus at up to 256 kbps
+static constexpr size_t MIN_CAPACITY = 8u << 20;
+
+ReplayBuffer::~ReplayBuffer() {
+    stop();
+}
+
+size_t ReplayBuffer::capacity_for(std::chrono::seconds span, uint32_t video_bitrate) {
+    // Twice the target covers keyframes and the encoder running over it
+    size_t per_second = static_cast<size_t>(video_bitrate) / 8 * 2 + AUDIO_BYTES_PER_SECOND;
+    return std::max(MIN_CAPACITY, per_second * static_cast<size_t>(span.count()));
+}
+
+bool ReplayBuffer::start(size_t capacity, uint32_t audio_sample_rate, uint16_t audio_channels) {
+    stop();
+    if (!ring_.open(capacity)) return false;
+    audio_sample_rate_ = audio_sample_rate;
+    audio_channels_ = audio_channels;
+    seen_dropped_ = queue_.dropped();
+    need_keyframe_ = true;
+    packets_skipped_ = 0;
+
+    running_ = true;
+    writer_thread_ = lancast::jthread([this](lancast::stop_token st) { writer_loop(st); });
+    LOG_INFO(TAG, "Keeping the last %.0f MB of video%s for replay", capacity / 1e6,
+             audio_channels > 0 ? " and audio" : "");
+    return true;
+}
+
+void ReplayBuffer::stop() {
+    if (!writer_thread_.joinable()) return;
+    running_ = false;
+    writer_thread_.request_stop();
+    writer_thread_.join();
+    while (queue_.try_pop()) {}
+
+    std::lock_guard lock(save_mutex_);
+    ring_.close();
+    config_.reset();
+}
+
+void ReplayBuffer::set_video_config(const StreamConfig& config) {
+    config_ = std::make_shared<const StreamConfig>(config);
+}
+
+void ReplayBuffer::add_video(const EncodedPacket& packet) {
+    if (!is_running() || !config_) return;
+    queue_.push(Item{packet, config_});
+}
+
+void ReplayBuffer::add_audio(const EncodedPacket& packet) {
+    if (!is_running() || audio_channels_ == 0) return;
+    queue_.push(Item{packet, nullptr});
+}
+
+void ReplayBuffer::writer_loop(lancast::stop_token st) {
+    Tracer::set_thread_name("replay");
+    while (!st.stop_requested()) {
+        auto item = queue_.wait_pop(std::chrono::milliseconds(50));
+        if (item) store(*item);
+    }
+}
+
+void ReplayBuffer::store(const Item& item) {
+    const EncodedPacket& packet = item.packet;
+    if (packet.type == FrameType::Audio) {
+        ring_.append(packet);
+        return;
+    }
+
+    // A shed frame leaves the P-frames after it without a reference, so
+    // the ring only takes video again from the next keyframe
+    uint64_t dropped = queue_.dropped();
+    if (dropped != seen_dropped_) {
+        seen_dropped_ = dropped;
+        need_keyframe_ = true;
+    }
+    if (packet.type == FrameType::VideoKeyframe) {
+        need_keyframe_ = !ring_.append(packet, item.config.get());
+    } else if (need_keyframe_) {
+        packets_skipped_.fetch_add(1, std::memory_order_relaxed);
+    } else if (!ring_.append(packet)) {
+        need_keyframe_ = true;
+    }
+}
+
+ReplayBuffer::SaveResult ReplayBuffer::save(const std::string& path, std::chrono::seconds span) {
+    std::lock_guard lock(save_mutex_);
+    SaveResult result;
+    if (!ring_.is_open()) {
+        result.error = "replay buffer not running";
+        return result;
+    }
+    if (!ContainerWriter::supports(path)) {
+        result.error = "unknown container for " + path + " (use .mkv or .mp4)";
+        return result;
+    }
+
+    // Whatever arrives from here on is left for the next save
+    uint64_t end = ring_.end();
+    auto start = ring_.find_start(span);
+    if (!start) {
+        result.error = "no keyframe buffered yet";
+        return result;
+    }
+
+    ContainerWriter writer;
+    std::optional<StreamConfig> segment_config;
+    ReplayRing::Frame frame;
+    int64_t first_pts_us = 0;
+    int64_t last_pts_us = 0;
+    for (uint64_t i = *start; i < end; ++i) {
+        if (!ring_.read(i, frame)) {
+            if (writer.is_open()) {
+                LOG_WARN(TAG, "Overwritten while saving; %s ends early", writer.path().c_str());
+                break;
+            }
+            // The ring overtook the start before anything was written
+            start = ring_.find_start(span);
+            if (!start || *start >= end) break;
+            i = *start - 1;
+            continue;
+        }
+
+        if (frame.config) {
+            const StreamConfig& config = *frame.config;
+            bool same_stream = segment_config && config.width == segment_config->width &&
+                               config.height == segment_config->height &&
+                               config.codec_data == segment_config->codec_data;
+            if (!writer.is_open() || !same_stream) {
+                writer.close();
+                StreamConfig container = config;
+                container.audio_sample_rate = audio_sample_rate_;
+                container.audio_channels = audio_channels_;
+                std::string file = ContainerWriter::segment_path(path, static_cast<uint32_t>(result.files.size() + 1));
+                if (!writer.open(file, container)) {
+                    result.error = "could not write " + file;
+                    return result;
+                }
+                result.files.push_back(file);
+                segment_config = std::move(frame.config);
+            }
+        } else if (!writer.is_open()) {
+            continue;
+        }
+
+        if (!writer.write(frame.packet)) continue;
+        result.packets++;
+        result.bytes += frame.packet.data.size();
+        if (frame.packet.type != FrameType::Audio) {
+            if (result.packets == 1) first_pts_us = frame.packet.pts_us;
+            last_pts_us = frame.packet.pts_us;
+        }
+    }
+    writer.close();
+
+    if (result.files.empty()) {
+        result.error = "no keyframe buffered yet";
+        return result;
+    }
+    result.ok = true;
+    result.seconds = (last_pts_us - first_pts_us) / 1e6;
+    LOG_INFO(TAG, "Saved %.1f s of replay to %s%s (%llu packets, %.1f MB)", result.seconds,
+             result.files.front().c_str(), result.files.size() > 1 ? " and following" : "",
+             static_cast<unsigned long long>(result.packets), result.bytes / 1e6);
+    return result;
+}
+
+ReplayBuffer::Stats ReplayBuffer::stats() const {
+    Stats s;
+    s.capacity = ring_.capacity();
+    s.bytes_used = ring_.bytes_used();
+    s.seconds = std::chrono::duration<double>(ring_.span()).count();
+    s.packets_dropped = queue_.dropped() + packets_skipped_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace lancast
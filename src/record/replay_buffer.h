@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/jthread.h"
+#include "core/thread_safe_queue.h"
+#include "core/types.h"
+#include "record/replay_ring.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lancast {
+
+// Instant replay for the host: the last stretch of the primary stream's
+// video and the audio, kept in a ReplayRing and saved to a file on request.
+//
+// The encode threads only copy each packet into a short queue, which
+// never waits (the oldest is dropped if the ring falls behind), and the
+// "replay" thread writes it into the ring. Memory is bounded by the ring's
+// mapping plus that queue. Disk traffic is the mapping's writeback, at
+// most the stream's own bitrate. save() remuxes with ContainerWriter from
+// the keyframe nearest the requested span, one packet at a time, while the
+// ring keeps filling.
+class ReplayBuffer {
+public:
+    struct SaveResult {
+        bool ok = false;
+        std::string error;
+        std::vector<std::string> files;  // One per size or SPS/PPS the stretch went through
+        double seconds = 0.0;            // Video time saved
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+    };
+
+    struct Stats {
+        size_t capacity = 0;
+        size_t bytes_used = 0;
+        double seconds = 0.0;            // How far back a save can reach
+        uint64_t packets_dropped = 0;    // Shed by the queue or waiting for a keyframe
+    };
+
+    ReplayBuffer() = default;
+    ~ReplayBuffer();
+
+    ReplayBuffer(const ReplayBuffer&) = delete;
+    ReplayBuffer& operator=(const ReplayBuffer&) = delete;
+
+    // Ring size for `span` of video at this bitrate plus Opus audio, with
+    // room for keyframes and bitrate overshoot
+    static size_t capacity_for(std::chrono::seconds span, uint32_t video_bitrate);
+
+    // audio_channels 0 keeps video only
+    bool start(size_t capacity, uint32_t audio_sample_rate, uint16_t audio_channels);
+    void stop();
+    bool is_running() const { return running_.load(std::memory_order_relaxed); }
+
+    // What the video packets from here on were encoded with; call from the
+    // thread that adds video
+    void set_video_config(const StreamConfig& config);
+    // Copy the packet; never block
+    void add_video(const EncodedPacket& packet);
+    void add_audio(const EncodedPacket& packet);
+
+    // Writes the last `span` (less if less is buffered) to path, .mkv or
+    // .mp4, starting at a keyframe. One save runs at a time.
+    SaveResult save(const std::string& path, std::chrono::seconds span);
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 64;  // About a second of video plus audio
+
+    struct Item {
+        EncodedPacket packet;
+        std::shared_ptr<const StreamConfig> config;  // Video only
+    };
+
+    void writer_loop(lancast::stop_token st);
+    void store(const Item& item);
+
+    ReplayRing ring_;
+    uint32_t audio_sample_rate_ = 48000;
+    uint16_t audio_channels_ = 0;
+    std::atomic<bool> running_{false};
+    ThreadSafeQueue<Item> queue_{QUEUE_CAPACITY};
+    lancast::jthread writer_thread_;
+    std::mutex save_mutex_;
+
+    // Video encode thread only
+    std::shared_ptr<const StreamConfig> config_;
+
+    // Writer thread only
+    uint64_t seen_dropped_ = 0;
+    bool need_keyframe_ = true;
+    std::atomic<uint64_t> packets_skipped_{0};
+};
+
+} // namespace lancast
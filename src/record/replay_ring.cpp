@@ -0,0 +1,219 @@
+#include "record/replay_ring.h"
+#include "core/logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "ReplayRing";
+
+ReplayRing::~ReplayRing() {
+    close();
+}
+
+bool ReplayRing::open(size_t capacity) {
+    close();
+    if (capacity == 0) return false;
+    std::lock_guard lock(mutex_);
+
+#if defined(_WIN32)
+    // Backed by the paging file: Windows won't let an open mapping's file be deleted
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(static_cast<uint64_t>(capacity) >> 32),
+                                        static_cast<DWORD>(capacity), nullptr);
+    if (!mapping) {
+        LOG_ERROR(TAG, "CreateFileMapping(%zu bytes) failed: %lu", capacity, GetLastError());
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, capacity);
+    if (!view) {
+        LOG_ERROR(TAG, "MapViewOfFile(%zu bytes) failed: %lu", capacity, GetLastError());
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = static_cast<uint8_t*>(view);
+#else
+    std::error_code ec;
+    std::string path = (std::filesystem::temp_directory_path(ec) / "lancast-replay-XXXXXX").string();
+    int fd = mkstemp(path.data());
+    if (fd < 0) {
+        LOG_ERROR(TAG, "Creating %s failed: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    unlink(path.c_str());
+#if defined(__linux__)
+    // Reserve the blocks now: running out of disk later would be a SIGBUS
+    // in the middle of a write
+    int err = posix_fallocate(fd, 0, static_cast<off_t>(capacity));
+#else
+    int err = ftruncate(fd, static_cast<off_t>(capacity)) == 0 ? 0 : errno;
+#endif
+    if (err != 0) {
+        LOG_ERROR(TAG, "Sizing the ring to %zu bytes failed: %s", capacity, strerror(err));
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(TAG, "mmap(%zu bytes) failed: %s", capacity, strerror(errno));
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(map);
+#endif
+
+    capacity_ = capacity;
+    head_ = 0;
+    entries_.clear();
+    keyframes_.clear();
+    first_index_ = 0;
+    bytes_used_ = 0;
+    newest_video_pts_us_ = 0;
+    return true;
+}
+
+void ReplayRing::close() {
+    std::lock_guard lock(mutex_);
+    if (!data_) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    mapping_ = nullptr;
+#else
+    munmap(data_, capacity_);
+#endif
+    data_ = nullptr;
+    capacity_ = 0;
+    first_index_ += entries_.size();
+    entries_.clear();
+    keyframes_.clear();
+    bytes_used_ = 0;
+}
+
+bool ReplayRing::is_open() const {
+    std::lock_guard lock(mutex_);
+    return data_ != nullptr;
+}
+
+void ReplayRing::evict_front() {
+    const Entry& e = entries_.front();
+    if (!keyframes_.empty() && keyframes_.front() == first_index_) keyframes_.pop_front();
+    bytes_used_ -= e.config_size + e.size;
+    entries_.pop_front();
+    first_index_++;
+}
+
+bool ReplayRing::append(const EncodedPacket& packet, const StreamConfig* config) {
+    bool keyframe = packet.type == FrameType::VideoKeyframe;
+    if (keyframe && !config) return false;
+    size_t config_size = keyframe ? config->codec_data.size() : 0;
+    size_t total = config_size + packet.data.size();
+
+    std::lock_guard lock(mutex_);
+    if (!data_ || packet.data.empty() || total > capacity_) return false;
+
+    // Packets are never split: one that doesn't fit before the end goes to
+    // the start, and whatever is left in the tail goes with the lap it
+    // belonged to
+    if (head_ + total > capacity_) {
+        while (!entries_.empty() && entries_.front().offset >= head_) evict_front();
+        head_ = 0;
+    }
+    uint64_t end = head_ + total;
+    while (!entries_.empty() && entries_.front().offset < end &&
+           entries_.front().offset + entries_.front().config_size + entries_.front().size > head_) {
+        evict_front();
+    }
+
+    Entry e;
+    e.offset = head_;
+    e.config_size = static_cast<uint32_t>(config_size);
+    e.size = static_cast<uint32_t>(packet.data.size());
+    e.type = packet.type;
+    e.stream_id = packet.stream_id;
+    e.frame_id = packet.frame_id;
+    e.pts_us = packet.pts_us;
+    if (keyframe) {
+        e.width = config->width;
+        e.height = config->height;
+        e.fps = config->fps;
+        std::memcpy(data_ + head_, config->codec_data.data(), config_size);
+    }
+    std::memcpy(data_ + head_ + config_size, packet.data.data(), packet.data.size());
+
+    entries_.push_back(e);
+    if (keyframe) keyframes_.push_back(first_index_ + entries_.size() - 1);
+    if (packet.type != FrameType::Audio) newest_video_pts_us_ = packet.pts_us;
+    bytes_used_ += total;
+    head_ = end;
+    return true;
+}
+
+std::optional<uint64_t> ReplayRing::find_start(std::chrono::microseconds span) const {
+    std::lock_guard lock(mutex_);
+    if (keyframes_.empty()) return std::nullopt;
+    int64_t from_us = newest_video_pts_us_ - span.count();
+    uint64_t start = keyframes_.front();
+    for (uint64_t k : keyframes_) {
+        if (entries_[k - first_index_].pts_us > from_us) break;
+        start = k;
+    }
+    return start;
+}
+
+bool ReplayRing::read(uint64_t index, Frame& out) const {
+    std::lock_guard lock(mutex_);
+    if (index < first_index_ || index - first_index_ >= entries_.size()) return false;
+    const Entry& e = entries_[index - first_index_];
+
+    out.packet.type = e.type;
+    out.packet.stream_id = e.stream_id;
+    out.packet.frame_id = e.frame_id;
+    out.packet.pts_us = e.pts_us;
+    out.packet.data.assign(data_ + e.offset + e.config_size, data_ + e.offset + e.config_size + e.size);
+    out.config.reset();
+    if (e.type == FrameType::VideoKeyframe) {
+        StreamConfig config;
+        config.width = e.width;
+        config.height = e.height;
+        config.fps = e.fps;
+        config.codec_data.assign(data_ + e.offset, data_ + e.offset + e.config_size);
+        out.config = std::move(config);
+    }
+    return true;
+}
+
+uint64_t ReplayRing::end() const {
+    std::lock_guard lock(mutex_);
+    return first_index_ + entries_.size();
+}
+
+size_t ReplayRing::bytes_used() const {
+    std::lock_guard lock(mutex_);
+    return bytes_used_;
+}
+
+size_t ReplayRing::packet_count() const {
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+}
+
+std::chrono::microseconds ReplayRing::span() const {
+    std::lock_guard lock(mutex_);
+    if (keyframes_.empty()) return std::chrono::microseconds(0);
+    return std::chrono::microseconds(newest_video_pts_us_ - entries_[keyframes_.front() - first_index_].pts_us);
+}
+
+} // namespace lancast
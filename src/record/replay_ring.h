@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/types.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+namespace lancast {
+
+// Fixed-size circular store for encoded packets, backed by a memory-mapped
+// file so the kernel can page it out instead of it counting as heap. The
+// file is unlinked as soon as it's mapped, so nothing is left behind.
+//
+// Packets are copied in back to back; the newest overwrites the oldest.
+// An index in memory keeps each packet's place and metadata, plus the
+// keyframes an export can start from. Keyframes carry their SPS/PPS and
+// size, so any one of them opens a playable file. Thread-safe; every call
+// holds the lock for at most one packet copy.
+class ReplayRing {
+public:
+    struct Frame {
+        EncodedPacket packet;
+        std::optional<StreamConfig> config;  // Keyframes
+    };
+
+    ReplayRing() = default;
+    ~ReplayRing();
+
+    ReplayRing(const ReplayRing&) = delete;
+    ReplayRing& operator=(const ReplayRing&) = delete;
+
+    bool open(size_t capacity);
+    void close();
+    bool is_open() const;
+
+    // Copies the packet in. Keyframes need config (for its size, frame rate
+    // and SPS/PPS). False if it could never fit.
+    bool append(const EncodedPacket& packet, const StreamConfig* config = nullptr);
+
+    // Keyframe to export the last `span` from: the newest one at least
+    // that far back, or the oldest one held. Indexes are sequence numbers
+    // that keep counting across overwrites.
+    std::optional<uint64_t> find_start(std::chrono::microseconds span) const;
+    // Copies out packet `index`; false once it's been overwritten or if it
+    // hasn't been written yet
+    bool read(uint64_t index, Frame& out) const;
+    // One past the newest packet
+    uint64_t end() const;
+
+    size_t capacity() const { return capacity_; }
+    size_t bytes_used() const;
+    size_t packet_count() const;
+    // Video time from the oldest keyframe to the newest frame: how far
+    // back an export can reach
+    std::chrono::microseconds span() const;
+
+private:
+    struct Entry {
+        uint64_t offset = 0;
+        uint32_t config_size = 0;  // SPS/PPS bytes ahead of the packet
+        uint32_t size = 0;         // Packet bytes
+        FrameType type = FrameType::VideoPFrame;
+        uint8_t stream_id = 0;
+        uint16_t frame_id = 0;
+        int64_t pts_us = 0;
+        uint32_t width = 0;        // Keyframes
+        uint32_t height = 0;
+        uint32_t fps = 0;
+    };
+
+    void evict_front();
+
+    mutable std::mutex mutex_;
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+#if defined(_WIN32)
+    void* mapping_ = nullptr;
+#endif
+
+    uint64_t head_ = 0;             // Where the next packet goes
+    std::deque<Entry> entries_;     // Oldest first
+    uint64_t first_index_ = 0;      // Sequence number of entries_.front()
+    std::deque<uint64_t> keyframes_;
+    size_t bytes_used_ = 0;
+    int64_t newest_video_pts_us_ = 0;
+};
+
+} // namespace lancast
@@ -0,0 +1,424 @@
+#include "render/frame_share.h"
+#include "core/logger.h"
+#include "core/trace.h"
+
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace lancast {
+
+static constexpr const char* TAG = "FrameShare";
+static constexpr size_t MAX_NAME = 64;
+
+static size_t chroma_plane(uint32_t width, uint32_t height) {
+    return static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+}
+
+static size_t i420_size(uint32_t width, uint32_t height) {
+    return static_cast<size_t>(width) * height + 2 * chroma_plane(width, height);
+}
+
+bool FramePublisher::valid_name(const std::string& name) {
+    if (name.empty() || name.size() > MAX_NAME) return false;
+    for (char c : name) {
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                  c == '.' || c == '_' || c == '-';
+        if (!ok) return false;
+    }
+    return true;
+}
+
+FramePublisher::~FramePublisher() {
+    close();
+}
+
+FrameShareReader::~FrameShareReader() {
+    detach();
+}
+
+#if defined(__linux__)
+
+// Abstract socket address: nothing on disk to clean up, and the name is
+// released when the publisher's process goes away, however it ends
+static socklen_t make_address(const std::string& name, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::string path = "lancast-frames/" + name;
+    std::memcpy(addr.sun_path + 1, path.data(), path.size());
+    return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + path.size());
+}
+
+static bool send_fd(int conn, int fd) {
+    char byte = 'F';
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return ::sendmsg(conn, &msg, MSG_NOSIGNAL) == 1;
+}
+
+static int receive_fd(int conn) {
+    char byte = 0;
+    iovec iov{&byte, 1};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) != 1) return -1;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+        return -1;
+    }
+    int fd = -1;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+static int64_t monotonic_now_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1000;
+}
+
+bool FramePublisher::open(const std::string& name, uint32_t slots, size_t max_frame_bytes) {
+    close();
+    if (!valid_name(name)) {
+        LOG_ERROR(TAG, "Frame share name \"%s\" must be 1-%zu of A-Z a-z 0-9 . _ -", name.c_str(), MAX_NAME);
+        return false;
+    }
+    if (slots < 2 || max_frame_bytes == 0) return false;
+
+    sockaddr_un addr;
+    socklen_t addr_len = make_address(name, addr);
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        LOG_ERROR(TAG, "socket(AF_UNIX) failed: %s", strerror(errno));
+        return false;
+    }
+    if (::bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), addr_len) < 0 ||
+        ::listen(listen_fd, 8) < 0) {
+        if (errno == EADDRINUSE) {
+            LOG_ERROR(TAG, "Another process is publishing frames as \"%s\"", name.c_str());
+        } else {
+            LOG_ERROR(TAG, "Can't listen for frame readers: %s", strerror(errno));
+        }
+        ::close(listen_fd);
+        return false;
+    }
+
+    size_t slot_stride = (sizeof(FrameShareSlot) + max_frame_bytes + 63) & ~size_t{63};
+    size_t map_size = sizeof(FrameShareHeader) + slot_stride * slots;
+    std::string memfd_name = "lancast-frames-" + name;
+    int memfd = memfd_create(memfd_name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    // Sparse: pages are only allocated as frames are written to them
+    if (memfd < 0 || ::ftruncate(memfd, static_cast<off_t>(map_size)) < 0) {
+        LOG_ERROR(TAG, "Creating %.1f MB of shared memory failed: %s", map_size / 1e6, strerror(errno));
+        if (memfd >= 0) ::close(memfd);
+        ::close(listen_fd);
+        return false;
+    }
+    void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(TAG, "mmap(%zu bytes) failed: %s", map_size, strerror(errno));
+        ::close(memfd);
+        ::close(listen_fd);
+        return false;
+    }
+    // Readers can rely on the size, and (where the kernel has
+    // F_SEAL_FUTURE_WRITE, 5.1+) can't map it writable themselves
+    constexpr int size_seals = F_SEAL_SHRINK | F_SEAL_GROW;
+#ifdef F_SEAL_FUTURE_WRITE
+    if (fcntl(memfd, F_ADD_SEALS, size_seals | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) < 0)
+#endif
+        fcntl(memfd, F_ADD_SEALS, size_seals | F_SEAL_SEAL);
+
+    auto* header = new (map) FrameShareHeader();
+    header->magic = FRAME_SHARE_MAGIC;
+    header->version = FRAME_SHARE_VERSION;
+    header->slot_count = slots;
+    header->header_size = sizeof(FrameShareHeader);
+    header->slot_stride = slot_stride;
+    header->slot_capacity = slot_stride - sizeof(FrameShareSlot);
+    header->writer_pid = static_cast<uint32_t>(getpid());
+    for (uint32_t i = 0; i < slots; ++i) {
+        new (static_cast<uint8_t*>(map) + sizeof(FrameShareHeader) + i * slot_stride) FrameShareSlot();
+    }
+    header->open.store(1, std::memory_order_release);
+
+    name_ = name;
+    memfd_ = memfd;
+    listen_fd_ = listen_fd;
+    header_ = header;
+    map_size_ = map_size;
+    next_sequence_ = 1;
+    frames_published_ = 0;
+    readers_attached_ = 0;
+    serve_thread_ = lancast::jthread([this](lancast::stop_token st) { serve_loop(st); });
+    LOG_INFO(TAG, "Publishing decoded frames as \"%s\" (%u slots, up to %.1f MB a frame)", name.c_str(),
+             slots, header->slot_capacity / 1e6);
+    return true;
+}
+
+void FramePublisher::close() {
+    if (serve_thread_.joinable()) {
+        serve_thread_.request_stop();
+        serve_thread_.join();
+    }
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    if (!header_) return;
+    header_->open.store(0, std::memory_order_release);
+    munmap(header_, map_size_);
+    header_ = nullptr;
+    ::close(memfd_);
+    memfd_ = -1;
+    LOG_INFO(TAG, "Stopped publishing \"%s\" (%llu frames)", name_.c_str(),
+             static_cast<unsigned long long>(frames_published_.load()));
+}
+
+void FramePublisher::serve_loop(lancast::stop_token st) {
+    Tracer::set_thread_name("frame-share");
+    while (!st.stop_requested()) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 100) <= 0) continue;
+        for (;;) {
+            int conn = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (conn < 0) break;
+            // Frames are the host's screen: only this user's processes get them
+            ucred cred{};
+            socklen_t len = sizeof(cred);
+            if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != geteuid()) {
+                LOG_WARN(TAG, "Refused frame reader pid %d of uid %u", cred.pid, cred.uid);
+            } else {
+                // Counted before the reader can see the fd, so once its
+                // attach returns the count already includes it
+                readers_attached_.fetch_add(1, std::memory_order_relaxed);
+                if (send_fd(conn, memfd_)) {
+                    LOG_INFO(TAG, "Reader pid %d attached to \"%s\"", cred.pid, name_.c_str());
+                } else {
+                    readers_attached_.fetch_sub(1, std::memory_order_relaxed);
+                }
+            }
+            ::close(conn);
+        }
+    }
+}
+
+FrameShareSlot* FramePublisher::slot(uint64_t sequence) const {
+    auto* base = reinterpret_cast<uint8_t*>(header_) + header_->header_size;
+    return reinterpret_cast<FrameShareSlot*>(base + (sequence % header_->slot_count) * header_->slot_stride);
+}
+
+bool FramePublisher::publish(const RawVideoFrame& frame) {
+    if (!header_ || frame.data.empty() || frame.data.size() != i420_size(frame.width, frame.height)) {
+        return false;
+    }
+    if (frame.data.size() > header_->slot_capacity) {
+        if (header_->skipped.fetch_add(1, std::memory_order_relaxed) == 0) {
+            LOG_WARN(TAG, "%ux%u frames don't fit the shared slots; not publishing them", frame.width,
+                     frame.height);
+        }
+        return false;
+    }
+
+    uint64_t sequence = next_sequence_++;
+    FrameShareSlot* s = slot(sequence);
+    // Seqlock write: readers that see the slot at 0, or at a sequence other
+    // than the one they started with, drop what they read
+    s->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s->width = frame.width;
+    s->height = frame.height;
+    s->size = static_cast<uint32_t>(frame.data.size());
+    s->frame_id = frame.frame_id;
+    s->pts_us = frame.pts_us;
+    std::memcpy(reinterpret_cast<uint8_t*>(s + 1), frame.data.data(), frame.data.size());
+    s->published_us = monotonic_now_us();
+    s->sequence.store(sequence, std::memory_order_release);
+    header_->latest.store(sequence, std::memory_order_release);
+    frames_published_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool FrameShareReader::attach(const std::string& name, int timeout_ms) {
+    detach();
+    if (!FramePublisher::valid_name(name)) return false;
+
+    sockaddr_un addr;
+    socklen_t addr_len = make_address(name, addr);
+    int conn = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (conn < 0) return false;
+    timeval tv{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (::connect(conn, reinterpret_cast<const sockaddr*>(&addr), addr_len) < 0) {
+        LOG_ERROR(TAG, "Nothing is publishing frames as \"%s\"", name.c_str());
+        ::close(conn);
+        return false;
+    }
+    int fd = receive_fd(conn);
+    ::close(conn);
+    if (fd < 0) {
+        LOG_ERROR(TAG, "The publisher of \"%s\" didn't hand over its frames", name.c_str());
+        return false;
+    }
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(FrameShareHeader)) {
+        map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        LOG_ERROR(TAG, "Mapping the frames of \"%s\" failed: %s", name.c_str(), strerror(errno));
+        return false;
+    }
+
+    size_t map_size = static_cast<size_t>(st.st_size);
+    auto* header = static_cast<const FrameShareHeader*>(map);
+    bool layout_ok = header->magic == FRAME_SHARE_MAGIC && header->version == FRAME_SHARE_VERSION &&
+                     header->slot_count >= 2 && header->header_size >= sizeof(FrameShareHeader) &&
+                     header->slot_stride >= sizeof(FrameShareSlot) + header->slot_capacity &&
+                     header->slot_stride % alignof(FrameShareSlot) == 0 &&
+                     header->header_size % alignof(FrameShareSlot) == 0 &&
+                     header->header_size + header->slot_stride * header->slot_count <= map_size;
+    if (!layout_ok) {
+        LOG_ERROR(TAG, "\"%s\" isn't a version %u frame share", name.c_str(), FRAME_SHARE_VERSION);
+        munmap(map, map_size);
+        return false;
+    }
+    header_ = header;
+    map_size_ = map_size;
+    return true;
+}
+
+void FrameShareReader::detach() {
+    if (!header_) return;
+    munmap(const_cast<FrameShareHeader*>(header_), map_size_);
+    header_ = nullptr;
+    map_size_ = 0;
+}
+
+#else
+
+bool FramePublisher::open(const std::string& name, uint32_t slots, size_t max_frame_bytes) {
+    (void)name;
+    (void)slots;
+    (void)max_frame_bytes;
+    LOG_WARN(TAG, "Sharing frames needs Linux (memfd)");
+    return false;
+}
+
+void FramePublisher::close() {}
+
+void FramePublisher::serve_loop(lancast::stop_token st) {
+    (void)st;
+}
+
+FrameShareSlot* FramePublisher::slot(uint64_t sequence) const {
+    (void)sequence;
+    return nullptr;
+}
+
+bool FramePublisher::publish(const RawVideoFrame& frame) {
+    (void)frame;
+    return false;
+}
+
+bool FrameShareReader::attach(const std::string& name, int timeout_ms) {
+    (void)name;
+    (void)timeout_ms;
+    LOG_WARN(TAG, "Sharing frames needs Linux (memfd)");
+    return false;
+}
+
+void FrameShareReader::detach() {}
+
+#endif
+
+FramePublisher::Stats FramePublisher::stats() const {
+    Stats s;
+    s.frames_published = frames_published_.load(std::memory_order_relaxed);
+    s.frames_skipped = header_ ? header_->skipped.load(std::memory_order_relaxed) : 0;
+    s.readers_attached = readers_attached_.load(std::memory_order_relaxed);
+    return s;
+}
+
+const FrameShareSlot* FrameShareReader::slot(uint64_t sequence) const {
+    auto* base = reinterpret_cast<const uint8_t*>(header_) + header_->header_size;
+    return reinterpret_cast<const FrameShareSlot*>(base + (sequence % header_->slot_count) * header_->slot_stride);
+}
+
+std::optional<FrameShareReader::Frame> FrameShareReader::latest(uint64_t after) const {
+    if (!header_) return std::nullopt;
+    // A retry only happens if the publisher lapped the ring mid-read
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        uint64_t sequence = header_->latest.load(std::memory_order_acquire);
+        if (sequence == 0 || sequence <= after) return std::nullopt;
+        const FrameShareSlot* s = slot(sequence);
+        if (s->sequence.load(std::memory_order_acquire) != sequence) continue;
+
+        Frame frame;
+        frame.sequence = sequence;
+        frame.width = s->width;
+        frame.height = s->height;
+        frame.frame_id = s->frame_id;
+        frame.pts_us = s->pts_us;
+        frame.published_us = s->published_us;
+        frame.size = s->size;
+        if (!still_valid(frame)) continue;
+        if (frame.size > header_->slot_capacity || frame.size != i420_size(frame.width, frame.height)) {
+            return std::nullopt;
+        }
+        frame.y = reinterpret_cast<const uint8_t*>(s + 1);
+        frame.u = frame.y + static_cast<size_t>(frame.width) * frame.height;
+        frame.v = frame.u + chroma_plane(frame.width, frame.height);
+        return frame;
+    }
+    return std::nullopt;
+}
+
+bool FrameShareReader::still_valid(const Frame& frame) const {
+    if (!header_) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot(frame.sequence)->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
+
+bool FrameShareReader::publisher_closed() const {
+    return !header_ || header_->open.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t FrameShareReader::slot_count() const {
+    return header_ ? header_->slot_count : 0;
+}
+
+uint64_t FrameShareReader::frames_skipped() const {
+    return header_ ? header_->skipped.load(std::memory_order_relaxed) : 0;
+}
+
+} // namespace lancast
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "core/jthread.h"
+#include "core/types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace lancast {
+
+// Decoded frames for other processes on the viewer machine (OBS, analysis
+// scripts, recorders), without screen-capturing the window. Linux only.
+//
+// The publisher keeps a memfd holding a FrameShareHeader and a fixed number
+// of slots, each a FrameShareSlot followed by one tightly packed I420 frame
+// (Y, then U, then V, chroma planes (w+1)/2 x (h+1)/2). Frames go into the
+// slots round-robin. Readers attach by name: connecting to the abstract
+// UNIX socket "lancast-frames/<name>" hands them the memfd, which they map
+// read-only and read in place.
+//
+// Nothing is locked across processes and the publisher never waits for a
+// reader. Each slot is a seqlock: its sequence is 0 while the frame is
+// being copied in and the frame's sequence number once it's complete, and
+// the header's `latest` then moves to it. A reader has slot_count - 1
+// frame times to use a frame before the publisher comes back around, and
+// checks the sequence again afterwards to know it wasn't overwritten.
+//
+// The layout is fixed so non-C++ readers can use it: the header is 64
+// bytes at offset 0 (little-endian, fields in declaration order), slot i
+// is at header_size + i * slot_stride, and its pixels follow its 64-byte
+// FrameShareSlot. The mapping's size never changes (the memfd is sealed).
+// Only processes of the same user are handed the memfd.
+static constexpr uint32_t FRAME_SHARE_MAGIC = 0x5346434c;  // "LCFS"
+static constexpr uint32_t FRAME_SHARE_VERSION = 1;
+
+struct alignas(64) FrameShareHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t header_size;            // Offset of slot 0
+    uint64_t slot_stride;            // Bytes from one slot to the next
+    uint64_t slot_capacity;          // Pixel bytes a slot holds
+    uint32_t writer_pid;
+    std::atomic<uint32_t> open;      // 1 while the publisher runs, 0 once it's closed
+    std::atomic<uint64_t> latest;    // Sequence of the newest complete frame, 0 before the first
+    std::atomic<uint64_t> skipped;   // Frames too large for a slot
+};
+
+struct alignas(64) FrameShareSlot {
+    std::atomic<uint64_t> sequence;  // Frame in the slot (from 1); 0 while it's being written
+    uint32_t width;
+    uint32_t height;
+    uint32_t size;                   // Pixel bytes
+    uint16_t frame_id;
+    uint16_t reserved;
+    int64_t pts_us;                  // Host capture time
+    int64_t published_us;            // CLOCK_MONOTONIC when the frame was complete
+};
+
+static_assert(sizeof(FrameShareHeader) == 64 && sizeof(FrameShareSlot) == 64);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+class FramePublisher {
+public:
+    static constexpr uint32_t DEFAULT_SLOTS = 4;
+    static constexpr size_t DEFAULT_MAX_FRAME_BYTES = 3840 * 2160 * 3 / 2;
+
+    struct Stats {
+        uint64_t frames_published = 0;
+        uint64_t frames_skipped = 0;   // Larger than max_frame_bytes
+        uint64_t readers_attached = 0;
+    };
+
+    FramePublisher() = default;
+    ~FramePublisher();
+
+    FramePublisher(const FramePublisher&) = delete;
+    FramePublisher& operator=(const FramePublisher&) = delete;
+
+    // Creates the memfd and starts handing it to readers under `name`
+    // ([A-Za-z0-9._-], up to 64 characters). Fails if another publisher
+    // holds the name. Slots are sized for max_frame_bytes; memory is only
+    // used as frames touch it.
+    bool open(const std::string& name, uint32_t slots = DEFAULT_SLOTS,
+              size_t max_frame_bytes = DEFAULT_MAX_FRAME_BYTES);
+    // Marks the header closed; attached readers keep their mapping
+    void close();
+    bool is_open() const { return header_ != nullptr; }
+    const std::string& name() const { return name_; }
+
+    // Copies the frame into the next slot. Call from one thread. False
+    // (and counted) if it doesn't fit.
+    bool publish(const RawVideoFrame& frame);
+
+    Stats stats() const;
+
+    static bool valid_name(const std::string& name);
+
+private:
+    void serve_loop(lancast::stop_token st);
+    FrameShareSlot* slot(uint64_t sequence) const;
+
+    std::string name_;
+    int memfd_ = -1;
+    int listen_fd_ = -1;
+    FrameShareHeader* header_ = nullptr;
+    size_t map_size_ = 0;
+    uint64_t next_sequence_ = 1;
+    std::atomic<uint64_t> frames_published_{0};
+    std::atomic<uint64_t> readers_attached_{0};
+    lancast::jthread serve_thread_;
+};
+
+class FrameShareReader {
+public:
+    // A frame in the publisher's memory. Stays intact until the publisher
+    // laps the ring; still_valid() says whether it has.
+    struct Frame {
+        uint64_t sequence = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint16_t frame_id = 0;
+        int64_t pts_us = 0;
+        int64_t published_us = 0;
+        const uint8_t* y = nullptr;
+        const uint8_t* u = nullptr;
+        const uint8_t* v = nullptr;
+        size_t size = 0;
+    };
+
+    FrameShareReader() = default;
+    ~FrameShareReader();
+
+    FrameShareReader(const FrameShareReader&) = delete;
+    FrameShareReader& operator=(const FrameShareReader&) = delete;
+
+    bool attach(const std::string& name, int timeout_ms = 2000);
+    void detach();
+    bool is_attached() const { return header_ != nullptr; }
+
+    // The newest frame if its sequence is past `after`
+    std::optional<Frame> latest(uint64_t after = 0) const;
+    bool still_valid(const Frame& frame) const;
+
+    // The publisher closed; a new one under the same name needs a new attach
+    bool publisher_closed() const;
+    uint32_t slot_count() const;
+    uint64_t frames_skipped() const;
+
+private:
+    const FrameShareSlot* slot(uint64_t sequence) const;
+
+    const FrameShareHeader* header_ = nullptr;
+    size_t map_size_ = 0;
+};
+
+} // namespace lancast
@@ -0,0 +1,119 @@
+#include "render/perf_overlay.h"
+
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace lancast {
+
+static constexpr float PANEL_X = 8.0f;
+static constexpr float PANEL_Y = 8.0f;
+static constexpr float PANEL_W = 264.0f;
+static constexpr float LINE_H = 11.0f;   // Debug font is 8x8 px
+static constexpr float SPARK_H = 28.0f;
+
+void PerfOverlay::History::push(float v) {
+    values[next] = v;
+    next = (next + 1) % HISTORY;
+    if (count < HISTORY) count++;
+}
+
+void PerfOverlay::set_stats(const Stats& stats) {
+    stats_ = stats;
+    bitrates_.push(static_cast<float>(stats.bitrate_mbps));
+}
+
+void PerfOverlay::add_frame_time(double ms) {
+    frame_times_.push(static_cast<float>(ms));
+}
+
+void PerfOverlay::draw(SDL_Renderer* renderer) {
+    if (!visible_ || !renderer) return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    constexpr int TEXT_LINES = 8;
+    float panel_h = 6.0f + TEXT_LINES * LINE_H + 2 * (LINE_H + SPARK_H + 4.0f);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 170);
+    SDL_FRect panel = {PANEL_X, PANEL_Y, PANEL_W, panel_h};
+    SDL_RenderFillRect(renderer, &panel);
+
+    float x = PANEL_X + 6.0f;
+    float y = PANEL_Y + 6.0f;
+    char line[96];
+
+    SDL_SetRenderDrawColor(renderer, 230, 230, 230, 255);
+    snprintf(line, sizeof(line), "fps %5.1f   lat %6.1f ms", stats_.fps, stats_.latency_ms);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "rate %5.2f Mbps  loss %5.2f%%", stats_.bitrate_mbps, stats_.loss_pct);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "jitter %5.1f ms  queue %5.1f ms", stats_.jitter_ms, stats_.queue_delay_ms);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "decode %5.2f ms", stats_.decode_ms);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "kernel rx %5.2f ms  tx %5.2f ms", stats_.kernel_rx_ms, stats_.kernel_tx_ms);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "queues: video %zu  decoded %zu", stats_.video_queue, stats_.decoded_queue);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    snprintf(line, sizeof(line), "dropped frames %llu",
+             static_cast<unsigned long long>(stats_.frames_dropped));
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+    SDL_SetRenderDrawColor(renderer, 140, 140, 140, 255);
+    snprintf(line, sizeof(line), "overlay %.3f ms  [F3]", draw_ms_);
+    SDL_RenderDebugText(renderer, x, y, line);
+    y += LINE_H;
+
+    float spark_w = PANEL_W - 12.0f;
+
+    SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
+    SDL_RenderDebugText(renderer, x, y, "frame time");
+    y += LINE_H;
+    SDL_SetRenderDrawColor(renderer, 100, 255, 100, 255);
+    draw_sparkline(renderer, frame_times_, x, y, spark_w, SPARK_H, 33.3f);
+    y += SPARK_H + 4.0f;
+
+    SDL_SetRenderDrawColor(renderer, 180, 180, 180, 255);
+    SDL_RenderDebugText(renderer, x, y, "bitrate");
+    y += LINE_H;
+    SDL_SetRenderDrawColor(renderer, 100, 180, 255, 255);
+    draw_sparkline(renderer, bitrates_, x, y, spark_w, SPARK_H, 1.0f);
+
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+    draw_ms_ = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void PerfOverlay::draw_sparkline(SDL_Renderer* renderer, const History& history,
+                                 float x, float y, float w, float h, float min_scale) {
+    if (history.count < 2) return;
+
+    // Oldest sample first
+    size_t first = (history.next + HISTORY - history.count) % HISTORY;
+    float max_v = min_scale;
+    for (size_t i = 0; i < history.count; ++i) {
+        max_v = std::max(max_v, history.values[(first + i) % HISTORY]);
+    }
+
+    std::array<SDL_FPoint, HISTORY> points;
+    float step = w / static_cast<float>(HISTORY - 1);
+    for (size_t i = 0; i < history.count; ++i) {
+        float v = history.values[(first + i) % HISTORY];
+        points[i].x = x + static_cast<float>(HISTORY - history.count + i) * step;
+        points[i].y = y + h - (v / max_v) * h;
+    }
+    SDL_RenderLines(renderer, points.data(), static_cast<int>(history.count));
+}
+
+} // namespace lancast
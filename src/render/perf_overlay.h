@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct SDL_Renderer;
+
+namespace lancast {
+
+// Toggleable on-screen performance HUD drawn on top of the video texture.
+// Text uses SDL's built-in debug font; history is shown as sparklines.
+class PerfOverlay {
+public:
+    struct Stats {
+        double latency_ms = 0.0;      // Frame assembled -> presented
+        double fps = 0.0;             // Rendered frames per second
+        double bitrate_mbps = 0.0;    // Received bitrate
+        double loss_pct = 0.0;        // Packet loss since connect
+        double jitter_ms = 0.0;       // Video frame interarrival jitter
+        double queue_delay_ms = 0.0;  // Frame assembled -> decode start
+        double decode_ms = 0.0;       // Time spent in VideoDecoder::decode
+        double kernel_rx_ms = 0.0;    // Kernel arrival -> assembled (0 if unavailable)
+        double kernel_tx_ms = 0.0;    // Client send -> wire (0 if unavailable)
+        size_t video_queue = 0;       // Encoded frames awaiting decode
+        size_t decoded_queue = 0;     // Decoded frames awaiting render
+        uint64_t frames_dropped = 0;  // Incomplete frames purged
+    };
+
+    void toggle() { visible_ = !visible_; }
+    bool visible() const { return visible_; }
+
+    // Called on each stats refresh; also appends a bitrate history sample
+    void set_stats(const Stats& stats);
+    // Called once per rendered frame with the time since the previous frame
+    void add_frame_time(double ms);
+
+    void draw(SDL_Renderer* renderer);
+
+private:
+    static constexpr size_t HISTORY = 120;
+
+    struct History {
+        std::array<float, HISTORY> values{};
+        size_t next = 0;
+        size_t count = 0;
+        void push(float v);
+    };
+
+    void draw_sparkline(SDL_Renderer* renderer, const History& history,
+                        float x, float y, float w, float h, float min_scale);
+
+    bool visible_ = false;
+    Stats stats_;
+    History frame_times_;
+    History bitrates_;
+    double draw_ms_ = 0.0;  // Cost of the previous draw, shown in the HUD
+};
+
+} // namespace lancast
@@ -3,22 +3,40 @@
 
 #include <SDL3/SDL.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace lancast {
 
 static constexpr const char* TAG = "SdlRenderer";
+static constexpr double ZOOM_STEP = 1.25;      // Per wheel notch
+static constexpr double MAX_ZOOM = 16.0;
 
 SdlRenderer::~SdlRenderer() {
     shutdown();
 }
 
-bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title) {
-    width_ = width;
-    height_ = height;
-
+bool SdlRenderer::prepare() {
+    if (video_ready_) return true;
     if (!SDL_Init(SDL_INIT_VIDEO)) {
         LOG_ERROR(TAG, "SDL_Init failed: %s", SDL_GetError());
         return false;
     }
+    video_ready_ = true;
+    return true;
+}
+
+void SdlRenderer::quit_video() {
+    SDL_Quit();
+    video_ready_ = false;
+}
+
+bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title) {
+    width_ = width;
+    height_ = height;
+
+    if (!prepare()) return false;
 
     window_ = SDL_CreateWindow(title.c_str(),
                                 static_cast<int>(width),
@@ -26,7 +44,7 @@ bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title
                                 SDL_WINDOW_RESIZABLE);
     if (!window_) {
         LOG_ERROR(TAG, "SDL_CreateWindow failed: %s", SDL_GetError());
-        SDL_Quit();
+        quit_video();
         return false;
     }
 
@@ -35,13 +53,24 @@ bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title
         LOG_ERROR(TAG, "SDL_CreateRenderer failed: %s", SDL_GetError());
         SDL_DestroyWindow(window_);
         window_ = nullptr;
-        SDL_Quit();
+        quit_video();
         return false;
     }
 
     // Disable VSync for lowest latency — we drive the frame rate from the network
     SDL_SetRenderVSync(renderer_, SDL_RENDERER_VSYNC_DISABLED);
 
+    // Without GPU acceleration, convert and scale frames ourselves
+    const char* name = SDL_GetRendererName(renderer_);
+    software_ = name && std::strcmp(name, SDL_SOFTWARE_RENDERER) == 0;
+    if (software_) {
+        converter_ = std::make_unique<YuvConverter>();
+        initialized_ = true;
+        LOG_INFO(TAG, "SDL renderer initialized (%ux%u, software: SIMD conversion on %zu threads)",
+                 width, height, converter_->threads());
+        return true;
+    }
+
     texture_ = SDL_CreateTexture(renderer_,
                                   SDL_PIXELFORMAT_IYUV,
                                   SDL_TEXTUREACCESS_STREAMING,
@@ -53,7 +82,7 @@ bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title
         renderer_ = nullptr;
         SDL_DestroyWindow(window_);
         window_ = nullptr;
-        SDL_Quit();
+        quit_video();
         return false;
     }
 
@@ -62,28 +91,254 @@ bool SdlRenderer::init(uint32_t width, uint32_t height, const std::string& title
     return true;
 }
 
+bool SdlRenderer::resize_texture(uint32_t width, uint32_t height) {
+    if (texture_) SDL_DestroyTexture(texture_);
+    texture_ = SDL_CreateTexture(renderer_,
+                                  SDL_PIXELFORMAT_IYUV,
+                                  SDL_TEXTUREACCESS_STREAMING,
+                                  static_cast<int>(width),
+                                  static_cast<int>(height));
+    if (!texture_) {
+        LOG_ERROR(TAG, "SDL_CreateTexture (%ux%u) failed: %s", width, height, SDL_GetError());
+        width_ = height_ = 0;
+        return false;
+    }
+    LOG_INFO(TAG, "Video texture resized %ux%u -> %ux%u", width_, height_, width, height);
+    width_ = width;
+    height_ = height;
+    return true;
+}
+
 void SdlRenderer::render_frame(const RawVideoFrame& frame) {
     if (!initialized_) return;
-    if (frame.width != width_ || frame.height != height_) return;
+    // The stream changed resolution; the window keeps its size and scales
+    if (!software_ && (frame.width != width_ || frame.height != height_)) {
+        if (frame.width == 0 || frame.height == 0 || !resize_texture(frame.width, frame.height)) return;
+    }
 
-    int w = static_cast<int>(width_);
-    int h = static_cast<int>(height_);
+    int w = static_cast<int>(frame.width);
+    int h = static_cast<int>(frame.height);
     size_t y_size = static_cast<size_t>(w) * h;
     size_t uv_size = y_size / 4;
 
     if (frame.data.size() < y_size + uv_size * 2) return;
 
-    const uint8_t* y_plane = frame.data.data();
-    const uint8_t* u_plane = frame.data.data() + y_size;
-    const uint8_t* v_plane = frame.data.data() + y_size + uv_size;
+    if (!software_) {
+        const uint8_t* y_plane = frame.data.data();
+        const uint8_t* u_plane = frame.data.data() + y_size;
+        const uint8_t* v_plane = frame.data.data() + y_size + uv_size;
 
-    SDL_UpdateYUVTexture(texture_, nullptr,
-                          y_plane, w,
-                          u_plane, w / 2,
-                          v_plane, w / 2);
+        SDL_UpdateYUVTexture(texture_, nullptr,
+                              y_plane, w,
+                              u_plane, w / 2,
+                              v_plane, w / 2);
+    }
+
+    // The frame covers frame.region of the source and the window shows
+    // view_; draw the overlap of the two. Outside it stays black until the
+    // host catches up with a zoom.
+    double fx = 0.0, fy = 0.0, fw = 1.0, fh = 1.0;
+    if (!frame.region.full()) {
+        fx = frame.region.x / 65536.0;
+        fy = frame.region.y / 65536.0;
+        fw = frame.region.width / 65536.0;
+        fh = frame.region.height / 65536.0;
+    }
+    double x0 = std::max(view_.x, fx);
+    double y0 = std::max(view_.y, fy);
+    double x1 = std::min(view_.x + view_.width, fx + fw);
+    double y1 = std::min(view_.y + view_.height, fy + fh);
 
     SDL_RenderClear(renderer_);
-    SDL_RenderTexture(renderer_, texture_, nullptr, nullptr);
+    last_drawn_ = false;
+    int out_w = 0, out_h = 0;
+    SDL_GetRenderOutputSize(renderer_, &out_w, &out_h);
+    if (x1 > x0 && y1 > y0) {
+        SDL_FRect src{
+            static_cast<float>((x0 - fx) / fw * w), static_cast<float>((y0 - fy) / fh * h),
+            static_cast<float>((x1 - x0) / fw * w), static_cast<float>((y1 - y0) / fh * h)};
+        SDL_FRect dst{
+            static_cast<float>((x0 - view_.x) / view_.width * out_w),
+            static_cast<float>((y0 - view_.y) / view_.height * out_h),
+            static_cast<float>((x1 - x0) / view_.width * out_w),
+            static_cast<float>((y1 - y0) / view_.height * out_h)};
+        if (software_) {
+            // Whole pixels on both sides; the converter does the scaling
+            auto px = [](float v) { return static_cast<uint32_t>(std::max(0L, std::lround(v))); };
+            PixelRect crop{px(src.x), px(src.y), std::max(px(src.w), 1u), std::max(px(src.h), 1u)};
+            crop.x = std::min(crop.x, frame.width - 1);
+            crop.y = std::min(crop.y, frame.height - 1);
+            crop.width = std::min(crop.width, frame.width - crop.x);
+            crop.height = std::min(crop.height, frame.height - crop.y);
+            render_converted(frame, crop, dst);
+        } else {
+            SDL_RenderTexture(renderer_, texture_, &src, &dst);
+            last_src_ = {src.x, src.y, src.w, src.h};
+            last_dst_ = {dst.x, dst.y, dst.w, dst.h};
+            last_drawn_ = true;
+        }
+    }
+    overlay_.draw(renderer_);
+    SDL_RenderPresent(renderer_);
+}
+
+void SdlRenderer::redraw() {
+    if (!initialized_) return;
+    if (!tiles_.empty()) {
+        present_tiles();
+        return;
+    }
+    // The texture still holds the last frame as drawn
+    SDL_RenderClear(renderer_);
+    if (last_drawn_) {
+        SDL_FRect src{last_src_.x, last_src_.y, last_src_.w, last_src_.h};
+        SDL_FRect dst{last_dst_.x, last_dst_.y, last_dst_.w, last_dst_.h};
+        SDL_RenderTexture(renderer_, software_ ? rgb_texture_ : texture_, &src, &dst);
+    }
+    overlay_.draw(renderer_);
+    SDL_RenderPresent(renderer_);
+}
+
+void SdlRenderer::render_converted(const RawVideoFrame& frame, const PixelRect& src, const SDL_FRect& dst) {
+    int out_w = 0, out_h = 0;
+    SDL_GetRenderOutputSize(renderer_, &out_w, &out_h);
+    if (out_w <= 0 || out_h <= 0) return;
+    if (!rgb_texture_ || out_w != rgb_width_ || out_h != rgb_height_) {
+        if (rgb_texture_) SDL_DestroyTexture(rgb_texture_);
+        rgb_texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_STREAMING, out_w, out_h);
+        if (!rgb_texture_) {
+            LOG_ERROR(TAG, "SDL_CreateTexture (%dx%d BGRX) failed: %s", out_w, out_h, SDL_GetError());
+            rgb_width_ = rgb_height_ = 0;
+            return;
+        }
+        rgb_width_ = out_w;
+        rgb_height_ = out_h;
+    }
+
+    SDL_Rect rect{static_cast<int>(std::lround(dst.x)), static_cast<int>(std::lround(dst.y)),
+                  static_cast<int>(std::lround(dst.w)), static_cast<int>(std::lround(dst.h))};
+    rect.x = std::clamp(rect.x, 0, out_w - 1);
+    rect.y = std::clamp(rect.y, 0, out_h - 1);
+    rect.w = std::clamp(rect.w, 1, out_w - rect.x);
+    rect.h = std::clamp(rect.h, 1, out_h - rect.y);
+    if (!convert_into(rgb_texture_, rect, frame, src)) return;
+
+    SDL_FRect area{static_cast<float>(rect.x), static_cast<float>(rect.y),
+                   static_cast<float>(rect.w), static_cast<float>(rect.h)};
+    SDL_RenderTexture(renderer_, rgb_texture_, &area, &area);
+    last_src_ = last_dst_ = {area.x, area.y, area.w, area.h};
+    last_drawn_ = true;
+}
+
+bool SdlRenderer::convert_into(SDL_Texture* texture, const SDL_Rect& rect,
+                               const RawVideoFrame& frame, const PixelRect& src) {
+    void* pixels = nullptr;
+    int pitch = 0;
+    if (!SDL_LockTexture(texture, &rect, &pixels, &pitch)) {
+        LOG_ERROR(TAG, "SDL_LockTexture failed: %s", SDL_GetError());
+        return false;
+    }
+    bool ok = converter_->convert(frame, src, static_cast<uint8_t*>(pixels), pitch,
+                                  static_cast<uint32_t>(rect.w), static_cast<uint32_t>(rect.h));
+    SDL_UnlockTexture(texture);
+    return ok;
+}
+
+void SdlRenderer::set_tile_count(size_t count) {
+    for (auto& tile : tiles_) {
+        if (tile.texture) SDL_DestroyTexture(tile.texture);
+    }
+    tiles_.assign(count, Tile{});
+}
+
+void SdlRenderer::tile_grid(size_t& columns, size_t& rows) const {
+    // As square as possible, filling rows first
+    columns = 1;
+    while (columns * columns < tiles_.size()) columns++;
+    rows = tiles_.empty() ? 1 : (tiles_.size() + columns - 1) / columns;
+}
+
+void SdlRenderer::tile_size(size_t index, uint32_t& width, uint32_t& height) const {
+    width = height = 0;
+    if (index >= tiles_.size()) return;
+    size_t columns = 1, rows = 1;
+    tile_grid(columns, rows);
+    drawable_size(width, height);
+    width /= static_cast<uint32_t>(columns);
+    height /= static_cast<uint32_t>(rows);
+}
+
+void SdlRenderer::update_tile(size_t index, const RawVideoFrame& frame) {
+    if (!initialized_ || index >= tiles_.size()) return;
+    Tile& tile = tiles_[index];
+    if (frame.width == 0 || frame.height == 0) return;
+
+    int w = static_cast<int>(frame.width);
+    size_t y_size = static_cast<size_t>(w) * frame.height;
+    size_t uv_size = y_size / 4;
+    if (frame.data.size() < y_size + uv_size * 2) return;
+
+    // The software path converts straight to the letterboxed cell size
+    uint32_t tex_w = frame.width, tex_h = frame.height;
+    if (software_) {
+        uint32_t cell_w = 0, cell_h = 0;
+        tile_size(index, cell_w, cell_h);
+        if (cell_w == 0 || cell_h == 0) return;
+        double scale = std::min(static_cast<double>(cell_w) / frame.width,
+                                static_cast<double>(cell_h) / frame.height);
+        tex_w = std::max(1u, static_cast<uint32_t>(frame.width * scale));
+        tex_h = std::max(1u, static_cast<uint32_t>(frame.height * scale));
+    }
+    if (tex_w != tile.width || tex_h != tile.height || !tile.texture) {
+        if (tile.texture) SDL_DestroyTexture(tile.texture);
+        tile.texture = SDL_CreateTexture(renderer_,
+                                         software_ ? SDL_PIXELFORMAT_XRGB8888 : SDL_PIXELFORMAT_IYUV,
+                                         SDL_TEXTUREACCESS_STREAMING,
+                                         static_cast<int>(tex_w),
+                                         static_cast<int>(tex_h));
+        if (!tile.texture) {
+            LOG_ERROR(TAG, "SDL_CreateTexture for tile %zu (%ux%u) failed: %s",
+                      index, tex_w, tex_h, SDL_GetError());
+            tile.width = tile.height = 0;
+            return;
+        }
+        LOG_INFO(TAG, "Tile %zu texture %ux%u", index, tex_w, tex_h);
+        tile.width = tex_w;
+        tile.height = tex_h;
+    }
+
+    if (software_) {
+        SDL_Rect rect{0, 0, static_cast<int>(tex_w), static_cast<int>(tex_h)};
+        convert_into(tile.texture, rect, frame, PixelRect{0, 0, frame.width, frame.height});
+        return;
+    }
+    SDL_UpdateYUVTexture(tile.texture, nullptr,
+                          frame.data.data(), w,
+                          frame.data.data() + y_size, w / 2,
+                          frame.data.data() + y_size + uv_size, w / 2);
+}
+
+void SdlRenderer::present_tiles() {
+    if (!initialized_) return;
+    size_t columns = 1, rows = 1;
+    tile_grid(columns, rows);
+
+    SDL_RenderClear(renderer_);
+    int out_w = 0, out_h = 0;
+    SDL_GetRenderOutputSize(renderer_, &out_w, &out_h);
+    float cell_w = static_cast<float>(out_w) / columns;
+    float cell_h = static_cast<float>(out_h) / rows;
+    for (size_t i = 0; i < tiles_.size(); ++i) {
+        const Tile& tile = tiles_[i];
+        if (!tile.texture) continue;
+        float scale = std::min(cell_w / tile.width, cell_h / tile.height);
+        float w = tile.width * scale;
+        float h = tile.height * scale;
+        SDL_FRect dst{(i % columns) * cell_w + (cell_w - w) / 2,
+                      (i / columns) * cell_h + (cell_h - h) / 2, w, h};
+        SDL_RenderTexture(renderer_, tile.texture, nullptr, &dst);
+    }
+    overlay_.draw(renderer_);
     SDL_RenderPresent(renderer_);
 }
 
@@ -100,10 +355,32 @@ bool SdlRenderer::poll_events() {
                 if (event.key.key == SDLK_F11) {
                     toggle_fullscreen();
                 }
+                if (event.key.key == SDLK_F3) {
+                    overlay_.toggle();
+                    LOG_INFO(TAG, "Performance overlay %s", overlay_.visible() ? "shown" : "hidden");
+                    // Right away, not with the next frame a still stream may not send
+                    redraw();
+                }
+                if (event.key.key == SDLK_0) {
+                    view_ = View{};
+                    LOG_INFO(TAG, "Zoom reset");
+                }
                 if (key_cb_) {
                     key_cb_(event.key.key);
                 }
                 break;
+            case SDL_EVENT_MOUSE_WHEEL:
+                if (event.wheel.y != 0.0f) {
+                    zoom(std::pow(ZOOM_STEP, -event.wheel.y), event.wheel.mouse_x, event.wheel.mouse_y);
+                }
+                break;
+            case SDL_EVENT_MOUSE_BUTTON_DOWN:
+            case SDL_EVENT_MOUSE_BUTTON_UP:
+                if (event.button.button == SDL_BUTTON_LEFT) dragging_ = event.button.down;
+                break;
+            case SDL_EVENT_MOUSE_MOTION:
+                if (dragging_) pan(event.motion.xrel, event.motion.yrel);
+                break;
             default:
                 break;
         }
@@ -111,6 +388,46 @@ bool SdlRenderer::poll_events() {
     return true;
 }
 
+void SdlRenderer::zoom(double factor, float mouse_x, float mouse_y) {
+    int win_w = 0, win_h = 0;
+    if (!SDL_GetWindowSize(window_, &win_w, &win_h) || win_w <= 0 || win_h <= 0) return;
+
+    // Keep the source point under the cursor where it is
+    double cx = std::clamp(static_cast<double>(mouse_x) / win_w, 0.0, 1.0);
+    double cy = std::clamp(static_cast<double>(mouse_y) / win_h, 0.0, 1.0);
+    double px = view_.x + cx * view_.width;
+    double py = view_.y + cy * view_.height;
+
+    double size = std::clamp(view_.width * factor, 1.0 / MAX_ZOOM, 1.0);
+    view_.width = view_.height = size;
+    view_.x = std::clamp(px - cx * size, 0.0, 1.0 - size);
+    view_.y = std::clamp(py - cy * size, 0.0, 1.0 - size);
+}
+
+void SdlRenderer::pan(float dx, float dy) {
+    int win_w = 0, win_h = 0;
+    if (!SDL_GetWindowSize(window_, &win_w, &win_h) || win_w <= 0 || win_h <= 0) return;
+
+    view_.x = std::clamp(view_.x - dx / win_w * view_.width, 0.0, 1.0 - view_.width);
+    view_.y = std::clamp(view_.y - dy / win_h * view_.height, 0.0, 1.0 - view_.height);
+}
+
+SourceRegion SdlRenderer::view_region() const {
+    if (view_.width >= 1.0 && view_.height >= 1.0) return {};
+    auto fixed = [](double v) {
+        return static_cast<uint16_t>(std::clamp(std::lround(v * 65536.0), 0L, 65535L));
+    };
+    return {fixed(view_.x), fixed(view_.y),
+            std::max<uint16_t>(fixed(view_.width), 1), std::max<uint16_t>(fixed(view_.height), 1)};
+}
+
+void SdlRenderer::drawable_size(uint32_t& width, uint32_t& height) const {
+    int w = 0, h = 0;
+    if (window_) SDL_GetWindowSizeInPixels(window_, &w, &h);
+    width = static_cast<uint32_t>(std::max(w, 0));
+    height = static_cast<uint32_t>(std::max(h, 0));
+}
+
 void SdlRenderer::toggle_fullscreen() {
     if (!initialized_ || !window_) return;
 
@@ -126,12 +443,22 @@ void SdlRenderer::set_title(const std::string& title) {
 }
 
 void SdlRenderer::shutdown() {
-    if (!initialized_) return;
+    if (!initialized_) {
+        if (video_ready_) quit_video();  // prepare() without init()
+        return;
+    }
 
+    set_tile_count(0);
     if (texture_) {
         SDL_DestroyTexture(texture_);
         texture_ = nullptr;
     }
+    if (rgb_texture_) {
+        SDL_DestroyTexture(rgb_texture_);
+        rgb_texture_ = nullptr;
+        rgb_width_ = rgb_height_ = 0;
+    }
+    converter_.reset();
     if (renderer_) {
         SDL_DestroyRenderer(renderer_);
         renderer_ = nullptr;
@@ -140,7 +467,7 @@ void SdlRenderer::shutdown() {
         SDL_DestroyWindow(window_);
         window_ = nullptr;
     }
-    SDL_Quit();
+    quit_video();
 
     initialized_ = false;
     LOG_INFO(TAG, "SDL renderer shut down");
@@ -1,13 +1,19 @@
 #pragma once
 
 #include "core/types.h"
+#include "render/perf_overlay.h"
+#include "render/yuv_converter.h"
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 struct SDL_Window;
 struct SDL_Renderer;
 struct SDL_Texture;
+struct SDL_FRect;
+struct SDL_Rect;
 
 namespace lancast {
 
@@ -18,6 +24,11 @@ public:
     SdlRenderer() = default;
     ~SdlRenderer();
 
+    // Brings up SDL video (display connection, driver loading), the slow
+    // part of init() that doesn't need the stream size, so callers can run
+    // it while the join handshake is in flight. Main thread only; init()
+    // does it if nobody did.
+    bool prepare();
     bool init(uint32_t width, uint32_t height, const std::string& title = "lancast");
     void render_frame(const RawVideoFrame& frame);
 
@@ -27,17 +38,85 @@ public:
     void set_key_callback(KeyCallback cb) { key_cb_ = std::move(cb); }
     void set_title(const std::string& title);
 
+    // Performance HUD, toggled with F3. Drawn after the video texture.
+    PerfOverlay& overlay() { return overlay_; }
+
+    // Part of the source the window shows, as fractions of the full source.
+    // Mouse wheel zooms around the cursor, left-drag pans, 0 resets.
+    struct View {
+        double x = 0.0;
+        double y = 0.0;
+        double width = 1.0;
+        double height = 1.0;
+    };
+    const View& view() const { return view_; }
+    SourceRegion view_region() const;
+
+    // Window size in pixels (0x0 before init)
+    void drawable_size(uint32_t& width, uint32_t& height) const;
+
+    // True when SDL fell back to its software renderer. Frames are then
+    // converted and scaled to window pixels by YuvConverter and drawn 1:1,
+    // instead of leaving SDL's generic C code to do both.
+    bool software() const { return software_; }
+
+    // Mosaic mode: the window is split into a grid of count tiles, each with
+    // its own texture, letterboxed to the frame's aspect ratio. update_tile
+    // uploads a tile's latest frame; present_tiles draws all of them once.
+    // Zoom and pan only apply to render_frame.
+    void set_tile_count(size_t count);
+    void update_tile(size_t index, const RawVideoFrame& frame);
+    void present_tiles();
+    // Size of a tile's grid cell in pixels
+    void tile_size(size_t index, uint32_t& width, uint32_t& height) const;
+
     void shutdown();
 
 private:
+    struct Tile {
+        SDL_Texture* texture = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    void quit_video();
+    bool resize_texture(uint32_t width, uint32_t height);
+    void render_converted(const RawVideoFrame& frame, const PixelRect& src, const SDL_FRect& dst);
+    bool convert_into(SDL_Texture* texture, const SDL_Rect& rect, const RawVideoFrame& frame, const PixelRect& src);
+    void tile_grid(size_t& columns, size_t& rows) const;
+    // Presents the last picture again (overlay toggled between frames)
+    void redraw();
+    void zoom(double factor, float mouse_x, float mouse_y);
+    void pan(float dx, float dy);
+
     SDL_Window* window_ = nullptr;
     SDL_Renderer* renderer_ = nullptr;
     SDL_Texture* texture_ = nullptr;
     uint32_t width_ = 0;
     uint32_t height_ = 0;
+
+    // Software renderer path: a window-sized BGRX texture
+    bool software_ = false;
+    std::unique_ptr<YuvConverter> converter_;
+    SDL_Texture* rgb_texture_ = nullptr;
+    int rgb_width_ = 0;
+    int rgb_height_ = 0;
+
+    // Where render_frame last drew its texture, for redraw()
+    struct DrawnRect {
+        float x = 0.0f, y = 0.0f, w = 0.0f, h = 0.0f;
+    };
+    DrawnRect last_src_, last_dst_;
+    bool last_drawn_ = false;
+
+    bool video_ready_ = false;  // SDL video is up (prepare)
     bool initialized_ = false;
     bool fullscreen_ = false;
+    View view_;
+    bool dragging_ = false;
     KeyCallback key_cb_;
+    PerfOverlay overlay_;
+    std::vector<Tile> tiles_;
 };
 
 } // namespace lancast
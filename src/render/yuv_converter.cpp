@@ -0,0 +1,293 @@
+#include "render/yuv_converter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LANCAST_YUV_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace lancast {
+
+static constexpr size_t MAX_AUTO_THREADS = 4;
+
+// BT.601 limited range in 6-bit fixed point. Luma is 74.5: (y - 16) * 74 plus
+// half of (y - 16), so 235 reaches 255. Every product fits in 16 bits.
+static constexpr int Y_GAIN = 74;
+static constexpr int V_TO_R = 102;
+static constexpr int U_TO_G = 25;
+static constexpr int V_TO_G = 52;
+static constexpr int U_TO_B = 129;
+
+static inline uint8_t clamp_pixel(int v) {
+    return static_cast<uint8_t>(std::clamp(v, 0, 255));
+}
+
+static inline uint8_t lerp(int a, int b, int weight) {
+    return static_cast<uint8_t>(a + (((b - a) * weight + 64) >> 7));
+}
+
+// out = a + (b - a) * weight / 128, over n samples
+static void blend_rows(const uint8_t* a, const uint8_t* b, uint32_t weight, uint8_t* out, uint32_t n) {
+    uint32_t x = 0;
+#ifdef LANCAST_YUV_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i w = _mm_set1_epi16(static_cast<short>(weight));
+    const __m128i round = _mm_set1_epi16(64);
+    for (; x + 16 <= n; x += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i alo = _mm_unpacklo_epi8(va, zero);
+        __m128i ahi = _mm_unpackhi_epi8(va, zero);
+        __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(vb, zero), alo);
+        __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(vb, zero), ahi);
+        __m128i lo = _mm_add_epi16(alo, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(dlo, w), round), 7));
+        __m128i hi = _mm_add_epi16(ahi, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(dhi, w), round), 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    const int wi = static_cast<int>(weight);
+    for (; x < n; ++x) {
+        out[x] = lerp(a[x], b[x], wi);
+    }
+}
+
+// Horizontal bilinear resample of one row (absolute sample indices)
+template <typename Tap>
+static void resample_row(const uint8_t* row, const Tap* taps, uint8_t* out, uint32_t n) {
+    for (uint32_t x = 0; x < n; ++x) {
+        const Tap& t = taps[x];
+        out[x] = lerp(row[t.first], row[t.second], static_cast<int>(t.weight));
+    }
+}
+
+// Both chroma rows share their taps, so they are resampled together
+template <typename Tap>
+static void resample_rows(const uint8_t* row_u, const uint8_t* row_v, const Tap* taps,
+                          uint8_t* out_u, uint8_t* out_v, uint32_t n) {
+    for (uint32_t x = 0; x < n; ++x) {
+        const Tap& t = taps[x];
+        int w = static_cast<int>(t.weight);
+        out_u[x] = lerp(row_u[t.first], row_u[t.second], w);
+        out_v[x] = lerp(row_v[t.first], row_v[t.second], w);
+    }
+}
+
+// One row to BGRX: n luma samples, each chroma sample covering two of them
+static void yuv_to_bgrx(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, uint32_t n) {
+    uint32_t x = 0;
+#ifdef LANCAST_YUV_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i k16 = _mm_set1_epi16(16);
+    const __m128i k128 = _mm_set1_epi16(128);
+    const __m128i round = _mm_set1_epi16(32);
+    const __m128i y_gain = _mm_set1_epi16(Y_GAIN);
+    const __m128i v_to_r = _mm_set1_epi16(V_TO_R);
+    const __m128i u_to_g = _mm_set1_epi16(U_TO_G);
+    const __m128i v_to_g = _mm_set1_epi16(V_TO_G);
+    const __m128i u_to_b = _mm_set1_epi16(U_TO_B);
+    const __m128i alpha = _mm_set1_epi8(-1);
+    for (; x + 8 <= n; x += 8) {
+        __m128i vy = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), zero), k16);
+        int32_t u4, v4;
+        std::memcpy(&u4, u + x / 2, 4);
+        std::memcpy(&v4, v + x / 2, 4);
+        __m128i vu = _mm_cvtsi32_si128(u4);
+        __m128i vv = _mm_cvtsi32_si128(v4);
+        vu = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(vu, vu), zero), k128);
+        vv = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_unpacklo_epi8(vv, vv), zero), k128);
+        __m128i c = _mm_add_epi16(_mm_mullo_epi16(vy, y_gain), _mm_srai_epi16(vy, 1));
+
+        // Saturating adds: only blue can overflow, and then it clamps to 255 anyway
+        __m128i r = _mm_adds_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(vv, v_to_r)), round);
+        __m128i g = _mm_adds_epi16(_mm_subs_epi16(_mm_subs_epi16(c, _mm_mullo_epi16(vu, u_to_g)),
+                                                  _mm_mullo_epi16(vv, v_to_g)), round);
+        __m128i b = _mm_adds_epi16(_mm_adds_epi16(c, _mm_mullo_epi16(vu, u_to_b)), round);
+        __m128i r8 = _mm_packus_epi16(_mm_srai_epi16(r, 6), zero);
+        __m128i g8 = _mm_packus_epi16(_mm_srai_epi16(g, 6), zero);
+        __m128i b8 = _mm_packus_epi16(_mm_srai_epi16(b, 6), zero);
+
+        __m128i bg = _mm_unpacklo_epi8(b8, g8);
+        __m128i ra = _mm_unpacklo_epi8(r8, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * x + 16), _mm_unpackhi_epi16(bg, ra));
+    }
+#endif
+    for (; x < n; ++x) {
+        int c = y[x] - 16;
+        c = c * Y_GAIN + (c >> 1);
+        int d = u[x / 2] - 128;
+        int e = v[x / 2] - 128;
+        uint8_t* px = dst + 4 * x;
+        px[0] = clamp_pixel((c + U_TO_B * d + 32) >> 6);
+        px[1] = clamp_pixel((c - U_TO_G * d - V_TO_G * e + 32) >> 6);
+        px[2] = clamp_pixel((c + V_TO_R * e + 32) >> 6);
+        px[3] = 255;
+    }
+}
+
+YuvConverter::YuvConverter(size_t threads) {
+    if (threads == 0) {
+        threads = std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 1, MAX_AUTO_THREADS);
+    }
+    bands_ = threads;
+    for (size_t band = 1; band < threads; ++band) {
+        workers_.emplace_back([this, band](lancast::stop_token) { worker_loop(band); });
+    }
+}
+
+YuvConverter::~YuvConverter() {
+    {
+        std::lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    workers_.clear();
+}
+
+// Maps dst_len outputs onto src_len samples starting at offset (in luma
+// units). With group 2, each tap serves two neighbouring outputs. Chroma
+// samples sit at the centre of each 2x2 luma block.
+template <typename Tap>
+static void make_taps(std::vector<Tap>& taps, uint32_t offset, uint32_t src_len, uint32_t dst_len,
+                      uint32_t group, bool chroma, uint32_t plane_len) {
+    taps.resize((dst_len + group - 1) / group);
+    double step = static_cast<double>(src_len) / dst_len;
+    double last = static_cast<double>(plane_len - 1);
+    for (uint32_t d = 0; d < taps.size(); ++d) {
+        double pos = offset + (d * group + group / 2.0) * step - 0.5;
+        if (chroma) pos = (pos + 0.5) / 2.0 - 0.5;
+        pos = std::clamp(pos, 0.0, last);
+        auto first = static_cast<uint32_t>(pos);
+        auto weight = static_cast<uint32_t>(std::lround((pos - first) * 128.0));
+        if (weight == 128) {
+            first++;
+            weight = 0;
+        }
+        taps[d] = {first, std::min(first + 1, plane_len - 1), weight};
+    }
+}
+
+void YuvConverter::build_taps() {
+    const Geometry& g = geometry_;
+    make_taps(luma_columns_, g.src.x, g.src.width, g.dst_width, 1, false, g.frame_width);
+    make_taps(chroma_columns_, g.src.x, g.src.width, g.dst_width, 2, true, g.frame_width / 2);
+    make_taps(luma_rows_, g.src.y, g.src.height, g.dst_height, 1, false, g.frame_height);
+    make_taps(chroma_rows_, g.src.y, g.src.height, g.dst_height, 1, true, g.frame_height / 2);
+    // At 1:1 from an even column, each output pair lands on one chroma sample
+    luma_unscaled_ = g.dst_width == g.src.width;
+    chroma_unscaled_ = luma_unscaled_ && g.src.x % 2 == 0;
+}
+
+bool YuvConverter::convert(const RawVideoFrame& frame, const PixelRect& src,
+                           uint8_t* dst, int pitch, uint32_t dst_width, uint32_t dst_height) {
+    uint32_t w = frame.width;
+    uint32_t h = frame.height;
+    size_t y_size = static_cast<size_t>(w) * h;
+    if (w < 2 || h < 2 || frame.data.size() < y_size + 2 * (y_size / 4)) return false;
+    if (src.width == 0 || src.height == 0 || src.x + src.width > w || src.y + src.height > h) return false;
+    if (dst_width == 0 || dst_height == 0 || pitch < static_cast<int>(dst_width * 4)) return false;
+
+    Geometry geometry{w, h, src, dst_width, dst_height};
+    if (!(geometry == geometry_)) {
+        geometry_ = geometry;
+        build_taps();
+    }
+    planes_[0] = frame.data.data();
+    planes_[1] = planes_[0] + y_size;
+    planes_[2] = planes_[1] + y_size / 4;
+    dst_ = dst;
+    pitch_ = pitch;
+
+    if (workers_.empty()) {
+        convert_rows(0, dst_height);
+        return true;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        job_generation_++;
+        bands_pending_ = workers_.size();
+    }
+    work_cv_.notify_all();
+    convert_rows(0, dst_height / bands_);
+    std::unique_lock lock(mutex_);
+    done_cv_.wait(lock, [this] { return bands_pending_ == 0; });
+    return true;
+}
+
+void YuvConverter::worker_loop(size_t band) {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            work_cv_.wait(lock, [&] { return stopping_ || job_generation_ != seen; });
+            if (stopping_) return;
+            seen = job_generation_;
+        }
+        uint32_t rows = geometry_.dst_height;
+        convert_rows(static_cast<uint32_t>(rows * band / bands_), static_cast<uint32_t>(rows * (band + 1) / bands_));
+        {
+            std::lock_guard lock(mutex_);
+            if (--bands_pending_ == 0) done_cv_.notify_one();
+        }
+    }
+}
+
+void YuvConverter::convert_rows(uint32_t first, uint32_t last) {
+    const Geometry& g = geometry_;
+    const uint32_t chroma_width = g.frame_width / 2;
+    const uint32_t out_width = g.dst_width;
+
+    // Source columns the output reads, so the vertical blend skips the rest
+    const uint32_t luma_begin = luma_columns_.front().first;
+    const uint32_t luma_end = luma_columns_.back().second + 1;
+    const uint32_t chroma_begin = chroma_columns_.front().first;
+    const uint32_t chroma_end = chroma_columns_.back().second + 1;
+
+    // Per-thread scratch: one blended source row per plane, then the
+    // resampled output-width rows
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize(static_cast<size_t>(g.frame_width) + 2 * chroma_width + 3 * static_cast<size_t>(out_width));
+    uint8_t* blended = scratch.data();
+    uint8_t* blended_u = blended + g.frame_width;
+    uint8_t* blended_v = blended_u + chroma_width;
+    uint8_t* out_y = blended_v + chroma_width;
+    uint8_t* out_u = out_y + out_width;
+    uint8_t* out_v = out_u + chroma_columns_.size();
+
+    auto blend = [&](const uint8_t* plane, uint32_t stride, const Tap& tap,
+                     uint32_t begin, uint32_t end, uint8_t* row) -> const uint8_t* {
+        const uint8_t* a = plane + static_cast<size_t>(tap.first) * stride;
+        if (tap.weight == 0) return a;
+        blend_rows(a + begin, plane + static_cast<size_t>(tap.second) * stride + begin, tap.weight,
+                   row + begin, end - begin);
+        return row;
+    };
+
+    for (uint32_t y = first; y < last; ++y) {
+        const uint8_t* luma = blend(planes_[0], g.frame_width, luma_rows_[y], luma_begin, luma_end, blended);
+        const uint8_t* row_y = luma + g.src.x;
+        if (!luma_unscaled_) {
+            resample_row(luma, luma_columns_.data(), out_y, out_width);
+            row_y = out_y;
+        }
+        const Tap& chroma_tap = chroma_rows_[y];
+        const uint8_t* chroma_u = blend(planes_[1], chroma_width, chroma_tap, chroma_begin, chroma_end, blended_u);
+        const uint8_t* chroma_v = blend(planes_[2], chroma_width, chroma_tap, chroma_begin, chroma_end, blended_v);
+        const uint8_t* row_u = chroma_u + g.src.x / 2;
+        const uint8_t* row_v = chroma_v + g.src.x / 2;
+        if (!chroma_unscaled_) {
+            resample_rows(chroma_u, chroma_v, chroma_columns_.data(), out_u, out_v,
+                          static_cast<uint32_t>(chroma_columns_.size()));
+            row_u = out_u;
+            row_v = out_v;
+        }
+        yuv_to_bgrx(row_y, row_u, row_v, dst_ + static_cast<size_t>(y) * pitch_, out_width);
+    }
+}
+
+} // namespace lancast
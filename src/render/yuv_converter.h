@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/types.h"
+#include "core/jthread.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace lancast {
+
+// I420 -> 32-bit BGRX (SDL_PIXELFORMAT_XRGB8888 on little endian) with the
+// scaling fused in: each output row is blended vertically from two source
+// rows, resampled horizontally and converted in one pass, so the frame is
+// read once and written once. Bilinear, with one chroma sample per output
+// pixel pair; BT.601 limited range (what SDL assumes for IYUV textures).
+// SSE2 on x86, portable C elsewhere.
+//
+// Used where SDL falls back to its software renderer, which otherwise
+// converts and scales in generic C. Row bands are spread over a small pool
+// of worker threads; the calling thread converts one band itself.
+class YuvConverter {
+public:
+    // threads = 0 picks from the core count; 1 converts on the caller only
+    explicit YuvConverter(size_t threads = 0);
+    ~YuvConverter();
+
+    YuvConverter(const YuvConverter&) = delete;
+    YuvConverter& operator=(const YuvConverter&) = delete;
+
+    // Converts src of frame into a dst_width x dst_height BGRX image at dst
+    // (pitch bytes per row). Returns false if the frame is too small for its
+    // size or src falls outside it.
+    bool convert(const RawVideoFrame& frame, const PixelRect& src,
+                 uint8_t* dst, int pitch, uint32_t dst_width, uint32_t dst_height);
+
+    size_t threads() const { return workers_.size() + 1; }
+
+private:
+    // Source position of an output column or row: the two samples around it
+    // and the weight (0..128) of the second
+    struct Tap {
+        uint32_t first;
+        uint32_t second;
+        uint32_t weight;
+    };
+
+    struct Geometry {
+        uint32_t frame_width = 0;
+        uint32_t frame_height = 0;
+        PixelRect src;
+        uint32_t dst_width = 0;
+        uint32_t dst_height = 0;
+
+        bool operator==(const Geometry& o) const {
+            return frame_width == o.frame_width && frame_height == o.frame_height &&
+                   src.x == o.src.x && src.y == o.src.y && src.width == o.src.width &&
+                   src.height == o.src.height && dst_width == o.dst_width && dst_height == o.dst_height;
+        }
+    };
+
+    void build_taps();
+    void convert_rows(uint32_t first, uint32_t last);
+    void worker_loop(size_t band);
+
+    // Current job, written by convert() before the workers are woken
+    Geometry geometry_;
+    const uint8_t* planes_[3] = {};
+    uint8_t* dst_ = nullptr;
+    int pitch_ = 0;
+    bool luma_unscaled_ = false;    // Output columns map 1:1 onto the crop
+    bool chroma_unscaled_ = false;  // ...and output pairs onto chroma samples
+    std::vector<Tap> luma_columns_;
+    std::vector<Tap> chroma_columns_;
+    std::vector<Tap> luma_rows_;
+    std::vector<Tap> chroma_rows_;
+
+    size_t bands_ = 1;
+    std::vector<lancast::jthread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable done_cv_;
+    uint64_t job_generation_ = 0;
+    size_t bands_pending_ = 0;
+    bool stopping_ = false;
+};
+
+} // namespace lancast
@@ -0,0 +1,84 @@
+// Command-line front end for a running host's control socket
+// (lancast --host --control-socket PATH). Prints the JSON response line.
+
+#include "net/control_socket.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace lancast;
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--socket PATH] COMMAND\n", prog);
+    fprintf(stderr, "  status                     Session, encoder, network and per-client stats\n");
+    fprintf(stderr, "  set KEY=VALUE ...          Change settings live:\n");
+    fprintf(stderr, "                               bitrate=BPS fps=N resolution=WxH\n");
+    fprintf(stderr, "                               pacing=BPS|auto log_level=debug|info|warn|error\n");
+    fprintf(stderr, "  replay [path=FILE] [seconds=N]\n");
+    fprintf(stderr, "                             Save the host's replay buffer (--replay) to FILE\n");
+    fprintf(stderr, "                               (.mkv or .mp4; default lancast-replay-<time>.mkv)\n");
+    fprintf(stderr, "  raw JSON                   Send a request line as is\n");
+    fprintf(stderr, "  --socket PATH              Control socket (default %s)\n", DEFAULT_CONTROL_SOCKET);
+}
+
+static bool is_number(const char* s) {
+    if (!*s) return false;
+    for (; *s; ++s) {
+        if (*s < '0' || *s > '9') return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path = DEFAULT_CONTROL_SOCKET;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+    if (i >= argc) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::string cmd = argv[i++];
+    std::string line;
+    if (cmd == "raw") {
+        if (i + 1 != argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        line = argv[i];
+    } else {
+        JsonWriter json;
+        json.begin_object().field("cmd", cmd);
+        for (; i < argc; ++i) {
+            const char* eq = strchr(argv[i], '=');
+            if (!eq || eq == argv[i]) {
+                fprintf(stderr, "Expected KEY=VALUE, got \"%s\"\n", argv[i]);
+                return 1;
+            }
+            std::string key(argv[i], eq - argv[i]);
+            if (is_number(eq + 1)) {
+                json.field(key.c_str(), static_cast<uint64_t>(strtoull(eq + 1, nullptr, 10)));
+            } else {
+                json.field(key.c_str(), eq + 1);
+            }
+        }
+        json.end_object();
+        line = json.str();
+    }
+
+    auto response = ControlSocket::request(path, line);
+    if (!response) {
+        fprintf(stderr, "No response from %s (is the host running with --control-socket?)\n", path.c_str());
+        return 1;
+    }
+    printf("%s\n", response->c_str());
+    return response->find("\"ok\":true") != std::string::npos ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+// Floods a local Server with client control traffic (PONG, NACK, mic audio)
+// from simulated clients, to measure the receive path with and without
+// SO_REUSEPORT sharding (--rx-shards).
+
+#include "core/logger.h"
+#include "net/packet_fragmenter.h"
+#include "net/protocol.h"
+#include "net/server.h"
+#include "net/socket.h"
+#include "net/winsock_init.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lancast;
+
+static constexpr const char* TAG = "FloodBench";
+
+struct BenchOptions {
+    uint16_t port = 47400;
+    size_t clients = 32;
+    size_t senders = 4;
+    double seconds = 3.0;
+    uint32_t rate = 0;  // Datagrams per second per client, 0 = unpaced
+    std::vector<size_t> shard_counts = {1, 2, 4};
+};
+
+struct RunResult {
+    size_t shards = 0;
+    uint64_t sent = 0;
+    uint64_t handled = 0;
+    double seconds = 0.0;
+};
+
+static Packet control_packet(PacketType type) {
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(type);
+    return pkt;
+}
+
+// The three datagrams a simulated client cycles through
+static std::vector<std::vector<uint8_t>> client_traffic(uint32_t& sequence) {
+    std::vector<std::vector<uint8_t>> out;
+
+    // PONG with an implausible timestamp: parsed, then rejected by the RTT sanity check
+    Packet pong = control_packet(PacketType::PONG);
+    PingPayload pp;
+    pp.timestamp_us = 1;
+    pong.payload.resize(sizeof(pp));
+    std::memcpy(pong.payload.data(), &pp, sizeof(pp));
+    out.push_back(pong.serialize());
+
+    // NACK for a keyframe the host never sent: parsed and ignored, no resend
+    Packet nack = control_packet(PacketType::NACK);
+    NackPayload np;
+    np.frame_id = 0xFFFF;
+    np.num_missing = 4;
+    nack.payload.resize(sizeof(np) + np.num_missing * sizeof(uint16_t));
+    std::memcpy(nack.payload.data(), &np, sizeof(np));
+    out.push_back(nack.serialize());
+
+    // One 20 ms Opus-sized mic frame
+    EncodedPacket mic;
+    mic.type = FrameType::ClientAudio;
+    mic.data.assign(160, 0x5A);
+    PacketFragmenter fragmenter;
+    for (const auto& frag : fragmenter.fragment(mic, sequence)) {
+        out.push_back(frag.serialize());
+    }
+    return out;
+}
+
+static RunResult run(const BenchOptions& opt, size_t shards) {
+    RunResult result;
+
+    Server server(opt.port);
+    server.set_receive_shards(shards);
+    if (!server.start()) {
+        LOG_ERROR(TAG, "Server failed to start on port %u", opt.port);
+        return result;
+    }
+    result.shards = server.receive_shards();
+
+    std::atomic<bool> receiving{true};
+    std::vector<std::thread> receivers;
+    receivers.emplace_back([&] {
+        while (receiving.load(std::memory_order_relaxed)) server.poll();
+    });
+    for (size_t i = 1; i < server.receive_shards(); ++i) {
+        receivers.emplace_back([&, i] {
+            while (receiving.load(std::memory_order_relaxed)) server.poll_shard(i);
+        });
+    }
+
+    Endpoint dest{"127.0.0.1", opt.port};
+    std::vector<UdpSocket> clients(opt.clients);
+    auto hello = control_packet(PacketType::HELLO).serialize();
+    for (auto& c : clients) {
+        c.set_send_buffer(1 << 20);
+        c.send_to(hello, dest);
+    }
+    auto join_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (server.client_count() < clients.size() &&
+           std::chrono::steady_clock::now() < join_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (server.client_count() < clients.size()) {
+        LOG_WARN(TAG, "Only %zu of %zu clients joined", server.client_count(), clients.size());
+    }
+    uint64_t baseline = server.stats().rx_packets;
+
+    std::atomic<bool> sending{true};
+    std::atomic<uint64_t> sent{0};
+    std::vector<std::thread> senders;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < opt.senders; ++t) {
+        senders.emplace_back([&, t] {
+            uint32_t sequence = 0;
+            auto traffic = client_traffic(sequence);
+            auto interval = opt.rate > 0
+                ? std::chrono::nanoseconds(1'000'000'000 / opt.rate)
+                : std::chrono::nanoseconds(0);
+            auto next = std::chrono::steady_clock::now();
+            uint64_t local = 0;
+            size_t k = 0;
+            while (sending.load(std::memory_order_relaxed)) {
+                for (size_t c = t; c < clients.size(); c += opt.senders) {
+                    const auto& data = traffic[k % traffic.size()];
+                    if (clients[c].send_to(data, dest) > 0) local++;
+                }
+                k++;
+                if (opt.rate > 0) {
+                    next += interval;
+                    std::this_thread::sleep_until(next);
+                }
+            }
+            sent.fetch_add(local);
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.seconds));
+    sending = false;
+    for (auto& s : senders) s.join();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Let the receivers drain what is already queued
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    receiving = false;
+    for (auto& r : receivers) r.join();
+    server.stop();
+
+    result.sent = sent.load();
+    result.handled = server.stats().rx_packets - baseline;
+    return result;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --clients N      Simulated clients (default 32)\n");
+    fprintf(stderr, "  --senders N      Sending threads (default 4)\n");
+    fprintf(stderr, "  --seconds S      Duration per run (default 3)\n");
+    fprintf(stderr, "  --rate PPS       Datagrams per second per client (default: unpaced)\n");
+    fprintf(stderr, "  --shards LIST    Comma-separated shard counts to compare (default 1,2,4)\n");
+    fprintf(stderr, "  --port PORT      Server port (default 47400)\n");
+    fprintf(stderr, "  --verbose, -v    Server logging\n");
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    WinsockInit winsock;
+#endif
+    BenchOptions opt;
+    Logger::set_level(LogLevel::Warn);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            opt.clients = static_cast<size_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--senders") == 0 && i + 1 < argc) {
+            opt.senders = static_cast<size_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            opt.seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            opt.rate = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc) {
+            opt.shard_counts.clear();
+            for (char* tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ",")) {
+                opt.shard_counts.push_back(static_cast<size_t>(atoi(tok)));
+            }
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            opt.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
+            Logger::set_level(LogLevel::Info);
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+    if (opt.clients == 0 || opt.senders == 0 || opt.seconds <= 0 || opt.shard_counts.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    opt.senders = std::min(opt.senders, opt.clients);
+
+    printf("%zu clients, %zu sender threads, %.1f s per run%s\n",
+           opt.clients, opt.senders, opt.seconds, opt.rate ? "" : ", unpaced");
+    printf("%-8s %12s %12s %14s %8s\n", "shards", "sent", "handled", "handled/s", "lost");
+    for (size_t shards : opt.shard_counts) {
+        RunResult r = run(opt, shards);
+        if (r.shards == 0) return 1;
+        double lost = r.sent > 0 ? 100.0 * (r.sent - std::min(r.handled, r.sent)) / r.sent : 0.0;
+        printf("%-8zu %12" PRIu64 " %12" PRIu64 " %14.0f %7.1f%%\n",
+               r.shards, r.sent, r.handled, r.handled / r.seconds, lost);
+    }
+    return 0;
+}
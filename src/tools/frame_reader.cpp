@@ -0,0 +1,126 @@
+// Reads the decoded frames a viewer shares (lancast --client IP
+// --share-frames NAME). Prints frame rate, size and age once a second, or
+// with --raw writes the frames to stdout as I420 for tools like
+//
+//   lancast_frames NAME --raw | ffplay -f rawvideo -pixel_format yuv420p -video_size WxH -
+
+#include "render/frame_share.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lancast;
+
+static std::atomic<bool> g_running{true};
+
+static void signal_handler(int) {
+    g_running.store(false);
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s NAME [--raw]\n", prog);
+    fprintf(stderr, "  NAME    What the viewer was started with (--share-frames NAME)\n");
+    fprintf(stderr, "  --raw   Write each frame to stdout as I420 instead of printing stats;\n");
+    fprintf(stderr, "          stops if the frame size changes\n");
+}
+
+static int64_t monotonic_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[]) {
+    std::string name;
+    bool raw = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--raw") == 0) {
+            raw = true;
+        } else if (argv[i][0] != '-' && name.empty()) {
+            name = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+    if (name.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+#ifdef SIGPIPE
+    std::signal(SIGPIPE, SIG_IGN);  // A closed pipe shows up as a short fwrite
+#endif
+
+    FrameShareReader reader;
+    if (!reader.attach(name)) return 1;
+    fprintf(stderr, "Attached to \"%s\" (%u slots)\n", name.c_str(), reader.slot_count());
+
+    uint64_t last = 0;
+    uint32_t width = 0, height = 0;
+    std::vector<uint8_t> copy;
+
+    // Per-second stats
+    auto report_time = std::chrono::steady_clock::now();
+    uint64_t frames = 0, missed = 0, torn = 0;
+    double age_ms = 0.0;
+
+    while (g_running.load() && !reader.publisher_closed()) {
+        auto frame = reader.latest(last);
+        if (!frame) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        } else {
+            if (last != 0) missed += frame->sequence - last - 1;
+            last = frame->sequence;
+
+            if (raw) {
+                if (width != 0 && (frame->width != width || frame->height != height)) {
+                    fprintf(stderr, "Frame size changed from %ux%u to %ux%u; stopping\n", width, height,
+                            frame->width, frame->height);
+                    break;
+                }
+                width = frame->width;
+                height = frame->height;
+                // Copied out first so a torn frame never reaches the pipe
+                copy.assign(frame->y, frame->y + frame->size);
+                if (!reader.still_valid(*frame)) {
+                    torn++;
+                    continue;
+                }
+                if (fwrite(copy.data(), 1, copy.size(), stdout) != copy.size()) break;
+            } else {
+                age_ms += (monotonic_now_us() - frame->published_us) / 1000.0;
+                width = frame->width;
+                height = frame->height;
+            }
+            frames++;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - report_time >= std::chrono::seconds(1)) {
+            double seconds = std::chrono::duration<double>(now - report_time).count();
+            if (raw) {
+                fprintf(stderr, "%ux%u  %.1f fps  missed %llu  torn %llu\n", width, height, frames / seconds,
+                        static_cast<unsigned long long>(missed), static_cast<unsigned long long>(torn));
+            } else {
+                printf("%ux%u  %.1f fps  age %.2f ms  missed %llu  too large %llu\n", width, height,
+                       frames / seconds, frames ? age_ms / frames : 0.0, static_cast<unsigned long long>(missed),
+                       static_cast<unsigned long long>(reader.frames_skipped()));
+                fflush(stdout);
+            }
+            report_time = now;
+            frames = missed = torn = 0;
+            age_ms = 0.0;
+        }
+    }
+
+    if (reader.publisher_closed()) fprintf(stderr, "The viewer stopped sharing \"%s\"\n", name.c_str());
+    return 0;
+}
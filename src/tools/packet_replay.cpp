@@ -0,0 +1,217 @@
+// Offline replay of a client packet trace (recorded with --record-packets)
+// through PacketAssembler, VideoDecoder and AudioDecoder, without a host.
+
+#include "core/logger.h"
+#include "core/perf_counters.h"
+#include "net/packet_assembler.h"
+#include "net/packet_trace.h"
+#include "net/protocol.h"
+#include "decode/video_decoder.h"
+#include "decode/audio_decoder.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace lancast;
+
+static constexpr const char* TAG = "Replay";
+
+struct ReplayStats {
+    uint64_t packets = 0;
+    uint64_t invalid = 0;
+    uint64_t video_frames = 0;
+    uint64_t audio_frames = 0;
+    uint64_t frames_dropped = 0;
+    uint64_t video_decoded = 0;
+    uint64_t audio_decoded = 0;
+    double decode_ms = 0.0;
+    double audio_decode_ms = 0.0;
+    uint64_t checksum = 1469598103934665603ull;  // FNV-1a over assembled frames
+};
+
+static void fnv1a(uint64_t& hash, const std::vector<uint8_t>& data) {
+    for (uint8_t b : data) {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s TRACE [options]\n", prog);
+    fprintf(stderr, "  --realtime       Replay with the original packet timing (default: as fast as possible)\n");
+    fprintf(stderr, "  --loop N         Replay the trace N times\n");
+    fprintf(stderr, "  --no-decode      Stop after reassembly\n");
+    fprintf(stderr, "  --perf-counters  Print per-stage CPU time and hardware counters\n");
+    fprintf(stderr, "  --verbose, -v    Debug logging\n");
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool replay_once(PacketTraceReader& reader, bool realtime, bool decode, ReplayStats& stats) {
+    PacketAssembler assembler;
+    StreamConfig config;
+    bool have_welcome = false;
+    std::unique_ptr<VideoDecoder> video;
+    std::unique_ptr<AudioDecoder> audio;
+
+    auto base = std::chrono::steady_clock::now();
+    reader.rewind();
+
+    while (auto rec = reader.next()) {
+        // Assembler timeouts run on trace time, so fast replay is deterministic
+        auto now = base + std::chrono::microseconds(rec->offset_us);
+        if (realtime) {
+            std::this_thread::sleep_until(now);
+        }
+
+        stats.packets++;
+        auto pkt = Packet::deserialize(rec->data, rec->size);
+        if (!pkt.header.is_valid()) {
+            stats.invalid++;
+            continue;
+        }
+
+        auto type = static_cast<PacketType>(pkt.header.type);
+        if (type == PacketType::WELCOME && pkt.payload.size() >= sizeof(WelcomePayload)) {
+            WelcomePayload wp;
+            std::memcpy(&wp, pkt.payload.data(), sizeof(WelcomePayload));
+            config.width = wp.width;
+            config.height = wp.height;
+            config.fps = wp.fps;
+            config.audio_sample_rate = wp.audio_sample_rate;
+            config.audio_channels = wp.audio_channels;
+            have_welcome = true;
+            continue;
+        }
+        if (type == PacketType::STREAM_CONFIG) {
+            config.codec_data = pkt.payload;
+            continue;
+        }
+        if (type != PacketType::VIDEO_DATA && type != PacketType::AUDIO_DATA) continue;
+
+        std::optional<EncodedPacket> frame;
+        if (type == PacketType::VIDEO_DATA) {
+            PerfScope perf(PerfStage::Assemble, false);
+            frame = assembler.feed(pkt, now);
+        } else {
+            frame = assembler.feed(pkt, now);
+        }
+        stats.frames_dropped += assembler.purge_stale(200, now);
+        if (!frame) continue;
+
+        fnv1a(stats.checksum, frame->data);
+
+        if (frame->type == FrameType::Audio) {
+            stats.audio_frames++;
+            if (!decode) continue;
+            if (!audio && have_welcome) {
+                audio = std::make_unique<AudioDecoder>();
+                if (!audio->init(config.audio_sample_rate, config.audio_channels)) return false;
+            }
+            if (!audio) continue;
+            auto start = std::chrono::steady_clock::now();
+            if (audio->decode(*frame)) stats.audio_decoded++;
+            stats.audio_decode_ms += elapsed_ms(start);
+        } else {
+            stats.video_frames++;
+            PerfCounters::count_frame(PerfStage::Assemble);
+            if (!decode) continue;
+            if (!video) {
+                if (!have_welcome) {
+                    LOG_WARN(TAG, "Trace has no WELCOME; recording must start before connect to decode");
+                    decode = false;
+                    continue;
+                }
+                video = std::make_unique<VideoDecoder>();
+                if (!video->init(config.width, config.height, config.codec_data)) return false;
+            }
+            auto start = std::chrono::steady_clock::now();
+            std::optional<RawVideoFrame> decoded;
+            {
+                PerfScope perf(PerfStage::Decode);
+                decoded = video->decode(*frame);
+            }
+            if (decoded) stats.video_decoded++;
+            stats.decode_ms += elapsed_ms(start);
+        }
+    }
+
+    if (video) video->shutdown();
+    if (audio) audio->shutdown();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string path;
+    bool realtime = false;
+    bool decode = true;
+    bool perf_counters = false;
+    int loops = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--loop") == 0 && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-decode") == 0) {
+            decode = false;
+        } else if (strcmp(argv[i], "--perf-counters") == 0) {
+            perf_counters = true;
+        } else if (strcmp(argv[i], "--verbose") == 0 || strcmp(argv[i], "-v") == 0) {
+            Logger::set_level(LogLevel::Debug);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] != '-' && path.empty()) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (path.empty() || loops < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (perf_counters) PerfCounters::enable();
+
+    PacketTraceReader reader;
+    if (!reader.open(path)) return 1;
+
+    ReplayStats stats;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; ++i) {
+        if (!replay_once(reader, realtime, decode, stats)) {
+            LOG_ERROR(TAG, "Decoder initialization failed");
+            return 1;
+        }
+    }
+    double wall_ms = elapsed_ms(start);
+
+    printf("packets        %" PRIu64 " (%" PRIu64 " invalid)\n", stats.packets, stats.invalid);
+    printf("frames         video %" PRIu64 ", audio %" PRIu64 ", dropped %" PRIu64 "\n",
+           stats.video_frames, stats.audio_frames, stats.frames_dropped);
+    if (decode) {
+        printf("decoded        video %" PRIu64 " (%.3f ms/frame), audio %" PRIu64 " (%.3f ms/frame)\n",
+               stats.video_decoded,
+               stats.video_decoded ? stats.decode_ms / stats.video_decoded : 0.0,
+               stats.audio_decoded,
+               stats.audio_decoded ? stats.audio_decode_ms / stats.audio_decoded : 0.0);
+    }
+    printf("wall time      %.1f ms (%.1f video frames/s)\n", wall_ms,
+           wall_ms > 0 ? stats.video_frames * 1000.0 / wall_ms : 0.0);
+    printf("checksum       %016" PRIx64 "\n", stats.checksum);
+
+    std::string report = PerfCounters::report();
+    if (!report.empty()) printf("%s\n", report.c_str());
+    return 0;
+}
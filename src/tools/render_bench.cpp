@@ -0,0 +1,182 @@
+// Render time per frame on SDL's software renderer: the stock path (IYUV
+// texture, SDL converts and scales) against YuvConverter (SIMD conversion
+// with fused scaling into a window-sized BGRX texture), which SdlRenderer
+// uses when no GPU renderer is available. Runs headless on an offscreen
+// surface.
+
+#include "core/logger.h"
+#include "render/yuv_converter.h"
+
+#include <SDL3/SDL.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace lancast;
+
+struct BenchOptions {
+    uint32_t source_width = 1920;
+    uint32_t source_height = 1080;
+    std::vector<std::pair<uint32_t, uint32_t>> outputs = {{1920, 1080}, {1280, 720}, {2560, 1440}};
+    uint32_t frames = 120;
+    size_t threads = 0;  // YuvConverter default
+};
+
+static bool parse_size(const char* str, uint32_t& w, uint32_t& h) {
+    const char* x = strchr(str, 'x');
+    if (!x) return false;
+    w = static_cast<uint32_t>(atoi(str));
+    h = static_cast<uint32_t>(atoi(x + 1));
+    return w >= 2 && h >= 2;
+}
+
+// Moving gradient with some detail, so nothing is trivially constant
+static RawVideoFrame make_frame(uint32_t w, uint32_t h, uint32_t n) {
+    RawVideoFrame frame;
+    frame.width = w;
+    frame.height = h;
+    size_t y_size = static_cast<size_t>(w) * h;
+    frame.data.resize(y_size + y_size / 2);
+    for (uint32_t row = 0; row < h; ++row) {
+        for (uint32_t col = 0; col < w; ++col) {
+            frame.data[row * w + col] = static_cast<uint8_t>(16 + ((col + n * 4) ^ row) % 220);
+        }
+    }
+    for (size_t i = y_size; i < frame.data.size(); ++i) {
+        frame.data[i] = static_cast<uint8_t>(64 + (i + n) % 128);
+    }
+    return frame;
+}
+
+// Mean milliseconds per frame of draw() followed by a flush of the renderer
+static double time_frames(SDL_Renderer* renderer, const std::vector<RawVideoFrame>& frames, uint32_t count,
+                          const std::function<bool(const RawVideoFrame&)>& draw) {
+    // One untimed frame creates textures and warms caches
+    if (!draw(frames[0]) || !SDL_FlushRenderer(renderer)) return -1.0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!draw(frames[i % frames.size()])) return -1.0;
+        SDL_FlushRenderer(renderer);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / count;
+}
+
+static double run_sdl(const BenchOptions& opt, const std::vector<RawVideoFrame>& frames, uint32_t out_w, uint32_t out_h) {
+    SDL_Surface* surface = SDL_CreateSurface(static_cast<int>(out_w), static_cast<int>(out_h), SDL_PIXELFORMAT_XRGB8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    SDL_Texture* texture = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_IYUV, SDL_TEXTUREACCESS_STREAMING,
+                                                        static_cast<int>(opt.source_width),
+                                                        static_cast<int>(opt.source_height))
+                                    : nullptr;
+    double ms = -1.0;
+    if (texture) {
+        int w = static_cast<int>(opt.source_width);
+        size_t y_size = static_cast<size_t>(opt.source_width) * opt.source_height;
+        ms = time_frames(renderer, frames, opt.frames, [&](const RawVideoFrame& frame) {
+            const uint8_t* y = frame.data.data();
+            SDL_UpdateYUVTexture(texture, nullptr, y, w, y + y_size, w / 2, y + y_size + y_size / 4, w / 2);
+            SDL_RenderClear(renderer);
+            return SDL_RenderTexture(renderer, texture, nullptr, nullptr);
+        });
+    } else {
+        fprintf(stderr, "SDL software renderer setup failed: %s\n", SDL_GetError());
+    }
+    if (texture) SDL_DestroyTexture(texture);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (surface) SDL_DestroySurface(surface);
+    return ms;
+}
+
+static double run_converter(const BenchOptions& opt, const std::vector<RawVideoFrame>& frames,
+                            uint32_t out_w, uint32_t out_h, YuvConverter& converter) {
+    SDL_Surface* surface = SDL_CreateSurface(static_cast<int>(out_w), static_cast<int>(out_h), SDL_PIXELFORMAT_XRGB8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    SDL_Texture* texture = renderer ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_XRGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                                        static_cast<int>(out_w), static_cast<int>(out_h))
+                                    : nullptr;
+    double ms = -1.0;
+    if (texture) {
+        PixelRect src{0, 0, opt.source_width, opt.source_height};
+        ms = time_frames(renderer, frames, opt.frames, [&](const RawVideoFrame& frame) {
+            void* pixels = nullptr;
+            int pitch = 0;
+            if (!SDL_LockTexture(texture, nullptr, &pixels, &pitch)) return false;
+            bool ok = converter.convert(frame, src, static_cast<uint8_t*>(pixels), pitch, out_w, out_h);
+            SDL_UnlockTexture(texture);
+            SDL_RenderClear(renderer);
+            return ok && SDL_RenderTexture(renderer, texture, nullptr, nullptr);
+        });
+    } else {
+        fprintf(stderr, "SDL software renderer setup failed: %s\n", SDL_GetError());
+    }
+    if (texture) SDL_DestroyTexture(texture);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (surface) SDL_DestroySurface(surface);
+    return ms;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --source WxH     Decoded frame size (default 1920x1080)\n");
+    fprintf(stderr, "  --output LIST    Comma-separated window sizes (default 1920x1080,1280x720,2560x1440)\n");
+    fprintf(stderr, "  --frames N       Frames per run (default 120)\n");
+    fprintf(stderr, "  --threads N      Converter threads (default: as SdlRenderer picks)\n");
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    Logger::set_level(LogLevel::Warn);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--source") == 0 && i + 1 < argc) {
+            if (!parse_size(argv[++i], opt.source_width, opt.source_height)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            opt.outputs.clear();
+            for (char* tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ",")) {
+                uint32_t w = 0, h = 0;
+                if (!parse_size(tok, w, h)) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                opt.outputs.emplace_back(w, h);
+            }
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            opt.frames = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            opt.threads = static_cast<size_t>(atoi(argv[++i]));
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+    if (opt.frames == 0 || opt.outputs.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<RawVideoFrame> frames;
+    for (uint32_t n = 0; n < 4; ++n) frames.push_back(make_frame(opt.source_width, opt.source_height, n));
+
+    YuvConverter single(1);
+    YuvConverter pooled(opt.threads);
+    printf("Source %ux%u, %u frames per run, software renderer\n", opt.source_width, opt.source_height, opt.frames);
+    printf("%-12s %14s %14s %14s\n", "output", "sdl ms", "simd 1t ms",
+           ("simd " + std::to_string(pooled.threads()) + "t ms").c_str());
+    for (auto [w, h] : opt.outputs) {
+        double sdl = run_sdl(opt, frames, w, h);
+        double one = run_converter(opt, frames, w, h, single);
+        double many = run_converter(opt, frames, w, h, pooled);
+        if (sdl < 0 || one < 0 || many < 0) return 1;
+        std::string size = std::to_string(w) + "x" + std::to_string(h);
+        printf("%-12s %14.2f %14.2f %14.2f   (%.1fx)\n", size.c_str(), sdl, one, many, sdl / many);
+    }
+    return 0;
+}
@@ -0,0 +1,155 @@
+// Time from launch to the first rendered frame, broken down by setup phase.
+// Starts a host in-process and a viewer against it over loopback (or only
+// a viewer against --connect IP), stops once the viewer has shown its
+// first frame and prints both startup timelines. Phases that ran side by
+// side overlap in the listing.
+
+#include "app/client_session.h"
+#include "app/host_session.h"
+#include "core/logger.h"
+#include "core/startup_timeline.h"
+#include "net/protocol.h"
+#include "net/winsock_init.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace lancast;
+
+static constexpr auto FIRST_FRAME_TIMEOUT = std::chrono::seconds(15);
+
+struct BenchOptions {
+    std::string connect_ip;  // Empty: run the host in-process
+    uint16_t port = DEFAULT_PORT + 7;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t fps = 30;
+    uint32_t bitrate = 6000000;
+    uint32_t runs = 1;
+};
+
+static void print_timeline(const char* who, const StartupTimeline& timeline) {
+    printf("%s:\n", who);
+    printf("  %-22s %9s %9s %9s\n", "phase", "start ms", "end ms", "took ms");
+    for (const auto& p : timeline.phases()) {
+        if (p.end_ms > p.start_ms) {
+            printf("  %-22s %9.1f %9.1f %9.1f\n", p.name.c_str(), p.start_ms, p.end_ms, p.end_ms - p.start_ms);
+        } else {
+            printf("  %-22s %9s %9.1f\n", p.name.c_str(), "", p.end_ms);
+        }
+    }
+}
+
+// Runs a viewer until its first frame; returns launch-to-first-frame in ms
+static std::optional<double> run_viewer(const std::string& ip, uint16_t port) {
+    ClientSession viewer;
+    if (!viewer.connect(ip, port)) return std::nullopt;
+
+    std::atomic<bool> running{true};
+    std::optional<double> first_frame;
+    {
+        // The render loop owns the main thread; this one ends it
+        lancast::jthread watcher([&](lancast::stop_token st) {
+            auto deadline = std::chrono::steady_clock::now() + FIRST_FRAME_TIMEOUT;
+            while (!st.stop_requested() && running.load() && std::chrono::steady_clock::now() < deadline) {
+                first_frame = viewer.startup().at("first_frame");
+                if (first_frame) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            running = false;
+        });
+        viewer.run(running);
+        running = false;
+    }
+    viewer.stop();
+    print_timeline("Viewer", viewer.startup());
+    return first_frame;
+}
+
+static bool run_once(const BenchOptions& opt) {
+    if (!opt.connect_ip.empty()) {
+        auto first_frame = run_viewer(opt.connect_ip, opt.port);
+        if (!first_frame) {
+            fprintf(stderr, "No frame within %lld s\n", static_cast<long long>(FIRST_FRAME_TIMEOUT.count()));
+            return false;
+        }
+        printf("Time to first frame: %.1f ms\n", *first_frame);
+        return true;
+    }
+
+    std::atomic<bool> host_running{true};
+    HostSession host;
+    if (!host.start(opt.port, opt.fps, opt.bitrate, opt.width, opt.height, 0, host_running)) {
+        fprintf(stderr, "Host failed to start\n");
+        return false;
+    }
+    double host_ready = host.startup().at("ready").value_or(0.0);
+    auto first_frame = run_viewer("127.0.0.1", opt.port);
+    host_running = false;
+    host.stop();
+    print_timeline("Host", host.startup());
+    if (!first_frame) {
+        fprintf(stderr, "No frame within %lld s\n", static_cast<long long>(FIRST_FRAME_TIMEOUT.count()));
+        return false;
+    }
+    printf("Time to first frame: %.1f ms (host ready %.1f ms, then viewer %.1f ms)\n",
+           host_ready + *first_frame, host_ready, *first_frame);
+    return true;
+}
+
+static bool parse_size(const char* str, uint32_t& w, uint32_t& h) {
+    const char* x = strchr(str, 'x');
+    if (!x) return false;
+    w = static_cast<uint32_t>(atoi(str));
+    h = static_cast<uint32_t>(atoi(x + 1));
+    return w > 0 && h > 0;
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [options]\n", prog);
+    fprintf(stderr, "  --connect IP     Only start a viewer, against this host\n");
+    fprintf(stderr, "  --port N         Host port (default %u)\n", static_cast<unsigned>(DEFAULT_PORT + 7));
+    fprintf(stderr, "  --resolution WxH In-process host capture size (default: screen)\n");
+    fprintf(stderr, "  --fps N          In-process host frame rate (default 30)\n");
+    fprintf(stderr, "  --runs N         Repeat the measurement (default 1)\n");
+}
+
+int main(int argc, char* argv[]) {
+#ifdef _WIN32
+    WinsockInit winsock;
+#endif
+    BenchOptions opt;
+    Logger::set_level(LogLevel::Warn);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            opt.connect_ip = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            opt.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+            if (!parse_size(argv[++i], opt.width, opt.height)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            opt.fps = static_cast<uint32_t>(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            opt.runs = static_cast<uint32_t>(atoi(argv[++i]));
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+        }
+    }
+
+    for (uint32_t run = 0; run < opt.runs; ++run) {
+        if (opt.runs > 1) printf("--- Run %u ---\n", run + 1);
+        if (!run_once(opt)) return 1;
+    }
+    return 0;
+}
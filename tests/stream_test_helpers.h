@@ -0,0 +1,44 @@
+#pragma once
+
+// Stream fixtures shared by the tests that run a Server and a Client
+// against each other
+
+#include "net/client.h"
+#include "core/thread_safe_queue.h"
+#include "core/types.h"
+#include <chrono>
+#include <optional>
+
+namespace lancast::test {
+
+inline StreamConfig make_config(uint32_t width, uint32_t height, uint32_t fps, uint8_t sps) {
+    StreamConfig config;
+    config.width = width;
+    config.height = height;
+    config.fps = fps;
+    config.codec_data = {0x00, 0x00, 0x00, 0x01, 0x67, sps};
+    return config;
+}
+
+// Large enough to take several fragments
+inline EncodedPacket keyframe(uint8_t stream, uint16_t frame_id, uint8_t fill = 0x42) {
+    EncodedPacket frame;
+    frame.type = FrameType::VideoKeyframe;
+    frame.stream_id = stream;
+    frame.frame_id = frame_id;
+    frame.data.assign(3000, fill);
+    return frame;
+}
+
+// Poll the client until a video frame is assembled or the timeout expires
+inline std::optional<EncodedPacket> receive_video(Client& client, std::chrono::milliseconds timeout) {
+    ThreadSafeQueue<EncodedPacket> video(8), audio(8);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        client.poll(video, audio);
+        if (auto frame = video.try_pop()) return frame;
+    }
+    return std::nullopt;
+}
+
+} // namespace lancast::test
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "core/autotune.h"
+
+using namespace lancast;
+
+static constexpr uint64_t PIXELS_1080P = 1920ull * 1080;
+
+static AutotuneLimits limits(uint32_t max_fps = 60, uint32_t presets = 3) {
+    AutotuneLimits l;
+    l.max_fps = max_fps;
+    l.min_fps = 15;
+    l.presets = presets;
+    return l;
+}
+
+static AutotuneSample sample(double encode_ms, double motion, uint32_t bitrate = 20'000'000) {
+    AutotuneSample s;
+    s.capture_ms = 2.0;
+    s.encode_ms = encode_ms;
+    s.send_ms = 0.5;
+    s.cpu_load = 0.3;
+    s.motion = motion;
+    s.bitrate = bitrate;
+    s.full_pixels = PIXELS_1080P;
+    return s;
+}
+
+static AutotuneSettings settings(uint32_t scale_step, uint32_t fps, uint32_t preset) {
+    AutotuneSettings s;
+    s.scale_step = scale_step;
+    s.fps = fps;
+    s.preset = preset;
+    return s;
+}
+
+TEST(AutotuneTest, SteadyStateHoldsSettings) {
+    Autotuner tuner(limits());
+    // Mid-range load, moderate motion, at the operator limits with the fastest preset
+    auto cur = settings(0, 60, 0);
+    auto s = sample(10.0, 0.05);
+    EXPECT_EQ(tuner.update(cur, s), cur);
+    EXPECT_TRUE(tuner.reason().empty());
+}
+
+TEST(AutotuneTest, OverloadTriesFasterPresetFirst) {
+    Autotuner tuner(limits());
+    auto next = tuner.update(settings(0, 60, 2), sample(16.0, 0.5));
+    EXPECT_EQ(next, settings(0, 60, 1));
+    EXPECT_NE(tuner.reason().find("faster preset"), std::string::npos);
+}
+
+TEST(AutotuneTest, OverloadedVideoGivesUpResolution) {
+    Autotuner tuner(limits());
+    auto next = tuner.update(settings(0, 60, 0), sample(16.0, 0.5));
+    EXPECT_EQ(next, settings(1, 60, 0));
+}
+
+TEST(AutotuneTest, OverloadedStaticContentGivesUpFrames) {
+    Autotuner tuner(limits());
+    auto next = tuner.update(settings(0, 60, 0), sample(16.0, 0.0));
+    EXPECT_EQ(next, settings(0, 45, 0));
+}
+
+TEST(AutotuneTest, FallsBackWhenPreferredKnobIsAtFloor) {
+    Autotuner tuner(limits());
+    // Video already at the smallest scale: frames go instead
+    auto next = tuner.update(settings(AUTOTUNE_SCALE_STEPS - 1, 60, 0), sample(16.0, 0.5));
+    EXPECT_EQ(next, settings(AUTOTUNE_SCALE_STEPS - 1, 45, 0));
+
+    // Nothing left to give
+    Autotuner floor(limits());
+    auto bottom = settings(AUTOTUNE_SCALE_STEPS - 1, 15, 0);
+    EXPECT_EQ(floor.update(bottom, sample(80.0, 0.5)), bottom);
+}
+
+TEST(AutotuneTest, StarvedNetworkShedsPixelsForVideo) {
+    Autotuner tuner(limits());
+    // 2 Mbps over 1080p60 is ~0.016 bits per pixel
+    auto next = tuner.update(settings(0, 60, 0), sample(5.0, 0.5, 2'000'000));
+    EXPECT_EQ(next, settings(1, 60, 0));
+    EXPECT_NE(tuner.reason().find("bits per pixel"), std::string::npos);
+}
+
+TEST(AutotuneTest, StaticContentTradesFramesForResolution) {
+    Autotuner tuner(limits());
+    auto next = tuner.update(settings(1, 60, 0), sample(10.0, 0.0));
+    EXPECT_EQ(next.scale_step, 0u);
+    EXPECT_LT(next.fps, 60u);
+    EXPECT_GE(next.fps, 30u);
+}
+
+TEST(AutotuneTest, HeadroomRestoresThenRefinesPreset) {
+    Autotuner tuner(limits());
+    auto cur = settings(1, 60, 0);
+    auto s = sample(3.0, 0.05);
+
+    cur = tuner.update(cur, s);
+    EXPECT_EQ(cur, settings(0, 60, 0));
+
+    // Held for a few windows after a change
+    for (int i = 0; i < 3; ++i) EXPECT_EQ(tuner.update(cur, s), cur);
+
+    cur = tuner.update(cur, s);
+    EXPECT_EQ(cur, settings(0, 60, 1));
+    EXPECT_NE(tuner.reason().find("slower preset"), std::string::npos);
+}
+
+TEST(AutotuneTest, HonorsOperatorLimits) {
+    Autotuner tuner(limits(30, 1));
+    auto next = tuner.update(settings(0, 60, 2), sample(3.0, 0.05));
+    EXPECT_EQ(next, settings(0, 30, 0));
+    EXPECT_EQ(tuner.reason(), "operator limits changed");
+
+    // Relaxed, but already at the fps cap with the only preset allowed
+    for (int i = 0; i < 5; ++i) next = tuner.update(next, sample(1.0, 0.05));
+    EXPECT_EQ(next, settings(0, 30, 0));
+}
+
+TEST(AutotuneTest, MotionSamplerCountsChangedGridPoints) {
+    RawVideoFrame frame;
+    frame.width = 128;
+    frame.height = 72;
+    frame.data.assign(frame.width * frame.height * 3 / 2, 16);
+
+    MotionSampler sampler;
+    EXPECT_DOUBLE_EQ(sampler.sample(frame), 0.0);
+    EXPECT_DOUBLE_EQ(sampler.sample(frame), 0.0);
+
+    // Brighten the top half of the luma plane
+    for (uint32_t y = 0; y < frame.height / 2; ++y) {
+        for (uint32_t x = 0; x < frame.width; ++x) frame.data[y * frame.width + x] = 200;
+    }
+    EXPECT_NEAR(sampler.sample(frame), 0.5, 0.01);
+    EXPECT_DOUBLE_EQ(sampler.sample(frame), 0.0);
+
+    // A new size starts over
+    frame.width = 64;
+    frame.height = 36;
+    frame.data.assign(frame.width * frame.height * 3 / 2, 90);
+    EXPECT_DOUBLE_EQ(sampler.sample(frame), 0.0);
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+#include "net/bandwidth_probe.h"
+#include "net/client.h"
+#include "net/server.h"
+#include "net/winsock_init.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+static ProbeTrainReport train(uint32_t sent_kbps, uint32_t measured_kbps, uint16_t received) {
+    ProbeTrainReport t;
+    t.sent_kbps = sent_kbps;
+    t.measured_kbps = measured_kbps;
+    t.received = received;
+    t.count = PROBE_TRAIN_LENGTH;
+    return t;
+}
+
+TEST(BandwidthProbeTest, TrainPacketsAreFullSize) {
+    auto packets = make_probe_train(1, 3, PROBE_TRAIN_LENGTH, 12'000'000);
+    ASSERT_EQ(packets.size(), PROBE_TRAIN_LENGTH);
+    for (const auto& data : packets) {
+        EXPECT_EQ(data.size(), MAX_UDP_PAYLOAD);
+    }
+
+    auto pkt = Packet::deserialize(packets.back().data(), packets.back().size());
+    ProbePayload pp;
+    std::memcpy(&pp, pkt.payload.data(), sizeof(pp));
+    EXPECT_EQ(pp.train, 1);
+    EXPECT_EQ(pp.trains, 3);
+    EXPECT_EQ(pp.index, PROBE_TRAIN_LENGTH - 1);
+    EXPECT_EQ(pp.rate_kbps, 12'000u);
+}
+
+TEST(BandwidthProbeTest, TrainRateSaturates) {
+    EXPECT_EQ(probe_train_rate(10'000'000, 0), 10'000'000u);
+    EXPECT_EQ(probe_train_rate(10'000'000, 2), 40'000'000u);
+    EXPECT_EQ(probe_train_rate(1'000'000'000, 3), UINT32_MAX);
+    EXPECT_EQ(probe_train_rate(UINT32_MAX, 8), UINT32_MAX);
+}
+
+TEST(BandwidthProbeTest, ReceiverMeasuresDispersion) {
+    auto packets = make_probe_train(0, 1, 4, 8'000'000);
+    ProbeReceiver rx;
+    // 1200-byte packets every 1200 us = 8 Mbps
+    for (size_t i = 0; i < packets.size(); ++i) {
+        auto pkt = Packet::deserialize(packets[i].data(), packets[i].size());
+        rx.on_packet(pkt, packets[i].size(), 1'000'000 + static_cast<int64_t>(i) * 1200);
+    }
+    EXPECT_TRUE(rx.complete());
+
+    auto report = rx.report();
+    ASSERT_EQ(report.trains, 1);
+    EXPECT_EQ(report.train[0].received, 4);
+    EXPECT_EQ(report.train[0].sent_kbps, 8'000u);
+    EXPECT_EQ(report.train[0].measured_kbps, 8'000u);
+}
+
+TEST(BandwidthProbeTest, FastLinkIsUnpacedAtTarget) {
+    ProbeReportPayload report;
+    report.trains = 3;
+    report.train[0] = train(6'000, 6'100, PROBE_TRAIN_LENGTH);
+    report.train[1] = train(12'000, 11'900, PROBE_TRAIN_LENGTH);
+    report.train[2] = train(24'000, 23'500, PROBE_TRAIN_LENGTH);
+
+    auto result = evaluate_probe(report);
+    EXPECT_TRUE(result.valid);
+    EXPECT_FALSE(result.bottlenecked);
+    EXPECT_EQ(result.pacing_bps(), 0u);
+    EXPECT_EQ(result.start_bitrate(6'000'000), 6'000'000u);
+}
+
+TEST(BandwidthProbeTest, BottleneckLowersStartAndPaces) {
+    ProbeReportPayload report;
+    report.trains = 3;
+    report.train[0] = train(6'000, 5'000, PROBE_TRAIN_LENGTH);  // Already slower than sent
+    report.train[1] = train(12'000, 5'000, 10);
+
+    auto result = evaluate_probe(report);
+    EXPECT_TRUE(result.valid);
+    EXPECT_TRUE(result.bottlenecked);
+    EXPECT_EQ(result.capacity_bps, 5'000'000u);
+    EXPECT_EQ(result.pacing_bps(), 5'000'000u);
+    EXPECT_EQ(result.start_bitrate(6'000'000), 3'000'000u);
+}
+
+TEST(BandwidthProbeTest, NothingReceivedIsInvalid) {
+    ProbeReportPayload report;
+    report.trains = 3;
+    report.train[0] = train(6'000, 0, 1);
+
+    auto result = evaluate_probe(report);
+    EXPECT_FALSE(result.valid);
+    EXPECT_EQ(result.start_bitrate(6'000'000), 6'000'000u);
+}
+
+TEST(BandwidthProbeTest, PacedClientDoesNotHoldUpBroadcast) {
+    constexpr uint16_t port = 47361;
+    Server server(port);
+    std::atomic<size_t> admitted{0};
+    server.set_client_count_callback([&](size_t count) { admitted = count; });
+    ASSERT_TRUE(server.start());
+    std::atomic<bool> polling{true};
+    std::thread poller([&] { while (polling) server.poll(); });
+
+    Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", port));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+    while (admitted == 0 && std::chrono::steady_clock::now() < deadline) {
+        ThreadSafeQueue<EncodedPacket> video(8), audio(8);
+        client.poll(video, audio);
+    }
+    ASSERT_EQ(admitted.load(), 1u);
+
+    // 60 KB at 2 Mbps is ~240 ms on the wire; broadcast() only queues it
+    server.set_pacing_override(2'000'000);
+    EncodedPacket frame;
+    frame.type = FrameType::VideoKeyframe;
+    frame.frame_id = 1;
+    frame.data.assign(60'000, 0x42);
+    auto start = std::chrono::steady_clock::now();
+    server.broadcast(frame);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+    ThreadSafeQueue<EncodedPacket> video(8), audio(8);
+    std::optional<EncodedPacket> received;
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (!received && std::chrono::steady_clock::now() < deadline) {
+        client.poll(video, audio);
+        received = video.try_pop();
+    }
+    ASSERT_TRUE(received);
+    EXPECT_EQ(received->data, frame.data);
+
+    client.disconnect();
+    polling = false;
+    poller.join();
+    server.stop();
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include "net/client_load.h"
+
+using namespace lancast;
+
+static ClientReportPayload report(double rendered_fps, uint16_t decoded, uint16_t discarded,
+                                  uint32_t decode_us, uint8_t video_queue = 0) {
+    ClientReportPayload r;
+    r.rendered_fps_x10 = static_cast<uint16_t>(rendered_fps * 10);
+    r.decoded = decoded;
+    r.discarded = discarded;
+    r.decode_us = decode_us;
+    r.video_queue = video_queue;
+    return r;
+}
+
+TEST(ClientLoadTest, KeepingUpLeavesNoLimit) {
+    EXPECT_EQ(client_fps_limit(report(60, 60, 0, 4000), 60, 0), 0u);
+    // Occasional discards below the threshold are tolerated
+    EXPECT_EQ(client_fps_limit(report(58, 60, 2, 5000), 60, 0), 0u);
+}
+
+TEST(ClientLoadTest, SlowDecodeCutsToSustainableRate) {
+    // 30 ms per frame: 0.9 / 30 ms = 30 fps
+    EXPECT_EQ(client_fps_limit(report(33, 33, 0, 30000), 60, 0), 30u);
+}
+
+TEST(ClientLoadTest, DiscardsCutToRenderedRate) {
+    // Decoder keeps up, renderer shows only 24 of 60
+    EXPECT_EQ(client_fps_limit(report(24, 60, 36, 5000), 60, 0), 24u);
+}
+
+TEST(ClientLoadTest, StillOverloadedAtLimitStepsDown) {
+    EXPECT_EQ(client_fps_limit(report(30, 30, 10, 10000), 60, 30), 22u);
+    // Never below the floor
+    EXPECT_EQ(client_fps_limit(report(2, 10, 8, 200000), 60, 12), MIN_CLIENT_FPS);
+}
+
+TEST(ClientLoadTest, RecoversGradually) {
+    // Healthy at 30 fps (budget 33 ms): step up by stream_fps / 6
+    EXPECT_EQ(client_fps_limit(report(30, 30, 0, 8000), 60, 30), 40u);
+    // Backlog in the decode queue holds the limit
+    EXPECT_EQ(client_fps_limit(report(30, 30, 0, 8000, 3), 60, 30), 30u);
+    // Reaching the stream rate lifts the limit
+    EXPECT_EQ(client_fps_limit(report(50, 50, 0, 8000), 60, 50), 0u);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "net/control_socket.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace lancast;
+
+TEST(ControlSocketTest, ParsesFlatRequests) {
+    std::string error;
+    auto req = parse_control_request(
+        R"( {"cmd":"set", "bitrate": 4000000, "resolution":"1280x720", "note":"a \"q\"\n", "on":true} )",
+        error);
+    ASSERT_TRUE(req) << error;
+    EXPECT_EQ(req->cmd, "set");
+    EXPECT_EQ(req->uint_arg("bitrate"), 4000000u);
+    EXPECT_EQ(req->string_arg("resolution"), "1280x720");
+    EXPECT_EQ(req->string_arg("note"), "a \"q\"\n");
+    EXPECT_EQ(req->string_arg("on"), "true");
+    EXPECT_FALSE(req->uint_arg("resolution"));
+    EXPECT_FALSE(req->has("fps"));
+}
+
+TEST(ControlSocketTest, RejectsOverflowingNumbers) {
+    std::string error;
+    auto req = parse_control_request(
+        R"({"cmd":"set", "max": 18446744073709551615, "over": 18446744073709551616, "long": 99999999999999999999999})",
+        error);
+    ASSERT_TRUE(req) << error;
+    EXPECT_EQ(req->uint_arg("max"), UINT64_MAX);
+    EXPECT_FALSE(req->uint_arg("over"));
+    EXPECT_FALSE(req->uint_arg("long"));
+}
+
+TEST(ControlSocketTest, RejectsMalformedRequests) {
+    std::string error;
+    EXPECT_FALSE(parse_control_request("status", error));
+    EXPECT_FALSE(parse_control_request(R"({"bitrate":1})", error));
+    EXPECT_EQ(error, "missing \"cmd\"");
+    EXPECT_FALSE(parse_control_request(R"({"cmd":"set","x":{"y":1}})", error));
+    EXPECT_EQ(error, "nested values are not supported");
+    EXPECT_FALSE(parse_control_request(R"({"cmd":"status"} extra)", error));
+    EXPECT_FALSE(parse_control_request(R"({"cmd":"status")", error));
+}
+
+TEST(ControlSocketTest, WritesNestedJson) {
+    JsonWriter json;
+    json.begin_object()
+        .field("ok", true)
+        .field("name", "a\"b")
+        .begin_array("items")
+            .begin_object().field("n", static_cast<uint64_t>(1)).end_object()
+            .begin_object().field("x", 0.5).end_object()
+        .end_array()
+        .end_object();
+    EXPECT_EQ(json.str(), R"({"ok":true,"name":"a\"b","items":[{"n":1},{"x":0.500}]})");
+    EXPECT_EQ(control_error("no"), R"({"ok":false,"error":"no"})");
+}
+
+#ifndef _WIN32
+TEST(ControlSocketTest, AnswersEachLineOverUnixSocket) {
+    std::string path = "/tmp/lancast_test_control_" + std::to_string(::getpid()) + ".sock";
+    ControlSocket server;
+    ASSERT_TRUE(server.open(path));
+
+    // A second listener on the same path is refused while the first is alive
+    ControlSocket other;
+    EXPECT_FALSE(other.open(path));
+
+    std::atomic<bool> serving{true};
+    std::thread loop([&] {
+        while (serving) {
+            server.poll(20, [](const ControlRequest& req) {
+                JsonWriter json;
+                json.begin_object().field("ok", true).field("cmd", req.cmd).end_object();
+                return json.str();
+            });
+        }
+    });
+
+    auto reply = ControlSocket::request(path, R"({"cmd":"status"})");
+    ASSERT_TRUE(reply);
+    EXPECT_EQ(*reply, R"({"ok":true,"cmd":"status"})");
+
+    reply = ControlSocket::request(path, "not json");
+    ASSERT_TRUE(reply);
+    EXPECT_EQ(*reply, R"({"ok":false,"error":"expected a JSON object"})");
+
+    serving = false;
+    loop.join();
+    server.close();
+    EXPECT_FALSE(ControlSocket::request(path, R"({"cmd":"status"})", 100));
+}
+#endif
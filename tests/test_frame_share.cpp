@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "render/frame_share.h"
+
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+using namespace lancast;
+
+// Unique per test process, so parallel ctest runs don't collide
+static std::string share_name(const char* test) {
+    return std::string("test-") + test + "-" + std::to_string(getpid());
+}
+
+static RawVideoFrame make_frame(uint32_t width, uint32_t height, uint16_t frame_id) {
+    RawVideoFrame f;
+    f.width = width;
+    f.height = height;
+    f.frame_id = frame_id;
+    f.pts_us = int64_t{frame_id} * 16'667;
+    f.data.resize(static_cast<size_t>(width) * height * 3 / 2);
+    for (size_t i = 0; i < f.data.size(); ++i) f.data[i] = static_cast<uint8_t>(i * 7 + frame_id);
+    return f;
+}
+
+TEST(FrameShareTest, ReaderSeesNewestFrameInPlace) {
+    FramePublisher publisher;
+    std::string name = share_name("newest");
+    ASSERT_TRUE(publisher.open(name, 3, 64 * 48 * 3 / 2));
+
+    FrameShareReader reader;
+    ASSERT_TRUE(reader.attach(name));
+    EXPECT_EQ(reader.slot_count(), 3u);
+    EXPECT_FALSE(reader.publisher_closed());
+    EXPECT_FALSE(reader.latest().has_value());  // Nothing published yet
+
+    for (uint16_t id = 0; id < 5; ++id) ASSERT_TRUE(publisher.publish(make_frame(64, 48, id)));
+
+    auto frame = reader.latest();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->sequence, 5u);
+    EXPECT_EQ(frame->width, 64u);
+    EXPECT_EQ(frame->height, 48u);
+    EXPECT_EQ(frame->frame_id, 4u);
+    EXPECT_EQ(frame->pts_us, 4 * 16'667);
+    EXPECT_GT(frame->published_us, 0);
+
+    auto expected = make_frame(64, 48, 4);
+    ASSERT_EQ(frame->size, expected.data.size());
+    EXPECT_EQ(std::memcmp(frame->y, expected.data.data(), 64 * 48), 0);
+    EXPECT_EQ(frame->u, frame->y + 64 * 48);
+    EXPECT_EQ(frame->v, frame->u + 32 * 24);
+    EXPECT_EQ(std::memcmp(frame->v, expected.data.data() + 64 * 48 + 32 * 24, 32 * 24), 0);
+    EXPECT_TRUE(reader.still_valid(*frame));
+
+    // Already seen
+    EXPECT_FALSE(reader.latest(frame->sequence).has_value());
+    EXPECT_EQ(publisher.stats().frames_published, 5u);
+    EXPECT_EQ(publisher.stats().readers_attached, 1u);
+}
+
+TEST(FrameShareTest, LappedFrameIsNoLongerValid) {
+    FramePublisher publisher;
+    std::string name = share_name("lapped");
+    ASSERT_TRUE(publisher.open(name, 3, 32 * 32 * 3 / 2));
+    FrameShareReader reader;
+    ASSERT_TRUE(reader.attach(name));
+
+    ASSERT_TRUE(publisher.publish(make_frame(32, 32, 1)));
+    auto frame = reader.latest();
+    ASSERT_TRUE(frame.has_value());
+
+    // The next two go to the other slots; the third reuses this one
+    ASSERT_TRUE(publisher.publish(make_frame(32, 32, 2)));
+    ASSERT_TRUE(publisher.publish(make_frame(32, 32, 3)));
+    EXPECT_TRUE(reader.still_valid(*frame));
+    ASSERT_TRUE(publisher.publish(make_frame(32, 32, 4)));
+    EXPECT_FALSE(reader.still_valid(*frame));
+}
+
+TEST(FrameShareTest, SkipsFramesLargerThanASlot) {
+    FramePublisher publisher;
+    std::string name = share_name("large");
+    ASSERT_TRUE(publisher.open(name, 2, 32 * 32 * 3 / 2));
+    FrameShareReader reader;
+    ASSERT_TRUE(reader.attach(name));
+
+    ASSERT_TRUE(publisher.publish(make_frame(32, 32, 1)));
+    EXPECT_FALSE(publisher.publish(make_frame(64, 64, 2)));
+    EXPECT_EQ(publisher.stats().frames_skipped, 1u);
+    EXPECT_EQ(reader.frames_skipped(), 1u);
+
+    // Smaller frames still fit, and the planes follow the new size
+    ASSERT_TRUE(publisher.publish(make_frame(16, 8, 3)));
+    auto frame = reader.latest();
+    ASSERT_TRUE(frame.has_value());
+    EXPECT_EQ(frame->frame_id, 3u);
+    EXPECT_EQ(frame->size, 16u * 8 * 3 / 2);
+    EXPECT_EQ(frame->v, frame->y + 16 * 8 + 8 * 4);
+
+    // Not I420 for its size
+    auto odd = make_frame(16, 8, 4);
+    odd.data.pop_back();
+    EXPECT_FALSE(publisher.publish(odd));
+}
+
+TEST(FrameShareTest, OneOwnerPerName) {
+    FramePublisher first;
+    std::string name = share_name("owner");
+    ASSERT_TRUE(first.open(name, 2, 1024));
+    FramePublisher second;
+    EXPECT_FALSE(second.open(name, 2, 1024));
+
+    FrameShareReader reader;
+    ASSERT_TRUE(reader.attach(name));
+    first.close();
+    EXPECT_TRUE(reader.publisher_closed());
+
+    // The name is free again; the old mapping stays readable until detach
+    EXPECT_TRUE(second.open(name, 2, 1024));
+    EXPECT_TRUE(reader.publisher_closed());
+    EXPECT_EQ(reader.slot_count(), 2u);
+}
+
+TEST(FrameShareTest, RejectsBadNamesAndMissingPublishers) {
+    FramePublisher publisher;
+    EXPECT_FALSE(publisher.open(""));
+    EXPECT_FALSE(publisher.open("has space"));
+    EXPECT_FALSE(publisher.open("a/b"));
+    EXPECT_FALSE(publisher.open(std::string(65, 'x')));
+    EXPECT_TRUE(FramePublisher::valid_name("obs-feed_1.0"));
+
+    FrameShareReader reader;
+    EXPECT_FALSE(reader.attach(share_name("nobody"), 200));
+    EXPECT_FALSE(reader.is_attached());
+    EXPECT_FALSE(reader.latest().has_value());
+    EXPECT_TRUE(reader.publisher_closed());
+}
@@ -8,7 +8,7 @@ using namespace lancast;
 
 TEST(LargeFrameRoundtripTest, FullHD_YUV420p_Frame) {
     // A 1920x1080 YUV420p frame is 1920*1080*3/2 = 3,110,400 bytes
-    // This requires 3,110,400 / 1184 = 2628 fragments (exceeds old uint8_t limit of 255)
+    // This requires 3,110,400 / 1182 = 2632 fragments (exceeds old uint8_t limit of 255)
     constexpr size_t frame_size = 1920 * 1080 * 3 / 2;
 
     PacketFragmenter fragmenter;
@@ -25,7 +25,7 @@ TEST(LargeFrameRoundtripTest, FullHD_YUV420p_Frame) {
         original.data[i] = static_cast<uint8_t>(i % 251); // Prime modulus for pattern
     }
 
-    uint16_t seq = 0;
+    uint32_t seq = 0;
     auto fragments = fragmenter.fragment(original, seq);
 
     // Verify we have more than 255 fragments (the old limit)
@@ -68,7 +68,7 @@ TEST(LargeFrameRoundtripTest, LargeFrame_OutOfOrder) {
     original.data.resize(frame_size);
     std::iota(original.data.begin(), original.data.end(), 0);
 
-    uint16_t seq = 0;
+    uint32_t seq = 0;
     auto fragments = fragmenter.fragment(original, seq);
 
     ASSERT_GT(fragments.size(), 255u);
@@ -88,7 +88,7 @@ TEST(LargeFrameRoundtripTest, LargeFrame_OutOfOrder) {
 }
 
 TEST(LargeFrameRoundtripTest, SequenceWraparound) {
-    // Test that uint16_t sequence wraps correctly near 65535
+    // Sequence numbers are 32 bits on the wire: 65535 no longer wraps
     PacketFragmenter fragmenter;
 
     EncodedPacket packet;
@@ -96,12 +96,16 @@ TEST(LargeFrameRoundtripTest, SequenceWraparound) {
     packet.type = FrameType::VideoPFrame;
     packet.data.resize(MAX_FRAGMENT_DATA * 2 + 1); // 3 fragments
 
-    uint16_t seq = 65534; // Near max uint16_t
+    uint32_t seq = 65534;
     auto fragments = fragmenter.fragment(packet, seq);
+    ASSERT_EQ(fragments.size(), 3u);
+    EXPECT_EQ(fragments[2].header.sequence, 65536u);
 
+    seq = 0xFFFFFFFE; // Near max uint32_t
+    fragments = fragmenter.fragment(packet, seq);
     ASSERT_EQ(fragments.size(), 3u);
-    EXPECT_EQ(fragments[0].header.sequence, 65534u);
-    EXPECT_EQ(fragments[1].header.sequence, 65535u);
+    EXPECT_EQ(fragments[0].header.sequence, 0xFFFFFFFEu);
+    EXPECT_EQ(fragments[1].header.sequence, 0xFFFFFFFFu);
     EXPECT_EQ(fragments[2].header.sequence, 0u); // Wrapped
     EXPECT_EQ(seq, 1u); // Counter after wrap
 }
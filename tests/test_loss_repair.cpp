@@ -0,0 +1,151 @@
+#include <gtest/gtest.h>
+#include "net/client.h"
+#include "net/packet_fragmenter.h"
+#include "net/socket.h"
+#include "net/winsock_init.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+using namespace lancast;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+// A host that sends exactly the packets a test picks, so it can lose and
+// reorder them
+struct FakeHost {
+    UdpSocket socket;
+    Endpoint client;
+    PacketFragmenter fragmenter;
+    uint32_t sequence = 0;
+    uint16_t frame_id = 0;
+    int keyframe_requests = 0;
+
+    bool start(uint16_t port) { return socket.bind(port) && socket.set_recv_timeout(1000); }
+
+    // HELLO -> WELCOME + STREAM_CONFIG; the client then waits out the
+    // missing bandwidth probe
+    bool accept() {
+        auto hello = socket.recv_from();
+        if (!hello) return false;
+        client = hello->source;
+        WelcomePayload wp;
+        wp.width = 320;
+        wp.height = 240;
+        wp.fps = 30;
+        send(PacketType::WELCOME, &wp, sizeof(wp));
+        uint8_t sps[] = {0x00, 0x00, 0x00, 0x01, 0x67};
+        send(PacketType::STREAM_CONFIG, sps, sizeof(sps));
+        socket.set_recv_timeout(1);
+        return true;
+    }
+
+    void send(PacketType type, const void* payload, size_t size) {
+        Packet pkt;
+        pkt.header.magic = PROTOCOL_MAGIC;
+        pkt.header.version = PROTOCOL_VERSION;
+        pkt.header.type = static_cast<uint8_t>(type);
+        pkt.payload.resize(size);
+        std::memcpy(pkt.payload.data(), payload, size);
+        socket.send_to(pkt.serialize(), client);
+    }
+
+    std::vector<Packet> frame(FrameType type, size_t size) {
+        EncodedPacket f;
+        f.type = type;
+        f.frame_id = frame_id++;
+        f.data.assign(size, 0x42);
+        return fragmenter.fragment(f, sequence);
+    }
+
+    void send(const Packet& pkt) { socket.send_to(pkt.serialize(), client); }
+    void send(const std::vector<Packet>& fragments) {
+        for (const auto& pkt : fragments) send(pkt);
+    }
+
+    void collect() {
+        while (auto result = socket.recv_from()) {
+            auto pkt = Packet::deserialize(result->data.data(), result->data.size());
+            if (static_cast<PacketType>(pkt.header.type) == PacketType::KEYFRAME_REQ) keyframe_requests++;
+        }
+    }
+};
+
+class LossRepairTest : public ::testing::Test {
+protected:
+    void connect(uint16_t port) {
+        ASSERT_TRUE(host.start(port));
+        std::thread accept([&] { accepted = host.accept(); });
+        ASSERT_TRUE(client.connect("127.0.0.1", port));
+        accept.join();
+        ASSERT_TRUE(accepted);
+        host.send(host.frame(FrameType::VideoKeyframe, 3000));
+        poll(std::chrono::milliseconds(50));
+    }
+
+    // Keeps a still picture going: one small P-frame per 30 fps tick
+    void stream_for(std::chrono::milliseconds duration) {
+        auto deadline = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < deadline) {
+            host.send(host.frame(FrameType::VideoPFrame, 100));
+            poll(std::chrono::milliseconds(33));
+        }
+        host.collect();
+    }
+
+    void poll(std::chrono::milliseconds duration) {
+        auto deadline = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < deadline) {
+            client.poll(video, audio);
+            while (video.try_pop()) {}
+        }
+    }
+
+    void TearDown() override { client.disconnect(); }
+
+    FakeHost host;
+    Client client;
+    bool accepted = false;
+    ThreadSafeQueue<EncodedPacket> video{64}, audio{64};
+};
+
+TEST_F(LossRepairTest, LostPFrameAsksForKeyframe) {
+    connect(47371);
+    host.frame(FrameType::VideoPFrame, 100);  // Lost
+    stream_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(host.keyframe_requests, 1);
+    EXPECT_EQ(client.stats().keyframes_requested, 1u);
+
+    // Another loss soon after waits for the request interval
+    host.frame(FrameType::VideoPFrame, 100);
+    stream_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(host.keyframe_requests, 1);
+    stream_for(std::chrono::milliseconds(700));
+    EXPECT_EQ(host.keyframe_requests, 2);
+}
+
+TEST_F(LossRepairTest, ReorderedPacketIsNoLoss) {
+    connect(47372);
+    auto late = host.frame(FrameType::VideoPFrame, 100);
+    host.send(host.frame(FrameType::VideoPFrame, 100));
+    host.send(late);
+    stream_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(host.keyframe_requests, 0);
+    EXPECT_EQ(client.stats().packets_lost, 0u);
+}
+
+TEST_F(LossRepairTest, NackedKeyframeNeedsNoRequest) {
+    connect(47373);
+    auto keyframe = host.frame(FrameType::VideoKeyframe, 3000);
+    ASSERT_GT(keyframe.size(), 1u);
+    host.send(std::vector<Packet>(keyframe.begin() + 1, keyframe.end()));
+    // The fragment the client NACKs arrives as a retransmission
+    stream_for(std::chrono::milliseconds(150));
+    keyframe.front().header.flags |= FLAG_RETRANSMIT;
+    host.send(keyframe.front());
+    stream_for(std::chrono::milliseconds(400));
+    EXPECT_EQ(host.keyframe_requests, 0);
+    EXPECT_EQ(client.stats().packets_repaired, 1u);
+}
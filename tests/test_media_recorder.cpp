@@ -0,0 +1,337 @@
+#include "record/container_writer.h"
+#include "record/media_recorder.h"
+#include "record/replay_buffer.h"
+#include "encode/video_encoder.h"
+#include "encode/audio_encoder.h"
+#include "core/types.h"
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+using namespace lancast;
+
+namespace fs = std::filesystem;
+
+static RawVideoFrame make_frame(uint32_t w, uint32_t h, int index) {
+    RawVideoFrame frame;
+    frame.width = w;
+    frame.height = h;
+    frame.data.resize(w * h * 3 / 2, 128);
+    for (uint32_t row = 0; row < h; ++row) {
+        for (uint32_t col = 0; col < w; ++col) {
+            frame.data[row * w + col] = static_cast<uint8_t>(col + row + index * 4);
+        }
+    }
+    return frame;
+}
+
+static RawAudioFrame make_audio(int index) {
+    RawAudioFrame frame;
+    frame.num_samples = 960;
+    frame.samples.resize(960 * 2);
+    for (uint32_t i = 0; i < 960; ++i) {
+        float s = 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 440.0f * (index * 960 + i) / 48000.0f);
+        frame.samples[i * 2] = s;
+        frame.samples[i * 2 + 1] = s;
+    }
+    return frame;
+}
+
+// What a viewer hands over: capture time truncated to the 32-bit header field
+static int64_t wire_time(int64_t us) {
+    return static_cast<int64_t>(static_cast<uint32_t>(us));
+}
+
+struct Demuxed {
+    int streams = 0;
+    AVCodecID codecs[2] = {AV_CODEC_ID_NONE, AV_CODEC_ID_NONE};
+    int width = 0;
+    struct Entry {
+        int stream;
+        int64_t dts_us;
+        bool key;
+    };
+    std::vector<Entry> packets;
+};
+
+static Demuxed demux(const std::string& path) {
+    Demuxed out;
+    AVFormatContext* ctx = nullptr;
+    if (avformat_open_input(&ctx, path.c_str(), nullptr, nullptr) < 0) return out;
+    avformat_find_stream_info(ctx, nullptr);
+    out.streams = static_cast<int>(ctx->nb_streams);
+    for (unsigned i = 0; i < ctx->nb_streams && i < 2; ++i) {
+        out.codecs[i] = ctx->streams[i]->codecpar->codec_id;
+        if (ctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) out.width = ctx->streams[i]->codecpar->width;
+    }
+    AVPacket* pkt = av_packet_alloc();
+    while (av_read_frame(ctx, pkt) >= 0) {
+        out.packets.push_back({pkt->stream_index,
+                               av_rescale_q(pkt->dts, ctx->streams[pkt->stream_index]->time_base, {1, 1000000}),
+                               (pkt->flags & AV_PKT_FLAG_KEY) != 0});
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&ctx);
+    return out;
+}
+
+class MediaRecorderTest : public ::testing::TestWithParam<const char*> {
+protected:
+    void TearDown() override {
+        for (const auto& p : paths_) fs::remove(p);
+    }
+    std::string temp_path(const std::string& stem) {
+        auto p = (fs::temp_directory_path() / (stem + GetParam())).string();
+        paths_.push_back(p);
+        return p;
+    }
+    std::vector<std::string> paths_;
+};
+
+TEST_P(MediaRecorderTest, RemuxesAcrossTimestampWrap) {
+    const uint32_t w = 320, h = 240, fps = 30;
+    VideoEncoder video;
+    ASSERT_TRUE(video.init(w, h, fps, 1000000));
+    AudioEncoder audio;
+    ASSERT_TRUE(audio.init(48000, 2, 64000));
+
+    StreamConfig config;
+    config.width = w;
+    config.height = h;
+    config.fps = fps;
+    config.codec_data = video.extradata();
+
+    std::string path = temp_path("lancast_wrap");
+    ContainerWriter writer;
+    ASSERT_TRUE(writer.open(path, config));
+    EXPECT_TRUE(writer.has_audio());
+
+    // Two seconds straddling the 32-bit wrap
+    const int64_t start_us = (int64_t{1} << 32) - 1000000;
+    int audio_index = 0;
+    for (int i = 0; i < 60; ++i) {
+        int64_t t = start_us + i * 1000000 / fps;
+        auto frame = make_frame(w, h, i);
+        frame.pts_us = t;
+        auto encoded = video.encode(frame);
+        ASSERT_TRUE(encoded.has_value());
+        encoded->pts_us = wire_time(t);
+        EXPECT_TRUE(writer.write(*encoded));
+
+        while (start_us + audio_index * 20000 <= t) {
+            auto pcm = make_audio(audio_index);
+            pcm.pts_us = start_us + audio_index * 20000;
+            if (auto opus = audio.encode(pcm)) {
+                opus->pts_us = wire_time(pcm.pts_us);
+                EXPECT_TRUE(writer.write(*opus));
+            }
+            audio_index++;
+        }
+    }
+    writer.close();
+
+    auto file = demux(path);
+    ASSERT_EQ(file.streams, 2);
+    EXPECT_EQ(file.codecs[0], AV_CODEC_ID_H264);
+    EXPECT_EQ(file.codecs[1], AV_CODEC_ID_OPUS);
+    EXPECT_EQ(file.width, static_cast<int>(w));
+
+    int video_packets = 0;
+    int64_t last_dts[2] = {-1, -1};
+    int64_t last_video_us = 0;
+    for (const auto& p : file.packets) {
+        ASSERT_TRUE(p.stream == 0 || p.stream == 1);
+        EXPECT_GT(p.dts_us, last_dts[p.stream]) << "packet " << video_packets;
+        last_dts[p.stream] = p.dts_us;
+        if (p.stream != 0) continue;
+        if (video_packets == 0) {
+            EXPECT_TRUE(p.key);
+        }
+        video_packets++;
+        last_video_us = p.dts_us;
+    }
+    EXPECT_EQ(video_packets, 60);
+    // The wrap leaves no jump: 59 frames after the first at 30 fps
+    EXPECT_NEAR(static_cast<double>(last_video_us), 59.0 * 1e6 / fps, 2000.0);
+}
+
+TEST_P(MediaRecorderTest, StartsAtKeyframeAndSplitsOnStreamChange) {
+    std::string path = temp_path("lancast_split");
+    std::string second = (fs::path(path).parent_path() /
+                          (fs::path(path).stem().string() + "-2" + GetParam())).string();
+    paths_.push_back(second);
+
+    MediaRecorder recorder;
+    ASSERT_TRUE(recorder.start(path, 48000, 0));
+
+    int64_t t = 1000000;
+    auto record = [&](uint32_t w, uint32_t h, uint32_t generation, int frames, bool lead_with_pframe) {
+        VideoEncoder video;
+        ASSERT_TRUE(video.init(w, h, 30, 1000000));
+        StreamConfig config;
+        config.width = w;
+        config.height = h;
+        config.fps = 30;
+        config.codec_data = video.extradata();
+
+        std::vector<EncodedPacket> packets;
+        for (int i = 0; i < frames; ++i) {
+            auto frame = make_frame(w, h, i);
+            frame.pts_us = t;
+            t += 33333;
+            auto encoded = video.encode(frame);
+            ASSERT_TRUE(encoded.has_value());
+            packets.push_back(std::move(*encoded));
+        }
+        // A P-frame ahead of any keyframe, as when joining mid-stream
+        if (lead_with_pframe) recorder.add_video(packets[1], config, generation);
+        for (auto& p : packets) recorder.add_video(std::move(p), config, generation);
+    };
+    record(320, 240, 1, 20, true);
+    record(640, 360, 2, 20, false);
+    recorder.stop();
+
+    auto stats = recorder.stats();
+    EXPECT_EQ(stats.segments, 2u);
+    EXPECT_EQ(stats.packets_written, 40u);
+    EXPECT_EQ(stats.packets_dropped, 1u);
+
+    auto first = demux(path);
+    ASSERT_EQ(first.streams, 1);
+    EXPECT_EQ(first.width, 320);
+    ASSERT_EQ(first.packets.size(), 20u);
+    EXPECT_TRUE(first.packets.front().key);
+    EXPECT_EQ(first.packets.front().dts_us, 0);
+
+    auto next = demux(second);
+    ASSERT_EQ(next.streams, 1);
+    EXPECT_EQ(next.width, 640);
+    ASSERT_EQ(next.packets.size(), 20u);
+    EXPECT_TRUE(next.packets.front().key);
+    EXPECT_EQ(next.packets.front().dts_us, 0);
+}
+
+TEST_P(MediaRecorderTest, ReplaySavesFromNearestKeyframe) {
+    const uint32_t w = 320, h = 240, fps = 30;
+    VideoEncoder video;
+    ASSERT_TRUE(video.init(w, h, fps, 1000000));
+    StreamConfig config;
+    config.width = w;
+    config.height = h;
+    config.fps = fps;
+    config.codec_data = video.extradata();
+
+    ReplayBuffer replay;
+    ASSERT_TRUE(replay.start(ReplayBuffer::capacity_for(std::chrono::seconds(10), 1000000), 48000, 0));
+    replay.set_video_config(config);
+    // Six seconds; the queue is short, so let the ring keep up
+    const int frames = 180;
+    std::vector<int> keyframes;
+    for (int i = 0; i < frames; ++i) {
+        auto frame = make_frame(w, h, i);
+        frame.pts_us = int64_t{i} * 1000000 / fps;
+        auto encoded = video.encode(frame);
+        ASSERT_TRUE(encoded.has_value());
+        if (encoded->type == FrameType::VideoKeyframe) keyframes.push_back(i);
+        replay.add_video(*encoded);
+        if (i % 8 == 7) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_GE(keyframes.size(), 2u);
+
+    // The last second reaches back to the newest keyframe at least a second old
+    int64_t from_us = int64_t{frames - 1} * 1000000 / fps - 1000000;
+    int start = keyframes.front();
+    for (int k : keyframes) {
+        if (int64_t{k} * 1000000 / fps <= from_us) start = k;
+    }
+    std::string path = temp_path("lancast_replay");
+    auto result = replay.save(path, std::chrono::seconds(1));
+    ASSERT_TRUE(result.ok) << result.error;
+    ASSERT_EQ(result.files.size(), 1u);
+    EXPECT_EQ(result.packets, static_cast<uint64_t>(frames - start));
+    EXPECT_NEAR(result.seconds, (frames - 1 - start) / static_cast<double>(fps), 0.01);
+
+    auto file = demux(path);
+    ASSERT_EQ(file.streams, 1);
+    ASSERT_EQ(file.packets.size(), static_cast<size_t>(frames - start));
+    EXPECT_TRUE(file.packets.front().key);
+    EXPECT_EQ(file.packets.front().dts_us, 0);
+    EXPECT_EQ(replay.stats().packets_dropped, 0u);
+    replay.stop();
+}
+
+TEST_P(MediaRecorderTest, ReplaySavesAudioFromTheKeyframeOn) {
+    const uint32_t w = 320, h = 240, fps = 30;
+    VideoEncoder video;
+    ASSERT_TRUE(video.init(w, h, fps, 1000000));
+    AudioEncoder audio;
+    ASSERT_TRUE(audio.init(48000, 2, 64000));
+    StreamConfig config;
+    config.width = w;
+    config.height = h;
+    config.fps = fps;
+    config.codec_data = video.extradata();
+
+    ReplayBuffer replay;
+    ASSERT_TRUE(replay.start(ReplayBuffer::capacity_for(std::chrono::seconds(10), 1000000), 48000, 2));
+    replay.set_video_config(config);
+    const int frames = 120;
+    int audio_index = 0;
+    for (int i = 0; i < frames; ++i) {
+        int64_t t = int64_t{i} * 1000000 / fps;
+        auto frame = make_frame(w, h, i);
+        frame.pts_us = t;
+        auto encoded = video.encode(frame);
+        ASSERT_TRUE(encoded.has_value());
+        replay.add_video(*encoded);
+        while (audio_index * 20000 <= t) {
+            auto pcm = make_audio(audio_index);
+            pcm.pts_us = audio_index * 20000;
+            if (auto opus = audio.encode(pcm)) replay.add_audio(*opus);
+            audio_index++;
+        }
+        if (i % 8 == 7) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::string path = temp_path("lancast_replay_audio");
+    auto result = replay.save(path, std::chrono::seconds(1));
+    ASSERT_TRUE(result.ok) << result.error;
+
+    // Audio from before the keyframe the save starts at is left out; the
+    // rest follows the video for the whole span
+    auto file = demux(path);
+    ASSERT_EQ(file.streams, 2);
+    EXPECT_EQ(file.codecs[1], AV_CODEC_ID_OPUS);
+    ASSERT_FALSE(file.packets.empty());
+    EXPECT_EQ(file.packets.front().stream, 0);
+    EXPECT_TRUE(file.packets.front().key);
+    int audio_packets = 0;
+    for (const auto& p : file.packets) {
+        if (p.stream != 1) continue;
+        EXPECT_GE(p.dts_us, 0);
+        audio_packets++;
+    }
+    EXPECT_NEAR(audio_packets, result.seconds * 50, 3);
+    replay.stop();
+}
+
+TEST(ContainerWriterTest, PicksFormatByExtension) {
+    EXPECT_TRUE(ContainerWriter::supports("out.mkv"));
+    EXPECT_TRUE(ContainerWriter::supports("out.mp4"));
+    EXPECT_FALSE(ContainerWriter::supports("out.notacontainer"));
+}
+
+INSTANTIATE_TEST_SUITE_P(Containers, MediaRecorderTest, ::testing::Values(".mkv", ".mp4"),
+                         [](const ::testing::TestParamInfo<const char*>& info) {
+                             return std::string(info.param + 1);
+                         });
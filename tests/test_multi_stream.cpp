@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "net/client.h"
+#include "net/server.h"
+#include "net/packet_assembler.h"
+#include "net/packet_fragmenter.h"
+#include "net/winsock_init.h"
+#include "stream_test_helpers.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+using namespace lancast::test;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+TEST(MultiStreamTest, StreamIdSharesFlagsWithFragmentBits) {
+    PacketHeader h;
+    h.flags = FLAG_KEYFRAME | FLAG_LAST;
+    h.set_stream_id(11);
+    EXPECT_EQ(h.stream_id(), 11);
+    EXPECT_EQ(h.flags & 0x0F, FLAG_KEYFRAME | FLAG_LAST);
+
+    Packet pkt;
+    pkt.header = h;
+    auto wire = pkt.serialize();
+    EXPECT_EQ(Packet::deserialize(wire.data(), wire.size()).header.stream_id(), 11);
+}
+
+TEST(MultiStreamTest, AssemblerKeepsStreamsApart) {
+    PacketFragmenter fragmenter;
+    uint32_t sequence = 0;
+    // Same frame id on two streams, fragments interleaved
+    auto a = fragmenter.fragment(keyframe(0, 7, 0xAA), sequence);
+    auto b = fragmenter.fragment(keyframe(3, 7, 0xBB), sequence);
+    ASSERT_EQ(a.size(), b.size());
+    ASSERT_GT(a.size(), 1u);
+
+    PacketAssembler assembler;
+    std::vector<EncodedPacket> done;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (auto f = assembler.feed(a[i])) done.push_back(std::move(*f));
+        if (auto f = assembler.feed(b[i])) done.push_back(std::move(*f));
+    }
+    ASSERT_EQ(done.size(), 2u);
+    EXPECT_EQ(done[0].stream_id, 0);
+    EXPECT_EQ(done[0].data, std::vector<uint8_t>(3000, 0xAA));
+    EXPECT_EQ(done[1].stream_id, 3);
+    EXPECT_EQ(done[1].data, std::vector<uint8_t>(3000, 0xBB));
+}
+
+TEST(MultiStreamTest, ClientGetsOnlySubscribedStreams) {
+    constexpr uint16_t port = 47351;
+    Server server(port);
+    server.set_stream_config(make_config(1920, 1080, 30, 0x01));
+    server.add_stream(1, "window 0x2a", make_config(800, 600, 30, 0x02));
+    std::atomic<uint16_t> keyframes_requested{0};
+    server.set_keyframe_callback([&](uint8_t stream) { keyframes_requested |= static_cast<uint16_t>(1u << stream); });
+    ASSERT_TRUE(server.start());
+    EXPECT_EQ(server.stream_count(), 2u);
+
+    std::atomic<bool> polling{true};
+    std::thread poller([&] { while (polling) server.poll(); });
+
+    Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", port));
+    auto streams = client.streams();
+    ASSERT_EQ(streams.size(), 2u);
+    EXPECT_EQ(streams[1].stream_id, 1);
+    EXPECT_EQ(streams[1].width, 800);
+    EXPECT_STREQ(streams[1].name, "window 0x2a");
+
+    // Admitted on stream 0 by default
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    std::optional<EncodedPacket> frame;
+    while (!frame && std::chrono::steady_clock::now() < deadline) {
+        server.broadcast(keyframe(0, 1, 0x10));
+        frame = receive_video(client, std::chrono::milliseconds(100));
+    }
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->stream_id, 0);
+    EXPECT_EQ(server.subscribers(1), 0u);
+
+    // Switch to stream 1 only; the host asks that stream's encoder for a keyframe
+    client.subscribe(0x2);
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (server.subscribers(1) == 0 && std::chrono::steady_clock::now() < deadline) {
+        receive_video(client, std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(server.subscribers(1), 1u);
+    EXPECT_EQ(server.subscribers(0), 0u);
+    EXPECT_TRUE(keyframes_requested.load() & 0x2);
+
+    server.broadcast(keyframe(0, 2, 0x20));
+    server.broadcast(keyframe(1, 1, 0x21));
+    frame = receive_video(client, std::chrono::milliseconds(1000));
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->stream_id, 1);
+    EXPECT_EQ(frame->data.front(), 0x21);
+    EXPECT_FALSE(receive_video(client, std::chrono::milliseconds(100)));
+
+    // Stream 1's config came ahead of its keyframe; stream 0's is untouched
+    EXPECT_EQ(client.config_generation(1), 1u);
+    EXPECT_EQ(client.stream_config(1).width, 800u);
+    EXPECT_EQ(client.stream_config(0).width, 1920u);
+    EXPECT_EQ(client.stats().packets_lost, 0u);
+
+    client.disconnect();
+    polling = false;
+    poller.join();
+    server.stop();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "net/packet_trace.h"
+#include "net/packet_fragmenter.h"
+#include "net/packet_assembler.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace lancast;
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+TEST(PacketTraceTest, RoundTripPreservesDataAndTiming) {
+    std::string path = temp_path("lancast_packets_roundtrip.lcpt");
+    {
+        PacketTraceWriter writer;
+        ASSERT_TRUE(writer.open(path, 1 << 16));
+        std::vector<uint8_t> a = {1, 2, 3};
+        std::vector<uint8_t> b(1200, 0x42);
+        EXPECT_TRUE(writer.record(a.data(), a.size(), 5'000'000));
+        EXPECT_TRUE(writer.record(b.data(), b.size(), 5'000'250));
+        EXPECT_TRUE(writer.record(a.data(), a.size(), 5'010'000));
+        EXPECT_EQ(writer.records(), 3u);
+    }
+
+    // Trimmed to the used size on close
+    EXPECT_EQ(std::filesystem::file_size(path),
+              PACKET_TRACE_HEADER_SIZE + 3 * PACKET_TRACE_RECORD_HEADER + 3 + 1200 + 3);
+
+    PacketTraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    auto r1 = reader.next();
+    auto r2 = reader.next();
+    auto r3 = reader.next();
+    ASSERT_TRUE(r1 && r2 && r3);
+    EXPECT_FALSE(reader.next().has_value());
+
+    EXPECT_EQ(r1->offset_us, 0);
+    EXPECT_EQ(r2->offset_us, 250);
+    EXPECT_EQ(r3->offset_us, 10'000);
+    EXPECT_EQ(r1->size, 3u);
+    EXPECT_EQ(r2->size, 1200u);
+    EXPECT_EQ(r2->data[1199], 0x42);
+
+    reader.rewind();
+    auto again = reader.next();
+    ASSERT_TRUE(again.has_value());
+    EXPECT_EQ(again->data[2], 3);
+
+    reader.close();
+    std::filesystem::remove(path);
+}
+
+TEST(PacketTraceTest, StopsWhenFull) {
+    std::string path = temp_path("lancast_packets_full.lcpt");
+    PacketTraceWriter writer;
+    ASSERT_TRUE(writer.open(path, 0));  // Clamped to the minimum size
+
+    std::vector<uint8_t> payload(1000, 7);
+    size_t written = 0;
+    while (writer.record(payload.data(), payload.size(), 0)) written++;
+    EXPECT_GT(written, 0u);
+    EXPECT_FALSE(writer.record(payload.data(), 10, 0));
+    writer.close();
+
+    PacketTraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    size_t read = 0;
+    while (reader.next()) read++;
+    EXPECT_EQ(read, written);
+
+    reader.close();
+    std::filesystem::remove(path);
+}
+
+TEST(PacketTraceTest, RejectsForeignFiles) {
+    std::string path = temp_path("lancast_packets_bad.lcpt");
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "this is not a packet trace";
+    }
+    PacketTraceReader reader;
+    EXPECT_FALSE(reader.open(path));
+    std::filesystem::remove(path);
+}
+
+TEST(PacketTraceTest, ReplayOnTraceTimeIsDeterministic) {
+    std::string path = temp_path("lancast_packets_replay.lcpt");
+    PacketFragmenter fragmenter;
+    uint32_t seq = 0;
+
+    EncodedPacket frame;
+    frame.data.resize(5000, 0x11);
+    frame.type = FrameType::VideoKeyframe;
+    frame.frame_id = 9;
+    auto fragments = fragmenter.fragment(frame, seq);
+    ASSERT_GT(fragments.size(), 1u);
+
+    {
+        PacketTraceWriter writer;
+        ASSERT_TRUE(writer.open(path, 1 << 16));
+        // Last fragment arrives 300 ms late: purged on trace time, even when replayed instantly
+        for (size_t i = 0; i < fragments.size(); ++i) {
+            auto data = fragments[i].serialize();
+            int64_t t = i + 1 == fragments.size() ? 300'000 : static_cast<int64_t>(i) * 100;
+            writer.record(data.data(), data.size(), t);
+        }
+    }
+
+    PacketTraceReader reader;
+    ASSERT_TRUE(reader.open(path));
+    PacketAssembler assembler;
+    auto base = std::chrono::steady_clock::time_point{};
+    size_t completed = 0, purged = 0;
+    while (auto rec = reader.next()) {
+        auto now = base + std::chrono::microseconds(rec->offset_us);
+        auto pkt = Packet::deserialize(rec->data, rec->size);
+        purged += assembler.purge_stale(200, now);
+        if (assembler.feed(pkt, now)) completed++;
+    }
+    EXPECT_EQ(purged, 1u);
+    EXPECT_EQ(completed, 0u);
+
+    reader.close();
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include "core/perf_counters.h"
+#include <string>
+
+using namespace lancast;
+
+// Must run first: counters are process-global and start disabled
+TEST(PerfCountersTest, DisabledByDefault) {
+    EXPECT_FALSE(PerfCounters::enabled());
+    {
+        PerfScope scope(PerfStage::Encode);
+    }
+    EXPECT_TRUE(PerfCounters::report().empty());
+}
+
+TEST(PerfCountersTest, ReportsSampledStagesAndResets) {
+    PerfCounters::enable();
+    ASSERT_TRUE(PerfCounters::enabled());
+
+    volatile uint64_t sink = 0;
+    for (int frame = 0; frame < 3; ++frame) {
+        PerfScope scope(PerfStage::Encode);
+        for (int i = 0; i < 100000; ++i) sink = sink + i;
+    }
+
+    std::string report = PerfCounters::report();
+    EXPECT_NE(report.find("encode"), std::string::npos);
+    EXPECT_NE(report.find("3 frames"), std::string::npos);
+    EXPECT_EQ(report.find("decode"), std::string::npos);
+
+    // Accumulators are reset by report()
+    EXPECT_TRUE(PerfCounters::report().empty());
+}
+
+TEST(PerfCountersTest, PerPacketScopesCountFramesSeparately) {
+    PerfCounters::enable();
+
+    for (int pkt = 0; pkt < 4; ++pkt) {
+        PerfScope scope(PerfStage::Assemble, false);
+    }
+    EXPECT_TRUE(PerfCounters::report().empty());
+
+    for (int pkt = 0; pkt < 4; ++pkt) {
+        PerfScope scope(PerfStage::Assemble, false);
+    }
+    PerfCounters::count_frame(PerfStage::Assemble);
+    std::string report = PerfCounters::report();
+    EXPECT_NE(report.find("assemble"), std::string::npos);
+    EXPECT_NE(report.find("1 frames"), std::string::npos);
+}
@@ -120,7 +120,8 @@ TEST(PacketAssembler, PurgesStaleFrames) {
     assembler.feed(pkt);
 
     // With 0ms threshold, should purge immediately
-    assembler.purge_stale(0);
+    EXPECT_EQ(assembler.purge_stale(0), 1u);
+    EXPECT_EQ(assembler.purge_stale(0), 0u);
 
     // Now send the remaining fragments — should not complete (frame was purged)
     for (uint16_t i = 1; i < 5; ++i) {
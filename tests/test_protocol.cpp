@@ -4,8 +4,8 @@
 using namespace lancast;
 
 TEST(ProtocolTest, HeaderSize) {
-    EXPECT_EQ(sizeof(PacketHeader), 16u);
-    EXPECT_EQ(HEADER_SIZE, 16u);
+    EXPECT_EQ(sizeof(PacketHeader), 18u);
+    EXPECT_EQ(HEADER_SIZE, 18u);
 }
 
 TEST(ProtocolTest, HeaderSerializeRoundtrip) {
@@ -14,13 +14,13 @@ TEST(ProtocolTest, HeaderSerializeRoundtrip) {
     h.version = PROTOCOL_VERSION;
     h.type = static_cast<uint8_t>(PacketType::VIDEO_DATA);
     h.flags = FLAG_KEYFRAME | FLAG_FIRST;
-    h.sequence = 12345;
+    h.sequence = 0x12345678;
     h.timestamp_us = 67890;
     h.frame_id = 42;
     h.frag_idx = 3;
     h.frag_total = 5;
 
-    uint8_t buf[16];
+    uint8_t buf[HEADER_SIZE];
     h.to_network(buf);
 
     PacketHeader h2 = PacketHeader::from_network(buf);
@@ -29,7 +29,7 @@ TEST(ProtocolTest, HeaderSerializeRoundtrip) {
     EXPECT_EQ(h2.version, PROTOCOL_VERSION);
     EXPECT_EQ(h2.type, static_cast<uint8_t>(PacketType::VIDEO_DATA));
     EXPECT_EQ(h2.flags, FLAG_KEYFRAME | FLAG_FIRST);
-    EXPECT_EQ(h2.sequence, 12345u);
+    EXPECT_EQ(h2.sequence, 0x12345678u);
     EXPECT_EQ(h2.timestamp_us, 67890u);
     EXPECT_EQ(h2.frame_id, 42u);
     EXPECT_EQ(h2.frag_idx, 3u);
@@ -95,5 +95,5 @@ TEST(ProtocolTest, TooShortPacket) {
 
 TEST(ProtocolTest, MaxFragmentData) {
     EXPECT_EQ(MAX_FRAGMENT_DATA, MAX_UDP_PAYLOAD - HEADER_SIZE);
-    EXPECT_EQ(MAX_FRAGMENT_DATA, 1184u);
+    EXPECT_EQ(MAX_FRAGMENT_DATA, 1182u);
 }
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "record/replay_ring.h"
+
+#include <chrono>
+
+using namespace lancast;
+using namespace std::chrono_literals;
+
+static EncodedPacket make_packet(FrameType type, uint16_t frame_id, int64_t pts_us, size_t size) {
+    EncodedPacket p;
+    p.type = type;
+    p.frame_id = frame_id;
+    p.pts_us = pts_us;
+    p.data.resize(size);
+    for (size_t i = 0; i < size; ++i) p.data[i] = static_cast<uint8_t>(i * 31 + frame_id);
+    return p;
+}
+
+static StreamConfig make_config(uint32_t width) {
+    StreamConfig c;
+    c.width = width;
+    c.height = width * 9 / 16;
+    c.fps = 30;
+    c.codec_data = {0, 0, 0, 1, 0x67, 0x42, static_cast<uint8_t>(width), 0, 0, 0, 1, 0x68};
+    return c;
+}
+
+// 30 fps video with a keyframe every `gop` frames
+static void fill(ReplayRing& ring, int frames, int gop, size_t size, const StreamConfig& config,
+                 uint16_t first_id = 0) {
+    for (int i = 0; i < frames; ++i) {
+        uint16_t id = static_cast<uint16_t>(first_id + i);
+        bool key = id % gop == 0;
+        auto p = make_packet(key ? FrameType::VideoKeyframe : FrameType::VideoPFrame, id,
+                             int64_t{id} * 33'333, size);
+        ASSERT_TRUE(ring.append(p, key ? &config : nullptr));
+    }
+}
+
+TEST(ReplayRingTest, RoundTripsPacketsAndKeyframeConfig) {
+    ReplayRing ring;
+    ASSERT_TRUE(ring.open(1 << 20));
+    auto config = make_config(1280);
+    fill(ring, 20, 10, 1000, config);
+    auto audio = make_packet(FrameType::Audio, 7, 123'456, 200);
+    ASSERT_TRUE(ring.append(audio));
+
+    EXPECT_EQ(ring.packet_count(), 21u);
+    EXPECT_EQ(ring.end(), 21u);
+    EXPECT_EQ(ring.bytes_used(), 20 * 1000 + 2 * config.codec_data.size() + 200);
+
+    ReplayRing::Frame frame;
+    ASSERT_TRUE(ring.read(10, frame));
+    EXPECT_EQ(frame.packet.type, FrameType::VideoKeyframe);
+    EXPECT_EQ(frame.packet.data, make_packet(FrameType::VideoKeyframe, 10, 0, 1000).data);
+    ASSERT_TRUE(frame.config.has_value());
+    EXPECT_EQ(frame.config->width, 1280u);
+    EXPECT_EQ(frame.config->codec_data, config.codec_data);
+
+    ASSERT_TRUE(ring.read(11, frame));
+    EXPECT_FALSE(frame.config.has_value());
+    ASSERT_TRUE(ring.read(20, frame));
+    EXPECT_EQ(frame.packet.type, FrameType::Audio);
+    EXPECT_EQ(frame.packet.pts_us, 123'456);
+    EXPECT_EQ(frame.packet.data, audio.data);
+    EXPECT_FALSE(ring.read(21, frame));
+}
+
+TEST(ReplayRingTest, OverwritesOldestAcrossLaps) {
+    ReplayRing ring;
+    const size_t capacity = 100'000;
+    ASSERT_TRUE(ring.open(capacity));
+    auto config = make_config(640);
+    // Sizes that don't divide the capacity, so every lap leaves a tail
+    for (int i = 0; i < 1000; ++i) {
+        size_t size = 1500 + (i * 977) % 3000;
+        bool key = i % 30 == 0;
+        auto p = make_packet(key ? FrameType::VideoKeyframe : FrameType::VideoPFrame,
+                             static_cast<uint16_t>(i), int64_t{i} * 33'333, size);
+        ASSERT_TRUE(ring.append(p, key ? &config : nullptr));
+        EXPECT_LE(ring.bytes_used(), capacity);
+    }
+
+    uint64_t end = ring.end();
+    uint64_t oldest = end - ring.packet_count();
+    EXPECT_GT(oldest, 0u);
+    ReplayRing::Frame frame;
+    EXPECT_FALSE(ring.read(oldest - 1, frame));
+    // Everything still held is intact
+    for (uint64_t i = oldest; i < end; ++i) {
+        ASSERT_TRUE(ring.read(i, frame)) << i;
+        auto expected = make_packet(frame.packet.type, frame.packet.frame_id, 0, 1500 + (i * 977) % 3000);
+        EXPECT_EQ(frame.packet.frame_id, static_cast<uint16_t>(i));
+        EXPECT_EQ(frame.packet.data, expected.data) << i;
+    }
+    // And it's most of the ring
+    EXPECT_GT(ring.bytes_used(), capacity * 85 / 100);
+}
+
+TEST(ReplayRingTest, StartsAtKeyframeCoveringSpan) {
+    ReplayRing ring;
+    ASSERT_TRUE(ring.open(1 << 20));
+    auto config = make_config(1920);
+    fill(ring, 180, 30, 500, config);  // Six seconds, a keyframe every second
+
+    // Newest frame at 179/30 s; 2.5 s back is 3.47 s, so the 3 s keyframe
+    auto start = ring.find_start(2500ms);
+    ASSERT_TRUE(start.has_value());
+    EXPECT_EQ(*start, 90u);
+    // Exactly on a keyframe
+    start = ring.find_start(std::chrono::microseconds(179 * 33'333 - 60 * 33'333));
+    ASSERT_TRUE(start.has_value());
+    EXPECT_EQ(*start, 60u);
+    // More than is held: the oldest keyframe
+    start = ring.find_start(60s);
+    ASSERT_TRUE(start.has_value());
+    EXPECT_EQ(*start, 0u);
+    EXPECT_NEAR(std::chrono::duration<double>(ring.span()).count(), 179 / 30.0, 0.01);
+}
+
+TEST(ReplayRingTest, KeyframeIndexFollowsOverwrites) {
+    ReplayRing ring;
+    ASSERT_TRUE(ring.open(50'000));
+    auto config = make_config(800);
+    fill(ring, 300, 30, 1000, config);  // Holds about 50 of them
+
+    auto start = ring.find_start(60s);
+    ASSERT_TRUE(start.has_value());
+    uint64_t oldest = ring.end() - ring.packet_count();
+    EXPECT_GE(*start, oldest);
+    ReplayRing::Frame frame;
+    ASSERT_TRUE(ring.read(*start, frame));
+    EXPECT_EQ(frame.packet.type, FrameType::VideoKeyframe);
+    EXPECT_TRUE(frame.config.has_value());
+    EXPECT_EQ(*start, 270u);
+}
+
+TEST(ReplayRingTest, RejectsWhatCannotBeStored) {
+    ReplayRing ring;
+    auto p = make_packet(FrameType::VideoPFrame, 1, 0, 100);
+    EXPECT_FALSE(ring.append(p));  // Not open
+    EXPECT_FALSE(ring.find_start(1s).has_value());
+
+    ASSERT_TRUE(ring.open(4096));
+    EXPECT_FALSE(ring.append(make_packet(FrameType::VideoPFrame, 1, 0, 5000)));
+    EXPECT_FALSE(ring.append(make_packet(FrameType::VideoKeyframe, 2, 0, 100)));  // No config
+    EXPECT_EQ(ring.packet_count(), 0u);
+    EXPECT_FALSE(ring.find_start(1s).has_value());  // No keyframe yet
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "net/server.h"
+#include "net/winsock_init.h"
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+static void send_control(UdpSocket& sock, PacketType type, uint16_t port) {
+    Packet pkt;
+    pkt.header.magic = PROTOCOL_MAGIC;
+    pkt.header.version = PROTOCOL_VERSION;
+    pkt.header.type = static_cast<uint8_t>(type);
+    sock.send_to(pkt.serialize(), {"127.0.0.1", port});
+}
+
+// Poll the server until pred() holds or the timeout expires
+template <typename Pred>
+static bool poll_until(Server& server, Pred pred, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        server.poll();
+        if (pred()) return true;
+    }
+    return pred();
+}
+
+TEST(ServerLivenessTest, SilentClientIsEvictedAndResumes) {
+    constexpr uint16_t port = 47321;
+    Server server(port);
+    Server::LivenessConfig liveness;
+    liveness.evict_after = std::chrono::milliseconds(300);
+    server.set_liveness_config(liveness);
+    ASSERT_TRUE(server.start());
+
+    int keyframe_requests = 0;
+    server.set_keyframe_callback([&](uint8_t) { keyframe_requests++; });
+
+    UdpSocket client;
+    send_control(client, PacketType::HELLO, port);
+    ASSERT_TRUE(poll_until(server, [&] { return server.client_count() == 1; },
+                           std::chrono::milliseconds(1000)));
+
+    // No traffic at all: evicted after evict_after
+    ASSERT_TRUE(poll_until(server, [&] { return server.client_count() == 0; },
+                           std::chrono::milliseconds(2000)));
+    EXPECT_EQ(server.stats().evictions, 1u);
+
+    // Any packet within the resume window brings it back with a fresh keyframe
+    keyframe_requests = 0;
+    send_control(client, PacketType::KEYFRAME_REQ, port);
+    ASSERT_TRUE(poll_until(server, [&] { return server.client_count() == 1; },
+                           std::chrono::milliseconds(1000)));
+    EXPECT_EQ(server.stats().resumptions, 1u);
+    EXPECT_GE(keyframe_requests, 1);
+
+    server.stop();
+}
+
+TEST(ServerLivenessTest, UnknownTrafficDoesNotResume) {
+    constexpr uint16_t port = 47322;
+    Server server(port);
+    ASSERT_TRUE(server.start());
+
+    UdpSocket stranger;
+    send_control(stranger, PacketType::KEYFRAME_REQ, port);
+    poll_until(server, [] { return false; }, std::chrono::milliseconds(200));
+    EXPECT_EQ(server.client_count(), 0u);
+    EXPECT_EQ(server.stats().resumptions, 0u);
+
+    server.stop();
+}
+
+TEST(ServerLivenessTest, SecondHostOnThePortIsRefused) {
+    constexpr uint16_t port = 47323;
+    {
+        Server first(port);
+        first.set_receive_shards(2);
+        ASSERT_TRUE(first.start());
+
+        // Neither a sharded host (which could join the SO_REUSEPORT group)
+        // nor a single-socket one gets to share the port
+        Server sharded(port);
+        sharded.set_receive_shards(2);
+        EXPECT_FALSE(sharded.start());
+        Server single(port);
+        EXPECT_FALSE(single.start());
+        EXPECT_TRUE(UdpSocket::port_in_use(port));
+        first.stop();
+    }
+    EXPECT_FALSE(UdpSocket::port_in_use(port));
+}
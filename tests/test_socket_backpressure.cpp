@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "net/socket.h"
+#include "net/winsock_init.h"
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+TEST(SocketBackpressureTest, FreshSocketIsWritable) {
+    UdpSocket sock;
+    ASSERT_TRUE(sock.is_valid());
+    EXPECT_TRUE(sock.wait_writable(100));
+    EXPECT_GT(sock.send_buffer_size(), 0);
+}
+
+TEST(SocketBackpressureTest, NonblockingFloodNeverStalls) {
+    UdpSocket rx;
+    ASSERT_TRUE(rx.bind(47331));
+    rx.set_recv_buffer(4096);  // Nobody reads: the receiver overflows immediately
+
+    UdpSocket tx;
+    tx.set_send_buffer(4096);
+    if (!tx.set_send_nonblocking(true)) GTEST_SKIP() << "No per-call nonblocking sends";
+    tx.enable_send_errors();
+
+    std::vector<uint8_t> data(1200, 0xAB);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 2000; ++i) {
+        ssize_t n = tx.send_to(data, {"127.0.0.1", 47331});
+        if (n < 0) {
+            EXPECT_TRUE(UdpSocket::last_send_error_transient());
+        } else {
+            EXPECT_EQ(n, static_cast<ssize_t>(data.size()));
+        }
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(2));
+
+    // Error-queue entries are discarded without timestamping enabled
+    std::vector<int64_t> delays;
+    EXPECT_EQ(tx.drain_tx_timestamps(delays), 0u);
+}
+
+TEST(SocketBackpressureTest, IcmpErrorNamesItsDestination) {
+    UdpSocket rx;
+    ASSERT_TRUE(rx.bind(47332));
+    rx.set_recv_timeout(500);
+
+    UdpSocket tx;
+    if (!tx.enable_send_errors()) GTEST_SKIP() << "No IP_RECVERR";
+
+    // Nothing listens on 47333: loopback answers with port unreachable
+    std::vector<uint8_t> data(100, 0x11);
+    ASSERT_EQ(tx.send_to(data, {"127.0.0.1", 47333}), 100);
+
+    std::vector<Endpoint> unreachable;
+    std::vector<int64_t> delays;
+    for (int attempt = 0; attempt < 50 && unreachable.empty(); ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        tx.drain_tx_timestamps(delays, &unreachable);
+    }
+    ASSERT_EQ(unreachable.size(), 1u);
+    EXPECT_EQ(unreachable[0].port, 47333);
+    EXPECT_EQ(unreachable[0].ip, "127.0.0.1");
+
+    // The pending error fails one send to a live destination, then clears
+    ssize_t n = tx.send_to(data, {"127.0.0.1", 47332});
+    if (n < 0) {
+        EXPECT_TRUE(UdpSocket::last_send_error_unreachable());
+        n = tx.send_to(data, {"127.0.0.1", 47332});
+    }
+    EXPECT_EQ(n, 100);
+    auto result = rx.recv_from();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->data, data);
+}
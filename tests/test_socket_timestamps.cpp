@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "net/socket.h"
+#include "net/winsock_init.h"
+#include "core/timing.h"
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+TEST(SocketTimestampTest, PlainSocketHasNoTimestamps) {
+    UdpSocket rx;
+    ASSERT_TRUE(rx.bind(47311));
+    rx.set_recv_timeout(500);
+
+    UdpSocket tx;
+    std::vector<uint8_t> data = {1, 2, 3};
+    ASSERT_EQ(tx.send_to(data, {"127.0.0.1", 47311}), 3);
+
+    auto result = rx.recv_from();
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->data, data);
+    EXPECT_EQ(result->kernel_rx_us, 0);
+
+    std::vector<int64_t> delays;
+    EXPECT_EQ(tx.drain_tx_timestamps(delays), 0u);
+}
+
+TEST(SocketTimestampTest, LoopbackRxAndTxTimestamps) {
+    UdpSocket rx;
+    ASSERT_TRUE(rx.bind(47312));
+    rx.set_recv_timeout(500);
+    UdpSocket tx;
+    if (!rx.enable_timestamping() || !tx.enable_timestamping()) {
+        GTEST_SKIP() << "SO_TIMESTAMPING not supported here";
+    }
+
+    int64_t before_us = steady_now_us();
+    std::vector<uint8_t> data(100, 0x5A);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(tx.send_to(data, {"127.0.0.1", 47312}), 100);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        auto result = rx.recv_from();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_EQ(result->data, data);
+        ASSERT_GT(result->kernel_rx_us, 0);
+        // Realtime -> steady conversion is only accurate to clock read skew
+        EXPECT_GE(result->kernel_rx_us, before_us - 1000);
+        EXPECT_LE(result->kernel_rx_us, steady_now_us() + 1000);
+    }
+
+    std::vector<int64_t> delays;
+    for (int attempt = 0; attempt < 50 && delays.size() < 4; ++attempt) {
+        tx.drain_tx_timestamps(delays);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    ASSERT_EQ(delays.size(), 4u);
+    for (int64_t d : delays) {
+        EXPECT_GE(d, 0);
+        EXPECT_LT(d, 1'000'000);
+    }
+}
+
+TEST(SocketTimestampTest, RxOnlyLeavesErrorQueueEmpty) {
+    UdpSocket rx;
+    ASSERT_TRUE(rx.bind(47313));
+    rx.set_recv_timeout(500);
+    UdpSocket tx;
+    if (!rx.enable_timestamping(false) || !tx.enable_timestamping(false)) {
+        GTEST_SKIP() << "SO_TIMESTAMPING not supported here";
+    }
+    EXPECT_TRUE(tx.timestamping_enabled());
+    EXPECT_FALSE(tx.tx_timestamping_enabled());
+
+    std::vector<uint8_t> data(100, 0x3C);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(tx.send_to(data, {"127.0.0.1", 47313}), 100);
+    }
+    for (int i = 0; i < 4; ++i) {
+        auto result = rx.recv_from();
+        ASSERT_TRUE(result.has_value());
+        EXPECT_GT(result->kernel_rx_us, 0);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<int64_t> delays;
+    EXPECT_EQ(tx.drain_tx_timestamps(delays), 0u);
+}
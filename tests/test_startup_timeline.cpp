@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "core/startup_timeline.h"
+#include "core/jthread.h"
+
+#include <thread>
+#include <vector>
+
+using namespace lancast;
+using namespace std::chrono_literals;
+
+TEST(StartupTimelineTest, PhasesAreRelativeToOriginAndSorted) {
+    auto origin = StartupTimeline::Clock::now();
+    StartupTimeline timeline(origin);
+    timeline.record("encoder", origin + 20ms, origin + 50ms);
+    timeline.record("capture", origin + 5ms, origin + 20ms);
+    timeline.record("audio", origin + 5ms, origin + 40ms);  // Overlaps both
+
+    auto phases = timeline.phases();
+    ASSERT_EQ(phases.size(), 3u);
+    EXPECT_EQ(phases[0].name, "capture");  // Ties keep recording order
+    EXPECT_EQ(phases[1].name, "audio");
+    EXPECT_EQ(phases[2].name, "encoder");
+    EXPECT_NEAR(phases[2].start_ms, 20.0, 1e-6);
+    EXPECT_NEAR(phases[2].end_ms, 50.0, 1e-6);
+    EXPECT_NEAR(*timeline.at("audio"), 40.0, 1e-6);
+    EXPECT_FALSE(timeline.at("decoder").has_value());
+    EXPECT_EQ(timeline.summary(), "capture 5.0-20.0, audio 5.0-40.0, encoder 20.0-50.0 ms");
+}
+
+TEST(StartupTimelineTest, MilestonesCountOnce) {
+    StartupTimeline timeline;
+    EXPECT_TRUE(timeline.mark_once("first_frame"));
+    auto first = timeline.at("first_frame");
+    ASSERT_TRUE(first.has_value());
+    EXPECT_FALSE(timeline.mark_once("first_frame"));
+    EXPECT_EQ(timeline.at("first_frame"), first);
+    EXPECT_EQ(timeline.phases().size(), 1u);
+    EXPECT_NE(timeline.summary().find("first_frame @"), std::string::npos);
+}
+
+TEST(StartupTimelineTest, ScopesRecordFromManyThreads) {
+    StartupTimeline timeline;
+    {
+        std::vector<lancast::jthread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&timeline](lancast::stop_token) {
+                StartupTimeline::Scope scope(timeline, "setup");
+                std::this_thread::sleep_for(2ms);
+            });
+        }
+    }
+    auto phases = timeline.phases();
+    ASSERT_EQ(phases.size(), 4u);
+    for (const auto& p : phases) {
+        EXPECT_EQ(p.name, "setup");
+        EXPECT_GE(p.end_ms - p.start_ms, 1.0);
+    }
+}
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "net/client.h"
+#include "net/server.h"
+#include "net/winsock_init.h"
+#include "stream_test_helpers.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace lancast;
+using namespace lancast::test;
+
+#ifdef _WIN32
+static WinsockInit winsock;
+#endif
+
+TEST(StreamUpdateTest, ClientFollowsMidStreamSwitch) {
+    constexpr uint16_t port = 47341;
+    Server server(port);
+    server.set_stream_config(make_config(1920, 1080, 60, 0x01));
+    ASSERT_TRUE(server.start());
+
+    std::atomic<bool> polling{true};
+    std::thread poller([&] { while (polling) server.poll(); });
+
+    Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", port));
+    EXPECT_EQ(client.stream_config().width, 1920u);
+    uint32_t generation = client.config_generation();
+
+    // Wait until the probe has settled and the client receives media
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    bool admitted = false;
+    while (!admitted && std::chrono::steady_clock::now() < deadline) {
+        server.broadcast(keyframe(0, 1));
+        admitted = receive_video(client, std::chrono::milliseconds(100)).has_value();
+    }
+    ASSERT_TRUE(admitted);
+    // The config repeated ahead of each keyframe is unchanged
+    EXPECT_EQ(client.config_generation(), generation);
+
+    server.update_stream_config(make_config(1280, 720, 30, 0x02));
+    server.broadcast(keyframe(0, 2));
+    ASSERT_TRUE(receive_video(client, std::chrono::milliseconds(1000)).has_value());
+
+    EXPECT_EQ(client.config_generation(), generation + 1);
+    auto config = client.stream_config();
+    EXPECT_EQ(config.width, 1280u);
+    EXPECT_EQ(config.height, 720u);
+    EXPECT_EQ(config.fps, 30u);
+    ASSERT_EQ(config.codec_data.size(), 6u);
+    EXPECT_EQ(config.codec_data.back(), 0x02);
+    EXPECT_TRUE(config.region.full());
+
+    // Zooming into a region at the same size is a change too
+    auto zoomed = make_config(1280, 720, 30, 0x02);
+    zoomed.region = {16384, 16384, 32768, 32768};
+    server.update_stream_config(zoomed);
+    server.broadcast(keyframe(0, 3));
+    ASSERT_TRUE(receive_video(client, std::chrono::milliseconds(1000)).has_value());
+    EXPECT_EQ(client.config_generation(), generation + 2);
+    EXPECT_EQ(client.stream_config().region, zoomed.region);
+
+    client.disconnect();
+    polling = false;
+    poller.join();
+    server.stop();
+}
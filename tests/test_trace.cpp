@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "core/trace.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace lancast;
+
+static std::string read_file(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static size_t count_occurrences(const std::string& haystack, const std::string& needle) {
+    size_t count = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos;
+         pos = haystack.find(needle, pos + needle.size())) {
+        ++count;
+    }
+    return count;
+}
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+// Must run first: the tracer is process-global and starts disabled
+TEST(TracerTest, DisabledByDefault) {
+    EXPECT_FALSE(Tracer::enabled());
+    {
+        TRACE_SCOPE("noop", 1);
+    }
+    EXPECT_FALSE(Tracer::dump(temp_path("lancast_trace_disabled.json")));
+}
+
+TEST(TracerTest, RecordsBeginEndAndComplete) {
+    std::string path = temp_path("lancast_trace_basic.json");
+    Tracer::enable(path, 64);
+    ASSERT_TRUE(Tracer::enabled());
+
+    Tracer::set_thread_name("test_main");
+    {
+        TRACE_SCOPE("encode", 7);
+    }
+    Tracer::complete("capture", 7, 1000, 1500);
+
+    ASSERT_TRUE(Tracer::dump());
+    std::string json = read_file(path);
+
+    EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"encode\",\"cat\":\"lancast\",\"ph\":\"B\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"encode\",\"cat\":\"lancast\",\"ph\":\"E\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\":\"X\",\"ts\":1000,\"dur\":500"), std::string::npos);
+    EXPECT_NE(json.find("\"args\":{\"name\":\"test_main\"}"), std::string::npos);
+    EXPECT_EQ(count_occurrences(json, "\"frame_id\":7"), 3u);
+
+    std::filesystem::remove(path);
+}
+
+TEST(TracerTest, RingKeepsMostRecentEvents) {
+    std::string path = temp_path("lancast_trace_wrap.json");
+    Tracer::enable(path, 8);
+
+    for (uint32_t i = 0; i < 20; ++i) {
+        Tracer::complete("stage", i, 0, 1);
+    }
+
+    ASSERT_TRUE(Tracer::dump());
+    std::string json = read_file(path);
+
+    EXPECT_EQ(count_occurrences(json, "\"name\":\"stage\""), 8u);
+    EXPECT_EQ(json.find("\"frame_id\":11}"), std::string::npos);
+    EXPECT_NE(json.find("\"frame_id\":12}"), std::string::npos);
+    EXPECT_NE(json.find("\"frame_id\":19}"), std::string::npos);
+
+    std::filesystem::remove(path);
+}
+
+TEST(TracerTest, DumpRequestIsConsumedOnce) {
+    std::string path = temp_path("lancast_trace_request.json");
+    Tracer::enable(path, 16);
+
+    EXPECT_FALSE(Tracer::dump_if_requested());
+    Tracer::request_dump();
+    EXPECT_TRUE(Tracer::dump_if_requested());
+    EXPECT_FALSE(Tracer::dump_if_requested());
+    EXPECT_TRUE(std::filesystem::exists(path));
+
+    std::filesystem::remove(path);
+}
+
+TEST(TracerTest, ConcurrentWriters) {
+    std::string path = temp_path("lancast_trace_threads.json");
+    Tracer::enable(path, 1024);
+
+    std::thread a([] { for (uint32_t i = 0; i < 100; ++i) { TRACE_SCOPE("a", i); } });
+    std::thread b([] { for (uint32_t i = 0; i < 100; ++i) { TRACE_SCOPE("b", i); } });
+    a.join();
+    b.join();
+
+    ASSERT_TRUE(Tracer::dump());
+    std::string json = read_file(path);
+    EXPECT_EQ(count_occurrences(json, "\"name\":\"a\""), 200u);
+    EXPECT_EQ(count_occurrences(json, "\"name\":\"b\""), 200u);
+
+    std::filesystem::remove(path);
+}
@@ -143,3 +143,52 @@ TEST(VideoCodec, MultipleFrames) {
     encoder.shutdown();
     decoder.shutdown();
 }
+
+TEST(VideoCodec, StaticInputRefinesThenStops) {
+    const uint32_t w = 320, h = 240, fps = 30, bitrate = 1000000;
+
+    VideoEncoder encoder;
+    ASSERT_TRUE(encoder.init(w, h, fps, bitrate));
+    encoder.set_static_refinement(true);
+
+    auto test_frame = make_test_frame(w, h);
+
+    // A still picture is sent, refined for a bounded run, then mostly not sent
+    int sent = 0;
+    for (int i = 0; i < 30; ++i) {
+        test_frame.pts_us = i * 33333;
+        auto encoded = encoder.encode(test_frame);
+        if (!encoded) break;
+        sent++;
+    }
+    EXPECT_GT(sent, 3) << "Refinement frames should follow the static ones";
+    EXPECT_LT(sent, 30) << "Converged static input should stop producing frames";
+    test_frame.pts_us = 30 * 33333;
+    EXPECT_FALSE(encoder.encode(test_frame).has_value());
+
+    // Except for a near-empty refresh every half second
+    int refreshes = 0;
+    for (int i = 0; i < 30; ++i) {
+        auto refresh = encoder.encode(test_frame);
+        if (!refresh) continue;
+        refreshes++;
+        EXPECT_EQ(refresh->type, FrameType::VideoPFrame);
+        EXPECT_LT(refresh->data.size(), bitrate / 8 / fps / 16);
+    }
+    EXPECT_EQ(refreshes, 2);
+
+    // A change brings frames back
+    test_frame.data[0] ^= 0xFF;
+    auto changed = encoder.encode(test_frame);
+    ASSERT_TRUE(changed.has_value());
+    EXPECT_EQ(changed->type, FrameType::VideoPFrame);
+
+    // So does a keyframe request on unchanged input
+    for (int i = 0; i < 30 && encoder.encode(test_frame); ++i) {}
+    encoder.request_keyframe();
+    auto keyframe = encoder.encode(test_frame);
+    ASSERT_TRUE(keyframe.has_value());
+    EXPECT_EQ(keyframe->type, FrameType::VideoKeyframe);
+
+    encoder.shutdown();
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "net/viewport.h"
+
+using namespace lancast;
+
+static ViewportRequest viewer(uint32_t width, uint32_t height, SourceRegion region = {}) {
+    ViewportRequest v;
+    v.drawable_width = width;
+    v.drawable_height = height;
+    v.region = region;
+    return v;
+}
+
+TEST(ViewportTest, RegionPixelsRoundsOutwards) {
+    PixelRect full = region_pixels({}, 1920, 1080);
+    EXPECT_EQ(full.width, 1920u);
+    EXPECT_EQ(full.height, 1080u);
+
+    // Right half, with the 65535 width that stands in for "to the edge"
+    PixelRect half = region_pixels({32768, 0, 32767, 65535}, 1920, 1080);
+    EXPECT_EQ(half.x, 960u);
+    EXPECT_EQ(half.width, 960u);
+    EXPECT_EQ(half.height, 1080u);
+
+    // Degenerate regions still cover 2x2 inside the source
+    PixelRect tiny = region_pixels({65535, 65535, 1, 1}, 1920, 1080);
+    EXPECT_EQ(tiny.x + tiny.width, 1920u);
+    EXPECT_EQ(tiny.y + tiny.height, 1080u);
+    EXPECT_GE(tiny.width, 2u);
+}
+
+TEST(ViewportTest, NoReportsKeepsFullSourceAtCap) {
+    auto format = viewport_format({}, 1920, 1080, 1920, 1080);
+    EXPECT_TRUE(format.region.full());
+    EXPECT_EQ(format.width, 1920u);
+    EXPECT_EQ(format.height, 1080u);
+
+    // A viewer that hasn't reported wants everything
+    format = viewport_format({viewer(640, 360), viewer(0, 0)}, 1920, 1080, 1280, 720);
+    EXPECT_EQ(format.width, 1280u);
+    EXPECT_EQ(format.height, 720u);
+}
+
+TEST(ViewportTest, SmallWindowLowersResolution) {
+    auto format = viewport_format({viewer(960, 540)}, 1920, 1080, 1920, 1080);
+    EXPECT_TRUE(format.region.full());
+    EXPECT_EQ(format.width, 960u);
+    EXPECT_EQ(format.height, 540u);
+
+    // The largest window wins
+    format = viewport_format({viewer(960, 540), viewer(1280, 720)}, 1920, 1080, 1920, 1080);
+    EXPECT_EQ(format.width, 1280u);
+    EXPECT_EQ(format.height, 720u);
+}
+
+TEST(ViewportTest, ZoomCapturesRegionWithoutUpscaling) {
+    // Top-left quarter in a 1920x1080 window: 960x540 source pixels, shown 1:1
+    SourceRegion quarter{0, 0, 32768, 32768};
+    auto format = viewport_format({viewer(1920, 1080, quarter)}, 1920, 1080, 1920, 1080);
+    EXPECT_EQ(format.region, quarter);
+    EXPECT_EQ(format.width, 960u);
+    EXPECT_EQ(format.height, 540u);
+
+    // The same zoom on a 4K source fills the window at full detail
+    format = viewport_format({viewer(1920, 1080, quarter)}, 3840, 2160, 3840, 2160);
+    EXPECT_EQ(format.width, 1920u);
+    EXPECT_EQ(format.height, 1080u);
+}
+
+TEST(ViewportTest, UnionOfRegionsSnapsToGrid) {
+    SourceRegion left{1000, 1000, 10000, 10000};
+    SourceRegion right{40000, 20000, 10000, 10000};
+    auto region = union_regions({viewer(800, 600, left), viewer(800, 600, right)});
+    EXPECT_EQ(region.x, 0u);
+    EXPECT_EQ(region.y, 0u);
+    EXPECT_EQ(region.x + region.width, 50176u);   // 49 * 1024
+    EXPECT_EQ(region.y + region.height, 30720u);  // 30 * 1024
+
+    // Any full-source viewer means the full source
+    EXPECT_TRUE(union_regions({viewer(800, 600, left), viewer(800, 600)}).full());
+}
+
+TEST(ViewportTest, OperatorCapShrinksUniformly) {
+    SourceRegion quarter{0, 0, 32768, 32768};
+    auto format = viewport_format({viewer(3840, 2160, quarter)}, 3840, 2160, 1280, 720);
+    EXPECT_EQ(format.width, 1280u);
+    EXPECT_EQ(format.height, 720u);
+}
+
+TEST(ViewportTest, PayloadRoundTrip) {
+    auto request = viewport_request(viewport_payload(viewer(1280, 800, {1024, 2048, 4096, 8192})));
+    EXPECT_EQ(request.drawable_width, 1280u);
+    EXPECT_EQ(request.drawable_height, 800u);
+    EXPECT_EQ(request.region, (SourceRegion{1024, 2048, 4096, 8192}));
+}
@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include "net/xdp_receiver.h"
+#include "net/packet_assembler.h"
+#include "net/packet_fragmenter.h"
+#include "net/socket.h"
+#include "core/jthread.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+using namespace lancast;
+
+// Ethernet + IPv4 (no options) + UDP around payload
+static std::vector<uint8_t> udp_frame(const std::vector<uint8_t>& payload, uint16_t src_port, uint16_t dst_port) {
+    std::vector<uint8_t> f(14 + 20 + 8 + payload.size(), 0);
+    f[12] = 0x08;
+    f[13] = 0x00;
+    uint8_t* ip = f.data() + 14;
+    ip[0] = 0x45;
+    size_t ip_len = 20 + 8 + payload.size();
+    ip[2] = static_cast<uint8_t>(ip_len >> 8);
+    ip[3] = static_cast<uint8_t>(ip_len);
+    ip[6] = 0x40;  // DF
+    ip[8] = 64;
+    ip[9] = 17;
+    ip[12] = 10; ip[13] = 0; ip[14] = 0; ip[15] = 2;
+    ip[16] = 10; ip[17] = 0; ip[18] = 0; ip[19] = 1;
+    uint8_t* udp = ip + 20;
+    udp[0] = static_cast<uint8_t>(src_port >> 8);
+    udp[1] = static_cast<uint8_t>(src_port);
+    udp[2] = static_cast<uint8_t>(dst_port >> 8);
+    udp[3] = static_cast<uint8_t>(dst_port);
+    size_t udp_len = 8 + payload.size();
+    udp[4] = static_cast<uint8_t>(udp_len >> 8);
+    udp[5] = static_cast<uint8_t>(udp_len);
+    std::copy(payload.begin(), payload.end(), udp + 8);
+    return f;
+}
+
+TEST(XdpReceiverTest, ParsesUdpPayloadInPlace) {
+    std::vector<uint8_t> payload = {1, 2, 3, 4, 5, 6, 7};
+    auto frame = udp_frame(payload, 40000, DEFAULT_PORT);
+    // Ethernet minimum-size padding must not end up in the payload
+    frame.resize(60, 0xee);
+
+    XdpReceiver::Datagram d;
+    ASSERT_TRUE(XdpReceiver::parse_frame(frame.data(), frame.size(), d));
+    EXPECT_EQ(d.data, frame.data() + 42);
+    ASSERT_EQ(d.size, payload.size());
+    EXPECT_TRUE(std::equal(payload.begin(), payload.end(), d.data));
+    EXPECT_EQ(d.source_port, 40000);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(&d.source_addr);
+    EXPECT_EQ(src[0], 10);
+    EXPECT_EQ(src[3], 2);
+}
+
+TEST(XdpReceiverTest, RejectsWhatItCannotHandOut) {
+    std::vector<uint8_t> payload(32, 0xab);
+    XdpReceiver::Datagram d;
+
+    auto frame = udp_frame(payload, 1, 2);
+    frame[23] = 6;  // TCP
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), frame.size(), d));
+
+    frame = udp_frame(payload, 1, 2);
+    frame[12] = 0x86;  // IPv6
+    frame[13] = 0xdd;
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), frame.size(), d));
+
+    frame = udp_frame(payload, 1, 2);
+    frame[14 + 6] = 0x20;  // More fragments
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), frame.size(), d));
+
+    frame = udp_frame(payload, 1, 2);
+    frame[14 + 7] = 0x10;  // Non-zero fragment offset
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), frame.size(), d));
+
+    frame = udp_frame(payload, 1, 2);
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), frame.size() - 1, d));  // UDP length past the end
+    EXPECT_FALSE(XdpReceiver::parse_frame(frame.data(), 40, d));
+}
+
+TEST(XdpReceiverTest, AssemblerFeedsFromReceiveBuffer) {
+    PacketFragmenter fragmenter;
+    PacketAssembler assembler;
+
+    EncodedPacket original;
+    original.frame_id = 9;
+    original.type = FrameType::VideoKeyframe;
+    original.data.resize(5000);
+    for (size_t i = 0; i < original.data.size(); ++i) original.data[i] = static_cast<uint8_t>(i * 7);
+
+    uint32_t seq = 0;
+    std::optional<EncodedPacket> result;
+    for (const auto& pkt : fragmenter.fragment(original, seq)) {
+        auto wire = pkt.serialize();
+        auto header = PacketHeader::from_network(wire.data());
+        result = assembler.feed(header, wire.data() + HEADER_SIZE, wire.size() - HEADER_SIZE);
+    }
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->data, original.data);
+    EXPECT_EQ(result->type, FrameType::VideoKeyframe);
+}
+
+#if defined(__linux__)
+
+// veth pair with the far end in its own network namespace, so traffic
+// between them really crosses lxdp0's receive path
+class VethNamespace {
+public:
+    VethNamespace() {
+        cleanup();
+        ok_ = run("ip netns add lancast_xdp") &&
+              run("ip link add lxdp0 type veth peer name lxdp1") &&
+              run("ip link set lxdp1 netns lancast_xdp") &&
+              run("ip addr add 10.77.0.1/24 dev lxdp0") &&
+              run("ip link set lxdp0 up") &&
+              run("ip netns exec lancast_xdp ip addr add 10.77.0.2/24 dev lxdp1") &&
+              run("ip netns exec lancast_xdp ip link set lxdp1 up");
+    }
+    ~VethNamespace() { cleanup(); }
+
+    bool ok() const { return ok_; }
+
+    // Moves the calling thread into the namespace
+    static bool enter() {
+        int fd = open("/var/run/netns/lancast_xdp", O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool entered = setns(fd, CLONE_NEWNET) == 0;
+        close(fd);
+        return entered;
+    }
+
+private:
+    static bool run(const std::string& cmd) {
+        return std::system((cmd + " >/dev/null 2>&1").c_str()) == 0;
+    }
+    static void cleanup() {
+        run("ip link del lxdp0");
+        run("ip netns del lancast_xdp");
+    }
+
+    bool ok_ = false;
+};
+
+TEST(XdpReceiverTest, ReceivesFramesOverVethPair) {
+    if (geteuid() != 0) GTEST_SKIP() << "Needs root for netns, veth and XDP";
+    VethNamespace ns;
+    if (!ns.ok()) GTEST_SKIP() << "Could not create the veth pair";
+
+    constexpr uint16_t port = DEFAULT_PORT + 40;
+    UdpSocket socket;  // Reserves the port; XDP takes the traffic before it
+    ASSERT_TRUE(socket.bind(port));
+    XdpReceiver xdp;
+    if (!xdp.open("lxdp0", port)) GTEST_SKIP() << "AF_XDP unavailable on this kernel";
+    EXPECT_GE(xdp.queue_count(), 1u);
+
+    constexpr int FRAME_COUNT = 40;
+    std::map<uint16_t, std::vector<uint8_t>> sent;
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        std::vector<uint8_t> data(200 + i * 1500);
+        for (size_t b = 0; b < data.size(); ++b) data[b] = static_cast<uint8_t>(b + i);
+        sent[static_cast<uint16_t>(i)] = std::move(data);
+    }
+
+    std::atomic<bool> sender_ok{false};
+    lancast::jthread sender([&](lancast::stop_token) {
+        if (!VethNamespace::enter()) return;
+        UdpSocket tx;
+        PacketFragmenter fragmenter;
+        uint32_t seq = 0;
+        Endpoint dest{"10.77.0.1", port};
+        for (const auto& [id, data] : sent) {
+            EncodedPacket frame;
+            frame.frame_id = id;
+            frame.type = FrameType::VideoPFrame;
+            frame.data = data;
+            for (const auto& pkt : fragmenter.fragment(frame, seq)) {
+                if (tx.send_to(pkt.serialize(), dest) < 0) return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        sender_ok = true;
+    });
+
+    PacketAssembler assembler;
+    std::map<uint16_t, std::vector<uint8_t>> received;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (received.size() < sent.size() && std::chrono::steady_clock::now() < deadline) {
+        xdp.poll(50, [&](const XdpReceiver::Datagram& d) {
+            if (d.size < HEADER_SIZE) return;
+            auto header = PacketHeader::from_network(d.data);
+            if (auto frame = assembler.feed(header, d.data + HEADER_SIZE, d.size - HEADER_SIZE)) {
+                received[frame->frame_id] = std::move(frame->data);
+            }
+        });
+    }
+    sender.join();
+    ASSERT_TRUE(sender_ok.load());
+
+    EXPECT_EQ(received.size(), sent.size());
+    for (const auto& [id, data] : received) {
+        EXPECT_EQ(data, sent[id]) << "frame " << id;
+    }
+
+    // Nothing for the port went up the stack
+    socket.set_nonblocking(true);
+    EXPECT_FALSE(socket.recv_from().has_value());
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "render/yuv_converter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace lancast;
+
+static RawVideoFrame make_frame(uint32_t w, uint32_t h, uint8_t y, uint8_t u, uint8_t v) {
+    RawVideoFrame frame;
+    frame.width = w;
+    frame.height = h;
+    size_t y_size = static_cast<size_t>(w) * h;
+    frame.data.assign(y_size + y_size / 2, y);
+    std::fill(frame.data.begin() + y_size, frame.data.begin() + y_size + y_size / 4, u);
+    std::fill(frame.data.begin() + y_size + y_size / 4, frame.data.end(), v);
+    return frame;
+}
+
+static RawVideoFrame make_noise_frame(uint32_t w, uint32_t h) {
+    RawVideoFrame frame = make_frame(w, h, 0, 0, 0);
+    uint32_t state = 12345;
+    for (auto& b : frame.data) {
+        state = state * 1664525u + 1013904223u;
+        b = static_cast<uint8_t>(state >> 24);
+    }
+    return frame;
+}
+
+// Floating-point BT.601 limited range, the reference for the fixed-point path
+static void reference_bgr(uint8_t y, uint8_t u, uint8_t v, int out[3]) {
+    double c = 1.164383 * (y - 16);
+    out[2] = static_cast<int>(c + 1.596027 * (v - 128) + 0.5);
+    out[1] = static_cast<int>(c - 0.391762 * (u - 128) - 0.812968 * (v - 128) + 0.5);
+    out[0] = static_cast<int>(c + 2.017232 * (u - 128) + 0.5);
+    for (int i = 0; i < 3; ++i) out[i] = std::min(std::max(out[i], 0), 255);
+}
+
+TEST(YuvConverterTest, MatchesBt601WithinRounding) {
+    const uint8_t samples[][3] = {
+        {16, 128, 128}, {235, 128, 128}, {128, 128, 128}, {81, 90, 240},
+        {145, 54, 34}, {41, 240, 110}, {0, 0, 0}, {255, 255, 255},
+    };
+    YuvConverter converter(1);
+    for (const auto& s : samples) {
+        // 18 wide covers both the 8-pixel SIMD body and the scalar tail
+        auto frame = make_frame(18, 2, s[0], s[1], s[2]);
+        std::vector<uint8_t> out(18 * 2 * 4);
+        ASSERT_TRUE(converter.convert(frame, {0, 0, 18, 2}, out.data(), 18 * 4, 18, 2));
+        int expected[3];
+        reference_bgr(s[0], s[1], s[2], expected);
+        for (size_t px = 0; px < 18 * 2; ++px) {
+            for (int c = 0; c < 3; ++c) {
+                EXPECT_LE(std::abs(out[px * 4 + c] - expected[c]), 2)
+                    << "yuv " << int(s[0]) << "," << int(s[1]) << "," << int(s[2]) << " pixel " << px << " channel " << c;
+            }
+            EXPECT_EQ(out[px * 4 + 3], 255);
+        }
+    }
+    // Black and white land exactly on the ends of the range
+    auto white = make_frame(8, 2, 235, 128, 128);
+    std::vector<uint8_t> out(8 * 2 * 4);
+    ASSERT_TRUE(converter.convert(white, {0, 0, 8, 2}, out.data(), 8 * 4, 8, 2));
+    EXPECT_EQ(out[0], 255);
+    EXPECT_EQ(out[1], 255);
+    EXPECT_EQ(out[2], 255);
+}
+
+TEST(YuvConverterTest, ScalesAndCropsUniformContent) {
+    // Left half one colour, right half another; a crop of the right half
+    // scaled to any size shows only the second colour
+    const uint32_t w = 64, h = 32;
+    auto frame = make_frame(w, h, 200, 100, 150);
+    for (uint32_t row = 0; row < h; ++row) {
+        for (uint32_t col = w / 2; col < w; ++col) frame.data[row * w + col] = 50;
+    }
+    uint8_t* u = frame.data.data() + w * h;
+    uint8_t* v = u + (w / 2) * (h / 2);
+    for (uint32_t row = 0; row < h / 2; ++row) {
+        for (uint32_t col = w / 4; col < w / 2; ++col) {
+            u[row * (w / 2) + col] = 128;
+            v[row * (w / 2) + col] = 128;
+        }
+    }
+    int expected[3];
+    reference_bgr(50, 128, 128, expected);
+
+    YuvConverter converter(1);
+    for (auto [dw, dh] : {std::pair<uint32_t, uint32_t>{7, 5}, {32, 32}, {100, 77}}) {
+        std::vector<uint8_t> out(static_cast<size_t>(dw) * dh * 4);
+        // Keep clear of the edge, where bilinear chroma still reads across it
+        ASSERT_TRUE(converter.convert(frame, {w / 2 + 2, 0, w / 2 - 2, h}, out.data(), dw * 4, dw, dh));
+        for (size_t px = 0; px < static_cast<size_t>(dw) * dh; ++px) {
+            for (int c = 0; c < 3; ++c) {
+                ASSERT_LE(std::abs(out[px * 4 + c] - expected[c]), 2) << dw << "x" << dh << " pixel " << px;
+            }
+        }
+    }
+}
+
+TEST(YuvConverterTest, RowBandsMatchSingleThread) {
+    auto frame = make_noise_frame(1280, 720);
+    const uint32_t dw = 1000, dh = 563;
+    const int pitch = dw * 4 + 64;  // Wider than the row, as locked textures can be
+    std::vector<uint8_t> single(static_cast<size_t>(pitch) * dh, 0);
+    std::vector<uint8_t> banded(static_cast<size_t>(pitch) * dh, 0);
+
+    YuvConverter one(1);
+    YuvConverter four(4);
+    EXPECT_EQ(four.threads(), 4u);
+    PixelRect src{100, 50, 1000, 600};
+    ASSERT_TRUE(one.convert(frame, src, single.data(), pitch, dw, dh));
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(four.convert(frame, src, banded.data(), pitch, dw, dh));
+        EXPECT_EQ(single, banded);
+    }
+}
+
+TEST(YuvConverterTest, RejectsBadInput) {
+    YuvConverter converter(1);
+    auto frame = make_frame(16, 16, 16, 128, 128);
+    std::vector<uint8_t> out(16 * 16 * 4);
+    EXPECT_FALSE(converter.convert(frame, {8, 0, 16, 16}, out.data(), 16 * 4, 16, 16));
+    EXPECT_FALSE(converter.convert(frame, {0, 0, 16, 16}, out.data(), 8, 16, 16));
+    frame.data.resize(100);
+    EXPECT_FALSE(converter.convert(frame, {0, 0, 16, 16}, out.data(), 16 * 4, 16, 16));
+}